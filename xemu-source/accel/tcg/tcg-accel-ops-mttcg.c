@@ -31,36 +31,13 @@
 #include "qemu/main-loop.h"
 #include "qemu/notify.h"
 #include "qemu/guest-random.h"
+#include "qemu/thread-placement.h"
 #include "exec/exec-all.h"
 #include "hw/boards.h"
 #include "tcg/startup.h"
 #include "tcg-accel-ops.h"
 #include "tcg-accel-ops-mttcg.h"
 
-/*
- * CPU Affinity for vCPU thread
- * Set XEMU_VCPU_AFFINITY=N to pin the Xbox CPU emulation thread to core N
- * Example: XEMU_VCPU_AFFINITY=0 pins to core 0
- */
-static int vcpu_affinity_core = -1;
-static bool vcpu_affinity_initialized = false;
-
-static void mttcg_init_vcpu_affinity(void)
-{
-    const char *env;
-
-    if (vcpu_affinity_initialized) {
-        return;
-    }
-    vcpu_affinity_initialized = true;
-
-    env = getenv("XEMU_VCPU_AFFINITY");
-    if (env) {
-        vcpu_affinity_core = atoi(env);
-        fprintf(stderr, "xemu: vCPU affinity set to core %d (MTTCG mode)\n", vcpu_affinity_core);
-    }
-}
-
 typedef struct MttcgForceRcuNotifier {
     Notifier notifier;
     CPUState *cpu;
@@ -100,6 +77,7 @@ static void *mttcg_cpu_thread_fn(void *arg)
     force_rcu.cpu = cpu;
     rcu_add_force_rcu_notifier(&force_rcu.notifier);
     tcg_register_thread();
+    thread_placement_enter(THREAD_CLASS_VCPU, cpu->cpu_index);
 
     bql_lock();
     qemu_thread_get_self(cpu->thread);
@@ -147,6 +125,7 @@ static void *mttcg_cpu_thread_fn(void *arg)
     bql_unlock();
     rcu_remove_force_rcu_notifier(&force_rcu.notifier);
     rcu_unregister_thread();
+    thread_placement_leave();
     return NULL;
 }
 
@@ -162,26 +141,10 @@ void mttcg_start_vcpu_thread(CPUState *cpu)
     g_assert(tcg_enabled());
     tcg_cpu_init_cflags(cpu, current_machine->smp.max_cpus > 1);
 
-    /* Check for CPU affinity environment variable */
-    mttcg_init_vcpu_affinity();
-
     /* create a thread per vCPU with TCG (MTTCG) */
     snprintf(thread_name, VCPU_THREAD_NAME_SIZE, "CPU %d/TCG",
              cpu->cpu_index);
 
     qemu_thread_create(cpu->thread, thread_name, mttcg_cpu_thread_fn,
                        cpu, QEMU_THREAD_JOINABLE);
-
-    /* Pin vCPU thread to specified core if requested */
-    if (vcpu_affinity_core >= 0) {
-        unsigned long cpu_mask = 1UL << vcpu_affinity_core;
-        int ret = qemu_thread_set_affinity(cpu->thread, &cpu_mask, 64);
-        if (ret) {
-            fprintf(stderr, "xemu: Failed to set vCPU %d affinity: %s\n",
-                    cpu->cpu_index, strerror(ret));
-        } else {
-            fprintf(stderr, "xemu: vCPU %d thread pinned to core %d\n",
-                    cpu->cpu_index, vcpu_affinity_core);
-        }
-    }
 }
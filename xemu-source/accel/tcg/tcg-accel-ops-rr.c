@@ -32,36 +32,13 @@
 #include "qemu/main-loop.h"
 #include "qemu/notify.h"
 #include "qemu/guest-random.h"
+#include "qemu/thread-placement.h"
 #include "exec/exec-all.h"
 #include "tcg/startup.h"
 #include "tcg-accel-ops.h"
 #include "tcg-accel-ops-rr.h"
 #include "tcg-accel-ops-icount.h"
 
-/*
- * CPU Affinity for vCPU thread
- * Set XEMU_VCPU_AFFINITY=N to pin the Xbox CPU emulation thread to core N
- * Example: XEMU_VCPU_AFFINITY=0 pins to core 0
- */
-static int vcpu_affinity_core = -1;
-static bool vcpu_affinity_initialized = false;
-
-static void rr_init_vcpu_affinity(void)
-{
-    const char *env;
-
-    if (vcpu_affinity_initialized) {
-        return;
-    }
-    vcpu_affinity_initialized = true;
-
-    env = getenv("XEMU_VCPU_AFFINITY");
-    if (env) {
-        vcpu_affinity_core = atoi(env);
-        fprintf(stderr, "xemu: vCPU affinity set to core %d\n", vcpu_affinity_core);
-    }
-}
-
 /* Kick all RR vCPUs */
 void rr_kick_vcpu_thread(CPUState *unused)
 {
@@ -212,6 +189,7 @@ static void *rr_cpu_thread_fn(void *arg)
     force_rcu.notify = rr_force_rcu;
     rcu_add_force_rcu_notifier(&force_rcu);
     tcg_register_thread();
+    thread_placement_enter(THREAD_CLASS_VCPU, 0);
 
     bql_lock();
     qemu_thread_get_self(cpu->thread);
@@ -327,6 +305,7 @@ static void *rr_cpu_thread_fn(void *arg)
         rr_deal_with_unplugged_cpus();
     }
 
+    thread_placement_leave();
     g_assert_not_reached();
 }
 
@@ -339,9 +318,6 @@ void rr_start_vcpu_thread(CPUState *cpu)
     g_assert(tcg_enabled());
     tcg_cpu_init_cflags(cpu, false);
 
-    /* Check for CPU affinity environment variable */
-    rr_init_vcpu_affinity();
-
     if (!single_tcg_cpu_thread) {
         single_tcg_halt_cond = cpu->halt_cond;
         single_tcg_cpu_thread = cpu->thread;
@@ -351,19 +327,6 @@ void rr_start_vcpu_thread(CPUState *cpu)
         qemu_thread_create(cpu->thread, thread_name,
                            rr_cpu_thread_fn,
                            cpu, QEMU_THREAD_JOINABLE);
-
-        /* Pin vCPU thread to specified core if requested */
-        if (vcpu_affinity_core >= 0) {
-            unsigned long cpu_mask = 1UL << vcpu_affinity_core;
-            int ret = qemu_thread_set_affinity(cpu->thread, &cpu_mask, 64);
-            if (ret) {
-                fprintf(stderr, "xemu: Failed to set vCPU affinity: %s\n",
-                        strerror(ret));
-            } else {
-                fprintf(stderr, "xemu: vCPU thread pinned to core %d\n",
-                        vcpu_affinity_core);
-            }
-        }
     } else {
         /* we share the thread, dump spare data */
         g_free(cpu->thread);
@@ -0,0 +1,127 @@
+/*
+ * Internal snapshots of the disk at an earlier stop point
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "block/block.h"
+#include "block/snapshot-stop-point.h"
+#include "qapi/error.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
+
+int bdrv_stop_point_prepare(Error **errp)
+{
+    GLOBAL_STATE_CODE();
+
+    int ret = bdrv_all_has_snapshot(BDRV_STOP_POINT_CURRENT, false, NULL,
+                                    errp);
+    if (ret < 0) {
+        return ret;
+    }
+    if (ret) {
+        error_setg(errp, "Snapshot \"%s\" holds disk contents that could "
+                   "not be restored", BDRV_STOP_POINT_CURRENT);
+        return -EEXIST;
+    }
+
+    return bdrv_all_delete_snapshot(BDRV_STOP_POINT_DISK, false, NULL, errp);
+}
+
+int bdrv_stop_point_capture(BlockDriverState *vm_state_bs,
+                            const QEMUSnapshotInfo *sn, Error **errp)
+{
+    QEMUSnapshotInfo disk_sn = *sn;
+    int ret;
+
+    GLOBAL_STATE_CODE();
+
+    pstrcpy(disk_sn.name, sizeof(disk_sn.name), BDRV_STOP_POINT_DISK);
+    bdrv_drained_begin(vm_state_bs);
+    ret = bdrv_all_create_snapshot(&disk_sn, vm_state_bs, 0, false, NULL,
+                                   errp);
+    bdrv_drained_end(vm_state_bs);
+
+    return ret;
+}
+
+bool bdrv_stop_point_create(QEMUSnapshotInfo *sn,
+                            BlockDriverState *vm_state_bs,
+                            BdrvStopPointWriteVMState *write_vmstate,
+                            void *opaque, Error **errp)
+{
+    QEMUSnapshotInfo cur_sn = *sn;
+    Error *local_err = NULL;
+    bool created = false;
+
+    GLOBAL_STATE_CODE();
+
+    pstrcpy(cur_sn.name, sizeof(cur_sn.name), BDRV_STOP_POINT_CURRENT);
+    int had_old = bdrv_all_has_snapshot(sn->name, false, NULL, errp);
+    if (had_old < 0) {
+        return false;
+    }
+
+    bdrv_drained_begin(vm_state_bs);
+
+    if (bdrv_all_create_snapshot(&cur_sn, vm_state_bs, 0, false, NULL,
+                                 errp) < 0) {
+        goto out;
+    }
+
+    if (bdrv_all_goto_snapshot(BDRV_STOP_POINT_DISK, false, NULL, errp) == 0) {
+        int64_t size = write_vmstate(vm_state_bs, opaque);
+        if (size < 0) {
+            error_setg_errno(errp, -size, "Error while writing VM state");
+        } else {
+            created = bdrv_all_create_snapshot(sn, vm_state_bs, size, false,
+                                               NULL, errp) == 0;
+        }
+    }
+
+    /* Back to what the guest has written since the stop point */
+    if (bdrv_all_goto_snapshot(BDRV_STOP_POINT_CURRENT, false, NULL,
+                               &local_err) < 0) {
+        error_report_err(local_err);
+        local_err = NULL;
+        error_report("Disk contents written after snapshot \"%s\" was "
+                     "started are kept in snapshot \"%s\"", sn->name,
+                     BDRV_STOP_POINT_CURRENT);
+    } else {
+        bdrv_all_delete_snapshot(BDRV_STOP_POINT_CURRENT, false, NULL, NULL);
+    }
+
+    /*
+     * Names need not be unique, and lookups by name find the oldest
+     * snapshot, which is the one being replaced.
+     */
+    if (created && had_old &&
+        bdrv_all_delete_snapshot(sn->name, false, NULL, &local_err) < 0) {
+        warn_report_err(local_err);
+    }
+
+out:
+    bdrv_drained_end(vm_state_bs);
+    return created;
+}
+
+void bdrv_stop_point_release(void)
+{
+    GLOBAL_STATE_CODE();
+
+    bdrv_all_delete_snapshot(BDRV_STOP_POINT_DISK, false, NULL, NULL);
+}
@@ -40,13 +40,10 @@
 #include "qemu/id.h"
 #include "qemu/coroutine.h"
 #include "qemu/yank.h"
+#include "qemu/main-loop.h"
 
 #include "chardev-internal.h"
 
-#ifdef XBOX
-extern GMainContext *qemu_main_context; /* FIXME: Cleanup */
-#endif
-
 /***********************************************************/
 /* character device */
 
@@ -294,8 +291,8 @@ static void char_init(Object *obj)
     chr->logfd = -1;
 
 #ifdef XBOX
-    /* Explicitly default to qemu_main_context, not the global context via NULL. */
-    chr->gcontext = qemu_main_context;
+    /* The main loop does not poll the default context (NULL) */
+    chr->gcontext = qemu_get_main_context();
 #endif
 
     qemu_mutex_init(&chr->chr_write_lock);
@@ -31,6 +31,7 @@
 #include "chardev/char-serial.h"
 #include "qapi/error.h"
 #include "qemu/timer.h"
+#include "qemu/main-loop.h"
 #include "sysemu/reset.h"
 #include "sysemu/runstate.h"
 #include "qemu/error-report.h"
@@ -856,7 +857,7 @@ static void serial_reset(void *opaque)
     SerialState *s = opaque;
 
     if (s->watch_tag > 0) {
-        g_source_remove(s->watch_tag);
+        qemu_main_context_source_remove(s->watch_tag);
         s->watch_tag = 0;
     }
 
@@ -911,7 +912,7 @@ static int serial_be_change(void *opaque)
     }
 
     if (s->watch_tag > 0) {
-        g_source_remove(s->watch_tag);
+        qemu_main_context_source_remove(s->watch_tag);
         s->watch_tag = qemu_chr_fe_add_watch(&s->chr, G_IO_OUT | G_IO_HUP,
                                              serial_watch_cb, s);
     }
@@ -14,6 +14,7 @@
 #include "chardev/char-fe.h"
 #include "qemu/error-report.h"
 #include "qemu/module.h"
+#include "qemu/main-loop.h"
 #include "trace.h"
 #include "hw/qdev-properties.h"
 #include "hw/qdev-properties-system.h"
@@ -160,7 +161,7 @@ static void chr_event(void *opaque, QEMUChrEvent event)
         break;
     case CHR_EVENT_CLOSED:
         if (vcon->watch) {
-            g_source_remove(vcon->watch);
+            qemu_main_context_source_remove(vcon->watch);
             vcon->watch = 0;
         }
         virtio_serial_close(port);
@@ -188,7 +189,7 @@ static int chr_be_change(void *opaque)
     }
 
     if (vcon->watch) {
-        g_source_remove(vcon->watch);
+        qemu_main_context_source_remove(vcon->watch);
         vcon->watch = qemu_chr_fe_add_watch(&vcon->chr,
                                             G_IO_OUT | G_IO_HUP,
                                             chr_write_unblocked, vcon);
@@ -257,7 +258,7 @@ static void virtconsole_unrealize(DeviceState *dev)
     VirtConsole *vcon = VIRTIO_CONSOLE(dev);
 
     if (vcon->watch) {
-        g_source_remove(vcon->watch);
+        qemu_main_context_source_remove(vcon->watch);
     }
 }
 
@@ -30,6 +30,7 @@
 #include "qemu/units.h"
 #include "qapi/error.h"
 #include "qemu/timer.h"
+#include "qemu/main-loop.h"
 #include "sysemu/runstate.h"
 #include "sysemu/sysemu.h"
 #include "qapi/qmp/qerror.h"
@@ -1227,7 +1228,7 @@ static void usbredir_chardev_close_bh(void *opaque)
         dev->parser = NULL;
     }
     if (dev->watch) {
-        g_source_remove(dev->watch);
+        qemu_main_context_source_remove(dev->watch);
         dev->watch = 0;
     }
 }
@@ -1495,7 +1496,7 @@ static void usbredir_unrealize(USBDevice *udev)
         usbredirparser_destroy(dev->parser);
     }
     if (dev->watch) {
-        g_source_remove(dev->watch);
+        qemu_main_context_source_remove(dev->watch);
     }
 
     free(dev->filter_rules);
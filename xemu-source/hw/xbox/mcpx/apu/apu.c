@@ -103,26 +103,83 @@ static const MemoryRegionOps mcpx_apu_mmio_ops = {
     .write = mcpx_apu_write,
 };
 
+/*
+ * Output ring sizing, in bytes of s16 stereo at 48 kHz. Latency starts at
+ * two EP frames and grows by one EP frame per underrun, up to eight. It drops
+ * back a frame after 30 seconds of playback without an underrun.
+ */
+#define MONITOR_RING_SIZE (16 * 1024)
+#define MONITOR_MIN_LATENCY (2 * 1024)
+#define MONITOR_MAX_LATENCY (8 * 1024)
+#define MONITOR_SHRINK_AFTER (30 * 48000 * 4)
+
+/* Upper bound on a frame thread wait for the output ring to drain */
+#define MONITOR_WAIT_MS 5
+
+static void monitor_update_stats(MCPXAPUState *d)
+{
+    MCPXAudioRingStats stats;
+    mcpx_audio_ring_get_stats(&d->monitor.ring, &stats);
+
+    g_dbg.output.underruns = stats.underruns;
+    g_dbg.output.wakeups = stats.wakeups;
+    g_dbg.output.latency_ms = stats.used / (48000.0f * 4) * 1000;
+    g_dbg.output.target_ms = stats.target / (48000.0f * 4) * 1000;
+    g_dbg.output.rate = stats.rate;
+}
+
+/* Called from the GP thread once the last frame of an EP group is mixed */
+void mcpx_apu_monitor_push_frame(MCPXAPUState *d)
+{
+#if 0
+    FILE *fd = fopen("ep.pcm", "a+");
+    assert(fd != NULL);
+    fwrite(d->apu_fifo_output, sizeof(d->apu_fifo_output), 1, fd);
+    fclose(fd);
+#endif
+
+    if (d->bench.capture) {
+        /* No audio device to feed */
+        memset(d->monitor.frame_buf, 0, sizeof(d->monitor.frame_buf));
+        return;
+    }
+
+    if (0 <= g_config.audio.volume_limit && g_config.audio.volume_limit < 1) {
+        float f = pow(g_config.audio.volume_limit, M_E);
+        for (int i = 0; i < 256; i++) {
+            d->monitor.frame_buf[i][0] *= f;
+            d->monitor.frame_buf[i][1] *= f;
+        }
+    }
+
+    /* The frame thread stops producing at the target, well short of full */
+    uint32_t written = mcpx_audio_ring_write(
+        &d->monitor.ring, d->monitor.frame_buf, sizeof(d->monitor.frame_buf));
+    assert(written == sizeof(d->monitor.frame_buf));
+    memset(d->monitor.frame_buf, 0, sizeof(d->monitor.frame_buf));
+}
+
 static void se_frame(MCPXAPUState *d)
 {
     mcpx_apu_update_dsp_preference(d);
     mcpx_debug_begin_frame();
     g_dbg.gp_realtime = d->gp.realtime;
     g_dbg.ep_realtime = d->ep.realtime;
-
-    qemu_spin_lock(&d->monitor.fifo_lock);
-    int num_bytes_free = fifo8_num_free(&d->monitor.fifo);
-    qemu_spin_unlock(&d->monitor.fifo_lock);
+    mcpx_audio_ring_set_drift_compensation(&d->monitor.ring,
+                                           g_config.audio.drift_compensation);
 
     /* A rudimentary calculation to determine approximately how taxed the APU
-     * thread is, by measuring how much time we spend waiting for FIFO to drain
-     * versus working on building frames.
+     * thread is, by measuring how much time we spend waiting for the output
+     * ring to drain versus working on building frames.
      * =1: thread is not sleeping and likely falling behind realtime
      * <1: thread is able to complete work on time
+     *
+     * The audio callback wakes us when the ring drops below its target. The
+     * wait is bounded in case that wakeup lands before we start waiting.
      */
-    if (num_bytes_free < sizeof(d->monitor.frame_buf)) {
+    if (!mcpx_audio_ring_needs_data(&d->monitor.ring)) {
         int64_t sleep_start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
-        qemu_cond_wait(&d->cond, &d->lock);
+        qemu_cond_timedwait(&d->cond, &d->lock, MONITOR_WAIT_MS);
         int64_t sleep_end = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
         d->sleep_acc += (sleep_end - sleep_start);
         return;
@@ -133,6 +190,8 @@ static void se_frame(MCPXAPUState *d)
         float t = 1.0f - ((double)d->sleep_acc /
                           (double)((now - d->frame_count_time) * 1000));
         g_dbg.utilization = t;
+        mcpx_apu_dsp_pipeline_update_stats(d);
+        monitor_update_stats(d);
 
         d->frame_count_time = now;
         d->frame_count = 0;
@@ -143,52 +202,17 @@ static void se_frame(MCPXAPUState *d)
     /* Buffer for all mixbins for this frame */
     float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME] = { 0 };
 
+    int64_t vp_start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
     mcpx_apu_vp_frame(d, mixbins);
-    mcpx_apu_dsp_frame(d, mixbins);
+    g_dbg.pipeline.vp_time_us =
+        qemu_clock_get_us(QEMU_CLOCK_REALTIME) - vp_start;
 
-    if ((d->ep_frame_div + 1) % 8 == 0) {
-#if 0
-        FILE *fd = fopen("ep.pcm", "a+");
-        assert(fd != NULL);
-        fwrite(d->apu_fifo_output, sizeof(d->apu_fifo_output), 1, fd);
-        fclose(fd);
-#endif
-
-        if (0 <= g_config.audio.volume_limit && g_config.audio.volume_limit < 1) {
-            float f = pow(g_config.audio.volume_limit, M_E);
-            for (int i = 0; i < 256; i++) {
-                d->monitor.frame_buf[i][0] *= f;
-                d->monitor.frame_buf[i][1] *= f;
-            }
-        }
-
-        qemu_spin_lock(&d->monitor.fifo_lock);
-        num_bytes_free = fifo8_num_free(&d->monitor.fifo);
-        assert(num_bytes_free >= sizeof(d->monitor.frame_buf));
-        fifo8_push_all(&d->monitor.fifo, (uint8_t *)d->monitor.frame_buf,
-                       sizeof(d->monitor.frame_buf));
-        qemu_spin_unlock(&d->monitor.fifo_lock);
-        memset(d->monitor.frame_buf, 0, sizeof(d->monitor.frame_buf));
-    }
-
-    d->ep_frame_div++;
+    /* GP and EP run on their own threads, trailing the VP by a frame */
+    mcpx_apu_dsp_frame(d, mixbins);
 
     mcpx_debug_end_frame();
 }
 
-/* Note: only supports millisecond resolution on Windows */
-static void sleep_ns(int64_t ns)
-{
-#ifndef _WIN32
-        struct timespec sleep_delay, rem_delay;
-        sleep_delay.tv_sec = ns / 1000000000LL;
-        sleep_delay.tv_nsec = ns % 1000000000LL;
-        nanosleep(&sleep_delay, &rem_delay);
-#else
-        Sleep(ns / SCALE_MS);
-#endif
-}
-
 static void monitor_sink_cb(void *opaque, uint8_t *stream, int free_b)
 {
     MCPXAPUState *s = MCPX_APU_DEVICE(opaque);
@@ -198,39 +222,22 @@ static void monitor_sink_cb(void *opaque, uint8_t *stream, int free_b)
         return;
     }
 
-    int avail = 0;
-    while (avail < free_b) {
-        qemu_spin_lock(&s->monitor.fifo_lock);
-        avail = fifo8_num_used(&s->monitor.fifo);
-        qemu_spin_unlock(&s->monitor.fifo_lock);
-        if (avail < free_b) {
-            sleep_ns(1000000);
-            qemu_cond_broadcast(&s->cond);
-        }
-        if (!runstate_is_running()) {
-            memset(stream, 0, free_b);
-            return;
-        }
-    }
-
-    int to_copy = MIN(free_b, avail);
-    while (to_copy > 0) {
-        uint32_t chunk_len = 0;
-        qemu_spin_lock(&s->monitor.fifo_lock);
-        chunk_len = fifo8_pop_buf(&s->monitor.fifo, stream, to_copy);
-        assert(chunk_len <= to_copy);
-        qemu_spin_unlock(&s->monitor.fifo_lock);
-        stream += chunk_len;
-        to_copy -= chunk_len;
-    }
+    mcpx_audio_ring_read(&s->monitor.ring, stream, free_b);
+}
 
-    qemu_cond_broadcast(&s->cond);
+/* Called from the audio callback when the ring drops below its target */
+static void monitor_wakeup(void *opaque)
+{
+    MCPXAPUState *d = opaque;
+    qemu_cond_broadcast(&d->cond);
 }
 
 static void monitor_init(MCPXAPUState *d)
 {
-    qemu_spin_init(&d->monitor.fifo_lock);
-    fifo8_create(&d->monitor.fifo, 3 * (256 * 2 * 2));
+    mcpx_audio_ring_init(&d->monitor.ring, MONITOR_RING_SIZE,
+                         MONITOR_MIN_LATENCY, MONITOR_MAX_LATENCY,
+                         sizeof(d->monitor.frame_buf), MONITOR_SHRINK_AFTER);
+    mcpx_audio_ring_set_wakeup(&d->monitor.ring, monitor_wakeup, d);
 
     struct SDL_AudioSpec sdl_audio_spec = {
         .freq = 48000,
@@ -254,6 +261,49 @@ static void monitor_init(MCPXAPUState *d)
         exit(1);
     }
     SDL_PauseAudioDevice(sdl_audio_dev, 0);
+    d->monitor.sdl_audio_dev = sdl_audio_dev;
+}
+
+/* The audio callback reads the ring, so stop it before freeing the ring */
+static void monitor_finalize(MCPXAPUState *d)
+{
+    if (d->monitor.sdl_audio_dev) {
+        SDL_CloseAudioDevice(d->monitor.sdl_audio_dev);
+        d->monitor.sdl_audio_dev = 0;
+    }
+    mcpx_audio_ring_destroy(&d->monitor.ring);
+}
+
+uint32_t mcpx_apu_ram_generation(MCPXAPUState *d, hwaddr addr, hwaddr len)
+{
+    if (addr >= d->ram_pages << TARGET_PAGE_BITS || len == 0) {
+        return 0;
+    }
+
+    hwaddr first = addr >> TARGET_PAGE_BITS;
+    hwaddr end = MIN((addr + len + TARGET_PAGE_SIZE - 1) >> TARGET_PAGE_BITS,
+                     d->ram_pages);
+    uint32_t gen = 0;
+
+    /*
+     * The dirty log is shared by every cache of guest memory, and testing a
+     * page clears it for all of them. Whoever sees the page dirty first
+     * bumps its generation so the others notice too.
+     */
+    qemu_mutex_lock(&d->ram_gen_lock);
+    if (memory_region_test_and_clear_dirty(d->ram, first << TARGET_PAGE_BITS,
+                                           (end - first) << TARGET_PAGE_BITS,
+                                           DIRTY_MEMORY_APU)) {
+        for (hwaddr page = first; page < end; page++) {
+            d->ram_gen[page]++;
+        }
+    }
+    for (hwaddr page = first; page < end; page++) {
+        gen += d->ram_gen[page];
+    }
+    qemu_mutex_unlock(&d->ram_gen_lock);
+
+    return gen;
 }
 
 static void mcpx_apu_realize(PCIDevice *dev, Error **errp)
@@ -285,22 +335,32 @@ static void mcpx_apu_exitfn(PCIDevice *dev)
     MCPXAPUState *d = MCPX_APU_DEVICE(dev);
     d->exiting = true;
     qemu_cond_broadcast(&d->cond);
-    qemu_thread_join(&d->apu_thread);
+    if (!d->bench.capture) {
+        qemu_thread_join(&d->apu_thread);
+    }
+    mcpx_apu_dsp_finalize(d);
     mcpx_apu_vp_finalize(d);
+    monitor_finalize(d);
 }
 
 static void mcpx_apu_reset(MCPXAPUState *d)
 {
     qemu_mutex_lock(&d->lock); // FIXME: Can fail if thread is pegged, add flag
+    mcpx_apu_dsp_pipeline_drain(d);
     memset(d->regs, 0, sizeof(d->regs));
 
     mcpx_apu_vp_reset(d);
 
     // FIXME: Reset DSP state
+    qemu_mutex_lock(&d->gp.lock);
+    qemu_mutex_lock(&d->ep.lock);
     memset(d->gp.dsp->core.pram_opcache, 0,
            sizeof(d->gp.dsp->core.pram_opcache));
     memset(d->ep.dsp->core.pram_opcache, 0,
            sizeof(d->ep.dsp->core.pram_opcache));
+    mcpx_apu_dsp_invalidate_sg(d);
+    qemu_mutex_unlock(&d->ep.lock);
+    qemu_mutex_unlock(&d->gp.lock);
     d->set_irq = false;
     qemu_cond_signal(&d->cond);
     qemu_mutex_unlock(&d->lock);
@@ -315,6 +375,7 @@ static void mcpx_apu_vm_state_change(void *opaque, bool running, RunState state)
 
     if (state == RUN_STATE_SAVE_VM) {
         qemu_mutex_lock(&d->lock);
+        mcpx_apu_dsp_pipeline_drain(d);
     }
 }
 
@@ -337,6 +398,7 @@ static int mcpx_apu_pre_load(void *opaque)
 static int mcpx_apu_post_load(void *opaque, int version_id)
 {
     MCPXAPUState *d = opaque;
+    mcpx_apu_dsp_invalidate_sg(d);
     qemu_cond_signal(&d->cond);
     qemu_mutex_unlock(&d->lock);
     return 0;
@@ -346,6 +408,11 @@ static void mcpx_apu_reset_hold(Object *obj, ResetType type)
 {
     MCPXAPUState *d = MCPX_APU_DEVICE(obj);
     mcpx_apu_reset(d);
+
+    /* Load the capture over the freshly reset state */
+    if (d->bench.capture) {
+        mcpx_apu_bench_start(d);
+    }
 }
 
 const VMStateDescription vmstate_vp_dsp_dma_state = {
@@ -462,6 +529,14 @@ static const VMStateDescription vmstate_mcpx_apu = {
     },
 };
 
+static Property mcpx_apu_properties[] = {
+    DEFINE_PROP_STRING("bench-capture", MCPXAPUState, bench.capture),
+    DEFINE_PROP_UINT32("bench-frames", MCPXAPUState, bench.frames, 15000),
+    DEFINE_PROP_BOOL("bench-placements", MCPXAPUState, bench.placements,
+                     false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void mcpx_apu_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -479,6 +554,7 @@ static void mcpx_apu_class_init(ObjectClass *klass, void *data)
 
     dc->desc = "MCPX Audio Processing Unit";
     dc->vmsd = &vmstate_mcpx_apu;
+    device_class_set_props(dc, mcpx_apu_properties);
 }
 
 static const TypeInfo mcpx_apu_info = {
@@ -502,6 +578,7 @@ type_init(mcpx_apu_register);
 static void *mcpx_apu_frame_thread(void *arg)
 {
     MCPXAPUState *d = MCPX_APU_DEVICE(arg);
+    thread_placement_enter(THREAD_CLASS_APU, 0);
     qemu_mutex_lock(&d->lock);
     while (!qatomic_read(&d->exiting)) {
         int xcntmode = GET_MASK(qatomic_read(&d->regs[NV_PAPU_SECTL]),
@@ -534,6 +611,7 @@ static void *mcpx_apu_frame_thread(void *arg)
         se_frame((void *)d);
     }
     qemu_mutex_unlock(&d->lock);
+    thread_placement_leave();
     return NULL;
 }
 
@@ -546,6 +624,10 @@ void mcpx_apu_init(PCIBus *bus, int devfn, MemoryRegion *ram)
 
     d->ram = ram;
     d->ram_ptr = memory_region_get_ram_ptr(d->ram);
+    d->ram_pages = memory_region_size(d->ram) >> TARGET_PAGE_BITS;
+    d->ram_gen = g_new0(uint32_t, d->ram_pages);
+    qemu_mutex_init(&d->ram_gen_lock);
+    memory_region_set_log(d->ram, true, DIRTY_MEMORY_APU);
 
     mcpx_apu_dsp_init(d);
 
@@ -557,6 +639,12 @@ void mcpx_apu_init(PCIBus *bus, int devfn, MemoryRegion *ram)
     qemu_add_vm_change_state_handler(mcpx_apu_vm_state_change, d);
 
     mcpx_apu_vp_init(d);
+
+    /* The benchmark drives frames itself once the machine is reset */
+    if (d->bench.capture) {
+        return;
+    }
+
     qemu_thread_create(&d->apu_thread, "mcpx.apu_thread", mcpx_apu_frame_thread,
                        d, QEMU_THREAD_JOINABLE);
 
@@ -37,6 +37,7 @@ struct McpxApuDebugVoice
 {
     bool active;
     bool paused;
+    bool silent;
     bool stereo;
     uint8_t bin[8];
     uint16_t vol[8];
@@ -70,10 +71,26 @@ struct McpxApuDebugDsp
     int cycles;
 };
 
+struct McpxApuDebugPipeline
+{
+    int vp_time_us, gp_time_us, ep_time_us;
+    int gp_stalls, gp_stall_us; /* VP waiting on the GP, per second */
+    int ep_stalls, ep_stall_us; /* GP waiting on the EP, per second */
+};
+
+struct McpxApuDebugOutput
+{
+    int underruns, wakeups; /* Per second */
+    float latency_ms, target_ms;
+    float rate;
+};
+
 struct McpxApuDebug
 {
     struct McpxApuDebugVp vp;
     struct McpxApuDebugDsp gp, ep;
+    struct McpxApuDebugPipeline pipeline;
+    struct McpxApuDebugOutput output;
     int frames_processed;
     float utilization;
     bool gp_realtime, ep_realtime;
@@ -92,6 +109,7 @@ void mcpx_apu_debug_toggle_mute(uint16_t v);
 bool mcpx_apu_debug_is_muted(uint16_t v);
 void mcpx_apu_debug_set_gp_realtime_enabled(bool enable);
 void mcpx_apu_debug_set_ep_realtime_enabled(bool enable);
+bool mcpx_apu_debug_capture(const char *path);
 
 #ifdef __cplusplus
 }
@@ -27,19 +27,22 @@
 #include "hw/hw.h"
 #include "hw/pci/pci.h"
 #include "hw/pci/pci_device.h"
+#include "hw/qdev-properties.h"
 #include "cpu.h"
 #include "migration/vmstate.h"
 #include "qemu/main-loop.h"
 #include "qemu/thread.h"
+#include "qemu/thread-placement.h"
 #include "sysemu/runstate.h"
 #include "audio/audio.h"
-#include "qemu/fifo8.h"
 #include "ui/xemu-settings.h"
 
 #include "trace.h"
 #include "apu.h"
 #include "apu_regs.h"
 #include "apu_debug.h"
+#include "audio_ring.h"
+#include "capture.h"
 #include "fpconv.h"
 #include "vp/vp.h"
 #include "dsp/gp_ep.h"
@@ -87,9 +90,15 @@ typedef struct MCPXAPUState {
     uint8_t *ram_ptr;
     MemoryRegion mmio;
 
+    /* Per-page content generations, see mcpx_apu_ram_generation */
+    QemuMutex ram_gen_lock;
+    uint32_t *ram_gen;
+    hwaddr ram_pages;
+
     MCPXAPUVPState vp;
     MCPXAPUGPState gp;
     MCPXAPUEPState ep;
+    MCPXAPUDSPPipeline dsp_pipeline;
 
     uint32_t regs[0x20000];
 
@@ -101,9 +110,18 @@ typedef struct MCPXAPUState {
     struct {
         McpxApuDebugMonitorPoint point;
         int16_t frame_buf[256][2]; // 1 EP frame (0x400 bytes), 8 buffered
-        QemuSpin fifo_lock;
-        Fifo8 fifo;
+        MCPXAudioRing ring;
+        SDL_AudioDeviceID sdl_audio_dev;
     } monitor;
+
+    /* Headless benchmark, see bench.c */
+    struct {
+        char *capture;
+        uint32_t frames;
+        bool placements;
+        bool started;
+        QemuThread thread;
+    } bench;
 } MCPXAPUState;
 
 extern MCPXAPUState *g_state; // Used via debug handlers
@@ -111,6 +129,16 @@ extern struct McpxApuDebug g_dbg, g_dbg_cache;
 extern int g_dbg_voice_monitor;
 extern uint64_t g_dbg_muted_voices[4];
 
+void mcpx_apu_monitor_push_frame(MCPXAPUState *d);
+
+/*
+ * Returns a value that changes whenever guest memory in [addr, addr + len)
+ * may have been written since the last call for any overlapping range.
+ * Caches of data decoded from guest memory compare it to detect stale
+ * entries.
+ */
+uint32_t mcpx_apu_ram_generation(MCPXAPUState *d, hwaddr addr, hwaddr len);
+
 void mcpx_debug_begin_frame(void);
 void mcpx_debug_end_frame(void);
 
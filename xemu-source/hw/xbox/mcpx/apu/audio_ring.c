@@ -0,0 +1,264 @@
+/*
+ * MCPX audio output ring
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include <math.h>
+
+#include "audio_ring.h"
+
+/* Maximum resampling correction, and the fill error at which it applies */
+#define DRIFT_MAX_CORRECTION 0.005f
+#define DRIFT_DEADBAND 0.5f
+
+/* Weight of each new fill level sample in the running average */
+#define DRIFT_AVG_WEIGHT (1.0f / 64.0f)
+
+#define Q16_ONE (1u << 16)
+
+void mcpx_audio_ring_init(MCPXAudioRing *r, uint32_t size, uint32_t min_target,
+                          uint32_t max_target, uint32_t target_step,
+                          uint64_t shrink_after)
+{
+    assert(size && !(size & (size - 1)));
+    assert(size % MCPX_AUDIO_RING_FRAME_SIZE == 0);
+    assert(min_target <= max_target && max_target < size);
+
+    memset(r, 0, sizeof(*r));
+    r->buf = g_malloc0(size);
+    r->size = size;
+    r->target = min_target;
+    r->min_target = min_target;
+    r->max_target = max_target;
+    r->target_step = target_step;
+    r->shrink_after = shrink_after;
+    r->rate_q16 = Q16_ONE;
+}
+
+void mcpx_audio_ring_destroy(MCPXAudioRing *r)
+{
+    g_free(r->buf);
+    r->buf = NULL;
+}
+
+void mcpx_audio_ring_set_wakeup(MCPXAudioRing *r, MCPXAudioRingWakeupFunc func,
+                                void *opaque)
+{
+    r->wakeup = func;
+    r->opaque = opaque;
+}
+
+void mcpx_audio_ring_set_drift_compensation(MCPXAudioRing *r, bool enable)
+{
+    qatomic_set(&r->drift_comp, enable);
+}
+
+uint32_t mcpx_audio_ring_used(MCPXAudioRing *r)
+{
+    return qatomic_load_acquire(&r->head) - qatomic_load_acquire(&r->tail);
+}
+
+bool mcpx_audio_ring_needs_data(MCPXAudioRing *r)
+{
+    return mcpx_audio_ring_used(r) < qatomic_read(&r->target);
+}
+
+uint32_t mcpx_audio_ring_write(MCPXAudioRing *r, const void *data,
+                               uint32_t len)
+{
+    uint32_t head = r->head;
+    uint32_t free_bytes = r->size - (head - qatomic_load_acquire(&r->tail));
+    len = len < free_bytes ? len : free_bytes;
+
+    uint32_t off = head & (r->size - 1);
+    uint32_t first = r->size - off;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(r->buf + off, data, first);
+    memcpy(r->buf, (const uint8_t *)data + first, len - first);
+
+    qatomic_store_release(&r->head, head + len);
+    return len;
+}
+
+static void copy_out(MCPXAudioRing *r, uint32_t tail, uint8_t *dst,
+                     uint32_t len)
+{
+    uint32_t off = tail & (r->size - 1);
+    uint32_t first = r->size - off;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dst, r->buf + off, first);
+    memcpy(dst + first, r->buf, len - first);
+}
+
+static inline const int16_t *frame_at(MCPXAudioRing *r, uint32_t tail)
+{
+    /* Frames never straddle the end of the buffer */
+    return (const int16_t *)(r->buf + (tail & (r->size - 1)));
+}
+
+static void update_rate(MCPXAudioRing *r, uint32_t used, uint32_t target)
+{
+    r->avg_used += ((float)used - r->avg_used) * DRIFT_AVG_WEIGHT;
+
+    /*
+     * Only correct once the fill level is well away from the target, so
+     * the normal sawtooth of producer writes and device reads is left alone.
+     */
+    float err = (r->avg_used - (float)target) / (float)target;
+    float correction = 0;
+    if (err > DRIFT_DEADBAND) {
+        correction = (err - DRIFT_DEADBAND) * DRIFT_MAX_CORRECTION;
+    } else if (err < -DRIFT_DEADBAND) {
+        correction = (err + DRIFT_DEADBAND) * DRIFT_MAX_CORRECTION;
+    }
+    correction = fmaxf(-DRIFT_MAX_CORRECTION,
+                       fminf(DRIFT_MAX_CORRECTION, correction));
+    qatomic_set(&r->rate_q16,
+                (uint32_t)lrintf((1.0f + correction) * Q16_ONE));
+}
+
+/*
+ * Linearly interpolate `frames` output frames, stepping through the input at
+ * the current rate. Returns the new tail.
+ */
+static uint32_t read_resampled(MCPXAudioRing *r, uint32_t tail, int16_t *dst,
+                               uint32_t frames)
+{
+    uint32_t pos = r->pos_q16;
+    uint32_t step = r->rate_q16;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        while (pos >= Q16_ONE) {
+            memcpy(r->last, frame_at(r, tail), sizeof(r->last));
+            tail += MCPX_AUDIO_RING_FRAME_SIZE;
+            pos -= Q16_ONE;
+        }
+        const int16_t *next = frame_at(r, tail);
+        for (int c = 0; c < 2; c++) {
+            int32_t a = r->last[c];
+            int32_t b = next[c];
+            dst[2 * i + c] = a + (((b - a) * (int32_t)pos) >> 16);
+        }
+        pos += step;
+    }
+
+    r->pos_q16 = pos;
+    return tail;
+}
+
+static void underrun(MCPXAudioRing *r, uint32_t target)
+{
+    r->primed = false;
+    r->clean_bytes = 0;
+    qatomic_inc(&r->underruns);
+
+    if (target + r->target_step <= r->max_target) {
+        qatomic_set(&r->target, target + r->target_step);
+    }
+}
+
+void mcpx_audio_ring_read(MCPXAudioRing *r, void *stream, uint32_t len)
+{
+    assert(len % MCPX_AUDIO_RING_FRAME_SIZE == 0);
+
+    uint8_t *dst = stream;
+    uint32_t target = qatomic_read(&r->target);
+    uint32_t tail = r->tail;
+    uint32_t used = qatomic_load_acquire(&r->head) - tail;
+    bool drift_comp = qatomic_read(&r->drift_comp);
+
+    if (!r->primed) {
+        if (used < target) {
+            memset(dst, 0, len);
+            return;
+        }
+        r->primed = true;
+        r->avg_used = used;
+        r->pos_q16 = Q16_ONE;
+    }
+
+    if (drift_comp) {
+        update_rate(r, used, target);
+    } else {
+        qatomic_set(&r->rate_q16, Q16_ONE);
+        r->pos_q16 = Q16_ONE;
+    }
+
+    uint32_t frames = len / MCPX_AUDIO_RING_FRAME_SIZE;
+    uint64_t needed;
+    if (r->rate_q16 == Q16_ONE && r->pos_q16 == Q16_ONE) {
+        needed = len;
+    } else {
+        /* Input frames stepped over, plus one to interpolate towards */
+        needed = (((uint64_t)r->pos_q16 + (uint64_t)frames * r->rate_q16) >>
+                  16) * MCPX_AUDIO_RING_FRAME_SIZE +
+                 MCPX_AUDIO_RING_FRAME_SIZE;
+    }
+
+    if (used < needed) {
+        /* Play out what is left and start refilling */
+        uint32_t n = used < len ? used : len;
+        copy_out(r, tail, dst, n);
+        memset(dst + n, 0, len - n);
+        tail += used;
+        qatomic_store_release(&r->tail, tail);
+        underrun(r, target);
+        qatomic_inc(&r->wakeups);
+        if (r->wakeup) {
+            r->wakeup(r->opaque);
+        }
+        return;
+    }
+
+    if (needed == len) {
+        copy_out(r, tail, dst, len);
+        tail += len;
+    } else {
+        tail = read_resampled(r, tail, (int16_t *)dst, frames);
+    }
+    qatomic_store_release(&r->tail, tail);
+
+    r->clean_bytes += len;
+    if (r->clean_bytes >= r->shrink_after &&
+        target >= r->min_target + r->target_step) {
+        target -= r->target_step;
+        qatomic_set(&r->target, target);
+        r->clean_bytes = 0;
+    }
+
+    uint32_t remaining = qatomic_load_acquire(&r->head) - tail;
+    if (used >= target && remaining < target) {
+        qatomic_inc(&r->wakeups);
+        if (r->wakeup) {
+            r->wakeup(r->opaque);
+        }
+    }
+}
+
+void mcpx_audio_ring_get_stats(MCPXAudioRing *r, MCPXAudioRingStats *stats)
+{
+    stats->underruns = qatomic_xchg(&r->underruns, 0);
+    stats->wakeups = qatomic_xchg(&r->wakeups, 0);
+    stats->used = mcpx_audio_ring_used(r);
+    stats->target = qatomic_read(&r->target);
+    stats->rate = (float)qatomic_read(&r->rate_q16) / Q16_ONE;
+}
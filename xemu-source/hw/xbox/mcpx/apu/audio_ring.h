@@ -0,0 +1,115 @@
+/*
+ * MCPX audio output ring
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_MCPX_APU_AUDIO_RING_H
+#define HW_XBOX_MCPX_APU_AUDIO_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Size in bytes of one interleaved s16 stereo sample frame */
+#define MCPX_AUDIO_RING_FRAME_SIZE 4
+
+typedef void (*MCPXAudioRingWakeupFunc)(void *opaque);
+
+/*
+ * Single-producer, single-consumer ring carrying s16 stereo output from the
+ * APU to the audio device callback. Neither side takes a lock or sleeps.
+ *
+ * The producer keeps the ring filled up to a target level. The consumer
+ * raises the target when it underruns and lowers it again after a period of
+ * clean playback, and calls the wakeup function when its reads take the fill
+ * level from at or above the target to below it.
+ */
+typedef struct MCPXAudioRing {
+    uint8_t *buf;
+    uint32_t size;       /* Power of two, multiple of the frame size */
+    uint32_t head;       /* Free running, written by the producer */
+    uint32_t tail;       /* Free running, written by the consumer */
+
+    /* Target fill level in bytes, written by the consumer */
+    uint32_t target;
+    uint32_t min_target;
+    uint32_t max_target;
+    uint32_t target_step;
+
+    /* Consumer state */
+    bool primed;
+    uint64_t clean_bytes;
+    uint64_t shrink_after;
+    bool drift_comp;
+    float avg_used;
+    uint32_t rate_q16;
+    uint32_t pos_q16;
+    int16_t last[2];
+
+    MCPXAudioRingWakeupFunc wakeup;
+    void *opaque;
+
+    /* Counters since the last mcpx_audio_ring_get_stats() */
+    uint32_t underruns;
+    uint32_t wakeups;
+} MCPXAudioRing;
+
+typedef struct MCPXAudioRingStats {
+    uint32_t underruns;
+    uint32_t wakeups;
+    uint32_t used;
+    uint32_t target;
+    float rate;
+} MCPXAudioRingStats;
+
+/*
+ * Set up a ring of `size` bytes whose target fill level adapts between
+ * `min_target` and `max_target` in steps of `target_step` bytes, dropping a
+ * step after `shrink_after` bytes have been played without an underrun.
+ */
+void mcpx_audio_ring_init(MCPXAudioRing *r, uint32_t size, uint32_t min_target,
+                          uint32_t max_target, uint32_t target_step,
+                          uint64_t shrink_after);
+void mcpx_audio_ring_destroy(MCPXAudioRing *r);
+void mcpx_audio_ring_set_wakeup(MCPXAudioRing *r, MCPXAudioRingWakeupFunc func,
+                                void *opaque);
+
+/*
+ * Enable slight resampling (up to +/-0.5%) in the consumer to hold the fill
+ * level at the target when producer and consumer clocks drift apart.
+ */
+void mcpx_audio_ring_set_drift_compensation(MCPXAudioRing *r, bool enable);
+
+uint32_t mcpx_audio_ring_used(MCPXAudioRing *r);
+
+/* Producer: true while the fill level is below the target */
+bool mcpx_audio_ring_needs_data(MCPXAudioRing *r);
+
+/* Producer: append up to `len` bytes, returning the number written */
+uint32_t mcpx_audio_ring_write(MCPXAudioRing *r, const void *data,
+                               uint32_t len);
+
+/*
+ * Consumer: fill `len` bytes of `stream`, padding with silence on underrun.
+ * While refilling after an underrun, only silence is produced until the fill
+ * level reaches the target again.
+ */
+void mcpx_audio_ring_read(MCPXAudioRing *r, void *stream, uint32_t len);
+
+/* Read and reset the counters */
+void mcpx_audio_ring_get_stats(MCPXAudioRing *r, MCPXAudioRingStats *stats);
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * QEMU MCPX Audio Processing Unit headless benchmark
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs a capture saved from the audio debug window through the frame
+ * pipeline as fast as it will go, with no audio device attached, e.g.
+ *
+ *   xemu -S -global mcpx-apu.bench-capture=apu-capture.bin \
+ *        -global mcpx-apu.bench-frames=15000
+ *
+ * Adding -global mcpx-apu.bench-placements=on compares the thread placement
+ * policies on the same capture.
+ *
+ * The guest CPU is left stopped so the capture is not disturbed.
+ */
+
+#include "apu_int.h"
+#include "qapi/error.h"
+#include "qemu/error-report.h"
+
+/* Duration of one APU frame in real time */
+#define FRAME_US (1000000.0 * NUM_SAMPLES_PER_FRAME / 48000)
+
+typedef struct BenchResult {
+    int64_t elapsed_us;
+    int64_t vp_us;
+    int64_t gp_us;
+    int64_t ep_us;
+} BenchResult;
+
+/* Called with the APU lock held */
+static void bench_run(MCPXAPUState *d, BenchResult *r)
+{
+    int64_t gp_start_us, ep_start_us;
+    mcpx_apu_dsp_pipeline_get_totals(d, &gp_start_us, &ep_start_us);
+
+    r->vp_us = 0;
+    int64_t start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    for (uint32_t i = 0; i < d->bench.frames; i++) {
+        float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME] = { 0 };
+
+        mcpx_debug_begin_frame();
+        int64_t vp_start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+        mcpx_apu_vp_frame(d, mixbins);
+        r->vp_us += qemu_clock_get_us(QEMU_CLOCK_REALTIME) - vp_start;
+        mcpx_apu_dsp_frame(d, mixbins);
+        mcpx_debug_end_frame();
+    }
+    mcpx_apu_dsp_pipeline_drain(d);
+    r->elapsed_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start;
+
+    mcpx_apu_dsp_pipeline_get_totals(d, &r->gp_us, &r->ep_us);
+    r->gp_us -= gp_start_us;
+    r->ep_us -= ep_start_us;
+}
+
+static double bench_fps(MCPXAPUState *d, const BenchResult *r)
+{
+    return MAX(d->bench.frames, 1) * 1e6 / MAX(r->elapsed_us, 1);
+}
+
+/* Called with the APU lock held, rewinds to the start of the capture */
+static bool bench_load(MCPXAPUState *d)
+{
+    Error *local_err = NULL;
+
+    qemu_mutex_lock(&d->gp.lock);
+    qemu_mutex_lock(&d->ep.lock);
+    bool loaded = mcpx_apu_capture_load(d, d->bench.capture, &local_err);
+    qemu_mutex_unlock(&d->ep.lock);
+    qemu_mutex_unlock(&d->gp.lock);
+    if (!loaded) {
+        error_report_err(local_err);
+        return false;
+    }
+
+    mcpx_apu_update_dsp_preference(d);
+    return true;
+}
+
+static void *bench_thread(void *arg)
+{
+    MCPXAPUState *d = arg;
+
+    rcu_register_thread();
+
+    /* Stands in for the frame thread, which is not started */
+    thread_placement_enter(THREAD_CLASS_APU, 0);
+
+    qemu_mutex_lock(&d->lock);
+    if (!bench_load(d)) {
+        qemu_mutex_unlock(&d->lock);
+        thread_placement_leave();
+        rcu_unregister_thread();
+        qemu_system_shutdown_request_with_code(SHUTDOWN_CAUSE_HOST_ERROR,
+                                               EXIT_FAILURE);
+        return NULL;
+    }
+
+    BenchResult r;
+    bench_run(d, &r);
+
+    double frames = MAX(d->bench.frames, 1);
+    double fps = bench_fps(d, &r);
+    printf("mcpx-apu bench: %s\n", d->bench.capture);
+    printf("  frames:   %u in %.3f s\n", d->bench.frames, r.elapsed_us / 1e6);
+    printf("  rate:     %.1f frames/s (%.2fx realtime)\n", fps,
+           fps * FRAME_US / 1e6);
+    printf("  VP:       %.1f us/frame\n", r.vp_us / frames);
+    printf("  GP:       %.1f us/frame\n", r.gp_us / frames);
+    printf("  EP:       %.1f us/frame\n", r.ep_us / frames);
+    printf("  budget:   %.1f us/frame\n", FRAME_US);
+
+    /* Run the same frames again under each thread placement */
+    if (d->bench.placements) {
+        ThreadPlacementPolicy initial = thread_placement_get_policy();
+
+        printf("  placement  frames/s  realtime  VP us  GP us  EP us\n");
+        for (int p = 0; p < THREAD_PLACEMENT__COUNT; p++) {
+            thread_placement_set_policy(p);
+            if (!bench_load(d)) {
+                break;
+            }
+            bench_run(d, &r);
+            fps = bench_fps(d, &r);
+            printf("  %-9s %9.1f %8.2fx %6.1f %6.1f %6.1f\n",
+                   thread_placement_policy_names[p], fps,
+                   fps * FRAME_US / 1e6, r.vp_us / frames, r.gp_us / frames,
+                   r.ep_us / frames);
+        }
+        thread_placement_set_policy(initial);
+    }
+
+    qemu_mutex_unlock(&d->lock);
+    fflush(stdout);
+
+    thread_placement_leave();
+    rcu_unregister_thread();
+
+    /* Exits through the main loop like any other quit */
+    qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_UI);
+    return NULL;
+}
+
+void mcpx_apu_bench_start(MCPXAPUState *d)
+{
+    if (d->bench.started) {
+        return;
+    }
+    d->bench.started = true;
+    qemu_thread_create(&d->bench.thread, "mcpx.apu_bench", bench_thread, d,
+                       QEMU_THREAD_DETACHED);
+}
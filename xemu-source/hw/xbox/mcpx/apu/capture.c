@@ -0,0 +1,212 @@
+/*
+ * QEMU MCPX Audio Processing Unit state capture
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "apu_int.h"
+#include "qapi/error.h"
+#include "qemu/bitmap.h"
+
+#define CAPTURE_MAGIC 0x50414358 /* "XCAP" */
+#define CAPTURE_VERSION 1
+
+typedef struct CaptureFile {
+    FILE *fd;
+    bool load;
+    bool error;
+} CaptureFile;
+
+/* Read or write one field, depending on the direction of the capture */
+static void capture_rw(CaptureFile *c, void *ptr, size_t len)
+{
+    if (c->error) {
+        return;
+    }
+
+    size_t n = c->load ? fread(ptr, len, 1, c->fd) : fwrite(ptr, len, 1, c->fd);
+    c->error = n != 1;
+}
+
+#define CAPTURE_FIELD(c, field) capture_rw((c), &(field), sizeof(field))
+
+static void capture_dsp(CaptureFile *c, DSPState *s)
+{
+    dsp_core_t *core = &s->core;
+
+    CAPTURE_FIELD(c, core->instr_cycle);
+    CAPTURE_FIELD(c, core->pc);
+    CAPTURE_FIELD(c, core->registers);
+    CAPTURE_FIELD(c, core->stack);
+    CAPTURE_FIELD(c, core->xram);
+    CAPTURE_FIELD(c, core->yram);
+    CAPTURE_FIELD(c, core->pram);
+    CAPTURE_FIELD(c, core->mixbuffer);
+    CAPTURE_FIELD(c, core->periph);
+    CAPTURE_FIELD(c, core->loop_rep);
+    CAPTURE_FIELD(c, core->pc_on_rep);
+    CAPTURE_FIELD(c, core->interrupt_state);
+    CAPTURE_FIELD(c, core->interrupt_instr_fetch);
+    CAPTURE_FIELD(c, core->interrupt_save_pc);
+    CAPTURE_FIELD(c, core->interrupt_counter);
+    CAPTURE_FIELD(c, core->interrupt_ipl_to_raise);
+    CAPTURE_FIELD(c, core->interrupt_pipeline_count);
+    CAPTURE_FIELD(c, core->interrupt_ipl);
+    CAPTURE_FIELD(c, core->interrupt_is_pending);
+    CAPTURE_FIELD(c, core->cur_inst_len);
+    CAPTURE_FIELD(c, core->cur_inst);
+
+    CAPTURE_FIELD(c, s->dma.configuration);
+    CAPTURE_FIELD(c, s->dma.control);
+    CAPTURE_FIELD(c, s->dma.start_block);
+    CAPTURE_FIELD(c, s->dma.next_block);
+    CAPTURE_FIELD(c, s->dma.error);
+    CAPTURE_FIELD(c, s->dma.eol);
+
+    CAPTURE_FIELD(c, s->save_cycles);
+    CAPTURE_FIELD(c, s->interrupts);
+}
+
+static void capture_state(CaptureFile *c, MCPXAPUState *d)
+{
+    CAPTURE_FIELD(c, d->regs);
+    CAPTURE_FIELD(c, d->gp.regs);
+    CAPTURE_FIELD(c, d->ep.regs);
+    CAPTURE_FIELD(c, d->ep_frame_div);
+
+    CAPTURE_FIELD(c, d->vp.inbuf_sge_handle);
+    CAPTURE_FIELD(c, d->vp.outbuf_sge_handle);
+    CAPTURE_FIELD(c, d->vp.ssl);
+    CAPTURE_FIELD(c, d->vp.ssl_base_page);
+    CAPTURE_FIELD(c, d->vp.hrtf_submix);
+    CAPTURE_FIELD(c, d->vp.hrtf_headroom);
+    CAPTURE_FIELD(c, d->vp.submix_headroom);
+    CAPTURE_FIELD(c, d->vp.voice_locked);
+    CAPTURE_FIELD(c, d->vp.hrtf);
+
+    capture_dsp(c, d->gp.dsp);
+    capture_dsp(c, d->ep.dsp);
+}
+
+typedef struct CapturePages {
+    unsigned long *map;
+    hwaddr num_pages;
+} CapturePages;
+
+static void capture_mark_range(void *opaque, hwaddr addr, hwaddr len)
+{
+    CapturePages *p = opaque;
+    hwaddr first = addr >> TARGET_PAGE_BITS;
+    hwaddr end = (addr + len + TARGET_PAGE_SIZE - 1) >> TARGET_PAGE_BITS;
+
+    /* Ranges come from guest-controlled tables, so clamp them to RAM */
+    if (len == 0 || first >= p->num_pages) {
+        return;
+    }
+    bitmap_set(p->map, first, MIN(end, p->num_pages) - first);
+}
+
+bool mcpx_apu_capture_save(MCPXAPUState *d, const char *path, Error **errp)
+{
+    CapturePages pages = {
+        .num_pages = memory_region_size(d->ram) >> TARGET_PAGE_BITS,
+    };
+    pages.map = bitmap_new(pages.num_pages);
+    mcpx_apu_vp_capture_ranges(d, capture_mark_range, &pages);
+    mcpx_apu_dsp_capture_ranges(d, capture_mark_range, &pages);
+
+    CaptureFile c = { .fd = qemu_fopen(path, "wb"), .load = false };
+    if (c.fd == NULL) {
+        error_setg_errno(errp, errno, "Failed to open %s", path);
+        g_free(pages.map);
+        return false;
+    }
+
+    uint32_t magic = CAPTURE_MAGIC;
+    uint32_t version = CAPTURE_VERSION;
+    uint32_t num_pages = bitmap_count_one(pages.map, pages.num_pages);
+    CAPTURE_FIELD(&c, magic);
+    CAPTURE_FIELD(&c, version);
+    capture_state(&c, d);
+
+    CAPTURE_FIELD(&c, num_pages);
+    unsigned long page;
+    for (page = find_first_bit(pages.map, pages.num_pages);
+         page < pages.num_pages;
+         page = find_next_bit(pages.map, pages.num_pages, page + 1)) {
+        uint32_t index = page;
+        CAPTURE_FIELD(&c, index);
+        capture_rw(&c, &d->ram_ptr[page << TARGET_PAGE_BITS],
+                   TARGET_PAGE_SIZE);
+    }
+
+    g_free(pages.map);
+    if (fclose(c.fd) != 0 || c.error) {
+        error_setg(errp, "Failed to write %s", path);
+        return false;
+    }
+    return true;
+}
+
+bool mcpx_apu_capture_load(MCPXAPUState *d, const char *path, Error **errp)
+{
+    CaptureFile c = { .fd = qemu_fopen(path, "rb"), .load = true };
+    if (c.fd == NULL) {
+        error_setg_errno(errp, errno, "Failed to open %s", path);
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0;
+    CAPTURE_FIELD(&c, magic);
+    CAPTURE_FIELD(&c, version);
+    if (c.error || magic != CAPTURE_MAGIC || version != CAPTURE_VERSION) {
+        error_setg(errp, "%s is not a version %d APU capture", path,
+                   CAPTURE_VERSION);
+        fclose(c.fd);
+        return false;
+    }
+
+    capture_state(&c, d);
+
+    hwaddr ram_pages = memory_region_size(d->ram) >> TARGET_PAGE_BITS;
+    uint32_t num_pages = 0;
+    CAPTURE_FIELD(&c, num_pages);
+    for (uint32_t i = 0; i < num_pages && !c.error; i++) {
+        uint32_t index = 0;
+        CAPTURE_FIELD(&c, index);
+        if (index >= ram_pages) {
+            c.error = true;
+            break;
+        }
+        hwaddr addr = (hwaddr)index << TARGET_PAGE_BITS;
+        capture_rw(&c, &d->ram_ptr[addr], TARGET_PAGE_SIZE);
+        memory_region_set_dirty(d->ram, addr, TARGET_PAGE_SIZE);
+    }
+    fclose(c.fd);
+
+    if (c.error) {
+        error_setg(errp, "%s is truncated or corrupt", path);
+        return false;
+    }
+
+    memset(d->gp.dsp->core.pram_opcache, 0,
+           sizeof(d->gp.dsp->core.pram_opcache));
+    memset(d->ep.dsp->core.pram_opcache, 0,
+           sizeof(d->ep.dsp->core.pram_opcache));
+    mcpx_apu_dsp_invalidate_sg(d);
+
+    return true;
+}
@@ -0,0 +1,50 @@
+/*
+ * QEMU MCPX Audio Processing Unit state capture
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_MCPX_APU_CAPTURE_H
+#define HW_XBOX_MCPX_APU_CAPTURE_H
+
+#include "qemu/osdep.h"
+#include "exec/hwaddr.h"
+
+typedef struct MCPXAPUState MCPXAPUState;
+
+/* Called for each range of guest memory that belongs in a capture */
+typedef void (*MCPXAPUCaptureRangeFunc)(void *opaque, hwaddr addr,
+                                        hwaddr len);
+
+/*
+ * A capture holds the APU registers, VP method state, GP and EP DSP state,
+ * and the guest pages holding voice blocks, SGE tables, notifiers and sample
+ * data. It is only meant to be loaded by the same build that saved it.
+ *
+ * Both must be called with the APU lock held, the DSP pipeline drained, and
+ * the GP and EP locks held.
+ */
+bool mcpx_apu_capture_save(MCPXAPUState *d, const char *path, Error **errp);
+bool mcpx_apu_capture_load(MCPXAPUState *d, const char *path, Error **errp);
+
+/*
+ * Headless benchmark: load the capture named by the bench-capture property,
+ * run bench-frames frames through the VP, GP and EP with no audio device,
+ * print a report and exit.
+ */
+void mcpx_apu_bench_start(MCPXAPUState *d);
+
+#endif
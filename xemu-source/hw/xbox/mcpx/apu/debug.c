@@ -20,6 +20,7 @@
  */
 
 #include "apu_int.h"
+#include "qemu/error-report.h"
 
 struct McpxApuDebug g_dbg, g_dbg_cache;
 int g_dbg_voice_monitor = -1;
@@ -34,6 +35,7 @@ void mcpx_debug_begin_frame(void)
 {
     for (int i = 0; i < MCPX_HW_MAX_VOICES; i++) {
         g_dbg.vp.v[i].active = false;
+        g_dbg.vp.v[i].silent = false;
         g_dbg.vp.v[i].multipass_dst_voice = 0xFFFF;
     }
 }
@@ -53,6 +55,27 @@ void mcpx_apu_debug_set_ep_realtime_enabled(bool run)
     g_state->ep.realtime = run;
 }
 
+/* Save the current APU state for the headless benchmark, see bench.c */
+bool mcpx_apu_debug_capture(const char *path)
+{
+    MCPXAPUState *d = g_state;
+    Error *local_err = NULL;
+
+    qemu_mutex_lock(&d->lock);
+    mcpx_apu_dsp_pipeline_drain(d);
+    qemu_mutex_lock(&d->gp.lock);
+    qemu_mutex_lock(&d->ep.lock);
+    bool ok = mcpx_apu_capture_save(d, path, &local_err);
+    qemu_mutex_unlock(&d->ep.lock);
+    qemu_mutex_unlock(&d->gp.lock);
+    qemu_mutex_unlock(&d->lock);
+
+    if (!ok) {
+        error_report_err(local_err);
+    }
+    return ok;
+}
+
 McpxApuDebugMonitorPoint mcpx_apu_debug_get_monitor(void)
 {
     return g_state->monitor.point;
@@ -28,6 +28,7 @@
 #include "dsp_dma.h"
 #include "dsp_state.h"
 #include "dsp.h"
+#include "dsp_convert.h"
 #include "debug.h"
 #include "trace.h"
 
@@ -144,6 +145,28 @@ void dsp_step(DSPState* dsp)
     dsp56k_execute_instruction(&dsp->core);
 }
 
+/*
+ * Skip whole iterations of a polling loop that cannot exit before the end of
+ * this run. At least one iteration is left to the interpreter, so the run ends
+ * on the same instruction with the same cycle accounting as without skipping.
+ */
+static void skip_idle_loop(DSPState* dsp)
+{
+    uint32_t loop_cycles, loop_insts;
+
+    if (!dsp56k_detect_idle_loop(&dsp->core, &loop_cycles, &loop_insts)) {
+        return;
+    }
+
+    int skip = (dsp->save_cycles - 1) / (int)loop_cycles - 1;
+    if (skip > 0) {
+        dsp->save_cycles -= skip * loop_cycles;
+        dsp->core.cycle_count += skip * loop_insts;
+        dsp->core.num_inst += skip * loop_cycles;
+        dsp56k_reset_idle_loop(&dsp->core);
+    }
+}
+
 void dsp_run(DSPState* dsp, int cycles)
 {
     dsp->save_cycles += cycles;
@@ -152,8 +175,12 @@ void dsp_run(DSPState* dsp, int cycles)
 
     int dma_timer = 0;
 
+    /* Memory and peripherals may have been changed since the last run */
+    dsp56k_reset_idle_loop(&dsp->core);
+
     while (dsp->save_cycles > 0)
     {
+        uint32_t pc = dsp->core.pc;
         dsp56k_execute_instruction(&dsp->core);
         dsp->save_cycles -= dsp->core.instr_cycle;
         dsp->core.cycle_count++;
@@ -169,6 +196,12 @@ void dsp_run(DSPState* dsp, int cycles)
         }
 
         if (dsp->core.is_idle) break;
+
+        /* With the DMA stopped, only the host can end a polling loop */
+        if (dsp->core.pc <= pc && pc - dsp->core.pc < DSP_IDLE_LOOP_MAX_LEN &&
+            !(dsp->dma.control & DMA_CONTROL_RUNNING)) {
+            skip_idle_loop(dsp);
+        }
     }
 
     /* FIXME: DMA timing be done cleaner. Xbox enables running
@@ -240,3 +273,101 @@ void dsp_write_memory(DSPState* dsp, char space, uint32_t address, uint32_t valu
 
     dsp56k_write_memory(&dsp->core, space_id, address, value);
 }
+
+static int get_space_id(char space)
+{
+    switch (space) {
+    case 'X':
+        return DSP_SPACE_X;
+    case 'Y':
+        return DSP_SPACE_Y;
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+/*
+ * The bulk accessors copy or convert directly to/from the backing array when
+ * the whole range is in one region, and otherwise go word by word through the
+ * regular memory access path in small batches.
+ */
+
+#define BULK_BATCH_SIZE 64
+
+void dsp_read_memory_block(DSPState* dsp, char space, uint32_t address,
+                           uint32_t *values, size_t count)
+{
+    int space_id = get_space_id(space);
+    uint32_t *src = dsp56k_get_memory_range(&dsp->core, space_id, address,
+                                            count);
+    if (src) {
+        memcpy(values, src, count * sizeof(uint32_t));
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        values[i] = dsp56k_read_memory(&dsp->core, space_id, address + i);
+    }
+}
+
+void dsp_write_memory_block(DSPState* dsp, char space, uint32_t address,
+                            const uint32_t *values, size_t count)
+{
+    int space_id = get_space_id(space);
+    uint32_t *dst = dsp56k_get_memory_range(&dsp->core, space_id, address,
+                                            count);
+    if (dst) {
+        memcpy(dst, values, count * sizeof(uint32_t));
+        dsp->core.write_count += count;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        dsp56k_write_memory(&dsp->core, space_id, address + i, values[i]);
+    }
+}
+
+void dsp_write_memory_float(DSPState* dsp, char space, uint32_t address,
+                            const float *values, size_t count)
+{
+    int space_id = get_space_id(space);
+    uint32_t *dst = dsp56k_get_memory_range(&dsp->core, space_id, address,
+                                            count);
+    if (dst) {
+        dsp_convert_float_to_24b(dst, values, count);
+        dsp->core.write_count += count;
+        return;
+    }
+
+    uint32_t batch[BULK_BATCH_SIZE];
+    for (size_t i = 0; i < count; i += BULK_BATCH_SIZE) {
+        size_t n = MIN(count - i, BULK_BATCH_SIZE);
+        dsp_convert_float_to_24b(batch, values + i, n);
+        dsp_write_memory_block(dsp, space, address + i, batch, n);
+    }
+}
+
+void dsp_read_memory_s16_stereo(DSPState* dsp, char space,
+                                uint32_t left_address, uint32_t right_address,
+                                int16_t *values, size_t count)
+{
+    int space_id = get_space_id(space);
+    const uint32_t *left = dsp56k_get_memory_range(&dsp->core, space_id,
+                                                   left_address, count);
+    const uint32_t *right = dsp56k_get_memory_range(&dsp->core, space_id,
+                                                    right_address, count);
+    if (left && right) {
+        dsp_convert_24b_to_s16_stereo(values, left, right, count);
+        return;
+    }
+
+    uint32_t left_batch[BULK_BATCH_SIZE], right_batch[BULK_BATCH_SIZE];
+    for (size_t i = 0; i < count; i += BULK_BATCH_SIZE) {
+        size_t n = MIN(count - i, BULK_BATCH_SIZE);
+        dsp_read_memory_block(dsp, space, left_address + i, left_batch, n);
+        dsp_read_memory_block(dsp, space, right_address + i, right_batch, n);
+        dsp_convert_24b_to_s16_stereo(values + 2 * i, left_batch, right_batch,
+                                      n);
+    }
+}
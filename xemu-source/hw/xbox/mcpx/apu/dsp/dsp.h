@@ -51,6 +51,17 @@ void dsp_start_frame(DSPState* dsp);
 uint32_t dsp_read_memory(DSPState* dsp, char space, uint32_t addr);
 void dsp_write_memory(DSPState* dsp, char space, uint32_t address, uint32_t value);
 
+/* Bulk access to `count` contiguous X or Y words */
+void dsp_read_memory_block(DSPState* dsp, char space, uint32_t address,
+                           uint32_t *values, size_t count);
+void dsp_write_memory_block(DSPState* dsp, char space, uint32_t address,
+                            const uint32_t *values, size_t count);
+void dsp_write_memory_float(DSPState* dsp, char space, uint32_t address,
+                            const float *values, size_t count);
+void dsp_read_memory_s16_stereo(DSPState* dsp, char space,
+                                uint32_t left_address, uint32_t right_address,
+                                int16_t *values, size_t count);
+
 void dsp_info(DSPState* dsp);
 void dsp_print_registers(DSPState* dsp);
 int dsp_get_register_address(DSPState* dsp, const char *arg, uint32_t **addr, uint32_t *mask);
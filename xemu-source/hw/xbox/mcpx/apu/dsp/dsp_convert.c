@@ -0,0 +1,213 @@
+/*
+ * MCPX DSP sample format conversion
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hw/xbox/mcpx/apu/fpconv.h"
+#include "dsp_convert.h"
+
+/*
+ * Scaling by 2^23 is exact in single precision, so the vector path can
+ * compare and round in float and still match the double precision scalar
+ * conversion. Out of range values (including infinities) saturate, and NaN
+ * converts to the integer indefinite value in both paths, which masks to 0.
+ */
+void dsp_convert_float_to_24b(uint32_t *dst, const float *src, size_t count)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 scale = _mm_set1_ps(8.0f * 0x100000);
+    const __m128 max = _mm_set1_ps(1.0f * 0x7fffff);
+    const __m128 min = _mm_set1_ps(-8.0f * 0x100000);
+    const __m128i max_i = _mm_set1_epi32(0x7fffff);
+    const __m128i min_i = _mm_set1_epi32(-1 - 0x7fffff);
+    const __m128i mask = _mm_set1_epi32(0xffffff);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128i hi = _mm_castps_si128(_mm_cmpge_ps(v, max));
+        __m128i lo = _mm_castps_si128(_mm_cmple_ps(v, min));
+        __m128i r = _mm_cvtps_epi32(v);
+        r = _mm_or_si128(_mm_andnot_si128(hi, r), _mm_and_si128(hi, max_i));
+        r = _mm_or_si128(_mm_andnot_si128(lo, r), _mm_and_si128(lo, min_i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(r, mask));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = float_to_24b(src[i]);
+    }
+}
+
+void dsp_convert_24b_to_s16_stereo(int16_t *dst, const uint32_t *left,
+                                   const uint32_t *right, size_t count)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8) {
+        __m128i l0 = _mm_loadu_si128((const __m128i *)(left + i));
+        __m128i l1 = _mm_loadu_si128((const __m128i *)(left + i + 4));
+        __m128i r0 = _mm_loadu_si128((const __m128i *)(right + i));
+        __m128i r1 = _mm_loadu_si128((const __m128i *)(right + i + 4));
+
+        /* Sign-extend bits 23:8 so the saturating pack is exact */
+        __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(l0, 8), 16),
+                                    _mm_srai_epi32(_mm_slli_epi32(l1, 8), 16));
+        __m128i r = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(r0, 8), 16),
+                                    _mm_srai_epi32(_mm_slli_epi32(r1, 8), 16));
+
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 8),
+                         _mm_unpackhi_epi16(l, r));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[2 * i + 0] = (int16_t)(left[i] >> 8);
+        dst[2 * i + 1] = (int16_t)(right[i] >> 8);
+    }
+}
+
+static inline __attribute__((always_inline)) void
+s16_from_24b(int16_t *dst, const uint32_t *src, size_t count, size_t stride)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i * stride] = (int16_t)(src[i] >> 8);
+    }
+}
+
+void dsp_convert_24b_to_s16(int16_t *dst, const uint32_t *src, size_t count)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        __m128i v = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(v0, 8), 16),
+                                    _mm_srai_epi32(_mm_slli_epi32(v1, 8), 16));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+#endif
+
+    s16_from_24b(dst + i, src + i, count - i, 1);
+}
+
+void dsp_convert_s16_to_24b(uint32_t *dst, const int16_t *src, size_t count)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_slli_epi32(_mm_unpacklo_epi16(v, zero), 8));
+        _mm_storeu_si128((__m128i *)(dst + i + 4),
+                         _mm_slli_epi32(_mm_unpackhi_epi16(v, zero), 8));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = (uint32_t)(uint16_t)src[i] << 8;
+    }
+}
+
+void dsp_convert_mask_24b(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi32(0xffffff);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(v, mask));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = src[i] & 0xffffff;
+    }
+}
+
+void dsp_convert_interleave_24b_to_s16(int16_t *dst, const uint32_t *src,
+                                       size_t frames, unsigned int channels)
+{
+    switch (channels) {
+    case 1:
+        dsp_convert_24b_to_s16(dst, src, frames);
+        break;
+    case 2:
+        dsp_convert_24b_to_s16_stereo(dst, src, src + frames, frames);
+        break;
+    default:
+        for (unsigned int ch = 0; ch < channels; ch++) {
+            s16_from_24b(dst + ch, src + ch * frames, frames, channels);
+        }
+        break;
+    }
+}
+
+void dsp_convert_interleave_32(uint32_t *dst, const uint32_t *src,
+                               size_t frames, unsigned int channels)
+{
+    size_t i = 0;
+
+    switch (channels) {
+    case 1:
+        memcpy(dst, src, frames * sizeof(uint32_t));
+        break;
+    case 2: {
+        const uint32_t *left = src, *right = src + frames;
+#ifdef __SSE2__
+        for (; i + 4 <= frames; i += 4) {
+            __m128i l = _mm_loadu_si128((const __m128i *)(left + i));
+            __m128i r = _mm_loadu_si128((const __m128i *)(right + i));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i),
+                             _mm_unpacklo_epi32(l, r));
+            _mm_storeu_si128((__m128i *)(dst + 2 * i + 4),
+                             _mm_unpackhi_epi32(l, r));
+        }
+#endif
+        for (; i < frames; i++) {
+            dst[2 * i + 0] = left[i];
+            dst[2 * i + 1] = right[i];
+        }
+        break;
+    }
+    default:
+        for (unsigned int ch = 0; ch < channels; ch++) {
+            const uint32_t *s = src + ch * frames;
+            for (i = 0; i < frames; i++) {
+                dst[i * channels + ch] = s[i];
+            }
+        }
+        break;
+    }
+}
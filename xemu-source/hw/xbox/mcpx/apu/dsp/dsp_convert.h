@@ -0,0 +1,56 @@
+/*
+ * MCPX DSP sample format conversion
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DSP_CONVERT_H
+#define DSP_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Convert `count` floats to 24-bit fixed point DSP words, saturating at
+ * [-1.0, 1.0). Results are identical to float_to_24b().
+ */
+void dsp_convert_float_to_24b(uint32_t *dst, const float *src, size_t count);
+
+/*
+ * Convert `count` pairs of 24-bit DSP words to interleaved signed 16-bit
+ * stereo samples by dropping the low 8 bits.
+ */
+void dsp_convert_24b_to_s16_stereo(int16_t *dst, const uint32_t *left,
+                                   const uint32_t *right, size_t count);
+
+/*
+ * Pack and unpack helpers for the DSP DMA engine. 16-bit samples are the top
+ * 16 bits of a 24-bit word, and are not sign-extended when unpacked.
+ */
+void dsp_convert_24b_to_s16(int16_t *dst, const uint32_t *src, size_t count);
+void dsp_convert_s16_to_24b(uint32_t *dst, const int16_t *src, size_t count);
+void dsp_convert_mask_24b(uint32_t *dst, const uint32_t *src, size_t count);
+
+/*
+ * Interleave `channels` planar blocks of `frames` words each, stored one
+ * after the other in `src`, into `dst`.
+ */
+void dsp_convert_interleave_24b_to_s16(int16_t *dst, const uint32_t *src,
+                                       size_t frames, unsigned int channels);
+void dsp_convert_interleave_32(uint32_t *dst, const uint32_t *src,
+                               size_t frames, unsigned int channels);
+
+#endif
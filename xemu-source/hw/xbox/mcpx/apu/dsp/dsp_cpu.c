@@ -410,6 +410,8 @@ void dsp56k_reset_cpu(dsp_core_t* dsp)
 
     dsp->exception_debugging = true;
     dsp->disasm_prev_inst_pc = 0xFFFFFFFF;
+
+    dsp56k_reset_idle_loop(dsp);
 }
 
 static const OpcodeEntry *lookup_opcode_slow(uint32_t op) {
@@ -682,6 +684,53 @@ void dsp56k_execute_instruction(dsp_core_t* dsp)
 #endif
 }
 
+/**********************************
+ *  Idle loop detection
+**********************************/
+
+/* Forget the candidate loop, e.g. when the host has touched the core */
+void dsp56k_reset_idle_loop(dsp_core_t* dsp)
+{
+    dsp->idle_loop.head = 0xFFFFFFFF;
+}
+
+/*
+ * Called after a short backward branch. Microcode waiting on the DMA or the
+ * next frame spins in a loop reading peripherals. If the core arrives back at
+ * the same loop head with identical registers and stack, and nothing was
+ * written to memory or peripherals in between, every further iteration will
+ * do exactly the same until something outside the core changes. In that case
+ * return the cycles and instructions one iteration takes so the caller can
+ * skip iterations instead of interpreting them.
+ */
+bool dsp56k_detect_idle_loop(dsp_core_t* dsp, uint32_t *cycles, uint32_t *insts)
+{
+    if (dsp->loop_rep || (dsp->registers[DSP_REG_SR] & (1 << DSP_SR_LF)) ||
+        dsp->interrupt_counter || dsp->interrupt_state != DSP_INTERRUPT_NONE) {
+        dsp56k_reset_idle_loop(dsp);
+        return false;
+    }
+
+    if (dsp->idle_loop.head == dsp->pc &&
+        dsp->idle_loop.write_count == dsp->write_count &&
+        !memcmp(dsp->idle_loop.registers, dsp->registers,
+                sizeof(dsp->registers)) &&
+        !memcmp(dsp->idle_loop.stack, dsp->stack, sizeof(dsp->stack))) {
+        /* Not crossed: num_inst counts cycles, cycle_count instructions */
+        *cycles = dsp->num_inst - dsp->idle_loop.num_inst;
+        *insts = dsp->cycle_count - dsp->idle_loop.cycle_count;
+        return *cycles > 0;
+    }
+
+    dsp->idle_loop.head = dsp->pc;
+    dsp->idle_loop.write_count = dsp->write_count;
+    dsp->idle_loop.num_inst = dsp->num_inst;
+    dsp->idle_loop.cycle_count = dsp->cycle_count;
+    memcpy(dsp->idle_loop.registers, dsp->registers, sizeof(dsp->registers));
+    memcpy(dsp->idle_loop.stack, dsp->stack, sizeof(dsp->stack));
+    return false;
+}
+
 /**********************************
  *  Update the PC
 **********************************/
@@ -972,6 +1021,8 @@ static void write_memory_raw(dsp_core_t* dsp, int space, uint32_t address, uint3
     assert((value & 0xFF000000) == 0);
     assert((address & 0xFF000000) == 0);
 
+    dsp->write_count++;
+
     if (space == DSP_SPACE_X) {
         if (address >= DSP_PERIPH_BASE) {
             assert(dsp->write_peripheral);
@@ -997,6 +1048,36 @@ static void write_memory_raw(dsp_core_t* dsp, int space, uint32_t address, uint3
     }
 }
 
+/*
+ * Returns a pointer to `count` contiguous X or Y words starting at `address`
+ * when they are all backed by the same array, or NULL if the range touches
+ * peripherals, crosses into another region, or memory writes are traced.
+ */
+uint32_t *dsp56k_get_memory_range(dsp_core_t* dsp, int space, uint32_t address, size_t count)
+{
+    if (TRACE_DSP_DISASM_MEM || count == 0) {
+        return NULL;
+    }
+
+    if (space == DSP_SPACE_X) {
+        if (address >= DSP_MIXBUFFER_BASE &&
+            address + count <= DSP_MIXBUFFER_BASE + DSP_MIXBUFFER_SIZE) {
+            return &dsp->mixbuffer[address - DSP_MIXBUFFER_BASE];
+        } else if (address >= 0xc00 &&
+                   address + count <= 0xc00 + DSP_MIXBUFFER_SIZE) {
+            return &dsp->mixbuffer[address - 0xc00];
+        } else if (address + count <= MIN(0xc00, DSP_XRAM_SIZE)) {
+            return &dsp->xram[address];
+        }
+    } else if (space == DSP_SPACE_Y) {
+        if (address + count <= DSP_YRAM_SIZE) {
+            return &dsp->yram[address];
+        }
+    }
+
+    return NULL;
+}
+
 static uint32_t read_memory_disasm(dsp_core_t* dsp, int space, uint32_t address)
 {
     return dsp56k_read_memory(dsp, space, address);
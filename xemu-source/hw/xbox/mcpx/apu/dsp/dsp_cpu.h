@@ -101,6 +101,19 @@ struct dsp_core_s {
     /* Current instruction */
     uint32_t cur_inst;
 
+    /* Number of memory and peripheral writes, for idle loop detection */
+    uint32_t write_count;
+
+    /* Core state at the head of a candidate idle loop */
+    struct {
+        uint32_t head;
+        uint32_t write_count;
+        uint32_t num_inst;
+        uint32_t cycle_count;
+        uint32_t registers[DSP_REG_MAX];
+        uint32_t stack[2][16];
+    } idle_loop;
+
     char str_disasm_memory[2][50];     /* Buffer for memory change text in disasm mode */
     uint32_t disasm_memory_ptr;        /* Pointer for memory change in disasm mode */
 
@@ -141,8 +154,15 @@ void dsp56k_execute_instruction(dsp_core_t* dsp);	/* Execute 1 instruction */
 
 uint32_t dsp56k_read_memory(dsp_core_t* dsp, int space, uint32_t address);
 void dsp56k_write_memory(dsp_core_t* dsp, int space, uint32_t address, uint32_t value);
+uint32_t *dsp56k_get_memory_range(dsp_core_t* dsp, int space, uint32_t address, size_t count);
 
 /* Interrupt relative functions */
 void dsp56k_add_interrupt(dsp_core_t* dsp, uint16_t inter);
 
+/* Idle loop detection */
+#define DSP_IDLE_LOOP_MAX_LEN 16 /* Longest loop body considered, in words */
+
+void dsp56k_reset_idle_loop(dsp_core_t* dsp);
+bool dsp56k_detect_idle_loop(dsp_core_t* dsp, uint32_t *cycles, uint32_t *insts);
+
 #endif	/* DSP_CPU_H */
@@ -20,6 +20,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/compiler.h"
+#include "dsp_convert.h"
 #include "dsp_dma.h"
 #include "dsp_dma_regs.h"
 #include "dsp_state.h"
@@ -99,6 +100,130 @@ static void scratch_circular_copy(
     }
 }
 
+typedef struct DSPDMANode {
+    uint32_t next_block;
+    uint32_t control;
+    uint32_t count;
+    uint32_t dsp_offset;
+    uint32_t scratch_offset;
+    uint32_t scratch_base;
+    uint32_t scratch_size;
+} DSPDMANode;
+
+static void map_dsp_address(uint32_t addr, uint32_t len, int *space,
+                            uint32_t *offset)
+{
+    if (addr < 0x1800) {
+        assert(addr + len < 0x1800);
+        *space = DSP_SPACE_X;
+        *offset = addr;
+    } else if (addr >= 0x1800 && addr < 0x2000) { //?
+        assert(addr + len < 0x2000);
+        *space = DSP_SPACE_Y;
+        *offset = addr - 0x1800;
+    } else if (addr >= 0x2800 && addr < 0x3800) { //?
+        assert(addr + len < 0x3800);
+        *space = DSP_SPACE_P;
+        *offset = addr - 0x2800;
+    } else {
+        fprintf(stderr, "Attempt to access %08x\n", addr);
+        assert(false);
+    }
+}
+
+/*
+ * Returns `count` words of DSP memory, pointing straight into the core's
+ * memory when the range is plain RAM and copying into `words` otherwise.
+ */
+static const uint32_t *read_words(DSPDMAState *s, int space, uint32_t addr,
+                                  size_t count)
+{
+    const uint32_t *p = dsp56k_get_memory_range(s->core, space, addr, count);
+    if (p) {
+        return p;
+    }
+
+    assert(count <= ARRAY_SIZE(s->words));
+    for (size_t i = 0; i < count; i++) {
+        s->words[i] = dsp56k_read_memory(s->core, space, addr + i);
+    }
+    return s->words;
+}
+
+/*
+ * Returns where `count` words destined for DSP memory should be built, to be
+ * committed with write_words().
+ */
+static uint32_t *begin_write_words(DSPDMAState *s, int space, uint32_t addr,
+                                   size_t count)
+{
+    uint32_t *p = dsp56k_get_memory_range(s->core, space, addr, count);
+    if (p) {
+        return p;
+    }
+
+    assert(count <= ARRAY_SIZE(s->words));
+    return s->words;
+}
+
+static void write_words(DSPDMAState *s, int space, uint32_t addr,
+                        const uint32_t *words, size_t count)
+{
+    if (words != s->words) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        dsp56k_write_memory(s->core, space, addr + i, words[i]);
+    }
+}
+
+static void read_node(DSPDMAState *s, uint32_t addr, DSPDMANode *node)
+{
+    int space;
+    uint32_t offset;
+    map_dsp_address(addr, 6, &space, &offset);
+
+    const uint32_t *w = read_words(s, space, offset, 7);
+    node->next_block = w[0];
+    node->control = w[1];
+    node->count = w[2];
+    node->dsp_offset = w[3];
+    node->scratch_offset = w[4];
+    node->scratch_base = w[5];
+    node->scratch_size = w[6] + 1;
+}
+
+static void buffer_rw(DSPDMAState *s, uint32_t buf_id, DSPDMANode *node,
+                      uint8_t *buf, size_t len, int direction)
+{
+    switch (buf_id) {
+    case 0x0:
+    case 0x1:
+    case 0x2:
+    case 0x3:
+        if (direction) {
+            s->fifo_rw(s->rw_opaque, buf, buf_id, len, 1);
+            return;
+        }
+        break;
+    case 0xE:
+        scratch_circular_copy(s, node->scratch_base, &node->scratch_offset,
+                              node->scratch_size, len, buf, direction);
+        return;
+    case 0xF:
+        s->scratch_rw(s->rw_opaque, buf,
+                      node->scratch_base + node->scratch_offset, len,
+                      direction);
+        return;
+    default:
+        break;
+    }
+
+    fprintf(stderr, "Unhandled DSP DMA buffer: 0x%x\n", buf_id);
+    assert(false);
+}
+
 static void dsp_dma_run(DSPDMAState *s)
 {
     if (!(s->control & DMA_CONTROL_RUNNING)
@@ -108,39 +233,16 @@ static void dsp_dma_run(DSPDMAState *s)
 
     while (!(s->next_block & NODE_POINTER_EOL)) {
         uint32_t addr = s->next_block & NODE_POINTER_VAL;
-        uint32_t block_addr = 0;
-        int block_space = DSP_SPACE_X;
-
-        if (addr < 0x1800) {
-            assert(addr+6 < 0x1800);
-            block_space = DSP_SPACE_X;
-            block_addr = addr;
-        } else if (addr >= 0x1800 && addr < 0x2000) { //?
-            assert(addr+6 < 0x2000);
-            block_space = DSP_SPACE_Y;
-            block_addr = addr - 0x1800;
-        } else if (addr >= 0x2800 && addr < 0x3800) { //?
-            assert(addr+6 < 0x3800);
-            block_space = DSP_SPACE_P;
-            block_addr = addr - 0x2800;
-        } else {
-            assert(false);
-        }
+        DSPDMANode node;
+        read_node(s, addr, &node);
 
-        uint32_t next_block = dsp56k_read_memory(s->core, block_space, block_addr);
-        uint32_t control = dsp56k_read_memory(s->core, block_space, block_addr+1);
-        uint32_t count = dsp56k_read_memory(s->core, block_space, block_addr+2);
-        uint32_t dsp_offset = dsp56k_read_memory(s->core, block_space, block_addr+3);
-        uint32_t scratch_offset = dsp56k_read_memory(s->core, block_space, block_addr+4);
-        uint32_t scratch_base = dsp56k_read_memory(s->core, block_space, block_addr+5);
-        uint32_t scratch_size = dsp56k_read_memory(s->core, block_space, block_addr+6)+1;
-
-        s->next_block = next_block;
+        s->next_block = node.next_block;
         if (s->next_block & NODE_POINTER_EOL) {
             s->eol = true;
         }
 
         /* Decode control word */
+        uint32_t control = node.control;
         bool     dsp_interleave          = (control >> 0) & 1;
         bool     direction               = control & NODE_CONTROL_DIRECTION;
         uint32_t unk2                    = (control >>  2) & 0x3;
@@ -156,22 +258,20 @@ static void dsp_dma_run(DSPDMAState *s)
         assert(unk13 == false);
 
         /* Decode count for interleaved mode */
+        uint32_t count = node.count;
         uint32_t channel_count = (count & 0xF) + 1;
         uint32_t block_count = count >> 4;
 
         unsigned int item_size = 4;
-        uint32_t item_mask = 0xffffffff;
         // bool lsb = (format == 6); // FIXME
 
         switch(format) {
         case 1:
             item_size = 2;
-            item_mask = 0x0000ffff;
             break;
         case 2:
         case 6:
             item_size = 4;
-            item_mask = 0x00ffffff;
             break;
         default:
             fprintf(stderr, "Unknown dsp dma format: 0x%x\n", format);
@@ -179,133 +279,64 @@ static void dsp_dma_run(DSPDMAState *s)
             break;
         }
 
-        size_t scratch_addr = scratch_base + scratch_offset;
-        uint32_t mem_address = 0;
-        int mem_space = DSP_SPACE_X;
-
-        if (dsp_offset < 0x1800) {
-            assert(dsp_offset+count < 0x1800);
-            mem_space = DSP_SPACE_X;
-            mem_address = dsp_offset;
-        } else if (dsp_offset >= 0x1800 && dsp_offset < 0x2000) { //?
-            assert(dsp_offset+count < 0x2000);
-            mem_space = DSP_SPACE_Y;
-            mem_address = dsp_offset - 0x1800;
-        } else if (dsp_offset >= 0x2800 && dsp_offset < 0x3800) { //?
-            assert(dsp_offset+count < 0x3800);
-            mem_space = DSP_SPACE_P;
-            mem_address = dsp_offset - 0x2800;
-        } else {
-            fprintf(stderr, "Attempt to access %08x\n", dsp_offset);
-            assert(false);
-        }
-
-        size_t transfer_size = count * item_size;
+        int mem_space;
+        uint32_t mem_address;
+        map_dsp_address(node.dsp_offset, count, &mem_space, &mem_address);
 
-        // FIXME: Remove this intermediate buffer
-        static uint8_t *scratch_buf = NULL;
-        static ssize_t scratch_buf_size = -1;
-        if (count * item_size > scratch_buf_size) {
-            scratch_buf_size = count * item_size;
-            scratch_buf = malloc(scratch_buf_size);
-        }
+        /* Whole blocks are moved through the staging buffer */
+        uint8_t *staging = (uint8_t *)s->staging;
 
         if (direction) {
+            size_t num_words = dsp_interleave ? block_count * channel_count :
+                                                count;
+            size_t transfer_size = num_words * item_size;
+            assert(transfer_size <= sizeof(s->staging));
+
+            const uint32_t *src = read_words(s, mem_space, mem_address,
+                                             num_words);
+
             if (dsp_interleave) {
-                // FIXME: Above xfer size calculation instead of
-                // overwriting here
-                transfer_size = block_count * item_size * channel_count;
-
-                // Interleave samples
-                for (int i = 0; i < block_count; i++) {
-                    for (int ch = 0; ch < channel_count; ch++) {
-                        uint32_t v = dsp56k_read_memory(s->core,
-                            mem_space, mem_address+ch*block_count+i);
-                        switch(item_size) {
-                        case 2:
-                            *(uint16_t*)(scratch_buf + i*2*channel_count + ch*2) = v >> 8;
-                            break;
-                        case 4:
-                            *(uint32_t*)(scratch_buf + i*4*channel_count + ch*4) = v;
-                            break;
-                        default:
-                            assert(false);
-                            break;
-                        }
-                    }
+                if (item_size == 2) {
+                    dsp_convert_interleave_24b_to_s16(
+                        (int16_t *)staging, src, block_count, channel_count);
+                } else {
+                    dsp_convert_interleave_32((uint32_t *)staging, src,
+                                              block_count, channel_count);
                 }
             } else {
-                for (int i = 0; i < count; i++) {
-                    uint32_t v = dsp56k_read_memory(s->core, mem_space, mem_address+i);
-                    switch(item_size) {
-                    case 2:
-                        *(uint16_t*)(scratch_buf + i*2) = v >> 8;
-                        break;
-                    case 4:
-                        *(uint32_t*)(scratch_buf + i*4) = v;
-                        break;
-                    default:
-                        assert(false);
-                        break;
-                    }
+                if (item_size == 2) {
+                    dsp_convert_24b_to_s16((int16_t *)staging, src, count);
+                } else {
+                    memcpy(staging, src, transfer_size);
                 }
-
             }
 
-            /* FIXME: Move to function; then reuse for both directions */
-            switch (buf_id) {
-            case 0x0:
-            case 0x1:
-            case 0x2:
-            case 0x3:
-                s->fifo_rw(s->rw_opaque, scratch_buf, buf_id, transfer_size, 1);
-                break;
-            case 0xE:
-                scratch_circular_copy(s, scratch_base, &scratch_offset, scratch_size, transfer_size, scratch_buf, 1);
-                break;
-            case 0xF:
-                s->scratch_rw(s->rw_opaque, scratch_buf, scratch_addr, transfer_size, 1);
-                break;
-            default:
-                fprintf(stderr, "Unknown DSP DMA buffer: 0x%x\n", buf_id);
-                assert(false);
-                break;
-            }
+            buffer_rw(s, buf_id, &node, staging, transfer_size, 1);
         } else {
             assert(!dsp_interleave);
 
-            if (buf_id == 0xe) {
-                scratch_circular_copy(s, scratch_base, &scratch_offset, scratch_size, transfer_size, scratch_buf, 0);
-            } else if (buf_id == 0xf) {
-                s->scratch_rw(s->rw_opaque, scratch_buf, scratch_addr, transfer_size, 0);
-            } else {
-                fprintf(stderr, "Unhandled DSP DMA buffer: 0x%x\n", buf_id);
-                assert(false);
-            }
+            size_t transfer_size = count * item_size;
+            assert(transfer_size <= sizeof(s->staging));
 
-            for (int i = 0; i < count; i++) {
-                uint32_t v;
-                switch(item_size) {
-                case 2:
-                    v = *(uint16_t*)(scratch_buf + i*2) << 8;
-                    break;
-                case 4:
-                    v = (*(uint32_t*)(scratch_buf + i*4)) & item_mask;
-                    break;
-                default:
-                    v = 0;
-                    assert(false);
-                    break;
-                }
+            buffer_rw(s, buf_id, &node, staging, transfer_size, 0);
 
-                dsp56k_write_memory(s->core, mem_space, mem_address+i, v);
+            uint32_t *dst = begin_write_words(s, mem_space, mem_address,
+                                              count);
+            if (item_size == 2) {
+                dsp_convert_s16_to_24b(dst, (int16_t *)staging, count);
+            } else {
+                dsp_convert_mask_24b(dst, (uint32_t *)staging, count);
             }
+            write_words(s, mem_space, mem_address, dst, count);
         }
 
         if (buffer_offset_writeback) {
-            dsp56k_write_memory(s->core, block_space, block_addr+4, scratch_offset);
+            int block_space;
+            uint32_t block_addr;
+            map_dsp_address(addr, 6, &block_space, &block_addr);
+            dsp56k_write_memory(s->core, block_space, block_addr + 4,
+                                node.scratch_offset);
         }
-
     }
 }
 
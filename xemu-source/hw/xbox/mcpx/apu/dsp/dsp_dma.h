@@ -29,6 +29,9 @@
 #define DMA_CONTROL_RUNNING (1 << 4)
 #define DMA_CONTROL_STOPPED (1 << 5)
 
+/* Largest transfer a single DMA node can describe, in 32-bit words */
+#define DSP_DMA_MAX_WORDS 0x3800
+
 typedef enum DSPDMARegister {
     DMA_CONFIGURATION,
     DMA_CONTROL,
@@ -50,6 +53,10 @@ typedef struct DSPDMAState {
 
     bool error;
     bool eol;
+
+    /* Staging for scratch/FIFO data, and for DSP words outside plain RAM */
+    uint32_t staging[DSP_DMA_MAX_WORDS];
+    uint32_t words[DSP_DMA_MAX_WORDS];
 } DSPDMAState;
 
 uint32_t dsp_dma_read(DSPDMAState *s, DSPDMARegister reg);
@@ -0,0 +1,120 @@
+/*
+ * MCPX DSP scatter-gather translation
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "dsp_sg.h"
+
+void dsp_sg_cache_init(DSPSGCache *c)
+{
+    memset(c, 0, sizeof(*c));
+}
+
+void dsp_sg_cache_finalize(DSPSGCache *c)
+{
+    g_free(c->pages);
+    g_free(c->run_pages);
+    memset(c, 0, sizeof(*c));
+}
+
+void dsp_sg_cache_invalidate(DSPSGCache *c)
+{
+    c->valid = false;
+}
+
+bool dsp_sg_cache_update(DSPSGCache *c, const uint8_t *ram, size_t ram_size,
+                         uint32_t base, unsigned int max_sge)
+{
+    if (c->valid && c->base == base && c->max_sge == max_sge) {
+        return false;
+    }
+
+    /*
+     * Only entries that lie in RAM are cached. Transfers through entries
+     * beyond that were never valid and are caught by dsp_sg_rw.
+     */
+    size_t num_entries = (size_t)max_sge + 1;
+    if (base >= ram_size) {
+        num_entries = 0;
+    } else {
+        num_entries = MIN(num_entries, (ram_size - base) / DSP_SG_ENTRY_SIZE);
+    }
+
+    if (num_entries > c->capacity) {
+        c->capacity = num_entries;
+        c->pages = g_renew(uint32_t, c->pages, c->capacity);
+        c->run_pages = g_renew(uint32_t, c->run_pages, c->capacity);
+    }
+
+    const uint8_t *table = ram + base;
+    for (size_t i = 0; i < num_entries; i++) {
+        c->pages[i] = ldl_le_p(table + i * DSP_SG_ENTRY_SIZE);
+    }
+
+    for (size_t i = num_entries; i-- > 0;) {
+        bool contiguous = i + 1 < num_entries &&
+                          c->pages[i + 1] == c->pages[i] + DSP_SG_PAGE_SIZE;
+        c->run_pages[i] = contiguous ? c->run_pages[i + 1] + 1 : 1;
+    }
+
+    c->valid = true;
+    c->base = base;
+    c->max_sge = max_sge;
+    c->num_entries = num_entries;
+
+    return true;
+}
+
+void dsp_sg_rw(const DSPSGCache *c, uint8_t *ram, size_t ram_size,
+               uint8_t *ptr, uint32_t addr, size_t len, bool dir,
+               dsp_sg_dirty_func dirty, void *opaque)
+{
+    unsigned int page_entry = addr / DSP_SG_PAGE_SIZE;
+    size_t offset_in_run = addr % DSP_SG_PAGE_SIZE;
+
+    assert(c->valid);
+
+    while (len > 0) {
+        assert(page_entry <= c->max_sge);
+        assert(page_entry < c->num_entries);
+
+        size_t run_size =
+            (size_t)c->run_pages[page_entry] * DSP_SG_PAGE_SIZE;
+        size_t bytes_to_copy = MIN(run_size - offset_in_run, len);
+        size_t paddr = (size_t)c->pages[page_entry] + offset_in_run;
+
+        assert(paddr + bytes_to_copy < ram_size);
+
+        if (dir) {
+            memcpy(&ram[paddr], ptr, bytes_to_copy);
+            if (dirty) {
+                dirty(opaque, paddr, bytes_to_copy);
+            }
+        } else {
+            memcpy(ptr, &ram[paddr], bytes_to_copy);
+        }
+
+        ptr += bytes_to_copy;
+        len -= bytes_to_copy;
+
+        /* After the first run, we are page aligned */
+        page_entry += c->run_pages[page_entry];
+        offset_in_run = 0;
+    }
+}
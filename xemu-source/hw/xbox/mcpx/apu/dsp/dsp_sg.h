@@ -0,0 +1,75 @@
+/*
+ * MCPX DSP scatter-gather translation
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DSP_SG_H
+#define DSP_SG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size of the guest page described by one scatter-gather entry */
+#define DSP_SG_PAGE_SIZE 4096
+
+/* Size of one scatter-gather entry (address, control) */
+#define DSP_SG_ENTRY_SIZE 8
+
+typedef void (*dsp_sg_dirty_func)(void *opaque, uint32_t addr, size_t len);
+
+/*
+ * Host copy of a GP/EP scratch or FIFO scatter-gather table. Each entry
+ * records the physical page address and the number of following pages that
+ * are physically contiguous with it, so transfers can be done with one copy
+ * per contiguous run instead of one table lookup and copy per page.
+ *
+ * The cache does not observe guest writes to the table itself; callers must
+ * invalidate it when the table memory is modified.
+ */
+typedef struct DSPSGCache {
+    bool valid;
+    uint32_t base;
+    unsigned int max_sge;
+    unsigned int num_entries;
+    unsigned int capacity;
+    uint32_t *pages;
+    uint32_t *run_pages;
+    uint32_t generation; /* Content generation of the table, owned by caller */
+} DSPSGCache;
+
+void dsp_sg_cache_init(DSPSGCache *c);
+void dsp_sg_cache_finalize(DSPSGCache *c);
+void dsp_sg_cache_invalidate(DSPSGCache *c);
+
+/*
+ * Ensure the cache describes the table at `base` with entries 0..`max_sge`,
+ * reloading it from `ram` if it is invalid or the table location changed.
+ * Returns true if the table was reloaded.
+ */
+bool dsp_sg_cache_update(DSPSGCache *c, const uint8_t *ram, size_t ram_size,
+                         uint32_t base, unsigned int max_sge);
+
+/*
+ * Copy `len` bytes between `ptr` and scatter-gathered offset `addr`. When
+ * writing (`dir` set), `dirty` is called once per physically contiguous run.
+ */
+void dsp_sg_rw(const DSPSGCache *c, uint8_t *ram, size_t ram_size,
+               uint8_t *ptr, uint32_t addr, size_t len, bool dir,
+               dsp_sg_dirty_func dirty, void *opaque);
+
+#endif
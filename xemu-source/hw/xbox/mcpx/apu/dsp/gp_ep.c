@@ -44,45 +44,45 @@ void mcpx_apu_update_dsp_preference(MCPXAPUState *d)
     last_known_preference = g_config.audio.use_dsp;
 }
 
-static void scatter_gather_rw(MCPXAPUState *d, hwaddr sge_base,
-                              unsigned int max_sge, uint8_t *ptr, uint32_t addr,
-                              size_t len, bool dir)
+static void scatter_gather_set_dirty(void *opaque, uint32_t addr, size_t len)
 {
-    unsigned int page_entry = addr / TARGET_PAGE_SIZE;
-    unsigned int offset_in_page = addr % TARGET_PAGE_SIZE;
-    unsigned int bytes_to_copy = TARGET_PAGE_SIZE - offset_in_page;
-
-    while (len > 0) {
-        assert(page_entry <= max_sge);
-
-        uint32_t prd_address = ldl_le_phys(&address_space_memory,
-                                           sge_base + page_entry * 8 + 0);
-        // uint32_t prd_control = ldl_le_phys(&address_space_memory,
-        //                                     sge_base + page_entry * 8 + 4);
-
-        hwaddr paddr = prd_address + offset_in_page;
-
-        if (bytes_to_copy > len) {
-            bytes_to_copy = len;
-        }
-
-        assert(paddr + bytes_to_copy < memory_region_size(d->ram));
+    MCPXAPUState *d = opaque;
+    memory_region_set_dirty(d->ram, addr, len);
+}
 
-        if (dir) {
-            memcpy(&d->ram_ptr[paddr], ptr, bytes_to_copy);
-            memory_region_set_dirty(d->ram, paddr, bytes_to_copy);
-        } else {
-            memcpy(ptr, &d->ram_ptr[paddr], bytes_to_copy);
+/*
+ * Translations are cached per table and revalidated on each transfer: the
+ * table location comes from the *SADDR/*FADDR and *MAXSGE registers, and
+ * guest writes to the table are detected through the APU page generations.
+ */
+static void scatter_gather_rw(MCPXAPUState *d, DSPSGCache *cache,
+                              hwaddr sge_base, unsigned int max_sge,
+                              uint8_t *ptr, uint32_t addr, size_t len,
+                              bool dir)
+{
+    hwaddr ram_size = memory_region_size(d->ram);
+
+    if (sge_base < ram_size) {
+        hwaddr table_size = MIN(((hwaddr)max_sge + 1) * DSP_SG_ENTRY_SIZE,
+                                ram_size - sge_base);
+        uint32_t gen = mcpx_apu_ram_generation(d, sge_base, table_size);
+        if (gen != cache->generation) {
+            dsp_sg_cache_invalidate(cache);
+            cache->generation = gen;
         }
+    }
 
-        ptr += bytes_to_copy;
-        len -= bytes_to_copy;
+    dsp_sg_cache_update(cache, d->ram_ptr, ram_size, sge_base, max_sge);
+    dsp_sg_rw(cache, d->ram_ptr, ram_size, ptr, addr, len, dir,
+              scatter_gather_set_dirty, d);
+}
 
-        /* After the first iteration, we are page aligned */
-        page_entry += 1;
-        bytes_to_copy = TARGET_PAGE_SIZE;
-        offset_in_page = 0;
-    }
+void mcpx_apu_dsp_invalidate_sg(MCPXAPUState *d)
+{
+    dsp_sg_cache_invalidate(&d->gp.scratch_sg);
+    dsp_sg_cache_invalidate(&d->gp.fifo_sg);
+    dsp_sg_cache_invalidate(&d->ep.scratch_sg);
+    dsp_sg_cache_invalidate(&d->ep.fifo_sg);
 }
 
 static void gp_scratch_rw(void *opaque, uint8_t *ptr, uint32_t addr, size_t len,
@@ -90,8 +90,8 @@ static void gp_scratch_rw(void *opaque, uint8_t *ptr, uint32_t addr, size_t len,
 {
     MCPXAPUState *d = opaque;
     // fprintf(stderr, "GP %s scratch 0x%x bytes (0x%x words) at %x (0x%x words)\n", dir ? "writing to" : "reading from", len, len/4, addr, addr/4);
-    scatter_gather_rw(d, d->regs[NV_PAPU_GPSADDR], d->regs[NV_PAPU_GPSMAXSGE],
-                      ptr, addr, len, dir);
+    scatter_gather_rw(d, &d->gp.scratch_sg, d->regs[NV_PAPU_GPSADDR],
+                      d->regs[NV_PAPU_GPSMAXSGE], ptr, addr, len, dir);
 }
 
 static void ep_scratch_rw(void *opaque, uint8_t *ptr, uint32_t addr, size_t len,
@@ -99,11 +99,12 @@ static void ep_scratch_rw(void *opaque, uint8_t *ptr, uint32_t addr, size_t len,
 {
     MCPXAPUState *d = opaque;
     // fprintf(stderr, "EP %s scratch 0x%x bytes (0x%x words) at %x (0x%x words)\n", dir ? "writing to" : "reading from", len, len/4, addr, addr/4);
-    scatter_gather_rw(d, d->regs[NV_PAPU_EPSADDR], d->regs[NV_PAPU_EPSMAXSGE],
-                      ptr, addr, len, dir);
+    scatter_gather_rw(d, &d->ep.scratch_sg, d->regs[NV_PAPU_EPSADDR],
+                      d->regs[NV_PAPU_EPSMAXSGE], ptr, addr, len, dir);
 }
 
-static uint32_t circular_scatter_gather_rw(MCPXAPUState *d, hwaddr sge_base,
+static uint32_t circular_scatter_gather_rw(MCPXAPUState *d, DSPSGCache *cache,
+                                           hwaddr sge_base,
                                            unsigned int max_sge, uint8_t *ptr,
                                            uint32_t base, uint32_t end,
                                            uint32_t cur, size_t len, bool dir)
@@ -120,7 +121,8 @@ static uint32_t circular_scatter_gather_rw(MCPXAPUState *d, hwaddr sge_base,
                 dir ? "write" : "read", base, end, cur, bytes_to_copy, len);
 
         assert((cur >= base) && ((cur + bytes_to_copy) <= end));
-        scatter_gather_rw(d, sge_base, max_sge, ptr, cur, bytes_to_copy, dir);
+        scatter_gather_rw(d, cache, sge_base, max_sge, ptr, cur, bytes_to_copy,
+                          dir);
 
         ptr += bytes_to_copy;
         len -= bytes_to_copy;
@@ -171,7 +173,7 @@ static void gp_fifo_rw(void *opaque, uint8_t *ptr, unsigned int index,
         cur = base;
     }
 
-    cur = circular_scatter_gather_rw(d,
+    cur = circular_scatter_gather_rw(d, &d->gp.fifo_sg,
         d->regs[NV_PAPU_GPFADDR], d->regs[NV_PAPU_GPFMAXSGE],
         ptr, base, end, cur, len, dir);
 
@@ -237,7 +239,7 @@ static void ep_fifo_rw(void *opaque, uint8_t *ptr, unsigned int index,
         cur = base;
     }
 
-    cur = circular_scatter_gather_rw(d,
+    cur = circular_scatter_gather_rw(d, &d->ep.fifo_sg,
         d->regs[NV_PAPU_EPFADDR], d->regs[NV_PAPU_EPFMAXSGE],
         ptr, base, end, cur, len, dir);
 
@@ -302,7 +304,7 @@ static void gp_write(void *opaque, hwaddr addr, uint64_t val, unsigned int size)
 {
     MCPXAPUState *d = opaque;
 
-    qemu_mutex_lock(&d->lock);
+    qemu_mutex_lock(&d->gp.lock);
 
     assert(size == 4);
     assert(addr % 4 == 0);
@@ -343,7 +345,7 @@ static void gp_write(void *opaque, hwaddr addr, uint64_t val, unsigned int size)
         break;
     }
 
-    qemu_mutex_unlock(&d->lock);
+    qemu_mutex_unlock(&d->gp.lock);
 }
 
 const MemoryRegionOps gp_ops = {
@@ -392,7 +394,7 @@ static void ep_write(void *opaque, hwaddr addr, uint64_t val, unsigned int size)
 {
     MCPXAPUState *d = opaque;
 
-    qemu_mutex_lock(&d->lock);
+    qemu_mutex_lock(&d->ep.lock);
 
     assert(size == 4);
     assert(addr % 4 == 0);
@@ -421,14 +423,14 @@ static void ep_write(void *opaque, hwaddr addr, uint64_t val, unsigned int size)
     case NV_PAPU_EPRST:
         proc_rst_write(d->ep.dsp, d->ep.regs[NV_PAPU_EPRST], val);
         d->ep.regs[NV_PAPU_EPRST] = val;
-        d->ep_frame_div = 0; /* FIXME: Still unsure about frame sync */
+        qatomic_set(&d->ep_frame_div, 0); /* FIXME: Still unsure about frame sync */
         break;
     default:
         d->ep.regs[addr] = val;
         break;
     }
 
-    qemu_mutex_unlock(&d->lock);
+    qemu_mutex_unlock(&d->ep.lock);
 }
 
 const MemoryRegionOps ep_ops = {
@@ -436,61 +438,379 @@ const MemoryRegionOps ep_ops = {
     .write = ep_write,
 };
 
-void mcpx_apu_dsp_frame(MCPXAPUState *d, float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME])
+static bool gp_enabled(MCPXAPUState *d)
+{
+    return (d->gp.regs[NV_PAPU_GPRST] & NV_PAPU_GPRST_GPRST) &&
+           (d->gp.regs[NV_PAPU_GPRST] & NV_PAPU_GPRST_GPDSPRST);
+}
+
+static bool ep_enabled(MCPXAPUState *d)
+{
+    return (d->ep.regs[NV_PAPU_EPRST] & NV_PAPU_GPRST_GPRST) &&
+           (d->ep.regs[NV_PAPU_EPRST] & NV_PAPU_GPRST_GPDSPRST);
+}
+
+/* Called with pipeline lock held */
+static void pipeline_wait_for(MCPXAPUDSPPipeline *p, bool *a, bool *b,
+                              int *stalls, int64_t *stall_us)
+{
+    if (!*a && !*b) {
+        return;
+    }
+
+    int64_t start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    while ((*a || *b) && !p->exiting) {
+        qemu_cond_wait(&p->cond, &p->lock);
+    }
+    *stalls += 1;
+    *stall_us += qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start;
+}
+
+static void ep_submit(MCPXAPUState *d)
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    pipeline_wait_for(p, &p->ep_pending, &p->ep_busy, &p->ep_stalls,
+                      &p->ep_stall_us);
+    p->ep_pending = true;
+    qemu_cond_broadcast(&p->cond);
+    qemu_mutex_unlock(&p->lock);
+}
+
+static void ep_wait_idle(MCPXAPUState *d)
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    pipeline_wait_for(p, &p->ep_pending, &p->ep_busy, &p->ep_stalls,
+                      &p->ep_stall_us);
+    qemu_mutex_unlock(&p->lock);
+}
+
+/* Returns the time taken, the cycle count goes to @cycles if the EP ran */
+static int64_t ep_frame(MCPXAPUState *d, int *cycles)
 {
-    /* Write VP results to the GP DSP MIXBUF */
-    for (int mixbin = 0; mixbin < NUM_MIXBINS; mixbin++) {
-        uint32_t base = GP_DSP_MIXBUF_BASE + mixbin * NUM_SAMPLES_PER_FRAME;
-        for (int sample = 0; sample < NUM_SAMPLES_PER_FRAME; sample++) {
-            dsp_write_memory(d->gp.dsp, 'X', base + sample,
-                             float_to_24b(mixbins[mixbin][sample]));
+    int64_t start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+
+    qemu_mutex_lock(&d->ep.lock);
+    if (ep_enabled(d)) {
+        dsp_start_frame(d->ep.dsp);
+        d->ep.dsp->core.is_idle = false;
+        d->ep.dsp->core.cycle_count = 0;
+        do {
+            dsp_run(d->ep.dsp, 1000);
+        } while (!d->ep.dsp->core.is_idle && d->ep.realtime);
+        *cycles = d->ep.dsp->core.cycle_count;
+    }
+    qemu_mutex_unlock(&d->ep.lock);
+
+    return qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start;
+}
+
+/* Copy only the mixbins the VP wrote this frame */
+static void copy_active_mixbins(float dst[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME],
+                                float src[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME],
+                                uint32_t active)
+{
+    for (uint32_t m = active; m; m &= m - 1) {
+        int b = ctz32(m);
+        memcpy(dst[b], src[b], sizeof(dst[b]));
+    }
+}
+
+/*
+ * Write VP results to the GP DSP MIXBUF. Silent mixbins are zero filled
+ * without going through the float conversion.
+ */
+static void gp_write_mixbuf(MCPXAPUState *d,
+                            float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME],
+                            uint32_t active)
+{
+    static const uint32_t zero[NUM_SAMPLES_PER_FRAME];
+
+    if (active == UINT32_MAX) {
+        dsp_write_memory_float(d->gp.dsp, 'X', GP_DSP_MIXBUF_BASE,
+                               &mixbins[0][0],
+                               NUM_MIXBINS * NUM_SAMPLES_PER_FRAME);
+        return;
+    }
+
+    for (int b = 0; b < NUM_MIXBINS; b++) {
+        uint32_t addr = GP_DSP_MIXBUF_BASE + b * NUM_SAMPLES_PER_FRAME;
+        if (active & (1u << b)) {
+            dsp_write_memory_float(d->gp.dsp, 'X', addr, mixbins[b],
+                                   NUM_SAMPLES_PER_FRAME);
+        } else {
+            dsp_write_memory_block(d->gp.dsp, 'X', addr, zero,
+                                   NUM_SAMPLES_PER_FRAME);
         }
     }
+}
+
+/* As ep_frame(), the time taken does not include waiting for the EP */
+static int64_t gp_frame(MCPXAPUState *d,
+                        float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME],
+                        uint32_t mixbins_active, bool vp_monitor_valid,
+                        int16_t vp_monitor[NUM_SAMPLES_PER_FRAME][2],
+                        int *cycles)
+{
+    int64_t start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    int frame_div = qatomic_read(&d->ep_frame_div);
+    int off = (frame_div % 8) * NUM_SAMPLES_PER_FRAME;
+
+    qemu_mutex_lock(&d->ep.lock);
+    bool run_ep = ep_enabled(d);
+    qemu_mutex_unlock(&d->ep.lock);
 
-    bool ep_enabled = (d->ep.regs[NV_PAPU_EPRST] & NV_PAPU_GPRST_GPRST) &&
-                      (d->ep.regs[NV_PAPU_EPRST] & NV_PAPU_GPRST_GPDSPRST);
+    qemu_mutex_lock(&d->gp.lock);
+
+    gp_write_mixbuf(d, mixbins, mixbins_active);
 
     /* Run GP */
-    if ((d->gp.regs[NV_PAPU_GPRST] & NV_PAPU_GPRST_GPRST) &&
-        (d->gp.regs[NV_PAPU_GPRST] & NV_PAPU_GPRST_GPDSPRST)) {
+    if (gp_enabled(d)) {
         dsp_start_frame(d->gp.dsp);
         d->gp.dsp->core.is_idle = false;
         d->gp.dsp->core.cycle_count = 0;
         do {
             dsp_run(d->gp.dsp, 1000);
         } while (!d->gp.dsp->core.is_idle && d->gp.realtime);
-        g_dbg.gp.cycles = d->gp.dsp->core.cycle_count;
+        *cycles = d->gp.dsp->core.cycle_count;
 
         if ((d->monitor.point == MCPX_APU_DEBUG_MON_GP) ||
-            (d->monitor.point == MCPX_APU_DEBUG_MON_GP_OR_EP && !ep_enabled)) {
-            int off = (d->ep_frame_div % 8) * NUM_SAMPLES_PER_FRAME;
-            for (int i = 0; i < NUM_SAMPLES_PER_FRAME; i++) {
-                uint32_t l = dsp_read_memory(d->gp.dsp, 'X', 0x1400 + i);
-                d->monitor.frame_buf[off + i][0] = l >> 8;
-                uint32_t r =
-                    dsp_read_memory(d->gp.dsp, 'X', 0x1400 + 1 * 0x20 + i);
-                d->monitor.frame_buf[off + i][1] = r >> 8;
-            }
+            (d->monitor.point == MCPX_APU_DEBUG_MON_GP_OR_EP && !run_ep)) {
+            dsp_read_memory_s16_stereo(d->gp.dsp, 'X', 0x1400,
+                                       0x1400 + 1 * 0x20,
+                                       &d->monitor.frame_buf[off][0],
+                                       NUM_SAMPLES_PER_FRAME);
+        }
+    }
+
+    qemu_mutex_unlock(&d->gp.lock);
+
+    if (vp_monitor_valid) {
+        for (int i = 0; i < NUM_SAMPLES_PER_FRAME; i++) {
+            d->monitor.frame_buf[off + i][0] += vp_monitor[i][0];
+            d->monitor.frame_buf[off + i][1] += vp_monitor[i][1];
+        }
+    }
+
+    int64_t time_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start;
+
+    /*
+     * The EP runs once every 8 frames, after the first GP frame of the group,
+     * and finishes before the group's monitor frame is pushed.
+     */
+    if (run_ep && frame_div % 8 == 0) {
+        ep_submit(d);
+    }
+
+    if ((frame_div + 1) % 8 == 0) {
+        ep_wait_idle(d);
+        mcpx_apu_monitor_push_frame(d);
+    }
+
+    qatomic_cmpxchg(&d->ep_frame_div, frame_div, frame_div + 1);
+
+    return time_us;
+}
+
+static void *gp_thread(void *arg)
+{
+    MCPXAPUState *d = arg;
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+    float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME];
+    int16_t vp_monitor[NUM_SAMPLES_PER_FRAME][2];
+
+    rcu_register_thread();
+    thread_placement_enter(THREAD_CLASS_DSP, 0);
+
+    qemu_mutex_lock(&p->lock);
+    while (true) {
+        while (!p->gp_pending && !p->exiting) {
+            qemu_cond_wait(&p->cond, &p->lock);
+        }
+        if (p->exiting) {
+            break;
         }
+
+        uint32_t mixbins_active = p->mixbins_active;
+        copy_active_mixbins(mixbins, p->mixbins, mixbins_active);
+        bool vp_monitor_valid = p->vp_monitor_valid;
+        if (vp_monitor_valid) {
+            memcpy(vp_monitor, p->vp_monitor, sizeof(vp_monitor));
+        }
+        p->gp_pending = false;
+        p->gp_busy = true;
+        qemu_cond_broadcast(&p->cond);
+        qemu_mutex_unlock(&p->lock);
+
+        int cycles = 0;
+        int64_t time_us = gp_frame(d, mixbins, mixbins_active,
+                                   vp_monitor_valid, vp_monitor, &cycles);
+
+        qemu_mutex_lock(&p->lock);
+        p->gp_time_us = time_us;
+        p->gp_cycles = cycles;
+        p->gp_total_us += time_us;
+        p->gp_busy = false;
+        qemu_cond_broadcast(&p->cond);
+    }
+    qemu_mutex_unlock(&p->lock);
+
+    thread_placement_leave();
+    rcu_unregister_thread();
+    return NULL;
+}
+
+static void *ep_thread(void *arg)
+{
+    MCPXAPUState *d = arg;
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    rcu_register_thread();
+    thread_placement_enter(THREAD_CLASS_DSP, 1);
+
+    qemu_mutex_lock(&p->lock);
+    while (true) {
+        while (!p->ep_pending && !p->exiting) {
+            qemu_cond_wait(&p->cond, &p->lock);
+        }
+        if (p->exiting) {
+            break;
+        }
+
+        p->ep_pending = false;
+        p->ep_busy = true;
+        qemu_mutex_unlock(&p->lock);
+
+        int cycles = 0;
+        int64_t time_us = ep_frame(d, &cycles);
+
+        qemu_mutex_lock(&p->lock);
+        p->ep_time_us = time_us;
+        p->ep_cycles = cycles;
+        p->ep_total_us += time_us;
+        p->ep_busy = false;
+        qemu_cond_broadcast(&p->cond);
+    }
+    qemu_mutex_unlock(&p->lock);
+
+    thread_placement_leave();
+    rcu_unregister_thread();
+    return NULL;
+}
+
+/*
+ * Hand the VP output for this frame to the GP thread. The handoff buffer is
+ * free again as soon as the GP thread has picked up the previous frame, so
+ * the VP only stalls here if the GP falls more than a frame behind.
+ */
+void mcpx_apu_dsp_frame(MCPXAPUState *d, float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME])
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    pipeline_wait_for(p, &p->gp_pending, &p->gp_pending, &p->gp_stalls,
+                      &p->gp_stall_us);
+    if (p->exiting) {
+        qemu_mutex_unlock(&p->lock);
+        return;
     }
 
-    /* Run EP */
-    if ((d->ep.regs[NV_PAPU_EPRST] & NV_PAPU_GPRST_GPRST) &&
-        (d->ep.regs[NV_PAPU_EPRST] & NV_PAPU_GPRST_GPDSPRST)) {
-        if (d->ep_frame_div % 8 == 0) {
-            dsp_start_frame(d->ep.dsp);
-            d->ep.dsp->core.is_idle = false;
-            d->ep.dsp->core.cycle_count = 0;
-            do {
-                dsp_run(d->ep.dsp, 1000);
-            } while (!d->ep.dsp->core.is_idle && d->ep.realtime);
-            g_dbg.ep.cycles = d->ep.dsp->core.cycle_count;
+    /* The GP and EP threads leave g_dbg to this thread */
+    g_dbg.gp.cycles = p->gp_cycles;
+    g_dbg.ep.cycles = p->ep_cycles;
+    g_dbg.pipeline.gp_time_us = p->gp_time_us;
+    g_dbg.pipeline.ep_time_us = p->ep_time_us;
+
+    copy_active_mixbins(p->mixbins, mixbins, d->vp.mixbins_active);
+    p->mixbins_active = d->vp.mixbins_active;
+    p->vp_monitor_valid = d->vp.monitor_valid;
+    if (p->vp_monitor_valid) {
+        memcpy(p->vp_monitor, d->vp.monitor_buf, sizeof(p->vp_monitor));
+    }
+    p->gp_pending = true;
+    qemu_cond_broadcast(&p->cond);
+    qemu_mutex_unlock(&p->lock);
+}
+
+/* Wait for all submitted frames to have passed through the GP and EP */
+void mcpx_apu_dsp_pipeline_drain(MCPXAPUState *d)
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    while ((p->gp_pending || p->gp_busy || p->ep_pending || p->ep_busy) &&
+           !p->exiting) {
+        qemu_cond_wait(&p->cond, &p->lock);
+    }
+    qemu_mutex_unlock(&p->lock);
+}
+
+void mcpx_apu_dsp_pipeline_update_stats(MCPXAPUState *d)
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    g_dbg.pipeline.gp_stalls = p->gp_stalls;
+    g_dbg.pipeline.gp_stall_us = p->gp_stall_us;
+    g_dbg.pipeline.ep_stalls = p->ep_stalls;
+    g_dbg.pipeline.ep_stall_us = p->ep_stall_us;
+    p->gp_stalls = 0;
+    p->gp_stall_us = 0;
+    p->ep_stalls = 0;
+    p->ep_stall_us = 0;
+    qemu_mutex_unlock(&p->lock);
+}
+
+void mcpx_apu_dsp_pipeline_get_totals(MCPXAPUState *d, int64_t *gp_us,
+                                      int64_t *ep_us)
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    *gp_us = p->gp_total_us;
+    *ep_us = p->ep_total_us;
+    qemu_mutex_unlock(&p->lock);
+}
+
+static void capture_sge_table(MCPXAPUState *d, MCPXAPUCaptureRangeFunc func,
+                              void *opaque, hwaddr base, unsigned int max_sge)
+{
+    func(opaque, base, ((hwaddr)max_sge + 1) * DSP_SG_ENTRY_SIZE);
+    for (hwaddr i = 0; i <= max_sge; i++) {
+        hwaddr entry = base + i * DSP_SG_ENTRY_SIZE;
+        if (entry + DSP_SG_ENTRY_SIZE > memory_region_size(d->ram)) {
+            break;
         }
+        func(opaque, ldl_le_p(&d->ram_ptr[entry]), DSP_SG_PAGE_SIZE);
     }
 }
 
+/* Report the scratch and FIFO pages the GP and EP DMA engines can reach */
+void mcpx_apu_dsp_capture_ranges(MCPXAPUState *d, MCPXAPUCaptureRangeFunc func,
+                                 void *opaque)
+{
+    capture_sge_table(d, func, opaque, d->regs[NV_PAPU_GPSADDR],
+                      d->regs[NV_PAPU_GPSMAXSGE]);
+    capture_sge_table(d, func, opaque, d->regs[NV_PAPU_GPFADDR],
+                      d->regs[NV_PAPU_GPFMAXSGE]);
+    capture_sge_table(d, func, opaque, d->regs[NV_PAPU_EPSADDR],
+                      d->regs[NV_PAPU_EPSMAXSGE]);
+    capture_sge_table(d, func, opaque, d->regs[NV_PAPU_EPFADDR],
+                      d->regs[NV_PAPU_EPFMAXSGE]);
+}
+
 void mcpx_apu_dsp_init(MCPXAPUState *d)
 {
+    qemu_mutex_init(&d->gp.lock);
+    qemu_mutex_init(&d->ep.lock);
+    dsp_sg_cache_init(&d->gp.scratch_sg);
+    dsp_sg_cache_init(&d->gp.fifo_sg);
+    dsp_sg_cache_init(&d->ep.scratch_sg);
+    dsp_sg_cache_init(&d->ep.fifo_sg);
+
     d->gp.dsp = dsp_init(d, gp_scratch_rw, gp_fifo_rw);
     for (int i = 0; i < DSP_PRAM_SIZE; i++) {
         d->gp.dsp->core.pram[i] = 0xCACACACA;
@@ -523,4 +843,26 @@ void mcpx_apu_dsp_init(MCPXAPUState *d)
      * use the full audio pipeline or not.
      */
     mcpx_apu_update_dsp_preference(d);
+
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+    qemu_mutex_init(&p->lock);
+    qemu_cond_init(&p->cond);
+    p->exiting = false;
+    qemu_thread_create(&p->gp_thread, "mcpx.gp_thread", gp_thread, d,
+                       QEMU_THREAD_JOINABLE);
+    qemu_thread_create(&p->ep_thread, "mcpx.ep_thread", ep_thread, d,
+                       QEMU_THREAD_JOINABLE);
+}
+
+void mcpx_apu_dsp_finalize(MCPXAPUState *d)
+{
+    MCPXAPUDSPPipeline *p = &d->dsp_pipeline;
+
+    qemu_mutex_lock(&p->lock);
+    p->exiting = true;
+    qemu_cond_broadcast(&p->cond);
+    qemu_mutex_unlock(&p->lock);
+
+    qemu_thread_join(&p->gp_thread);
+    qemu_thread_join(&p->ep_thread);
 }
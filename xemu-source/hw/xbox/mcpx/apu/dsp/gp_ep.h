@@ -25,33 +25,90 @@
 #include "hw/hw.h"
 #include "hw/pci/pci.h"
 #include "hw/xbox/mcpx/apu/apu_regs.h"
+#include "hw/xbox/mcpx/apu/capture.h"
 
 #include "dsp.h"
 #include "dsp_dma.h"
 #include "dsp_cpu.h"
 #include "dsp_state.h"
+#include "dsp_sg.h"
 
 typedef struct MCPXAPUState MCPXAPUState;
 
 typedef struct MCPXAPUGPState {
     bool realtime;
     MemoryRegion mmio;
+    QemuMutex lock;
     DSPState *dsp;
+    DSPSGCache scratch_sg;
+    DSPSGCache fifo_sg;
     uint32_t regs[0x10000];
 } MCPXAPUGPState;
 
 typedef struct MCPXAPUEPState {
     bool realtime;
     MemoryRegion mmio;
+    QemuMutex lock;
     DSPState *dsp;
+    DSPSGCache scratch_sg;
+    DSPSGCache fifo_sg;
     uint32_t regs[0x10000];
 } MCPXAPUEPState;
 
+/*
+ * The GP and EP each run on their own thread so that the VP can work on the
+ * next frame while the GP processes the current one, and the EP can process
+ * a completed group of GP frames while the GP moves on to the next group.
+ */
+typedef struct MCPXAPUDSPPipeline {
+    QemuThread gp_thread;
+    QemuThread ep_thread;
+    QemuMutex lock;
+    QemuCond cond;
+    bool exiting;
+
+    /* VP to GP handoff */
+    bool gp_pending;
+    bool gp_busy;
+    float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME];
+    uint32_t mixbins_active; /* Other mixbins are silent and left stale */
+    bool vp_monitor_valid;
+    int16_t vp_monitor[NUM_SAMPLES_PER_FRAME][2];
+
+    /* GP to EP handoff */
+    bool ep_pending;
+    bool ep_busy;
+
+    /* Stalls since the last mcpx_apu_dsp_pipeline_update_stats() */
+    int gp_stalls;
+    int64_t gp_stall_us;
+    int ep_stalls;
+    int64_t ep_stall_us;
+
+    /* Last frame, written by the GP and EP threads */
+    int64_t gp_time_us;
+    int gp_cycles;
+    int64_t ep_time_us;
+    int ep_cycles;
+
+    /* Running totals, never reset */
+    int64_t gp_total_us;
+    int64_t ep_total_us;
+} MCPXAPUDSPPipeline;
+
 extern const MemoryRegionOps gp_ops;
 extern const MemoryRegionOps ep_ops;
 
 void mcpx_apu_dsp_init(MCPXAPUState *d);
+void mcpx_apu_dsp_finalize(MCPXAPUState *d);
 void mcpx_apu_update_dsp_preference(MCPXAPUState *d);
+void mcpx_apu_dsp_invalidate_sg(MCPXAPUState *d);
 void mcpx_apu_dsp_frame(MCPXAPUState *d, float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME]);
+void mcpx_apu_dsp_pipeline_drain(MCPXAPUState *d);
+void mcpx_apu_dsp_pipeline_update_stats(MCPXAPUState *d);
+void mcpx_apu_dsp_pipeline_get_totals(MCPXAPUState *d, int64_t *gp_us,
+                                      int64_t *ep_us);
+void mcpx_apu_dsp_capture_ranges(MCPXAPUState *d, MCPXAPUCaptureRangeFunc func,
+                                 void *opaque);
 
 #endif
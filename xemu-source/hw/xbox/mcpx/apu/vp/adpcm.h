@@ -31,6 +31,10 @@
 #ifndef ADPCM_DECODE_H
 #define ADPCM_DECODE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
 /********************************* 4-bit ADPCM decoder ********************************/
 
 /* Decode the block of ADPCM data into PCM. This requires no context because ADPCM blocks
@@ -47,34 +51,34 @@
  * Returns number of converted composite samples (total samples divided by number of channels)
  */
 
+/* step table */
+static const uint16_t adpcm_step_table[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,
+    16,    17,    19,    21,    23,    25,    28,    31,
+    34,    37,    41,    45,    50,    55,    60,    66,
+    73,    80,    88,    97,    107,   118,   130,   143,
+    157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,
+    724,   796,   876,   963,   1060,  1166,  1282,  1411,
+    1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,
+    3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,
+    7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+/* step index tables */
+static const int adpcm_index_table[] = {
+    /* adpcm data size is 4 */
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
 static int adpcm_decode_block (int16_t *outbuf, const uint8_t *inbuf, size_t inbufsize, int channels)
 {
     #define CLIP(data, min, max) \
     if ((data) > (max)) data = max; \
     else if ((data) < (min)) data = min;
 
-    /* step table */
-    static const uint16_t step_table[89] = {
-        7,     8,     9,     10,    11,    12,    13,    14,
-        16,    17,    19,    21,    23,    25,    28,    31,
-        34,    37,    41,    45,    50,    55,    60,    66,
-        73,    80,    88,    97,    107,   118,   130,   143,
-        157,   173,   190,   209,   230,   253,   279,   307,
-        337,   371,   408,   449,   494,   544,   598,   658,
-        724,   796,   876,   963,   1060,  1166,  1282,  1411,
-        1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,
-        3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,
-        7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
-        15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
-        32767
-    };
-
-    /* step index tables */
-    static const int index_table[] = {
-        /* adpcm data size is 4 */
-        -1, -1, -1, -1, 2, 4, 6, 8
-    };
-
     int samples = 1, chunks;
     int32_t pcmdata[2];
     int8_t index[2];
@@ -101,7 +105,7 @@ static int adpcm_decode_block (int16_t *outbuf, const uint8_t *inbuf, size_t inb
         for (int ch = 0; ch < channels; ++ch) {
 
             for (int i = 0; i < 4; ++i) {
-                int step = step_table [index [ch]], delta = step >> 3;
+                int step = adpcm_step_table [index [ch]], delta = step >> 3;
 
                 if (*inbuf & 1) delta += (step >> 2);
                 if (*inbuf & 2) delta += (step >> 1);
@@ -109,12 +113,12 @@ static int adpcm_decode_block (int16_t *outbuf, const uint8_t *inbuf, size_t inb
                 if (*inbuf & 8) delta = -delta;
 
                 pcmdata[ch] += delta;
-                index[ch] += index_table [*inbuf & 0x7];
+                index[ch] += adpcm_index_table [*inbuf & 0x7];
                 CLIP(index[ch], 0, 88);
                 CLIP(pcmdata[ch], -32768, 32767);
                 outbuf [i * 2 * channels] = pcmdata[ch];
 
-                step = step_table [index [ch]], delta = step >> 3;
+                step = adpcm_step_table [index [ch]], delta = step >> 3;
 
                 if (*inbuf & 0x10) delta += (step >> 2);
                 if (*inbuf & 0x20) delta += (step >> 1);
@@ -122,7 +126,7 @@ static int adpcm_decode_block (int16_t *outbuf, const uint8_t *inbuf, size_t inb
                 if (*inbuf & 0x80) delta = -delta;
 
                 pcmdata[ch] += delta;
-                index[ch] += index_table [(*inbuf >> 4) & 0x7];
+                index[ch] += adpcm_index_table [(*inbuf >> 4) & 0x7];
                 CLIP(index[ch], 0, 88);
                 CLIP(pcmdata[ch], -32768, 32767);
                 outbuf [(i * 2 + 1) * channels] = pcmdata[ch];
@@ -139,4 +143,82 @@ static int adpcm_decode_block (int16_t *outbuf, const uint8_t *inbuf, size_t inb
     return samples;
 }
 
-#endif
+/*
+ * Table-driven decoder for whole Xbox ADPCM blocks: 36 bytes per channel,
+ * decoding to 65 samples per channel. For each nibble, the signed delta and
+ * the next step index are looked up for the current step index. There are no
+ * data-dependent branches, and all channels of a chunk are decoded in the
+ * same pass. The output matches adpcm_decode_block() exactly.
+ *
+ * adpcm_init_tables() must be called once first.
+ */
+#define ADPCM_BLOCK_SIZE 36
+#define ADPCM_DECODED_SAMPLES 65
+
+static int32_t adpcm_delta_table[89][16];
+static uint8_t adpcm_next_index_table[89][16];
+
+static void adpcm_init_tables (void)
+{
+    for (int index = 0; index < 89; index++) {
+        for (int nibble = 0; nibble < 16; nibble++) {
+            int step = adpcm_step_table [index], delta = step >> 3;
+
+            if (nibble & 1) delta += (step >> 2);
+            if (nibble & 2) delta += (step >> 1);
+            if (nibble & 4) delta += step;
+            if (nibble & 8) delta = -delta;
+
+            int next = index + adpcm_index_table [nibble & 0x7];
+            CLIP(next, 0, 88);
+
+            adpcm_delta_table [index][nibble] = delta;
+            adpcm_next_index_table [index][nibble] = next;
+        }
+    }
+}
+
+static inline int32_t adpcm_step (int32_t pcm, int *index, unsigned int nibble)
+{
+    pcm += adpcm_delta_table [*index][nibble];
+    *index = adpcm_next_index_table [*index][nibble];
+    pcm = pcm < -32768 ? -32768 : pcm;
+    return pcm > 32767 ? 32767 : pcm;
+}
+
+static int adpcm_decode_block_fast (int16_t *outbuf, const uint8_t *inbuf, int channels)
+{
+    int32_t pcmdata[2];
+    int index[2];
+
+    for (int ch = 0; ch < channels; ch++) {
+        outbuf [ch] = pcmdata[ch] = (int16_t) (inbuf [0] | (inbuf [1] << 8));
+        index[ch] = (int8_t) inbuf [2];
+
+        if (index [ch] < 0 || index [ch] > 88 || inbuf [3])
+            return 0;
+
+        inbuf += 4;
+    }
+
+    for (int chunk = 0; chunk < 8; chunk++) {
+        for (int ch = 0; ch < channels; ch++) {
+            int16_t *out = outbuf + (1 + chunk * 8) * channels + ch;
+
+            for (int i = 0; i < 4; i++) {
+                unsigned int byte = inbuf [i];
+
+                pcmdata[ch] = adpcm_step (pcmdata[ch], &index[ch], byte & 0xf);
+                out [(i * 2) * channels] = pcmdata[ch];
+                pcmdata[ch] = adpcm_step (pcmdata[ch], &index[ch], byte >> 4);
+                out [(i * 2 + 1) * channels] = pcmdata[ch];
+            }
+
+            inbuf += 4;
+        }
+    }
+
+    return ADPCM_DECODED_SAMPLES;
+}
+
+#endif
\ No newline at end of file
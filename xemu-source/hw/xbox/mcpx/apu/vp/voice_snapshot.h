@@ -0,0 +1,78 @@
+/*
+ * QEMU MCPX Audio Processing Unit voice descriptor snapshot
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_MCPX_VP_VOICE_SNAPSHOT_H
+#define HW_XBOX_MCPX_VP_VOICE_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hw/xbox/mcpx/apu/apu_regs.h"
+
+#define VOICE_SNAPSHOT_WORDS (NV_PAVS_SIZE / 4)
+
+/*
+ * Host copy of a voice's PAVS block, loaded once while the voice is being
+ * processed. Fields are read from and modified in the copy, and only the bits
+ * that were modified are merged back into guest memory afterwards, so that
+ * concurrent guest writes to other fields of the block are preserved.
+ */
+typedef struct VoiceSnapshot {
+    uint32_t regs[VOICE_SNAPSHOT_WORDS];
+    uint32_t dirty[VOICE_SNAPSHOT_WORDS];
+    uint32_t dirty_words;
+    uint16_t voice;
+} VoiceSnapshot;
+
+static inline void voice_snapshot_load(VoiceSnapshot *s, uint16_t voice,
+                                       const uint8_t block[NV_PAVS_SIZE])
+{
+    for (int i = 0; i < VOICE_SNAPSHOT_WORDS; i++) {
+        const uint8_t *p = &block[i * 4];
+        s->regs[i] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                     ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        s->dirty[i] = 0;
+    }
+    s->dirty_words = 0;
+    s->voice = voice;
+}
+
+static inline uint32_t voice_snapshot_get_mask(const VoiceSnapshot *s,
+                                               uint32_t offset, uint32_t mask)
+{
+    return (s->regs[offset / 4] & mask) >> __builtin_ctz(mask);
+}
+
+static inline void voice_snapshot_set_mask(VoiceSnapshot *s, uint32_t offset,
+                                           uint32_t mask, uint32_t val)
+{
+    uint32_t *reg = &s->regs[offset / 4];
+    *reg = (*reg & ~mask) | ((val << __builtin_ctz(mask)) & mask);
+    s->dirty[offset / 4] |= mask;
+    s->dirty_words |= 1u << (offset / 4);
+}
+
+/* Merge the modified bits of word `index` into the current guest value */
+static inline uint32_t voice_snapshot_merge(const VoiceSnapshot *s, int index,
+                                            uint32_t current)
+{
+    return (current & ~s->dirty[index]) | (s->regs[index] & s->dirty[index]);
+}
+
+#endif
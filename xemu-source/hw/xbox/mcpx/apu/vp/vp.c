@@ -20,7 +20,9 @@
  */
 
 #include "hw/xbox/mcpx/apu/apu_int.h"
+#include "qemu/cutils.h"
 #include "adpcm.h"
+#include "voice_snapshot.h"
 
 static const struct {
     hwaddr top, current, next;
@@ -96,9 +98,16 @@ static float attenuate(uint16_t vol)
     return (vol == 0xFFF) ? 0.0 : powf(10.0f, vol/(64.0 * -20.0f));
 }
 
+/* Snapshot of the voice being processed by the current worker thread */
+static __thread VoiceSnapshot *voice_snapshot;
+
 static uint32_t voice_get_mask(MCPXAPUState *d, uint16_t voice_handle,
                                hwaddr offset, uint32_t mask)
 {
+    if (voice_snapshot && voice_snapshot->voice == voice_handle) {
+        return voice_snapshot_get_mask(voice_snapshot, offset, mask);
+    }
+
     hwaddr voice = d->regs[NV_PAPU_VPVADDR] + voice_handle * NV_PAVS_SIZE;
     return (ldl_le_phys(&address_space_memory, voice + offset) & mask) >>
            ctz32(mask);
@@ -107,6 +116,11 @@ static uint32_t voice_get_mask(MCPXAPUState *d, uint16_t voice_handle,
 static void voice_set_mask(MCPXAPUState *d, uint16_t voice_handle,
                            hwaddr offset, uint32_t mask, uint32_t val)
 {
+    if (voice_snapshot && voice_snapshot->voice == voice_handle) {
+        voice_snapshot_set_mask(voice_snapshot, offset, mask, val);
+        return;
+    }
+
     hwaddr voice = d->regs[NV_PAPU_VPVADDR]
                     + voice_handle * NV_PAVS_SIZE;
     uint32_t v = ldl_le_phys(&address_space_memory, voice + offset) & ~mask;
@@ -114,6 +128,41 @@ static void voice_set_mask(MCPXAPUState *d, uint16_t voice_handle,
                 v | ((val << ctz32(mask)) & mask));
 }
 
+/*
+ * Voice fields are accessed dozens of times while a voice is processed, so
+ * the block is copied in with a single read and modified fields are written
+ * back in one pass. The voice spinlock is held by the dispatcher for the
+ * duration, so fe_method() cannot lock and modify the voice in between.
+ */
+static void voice_snapshot_begin(MCPXAPUState *d, VoiceSnapshot *s,
+                                 uint16_t v)
+{
+    uint8_t block[NV_PAVS_SIZE];
+    hwaddr voice = d->regs[NV_PAPU_VPVADDR] + v * NV_PAVS_SIZE;
+
+    assert(!voice_snapshot);
+    address_space_read(&address_space_memory, voice, MEMTXATTRS_UNSPECIFIED,
+                       block, sizeof(block));
+    voice_snapshot_load(s, v, block);
+    voice_snapshot = s;
+}
+
+static void voice_snapshot_end(MCPXAPUState *d, VoiceSnapshot *s)
+{
+    hwaddr voice = d->regs[NV_PAPU_VPVADDR] + s->voice * NV_PAVS_SIZE;
+
+    assert(voice_snapshot == s);
+    voice_snapshot = NULL;
+
+    for (uint32_t words = s->dirty_words; words; words &= words - 1) {
+        int i = ctz32(words);
+        hwaddr addr = voice + i * 4;
+        uint32_t current = ldl_le_phys(&address_space_memory, addr);
+        stl_le_phys(&address_space_memory, addr,
+                    voice_snapshot_merge(s, i, current));
+    }
+}
+
 static void voice_off(MCPXAPUState *d, uint16_t v)
 {
     voice_set_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
@@ -672,6 +721,35 @@ static hwaddr get_data_ptr(hwaddr sge_base, unsigned int max_sge, uint32_t addr)
     return prd_address + addr % TARGET_PAGE_SIZE;
 }
 
+static MCPXAPUADPCMCacheEntry *
+voice_lookup_adpcm_block(MCPXAPUState *d, uint32_t v, unsigned int block_index,
+                         hwaddr addr, hwaddr last, size_t block_size,
+                         unsigned int channels, bool *hit)
+{
+    MCPXAPUADPCMCacheEntry *entry =
+        &d->vp.adpcm_cache[v][block_index % MCPX_VP_ADPCM_CACHE_SIZE];
+
+    /* A block is smaller than a page, so it touches at most two */
+    uint32_t gen;
+    if (last - addr == block_size - 4) {
+        gen = mcpx_apu_ram_generation(d, addr, block_size);
+    } else {
+        gen = mcpx_apu_ram_generation(d, addr, 4) +
+              mcpx_apu_ram_generation(d, last, 4);
+    }
+
+    *hit = entry->valid && entry->addr == addr && entry->last == last &&
+           entry->channels == channels && entry->gen == gen;
+
+    entry->valid = true;
+    entry->channels = channels;
+    entry->gen = gen;
+    entry->addr = addr;
+    entry->last = last;
+
+    return entry;
+}
+
 static float voice_step_envelope(MCPXAPUState *d, uint16_t v, uint32_t reg_0,
                            uint32_t reg_a, uint32_t rr_reg, uint32_t rr_mask,
                            uint32_t lvl_reg, uint32_t lvl_mask,
@@ -883,7 +961,7 @@ static int voice_get_samples(MCPXAPUState *d, uint32_t v, float samples[][2],
 
     int adpcm_block_index = -1;
     uint32_t adpcm_block[36*2/4];
-    int16_t adpcm_decoded[65*2]; // FIXME: Move out of here
+    const int16_t *adpcm_decoded = NULL;
 
     // FIXME: Only update if necessary
     struct McpxApuDebugVoice *dbg = &g_dbg.vp.v[v];
@@ -1005,32 +1083,67 @@ static int voice_get_samples(MCPXAPUState *d, uint32_t v, float samples[][2],
 
     // FIXME: Restructure this loop
     int sample_count = 0;
-    for (; (sample_count < num_samples_requested) && (cbo <= ebo);
+    if (samples == NULL && cbo <= ebo) {
+        /* Silent voice: only advance the position */
+        sample_count = MIN((uint32_t)num_samples_requested, ebo - cbo + 1);
+        cbo += sample_count;
+    }
+    for (; samples && (sample_count < num_samples_requested) && (cbo <= ebo);
          sample_count++, cbo++) {
         if (adpcm) {
             unsigned int block_index = cbo / ADPCM_SAMPLES_PER_BLOCK;
             unsigned int block_position = cbo % ADPCM_SAMPLES_PER_BLOCK;
             if (adpcm_block_index != block_index) {
                 uint32_t linear_addr = block_index * block_size;
+                hwaddr addr, last;
                 if (stream) {
-                    hwaddr addr = segment_offset + linear_addr;
                     int max_seg_byte = (seg_len >> 6) * block_size;
                     assert(linear_addr + block_size <= max_seg_byte);
-                    memcpy(adpcm_block, &d->ram_ptr[addr],
-                           block_size); // FIXME: Use idiomatic DMA function
+                    addr = segment_offset + linear_addr;
+                    last = addr + block_size - 4;
                 } else {
                     linear_addr += ba;
-                    for (unsigned int word_index = 0;
-                         word_index < (9 * samples_per_block); word_index++) {
-                        hwaddr addr = get_data_ptr(d->regs[NV_PAPU_VPSGEADDR],
-                                                   0xFFFFFFFF, linear_addr);
-                        adpcm_block[word_index] =
-                            ldl_le_phys(&address_space_memory, addr);
-                        linear_addr += 4;
+                    addr = get_data_ptr(d->regs[NV_PAPU_VPSGEADDR], 0xFFFFFFFF,
+                                        linear_addr);
+                    last = get_data_ptr(d->regs[NV_PAPU_VPSGEADDR], 0xFFFFFFFF,
+                                        linear_addr + block_size - 4);
+                }
+
+                bool hit;
+                MCPXAPUADPCMCacheEntry *entry = voice_lookup_adpcm_block(
+                    d, v, block_index, addr, last, block_size, channels, &hit);
+                if (!hit) {
+                    if (stream) {
+                        memcpy(adpcm_block, &d->ram_ptr[addr],
+                               block_size); // FIXME: Use idiomatic DMA function
+                    } else {
+                        for (unsigned int word_index = 0;
+                             word_index < (9 * samples_per_block);
+                             word_index++) {
+                            hwaddr word_addr = get_data_ptr(
+                                d->regs[NV_PAPU_VPSGEADDR], 0xFFFFFFFF,
+                                linear_addr);
+                            adpcm_block[word_index] =
+                                ldl_le_phys(&address_space_memory, word_addr);
+                            linear_addr += 4;
+                        }
+                    }
+
+                    int decoded;
+                    if (block_size == ADPCM_BLOCK_SIZE * channels) {
+                        decoded = adpcm_decode_block_fast(
+                            entry->decoded, (uint8_t *)adpcm_block, channels);
+                    } else {
+                        decoded = adpcm_decode_block(entry->decoded,
+                                                     (uint8_t *)adpcm_block,
+                                                     block_size, channels);
+                    }
+                    if (!decoded) {
+                        /* Play silence rather than a stale block */
+                        memset(entry->decoded, 0, sizeof(entry->decoded));
                     }
                 }
-                adpcm_decode_block(adpcm_decoded, (uint8_t *)adpcm_block,
-                                   block_size, channels);
+                adpcm_decoded = entry->decoded;
                 adpcm_block_index = block_index;
             }
 
@@ -1281,10 +1394,49 @@ static void get_multipass_samples(MCPXAPUState *d,
     dump_multipass_unused_debug_info(d, v);
 }
 
+/*
+ * Advance a silent voice by the number of source samples the resampler would
+ * have consumed this frame, without fetching or filtering any of them.
+ */
+static void voice_skip(MCPXAPUState *d, uint16_t v, float rate)
+{
+    MCPXAPUVoiceFilter *filter = &d->vp.filters[v];
+
+    float pos = filter->skip_frac + NUM_SAMPLES_PER_FRAME / rate;
+    int remaining = pos;
+    filter->skip_frac = pos - remaining;
+
+    while (remaining > 0) {
+        int active = voice_get_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
+                                    NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE);
+        if (!active) {
+            break;
+        }
+        int count = voice_get_samples(d, v, NULL, remaining);
+        if (count < 0) {
+            break;
+        }
+        remaining -= count;
+    }
+}
+
+/* Drop filter history left over from before the voice went silent */
+static void voice_wake(MCPXAPUState *d, uint16_t v)
+{
+    MCPXAPUVoiceFilter *filter = &d->vp.filters[v];
+
+    voice_reset_filters(d, v);
+    for (int ch = 0; ch < 2; ch++) {
+        memset(filter->hrtf.ch[ch].buf, 0, sizeof(filter->hrtf.ch[ch].buf));
+    }
+    filter->skip_frac = 0;
+    filter->silent = false;
+}
+
 static void voice_process(MCPXAPUState *d,
                           float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME],
                           float sample_buf[NUM_SAMPLES_PER_FRAME][2],
-                          uint16_t v, int voice_list)
+                          uint32_t *mixbins_active, uint16_t v, int voice_list)
 {
     assert(v < MCPX_HW_MAX_VOICES);
     bool stereo = voice_get_mask(d, v, NV_PAVS_VOICE_CFG_FMT,
@@ -1324,37 +1476,6 @@ static void voice_process(MCPXAPUState *d,
     assert(ea_value >= 0.0f);
     assert(ea_value <= 1.0f);
 
-    float samples[NUM_SAMPLES_PER_FRAME][2] = { 0 };
-
-    bool multipass = voice_get_mask(d, v, NV_PAVS_VOICE_CFG_FMT,
-                                    NV_PAVS_VOICE_CFG_FMT_MULTIPASS);
-    dbg->multipass = multipass;
-
-    if (multipass) {
-        get_multipass_samples(d, mixbins, v, samples);
-    } else {
-        for (int sample_count = 0; sample_count < NUM_SAMPLES_PER_FRAME;) {
-            int active = voice_get_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
-                                        NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE);
-            if (!active) {
-                return;
-            }
-            int count =
-                voice_resample(d, v, &samples[sample_count],
-                               NUM_SAMPLES_PER_FRAME - sample_count, rate);
-            if (count < 0) {
-                break;
-            }
-            sample_count += count;
-        }
-    }
-
-    int active = voice_get_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
-                                NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE);
-    if (!active) {
-        return;
-    }
-
     int bin[8];
     bin[0] = voice_get_mask(d, v, NV_PAVS_VOICE_CFG_VBIN,
                             NV_PAVS_VOICE_CFG_VBIN_V0BIN);
@@ -1415,6 +1536,61 @@ static void voice_process(MCPXAPUState *d,
         dbg->vol[i] = vol[i];
     }
 
+    bool multipass = voice_get_mask(d, v, NV_PAVS_VOICE_CFG_FMT,
+                                    NV_PAVS_VOICE_CFG_FMT_MULTIPASS);
+    dbg->multipass = multipass;
+
+    /*
+     * A voice with its amplitude envelope at zero, every bin fully
+     * attenuated, or muted from the debugger contributes nothing. Skip
+     * fetching, resampling and filtering it, and only move it along.
+     * Multipass voices are cheap and clear their source bin, so they always
+     * take the full path.
+     */
+    bool silent = true;
+    for (int b = 0; b < 8; b++) {
+        silent &= attenuate(vol[b]) == 0.0f;
+    }
+    silent = !multipass &&
+             (silent || ea_value == 0.0f || voice_should_mute(v));
+    dbg->silent = silent;
+
+    MCPXAPUVoiceFilter *filter = &d->vp.filters[v];
+    if (silent) {
+        voice_skip(d, v, rate);
+        filter->silent = true;
+        return;
+    } else if (filter->silent) {
+        voice_wake(d, v);
+    }
+
+    float samples[NUM_SAMPLES_PER_FRAME][2] = { 0 };
+
+    if (multipass) {
+        get_multipass_samples(d, mixbins, v, samples);
+    } else {
+        for (int sample_count = 0; sample_count < NUM_SAMPLES_PER_FRAME;) {
+            int active = voice_get_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
+                                        NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE);
+            if (!active) {
+                return;
+            }
+            int count =
+                voice_resample(d, v, &samples[sample_count],
+                               NUM_SAMPLES_PER_FRAME - sample_count, rate);
+            if (count < 0) {
+                break;
+            }
+            sample_count += count;
+        }
+    }
+
+    int active = voice_get_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
+                                NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE);
+    if (!active) {
+        return;
+    }
+
     if (voice_should_mute(v)) {
         return;
     }
@@ -1462,7 +1638,13 @@ static void voice_process(MCPXAPUState *d,
 
     // FIXME: ParaEQ
 
+    /* Silent source data, e.g. a zero-filled streaming buffer */
+    if (buffer_is_zero(samples, sizeof(samples))) {
+        return;
+    }
+
     for (int b = 0; b < 8; b++) {
+        *mixbins_active |= 1 << bin[b];
         float g = ea_value;
         float hr;
         if ((v < MCPX_HW_MAX_3D_VOICES) && (b < 4)) {
@@ -1589,6 +1771,7 @@ static void *voice_worker_thread(void *arg)
     int worker_id = ctz64(vwd->workers_pending);
     VoiceWorker *self = &d->vp.voice_work_dispatch.workers[worker_id];
     self->queue_len = 0;
+    thread_placement_enter(THREAD_CLASS_VOICE, worker_id);
 
     do {
         int64_t start_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
@@ -1599,22 +1782,29 @@ static void *voice_worker_thread(void *arg)
 
             // Process queued voices
             memset(self->mixbins, 0, sizeof(self->mixbins));
+            self->mixbins_active = 0;
             if (d->monitor.point == MCPX_APU_DEBUG_MON_VP) {
                 memset(self->sample_buf, 0, sizeof(self->sample_buf));
             }
             for (int i = 0; i < self->queue_len; i++) {
+                VoiceSnapshot snapshot;
+                voice_snapshot_begin(d, &snapshot, self->queue[i].voice);
                 voice_process(d, self->mixbins, self->sample_buf,
-                              self->queue[i].voice, self->queue[i].list);
+                              &self->mixbins_active, self->queue[i].voice,
+                              self->queue[i].list);
+                voice_snapshot_end(d, &snapshot);
             }
 
             qemu_mutex_lock(&vwd->lock);
 
             // Add voice contributions
-            for (int b = 0; b < NUM_MIXBINS; b++) {
+            for (uint32_t m = self->mixbins_active; m; m &= m - 1) {
+                int b = ctz32(m);
                 for (int s = 0; s < NUM_SAMPLES_PER_FRAME; s++) {
                     vwd->mixbins[b][s] += self->mixbins[b][s];
                 }
             }
+            vwd->mixbins_active |= self->mixbins_active;
             if (d->monitor.point == MCPX_APU_DEBUG_MON_VP) {
                 for (int i = 0; i < NUM_SAMPLES_PER_FRAME; i++) {
                     d->vp.sample_buf[i][0] += self->sample_buf[i][0];
@@ -1636,6 +1826,7 @@ static void *voice_worker_thread(void *arg)
         qemu_cond_wait(&vwd->work_pending, &vwd->lock);
     } while (!vwd->workers_should_exit);
 
+    thread_placement_leave();
     rcu_unregister_thread();
     return NULL;
 }
@@ -1732,8 +1923,10 @@ voice_work_dispatch(MCPXAPUState *d,
 
     qemu_mutex_lock(&vwd->lock);
 
+    d->vp.mixbins_active = 0;
     if (vwd->queue_len) {
         memset(vwd->mixbins, 0, sizeof(vwd->mixbins));
+        vwd->mixbins_active = 0;
 
         // Signal workers and wait for completion
         voice_work_schedule(d);
@@ -1744,11 +1937,13 @@ voice_work_dispatch(MCPXAPUState *d,
         vwd->queue_len = 0;
 
         // Add voice contributions
-        for (int b = 0; b < NUM_MIXBINS; b++) {
+        for (uint32_t m = vwd->mixbins_active; m; m &= m - 1) {
+            int b = ctz32(m);
             for (int s = 0; s < NUM_SAMPLES_PER_FRAME; s++) {
                 mixbins[b][s] += vwd->mixbins[b][s];
             }
         }
+        d->vp.mixbins_active = vwd->mixbins_active;
     }
 
     int64_t end_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
@@ -1802,6 +1997,7 @@ static void voice_work_finalize(MCPXAPUState *d)
 void mcpx_apu_vp_frame(MCPXAPUState *d, float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME])
 {
     memset(d->vp.sample_buf, 0, sizeof(d->vp.sample_buf));
+    d->vp.monitor_valid = false;
 
     /* Process all voices, mixing each into the affected MIXBINs */
     for (int list = 0; list < 3; list++) {
@@ -1835,23 +2031,25 @@ void mcpx_apu_vp_frame(MCPXAPUState *d, float mixbins[NUM_MIXBINS][NUM_SAMPLES_P
     voice_work_dispatch(d, mixbins);
 
     if (d->monitor.point == MCPX_APU_DEBUG_MON_VP) {
-        /* Mix all voices together to hear any audible voice */
-        int16_t isamp[NUM_SAMPLES_PER_FRAME * 2];
-        src_float_to_short_array((float *)d->vp.sample_buf, isamp,
+        /*
+         * Mix all voices together to hear any audible voice. The result is
+         * added to the monitor buffer once the GP thread picks the frame up.
+         */
+        src_float_to_short_array((float *)d->vp.sample_buf,
+                                 &d->vp.monitor_buf[0][0],
                                  NUM_SAMPLES_PER_FRAME * 2);
-        int off = (d->ep_frame_div % 8) * NUM_SAMPLES_PER_FRAME;
-        for (int i = 0; i < NUM_SAMPLES_PER_FRAME; i++) {
-            d->monitor.frame_buf[off + i][0] += isamp[2*i];
-            d->monitor.frame_buf[off + i][1] += isamp[2*i+1];
-        }
+        d->vp.monitor_valid = true;
 
         memset(d->vp.sample_buf, 0, sizeof(d->vp.sample_buf));
         memset(mixbins, 0, sizeof(float[32][32]));
+        d->vp.mixbins_active = 0;
     }
 }
 
 void mcpx_apu_vp_init(MCPXAPUState *d)
 {
+    adpcm_init_tables();
+
     for (int i = 0; i < MCPX_HW_MAX_VOICES; i++) {
         qemu_spin_init(&d->vp.voice_spinlocks[i]);
     }
@@ -1872,7 +2070,61 @@ void mcpx_apu_vp_reset(MCPXAPUState *d)
     memset(d->vp.hrtf_submix, 0, sizeof(d->vp.hrtf_submix));
     memset(d->vp.submix_headroom, 0, sizeof(d->vp.submix_headroom));
     memset(d->vp.voice_locked, 0, sizeof(d->vp.voice_locked));
+    memset(d->vp.adpcm_cache, 0, sizeof(d->vp.adpcm_cache));
     for (int v = 0; v < ARRAY_SIZE(d->vp.filters); v++) {
         hrtf_filter_init(&d->vp.filters[v].hrtf);
     }
 }
+
+/* Report the guest memory the VP reads while processing active voices */
+void mcpx_apu_vp_capture_ranges(MCPXAPUState *d, MCPXAPUCaptureRangeFunc func,
+                                void *opaque)
+{
+    func(opaque, d->regs[NV_PAPU_VPVADDR], MCPX_HW_MAX_VOICES * NV_PAVS_SIZE);
+    func(opaque, d->regs[NV_PAPU_FENADDR],
+         16 * (MCPX_HW_NOTIFIER_BASE_OFFSET +
+               MCPX_HW_MAX_VOICES * MCPX_HW_NOTIFIER_COUNT));
+    func(opaque, d->regs[NV_PAPU_VPSSLADDR],
+         MCPX_HW_MAX_SSL_PRDS * NV_PSGE_SIZE);
+
+    for (int v = 0; v < MCPX_HW_MAX_VOICES; v++) {
+        if (!voice_get_mask(d, v, NV_PAVS_VOICE_PAR_STATE,
+                            NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE)) {
+            continue;
+        }
+
+        /*
+         * Sample data is bounded using the largest block, a stereo 32-bit
+         * sample, rather than decoding the voice format here.
+         */
+        bool stream = voice_get_mask(d, v, NV_PAVS_VOICE_CFG_FMT,
+                                     NV_PAVS_VOICE_CFG_FMT_DATA_TYPE);
+        if (stream) {
+            for (int i = 0; i < MCPX_HW_SSLS_PER_VOICE; i++) {
+                for (int seg = 0; seg < d->vp.ssl[v].count[i]; seg++) {
+                    hwaddr addr = d->regs[NV_PAPU_VPSSLADDR] +
+                                  (d->vp.ssl[v].base[i] + seg) * NV_PSGE_SIZE;
+                    uint32_t offset =
+                        ldl_le_phys(&address_space_memory, addr);
+                    uint32_t length =
+                        ldl_le_phys(&address_space_memory, addr + 4);
+                    func(opaque, offset, (length & 0xffff) * 8);
+                }
+            }
+            continue;
+        }
+
+        uint32_t ba = voice_get_mask(d, v, NV_PAVS_VOICE_CUR_PSL_START,
+                                     NV_PAVS_VOICE_CUR_PSL_START_BA);
+        uint32_t ebo = voice_get_mask(d, v, NV_PAVS_VOICE_PAR_NEXT,
+                                      NV_PAVS_VOICE_PAR_NEXT_EBO);
+        uint32_t first = ba / TARGET_PAGE_SIZE;
+        uint32_t last = (ba + (ebo + 1) * 8 - 1) / TARGET_PAGE_SIZE;
+        for (uint32_t entry = first; entry <= last; entry++) {
+            hwaddr sge = d->regs[NV_PAPU_VPSGEADDR] + entry * NV_PSGE_SIZE;
+            func(opaque, sge, NV_PSGE_SIZE);
+            func(opaque, ldl_le_phys(&address_space_memory, sge),
+                 TARGET_PAGE_SIZE);
+        }
+    }
+}
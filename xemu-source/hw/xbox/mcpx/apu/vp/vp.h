@@ -28,6 +28,7 @@
 #include "hw/hw.h"
 #include "hw/pci/pci.h"
 #include "hw/xbox/mcpx/apu/apu_regs.h"
+#include "hw/xbox/mcpx/apu/capture.h"
 #include "svf.h"
 #include "hrtf.h"
 
@@ -46,8 +47,27 @@ typedef struct MCPXAPUVoiceFilter {
     SRC_STATE *resampler;
     sv_filter svf[2];
     HrtfFilter hrtf;
+    bool silent; /* Skipped last frame, filter state is stale */
+    float skip_frac; /* Source position carried between skipped frames */
 } MCPXAPUVoiceFilter;
 
+/*
+ * Decoded ADPCM blocks, kept per voice so looping and streaming voices do not
+ * decode the same block every frame. Entries are direct-mapped by block index
+ * and keyed by the physical address of the block's first and last word and
+ * the generation of the pages holding it.
+ */
+#define MCPX_VP_ADPCM_CACHE_SIZE 4
+
+typedef struct MCPXAPUADPCMCacheEntry {
+    bool valid;
+    uint8_t channels;
+    uint32_t gen;
+    hwaddr addr;
+    hwaddr last;
+    int16_t decoded[65 * 2];
+} MCPXAPUADPCMCacheEntry;
+
 typedef struct VoiceWorkItem {
     int voice;
     int list;
@@ -56,6 +76,7 @@ typedef struct VoiceWorkItem {
 typedef struct VoiceWorker {
     QemuThread thread;
     float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME];
+    uint32_t mixbins_active;
     float sample_buf[NUM_SAMPLES_PER_FRAME][2];
     VoiceWorkItem queue[MCPX_HW_MAX_VOICES];
     int queue_len;
@@ -70,6 +91,7 @@ typedef struct VoiceWorkDispatch {
     uint64_t workers_pending;
     QemuCond work_finished;
     float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME];
+    uint32_t mixbins_active;
     VoiceWorkItem queue[MCPX_HW_MAX_VOICES];
     int queue_len;
 } VoiceWorkDispatch;
@@ -78,6 +100,8 @@ typedef struct {
     MemoryRegion mmio;
     VoiceWorkDispatch voice_work_dispatch;
     MCPXAPUVoiceFilter filters[MCPX_HW_MAX_VOICES];
+    MCPXAPUADPCMCacheEntry adpcm_cache[MCPX_HW_MAX_VOICES]
+                                      [MCPX_VP_ADPCM_CACHE_SIZE];
 
     // FIXME: Where are these stored?
     int ssl_base_page;
@@ -86,6 +110,9 @@ typedef struct {
     uint8_t hrtf_submix[4];
     uint8_t submix_headroom[NUM_MIXBINS];
     float sample_buf[NUM_SAMPLES_PER_FRAME][2];
+    uint32_t mixbins_active; /* Mixbins written by the last frame */
+    bool monitor_valid;
+    int16_t monitor_buf[NUM_SAMPLES_PER_FRAME][2];
     uint64_t voice_locked[4];
     QemuSpin voice_spinlocks[MCPX_HW_MAX_VOICES];
 
@@ -108,5 +135,7 @@ void mcpx_apu_vp_init(MCPXAPUState *d);
 void mcpx_apu_vp_finalize(MCPXAPUState *d);
 void mcpx_apu_vp_frame(MCPXAPUState *d, float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME]);
 void mcpx_apu_vp_reset(MCPXAPUState *d);
+void mcpx_apu_vp_capture_ranges(MCPXAPUState *d, MCPXAPUCaptureRangeFunc func,
+                                void *opaque);
 
 #endif
@@ -96,19 +96,38 @@
     _X(NV2A_PROF_SHADER_BIND_NOTDIRTY) \
     _X(NV2A_PROF_SHADER_UBO_DIRTY) \
     _X(NV2A_PROF_SHADER_UBO_NOTDIRTY) \
+    _X(NV2A_PROF_SHADER_UBO_BYTES) \
+    _X(NV2A_PROF_SHADER_UBO_BYTES_PER_DRAW) \
+    _X(NV2A_PROF_DESC_SET_WRITE) \
+    _X(NV2A_PROF_DESC_SET_HIT) \
+    _X(NV2A_PROF_DESC_SET_HIT_RATE) \
+    _X(NV2A_PROF_DESC_SET_PUSH) \
     _X(NV2A_PROF_ATTR_BIND) \
+    _X(NV2A_PROF_ATTR_CONVERT) \
+    _X(NV2A_PROF_ATTR_CONVERT_NOTDIRTY) \
     _X(NV2A_PROF_TEX_UPLOAD) \
+    _X(NV2A_PROF_TEX_UPLOAD_BYTES) \
     _X(NV2A_PROF_GEOM_BUFFER_UPDATE_1) \
     _X(NV2A_PROF_GEOM_BUFFER_UPDATE_2) \
     _X(NV2A_PROF_GEOM_BUFFER_UPDATE_3) \
     _X(NV2A_PROF_GEOM_BUFFER_UPDATE_4) \
     _X(NV2A_PROF_GEOM_BUFFER_UPDATE_4_NOTDIRTY) \
+    _X(NV2A_PROF_GEOM_BUFFER_UPDATE_BYTES) \
     _X(NV2A_PROF_SURF_SWIZZLE) \
     _X(NV2A_PROF_SURF_CREATE) \
     _X(NV2A_PROF_SURF_DOWNLOAD) \
     _X(NV2A_PROF_SURF_UPLOAD) \
+    _X(NV2A_PROF_SURF_UPLOAD_BYTES) \
     _X(NV2A_PROF_SURF_TO_TEX) \
     _X(NV2A_PROF_SURF_TO_TEX_FALLBACK) \
+    _X(NV2A_PROF_LOADVM_PAGES_CHANGED) \
+    _X(NV2A_PROF_LOADVM_SURF_KEPT) \
+    _X(NV2A_PROF_LOADVM_SURF_STALE) \
+    _X(NV2A_PROF_DISPLAY_PUBLISH) \
+    _X(NV2A_PROF_DISPLAY_DROPPED) \
+    _X(NV2A_PROF_DISPLAY_REPEATED) \
+    _X(NV2A_PROF_DISPLAY_LATENCY_US) \
+    _X(NV2A_PROF_BQL_MAIN_LOOP_US) \
     _X(NV2A_PROF_QUEUE_SUBMIT_1) \
     _X(NV2A_PROF_QUEUE_SUBMIT_2) \
     _X(NV2A_PROF_QUEUE_SUBMIT_3) \
@@ -151,6 +170,12 @@ static inline void nv2a_profile_inc_counter(enum NV2A_PROF_COUNTERS_ENUM cnt)
     g_nv2a_stats.frame_working.counters[cnt] += 1;
 }
 
+static inline void nv2a_profile_add_counter(enum NV2A_PROF_COUNTERS_ENUM cnt,
+                                            int value)
+{
+    g_nv2a_stats.frame_working.counters[cnt] += value;
+}
+
 #ifdef CONFIG_RENDERDOC
 void nv2a_dbg_renderdoc_init(void);
 void *nv2a_dbg_renderdoc_get_api(void);
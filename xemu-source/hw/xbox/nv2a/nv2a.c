@@ -266,6 +266,8 @@ static void nv2a_reset(NV2AState *d)
         qatomic_set(&d->pfifo.halt, true);
     }
     qemu_event_reset(&d->pgraph.flush_complete);
+    d->pgraph.loadvm.page_hashes_valid = false;
+    d->pgraph.loadvm.pending = false;
     qatomic_set(&d->pgraph.flush_pending, true);
     nv2a_unlock_fifo(d);
     bql_unlock();
@@ -278,6 +280,7 @@ static void nv2a_reset(NV2AState *d)
 
     memset(d->pfifo.regs, 0, sizeof(d->pfifo.regs));
     memset(d->pgraph.regs_, 0, sizeof(d->pgraph.regs_));
+    d->pgraph.shader_state_dirty = SHADER_STATE_ALL;
     memset(d->pvideo.regs, 0, sizeof(d->pvideo.regs));
 
     d->pcrtc.start = 0;
@@ -374,9 +377,12 @@ static void nv2a_vm_state_change(void *opaque, bool running, RunState state)
     } else if (state == RUN_STATE_RESTORE_VM) {
         nv2a_lock_fifo(d);
         qatomic_set(&d->pfifo.halt, true);
+        pgraph_pre_loadvm(d);
         nv2a_unlock_fifo(d);
     } else if (state == RUN_STATE_RUNNING) {
         nv2a_lock_fifo(d);
+        /* Drop page hashes left behind by a failed load */
+        d->pgraph.loadvm.page_hashes_valid = false;
         qatomic_set(&d->pfifo.halt, false);
         nv2a_unlock_fifo(d);
     } else if (state == RUN_STATE_SHUTDOWN) {
@@ -406,6 +412,8 @@ static int nv2a_pre_load(void *opaque)
 static int nv2a_post_load(void *opaque, int version_id)
 {
     NV2AState *d = opaque;
+    d->pgraph.shader_state_dirty = SHADER_STATE_ALL;
+    pgraph_post_loadvm(d);
     qatomic_set(&d->pgraph.flush_pending, true);
     nv2a_unlock_fifo(d);
     return 0;
@@ -27,6 +27,7 @@
 #include "qemu/osdep.h"
 #include "qemu/units.h"
 #include "qemu/thread.h"
+#include "qemu/thread-placement.h"
 #include "qemu/queue.h"
 #include "qemu/main-loop.h"
 #include "qapi/error.h"
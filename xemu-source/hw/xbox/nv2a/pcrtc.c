@@ -70,6 +70,7 @@ void pcrtc_write(void *opaque, hwaddr addr, uint64_t val, unsigned int size)
         NV2A_DPRINTF("PCRTC_START - %x %x %x %x\n",
                 d->vram_ptr[val+64], d->vram_ptr[val+64+1],
                 d->vram_ptr[val+64+2], d->vram_ptr[val+64+3]);
+        pgraph_display_flipped(d);
         break;
     default:
         break;
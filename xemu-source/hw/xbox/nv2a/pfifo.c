@@ -456,6 +456,7 @@ void *pfifo_thread(void *arg)
     pgraph_init_thread(d);
 
     rcu_register_thread();
+    thread_placement_enter(THREAD_CLASS_PFIFO, 0);
 
     qemu_mutex_lock(&d->pfifo.lock);
     while (true) {
@@ -482,6 +483,7 @@ void *pfifo_thread(void *arg)
     }
     qemu_mutex_unlock(&d->pfifo.lock);
 
+    thread_placement_leave();
     rcu_unregister_thread();
 
     return NULL;
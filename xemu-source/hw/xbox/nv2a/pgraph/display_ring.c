@@ -0,0 +1,114 @@
+/*
+ * QEMU Geforce NV2A display image hand-off
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "display_ring.h"
+
+#define DISPLAY_RING_FRESH 0x80000000u
+#define DISPLAY_RING_INDEX 0x7fffffffu
+
+void display_ring_init(DisplayRing *r)
+{
+    memset(r, 0, sizeof(*r));
+    display_ring_reset(r);
+}
+
+void display_ring_reset(DisplayRing *r)
+{
+    memset(r->slots, 0, sizeof(r->slots));
+    r->back = 0;
+    r->ready = 1;
+    r->front = 2;
+    r->front_valid = false;
+}
+
+int display_ring_back(DisplayRing *r)
+{
+    return r->back;
+}
+
+void display_ring_publish(DisplayRing *r, int64_t now)
+{
+    DisplayRingSlot *slot = &r->slots[r->back];
+
+    slot->published_ns = now;
+    slot->presented = false;
+
+    /* Release the image contents along with the slot */
+    uint32_t old = qatomic_xchg(&r->ready, r->back | DISPLAY_RING_FRESH);
+    r->back = old & DISPLAY_RING_INDEX;
+
+    qatomic_inc(&r->stats.published);
+    if (old & DISPLAY_RING_FRESH) {
+        qatomic_inc(&r->stats.dropped);
+    }
+}
+
+bool display_ring_has_frame(DisplayRing *r)
+{
+    return r->front_valid ||
+           (qatomic_load_acquire(&r->ready) & DISPLAY_RING_FRESH);
+}
+
+bool display_ring_has_new_frame(DisplayRing *r)
+{
+    return qatomic_load_acquire(&r->ready) & DISPLAY_RING_FRESH;
+}
+
+DisplayRingSlot *display_ring_acquire(DisplayRing *r)
+{
+    if (qatomic_read(&r->ready) & DISPLAY_RING_FRESH) {
+        /* Only the renderer sets the flag, so it is still set here */
+        uint32_t old = qatomic_xchg(&r->ready, r->front);
+        r->front = old & DISPLAY_RING_INDEX;
+        r->front_valid = true;
+        qatomic_inc(&r->stats.acquired);
+    } else if (r->front_valid) {
+        qatomic_inc(&r->stats.repeated);
+    }
+
+    return r->front_valid ? &r->slots[r->front] : NULL;
+}
+
+void display_ring_presented(DisplayRing *r, int64_t now)
+{
+    DisplayRingSlot *slot = &r->slots[r->front];
+
+    if (!r->front_valid || slot->presented) {
+        return;
+    }
+    slot->presented = true;
+
+    uint64_t latency = MAX(now - slot->published_ns, 0);
+    qatomic_inc(&r->stats.presented);
+    qatomic_add(&r->stats.latency_ns, latency);
+    if (latency > qatomic_read(&r->stats.latency_max_ns)) {
+        qatomic_set(&r->stats.latency_max_ns, latency);
+    }
+}
+
+void display_ring_get_stats(DisplayRing *r, DisplayRingStats *stats)
+{
+    const uint64_t *src = (const uint64_t *)&r->stats;
+    uint64_t *dst = (uint64_t *)stats;
+
+    for (size_t i = 0; i < sizeof(*stats) / sizeof(uint64_t); i++) {
+        dst[i] = qatomic_read(&src[i]);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * QEMU Geforce NV2A display image hand-off
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_NV2A_PGRAPH_DISPLAY_RING_H
+#define HW_XBOX_NV2A_PGRAPH_DISPLAY_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Triple buffer of presentable images between the renderer, which draws the
+ * display into the back slot, and the UI, which samples the front slot
+ * directly. Publishing swaps the back slot with the ready slot, acquiring
+ * swaps the ready slot with the front slot, so neither side ever waits for
+ * the other or touches an image the other is using. A frame published
+ * before the UI took the previous one replaces it.
+ */
+
+#define DISPLAY_RING_SIZE 3
+
+typedef struct DisplayRingSlot {
+    uint32_t texture;     /* GL texture name, set by the renderer */
+    int width, height;
+    int64_t published_ns;
+    bool presented;
+} DisplayRingSlot;
+
+typedef struct DisplayRingStats {
+    uint64_t published;
+    uint64_t dropped;        /* Replaced before the UI took them */
+    uint64_t acquired;
+    uint64_t repeated;       /* UI frames that showed an old image again */
+    uint64_t presented;
+    uint64_t latency_ns;     /* Sum of publish to present */
+    uint64_t latency_max_ns;
+} DisplayRingStats;
+
+typedef struct DisplayRing {
+    DisplayRingSlot slots[DISPLAY_RING_SIZE];
+    int back;       /* Owned by the renderer */
+    int front;      /* Owned by the UI */
+    bool front_valid;
+    uint32_t ready; /* Slot index, plus DISPLAY_RING_FRESH if unseen */
+    DisplayRingStats stats;
+} DisplayRing;
+
+void display_ring_init(DisplayRing *r);
+
+/* Forget all images, keeping the stats. Neither side may be using it. */
+void display_ring_reset(DisplayRing *r);
+
+/* Renderer: slot to draw the next image into */
+int display_ring_back(DisplayRing *r);
+
+/* Renderer: the back slot is complete and may be sampled by the UI */
+void display_ring_publish(DisplayRing *r, int64_t now);
+
+/* True once there is an image to show */
+bool display_ring_has_frame(DisplayRing *r);
+
+/* True if an image was published that the UI has not taken yet */
+bool display_ring_has_new_frame(DisplayRing *r);
+
+/* UI: take the newest image, or keep the current one. NULL if none yet. */
+DisplayRingSlot *display_ring_acquire(DisplayRing *r);
+
+/* UI: the acquired image has been composited */
+void display_ring_presented(DisplayRing *r, int64_t now);
+
+void display_ring_get_stats(DisplayRing *r, DisplayRingStats *stats);
+
+#endif
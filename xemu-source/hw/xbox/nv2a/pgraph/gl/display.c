@@ -34,12 +34,11 @@ void pgraph_gl_init_display(NV2AState *d)
 
     glo_set_current(g_nv2a_context_display);
 
-    glGenTextures(1, &r->gl_display_buffer);
-    r->gl_display_buffer_internal_format = 0;
-    r->gl_display_buffer_width = 0;
-    r->gl_display_buffer_height = 0;
-    r->gl_display_buffer_format = 0;
-    r->gl_display_buffer_type = 0;
+    for (int i = 0; i < DISPLAY_RING_SIZE; i++) {
+        PGRAPHGLDisplayBuffer *buf = &r->gl_display_buffers[i];
+        memset(buf, 0, sizeof(*buf));
+        glGenTextures(1, &buf->texture);
+    }
 
     const char *vs =
         "#version 330\n"
@@ -114,8 +113,10 @@ void pgraph_gl_finalize_display(PGRAPHState *pg)
 
     glo_set_current(g_nv2a_context_display);
 
-    glDeleteTextures(1, &r->gl_display_buffer);
-    r->gl_display_buffer = 0;
+    for (int i = 0; i < DISPLAY_RING_SIZE; i++) {
+        glDeleteTextures(1, &r->gl_display_buffers[i].texture);
+        r->gl_display_buffers[i].texture = 0;
+    }
 
     glDeleteProgram(r->disp_rndr.prog);
     r->disp_rndr.prog = 0;
@@ -162,7 +163,8 @@ static float pvideo_calculate_scale(unsigned int din_dout,
     return (calculated_in + 1.0f) / output_size;
 }
 
-static void render_display_pvideo_overlay(NV2AState *d)
+static void render_display_pvideo_overlay(NV2AState *d,
+                                          PGRAPHGLDisplayBuffer *buf)
 {
     PGRAPHState *pg = &d->pgraph;
     PGRAPHGLState *r = pg->gl_renderer_state;
@@ -256,7 +258,7 @@ static void render_display_pvideo_overlay(NV2AState *d)
     pgraph_apply_scaling_factor(pg, &out_width, &out_height);
 
     // Translate for the GL viewport origin.
-    out_y = MAX(r->gl_display_buffer_height - 1 - (int)(out_y + out_height), 0);
+    out_y = MAX(buf->height - 1 - (int)(out_y + out_height), 0);
 
     glActiveTexture(GL_TEXTURE0 + 1);
     glBindTexture(GL_TEXTURE_2D, r->disp_rndr.pvideo_tex);
@@ -276,7 +278,8 @@ static void render_display_pvideo_overlay(NV2AState *d)
                 scale_x, scale_y, 1.0f / pg->surface_scale_factor);
 }
 
-static void render_display(NV2AState *d, SurfaceBinding *surface)
+static void render_display(NV2AState *d, SurfaceBinding *surface,
+                           PGRAPHGLDisplayBuffer *buf)
 {
     struct PGRAPHState *pg = &d->pgraph;
     PGRAPHGLState *r = pg->gl_renderer_state;
@@ -296,13 +299,13 @@ static void render_display(NV2AState *d, SurfaceBinding *surface)
 
     glBindFramebuffer(GL_FRAMEBUFFER, r->disp_rndr.fbo);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, r->gl_display_buffer);
+    glBindTexture(GL_TEXTURE_2D, buf->texture);
     bool recreate = (
-        surface->fmt.gl_internal_format != r->gl_display_buffer_internal_format
-        || width != r->gl_display_buffer_width
-        || height != r->gl_display_buffer_height
-        || surface->fmt.gl_format != r->gl_display_buffer_format
-        || surface->fmt.gl_type != r->gl_display_buffer_type
+        surface->fmt.gl_internal_format != buf->internal_format
+        || width != buf->width
+        || height != buf->height
+        || surface->fmt.gl_format != buf->format
+        || surface->fmt.gl_type != buf->type
         );
 
     if (recreate) {
@@ -317,23 +320,23 @@ static void render_display(NV2AState *d, SurfaceBinding *surface)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        r->gl_display_buffer_internal_format = surface->fmt.gl_internal_format;
-        r->gl_display_buffer_width = width;
-        r->gl_display_buffer_height = height;
-        r->gl_display_buffer_format = surface->fmt.gl_format;
-        r->gl_display_buffer_type = surface->fmt.gl_type;
+        buf->internal_format = surface->fmt.gl_internal_format;
+        buf->width = width;
+        buf->height = height;
+        buf->format = surface->fmt.gl_format;
+        buf->type = surface->fmt.gl_type;
         glTexImage2D(GL_TEXTURE_2D, 0,
-            r->gl_display_buffer_internal_format,
-            r->gl_display_buffer_width,
-            r->gl_display_buffer_height,
+            buf->internal_format,
+            buf->width,
+            buf->height,
             0,
-            r->gl_display_buffer_format,
-            r->gl_display_buffer_type,
+            buf->format,
+            buf->type,
             NULL);
     }
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-        GL_TEXTURE_2D, r->gl_display_buffer, 0);
+        GL_TEXTURE_2D, buf->texture, 0);
     GLenum DrawBuffers[1] = {GL_COLOR_ATTACHMENT0};
     glDrawBuffers(1, DrawBuffers);
     assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
@@ -345,7 +348,7 @@ static void render_display(NV2AState *d, SurfaceBinding *surface)
     glProgramUniform1i(r->disp_rndr.prog, r->disp_rndr.tex_loc, 0);
     glUniform2f(r->disp_rndr.display_size_loc, width, height);
     glUniform1f(r->disp_rndr.line_offset_loc, line_offset);
-    render_display_pvideo_overlay(d);
+    render_display_pvideo_overlay(d, buf);
 
     glViewport(0, 0, width, height);
     glColorMask(true, true, true, true);
@@ -379,7 +382,7 @@ void pgraph_gl_sync(NV2AState *d)
 
     SurfaceBinding *surface = pgraph_gl_surface_get_within(d, d->pcrtc.start + vga_display_params.line_offset);
     if (surface == NULL || !surface->color) {
-        qemu_event_set(&d->pgraph.sync_complete);
+        pgraph_sync_complete(&d->pgraph);
         return;
     }
 
@@ -390,23 +393,32 @@ void pgraph_gl_sync(NV2AState *d)
     gl_fence();
     assert(glGetError() == GL_NO_ERROR);
 
-    /* Render framebuffer in display context */
+    /* Render framebuffer in display context, into an image the UI is not
+     * sampling. Complete before the UI may see it. */
+    PGRAPHGLState *r = d->pgraph.gl_renderer_state;
+    DisplayRing *ring = &d->pgraph.display_ring;
+    PGRAPHGLDisplayBuffer *buf = &r->gl_display_buffers[display_ring_back(ring)];
+
     glo_set_current(g_nv2a_context_display);
-    render_display(d, surface);
+    render_display(d, surface, buf);
     gl_fence();
     assert(glGetError() == GL_NO_ERROR);
 
     /* Switch back to original context */
     glo_set_current(g_nv2a_context_render);
 
-    qatomic_set(&d->pgraph.sync_pending, false);
-    qemu_event_set(&d->pgraph.sync_complete);
+    DisplayRingSlot *slot = &ring->slots[display_ring_back(ring)];
+    slot->texture = buf->texture;
+    slot->width = buf->width;
+    slot->height = buf->height;
+    display_ring_publish(ring, qemu_clock_get_ns(QEMU_CLOCK_REALTIME));
+
+    pgraph_sync_complete(&d->pgraph);
 }
 
-int pgraph_gl_get_framebuffer_surface(NV2AState *d)
+bool pgraph_gl_request_display(NV2AState *d)
 {
     PGRAPHState *pg = &d->pgraph;
-    PGRAPHGLState *r = pg->gl_renderer_state;
 
     qemu_mutex_lock(&d->pfifo.lock);
     // FIXME: Possible race condition with pgraph, consider lock
@@ -418,7 +430,7 @@ int pgraph_gl_get_framebuffer_surface(NV2AState *d)
         d, d->pcrtc.start + vga_display_params.line_offset);
     if (surface == NULL || !surface->color) {
         qemu_mutex_unlock(&d->pfifo.lock);
-        return 0;
+        return false;
     }
 
     assert(surface->color);
@@ -430,11 +442,9 @@ int pgraph_gl_get_framebuffer_surface(NV2AState *d)
         );
 
     surface->frame_time = pg->frame_time;
-    qemu_event_reset(&d->pgraph.sync_complete);
     qatomic_set(&pg->sync_pending, true);
     pfifo_kick(d);
     qemu_mutex_unlock(&d->pfifo.lock);
-    qemu_event_wait(&d->pgraph.sync_complete);
 
-    return r->gl_display_buffer;
+    return true;
 }
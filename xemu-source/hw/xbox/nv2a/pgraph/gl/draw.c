@@ -449,11 +449,6 @@ void pgraph_gl_flush_draw(NV2AState *d)
         nv2a_profile_inc_counter(NV2A_PROF_INLINE_BUFFERS);
         assert(pg->inline_array_length == 0);
 
-        if (pg->compressed_attrs) {
-            pg->compressed_attrs = 0;
-            pgraph_gl_bind_shaders(pg);
-        }
-
         for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
             VertexAttribute *attr = &pg->vertex_attributes[i];
             if (attr->inline_buffer_populated) {
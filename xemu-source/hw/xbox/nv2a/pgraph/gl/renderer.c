@@ -74,7 +74,6 @@ static void pgraph_gl_init(NV2AState *d, Error **errp)
     pgraph_gl_update_entire_memory_buffer(d);
 
     pg->uniform_attrs = 0;
-    pg->swizzle_attrs = 0;
 
     r->supported_extensions.texture_filter_anisotropic =
         glo_check_extension("GL_EXT_texture_filter_anisotropic");
@@ -107,9 +106,21 @@ static void pgraph_gl_flip_stall(NV2AState *d)
 
 static void pgraph_gl_flush(NV2AState *d)
 {
-    pgraph_gl_surface_flush(d);
-    pgraph_gl_mark_textures_possibly_dirty(d, 0, memory_region_size(d->vram));
-    pgraph_gl_update_entire_memory_buffer(d);
+    PGRAPHState *pg = &d->pgraph;
+
+    if (pg->loadvm.pending) {
+        /*
+         * VRAM the snapshot load changed is marked dirty, textures and the
+         * memory buffer pick it up like any other guest write.
+         */
+        pgraph_gl_surface_revalidate(d);
+        pgraph_loadvm_complete(pg);
+    } else {
+        pgraph_gl_surface_flush(d);
+        pgraph_gl_mark_textures_possibly_dirty(d, 0,
+                                               memory_region_size(d->vram));
+        pgraph_gl_update_entire_memory_buffer(d);
+    }
     /* FIXME: Flush more? */
 
     qatomic_set(&d->pgraph.flush_pending, false);
@@ -123,7 +134,7 @@ static void pgraph_gl_process_pending(NV2AState *d)
 
     if (qatomic_read(&r->downloads_pending) ||
         qatomic_read(&r->download_dirty_surfaces_pending) ||
-        qatomic_read(&d->pgraph.sync_pending) ||
+        pgraph_display_pending(&d->pgraph) ||
         qatomic_read(&d->pgraph.flush_pending) ||
         qatomic_read(&r->shader_cache_writeback_pending)) {
         qemu_mutex_unlock(&d->pfifo.lock);
@@ -134,7 +145,8 @@ static void pgraph_gl_process_pending(NV2AState *d)
         if (qatomic_read(&r->download_dirty_surfaces_pending)) {
             pgraph_gl_download_dirty_surfaces(d);
         }
-        if (qatomic_read(&d->pgraph.sync_pending)) {
+        if (pgraph_display_pending(&d->pgraph)) {
+            pgraph_sync_begin(&d->pgraph);
             pgraph_gl_sync(d);
         }
         if (qatomic_read(&d->pgraph.flush_pending)) {
@@ -206,7 +218,7 @@ static PGRAPHRenderer pgraph_gl_renderer = {
         .surface_update = pgraph_gl_surface_update,
         .set_surface_scale_factor = pgraph_gl_set_surface_scale_factor,
         .get_surface_scale_factor = pgraph_gl_get_surface_scale_factor,
-        .get_framebuffer_surface = pgraph_gl_get_framebuffer_surface,
+        .request_display = pgraph_gl_request_display,
         .get_gpu_properties = pgraph_gl_get_gpu_properties,
     }
 };
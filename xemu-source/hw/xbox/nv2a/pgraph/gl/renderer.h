@@ -167,14 +167,18 @@ typedef struct QueryReport {
     GLuint *queries;
 } QueryReport;
 
+typedef struct PGRAPHGLDisplayBuffer {
+    GLuint texture;
+    GLint internal_format;
+    GLsizei width;
+    GLsizei height;
+    GLenum format;
+    GLenum type;
+} PGRAPHGLDisplayBuffer;
+
 typedef struct PGRAPHGLState {
     GLuint gl_framebuffer;
-    GLuint gl_display_buffer;
-    GLint gl_display_buffer_internal_format;
-    GLsizei gl_display_buffer_width;
-    GLsizei gl_display_buffer_height;
-    GLenum gl_display_buffer_format;
-    GLenum gl_display_buffer_type;
+    PGRAPHGLDisplayBuffer gl_display_buffers[DISPLAY_RING_SIZE];
 
     Lru element_cache;
     VertexLruNode *element_cache_entries;
@@ -182,6 +186,8 @@ typedef struct PGRAPHGLState {
     GLuint gl_memory_buffer;
     GLuint gl_vertex_array;
     GLuint gl_inline_buffer[NV2A_VERTEXSHADER_ATTRIBUTES];
+    GLuint gl_converted_buffer[NV2A_VERTEXSHADER_ATTRIBUTES];
+    uint64_t gl_converted_buffer_generation[NV2A_VERTEXSHADER_ATTRIBUTES];
 
     QTAILQ_HEAD(, SurfaceBinding) surfaces;
     SurfaceBinding *color_binding, *zeta_binding;
@@ -260,6 +266,7 @@ void pgraph_gl_image_blit(NV2AState *d);
 void pgraph_gl_mark_textures_possibly_dirty(NV2AState *d, hwaddr addr, hwaddr size);
 void pgraph_gl_process_pending_reports(NV2AState *d);
 void pgraph_gl_surface_flush(NV2AState *d);
+void pgraph_gl_surface_revalidate(NV2AState *d);
 void pgraph_gl_surface_update(NV2AState *d, bool upload, bool color_write, bool zeta_write);
 void pgraph_gl_sync(NV2AState *d);
 void pgraph_gl_update_entire_memory_buffer(NV2AState *d);
@@ -290,7 +297,7 @@ bool pgraph_gl_shader_load_from_memory(ShaderBinding *snode);
 void pgraph_gl_shader_write_cache_reload_list(PGRAPHState *pg);
 void pgraph_gl_set_surface_scale_factor(NV2AState *d, unsigned int scale);
 unsigned int pgraph_gl_get_surface_scale_factor(NV2AState *d);
-int pgraph_gl_get_framebuffer_surface(NV2AState *d);
+bool pgraph_gl_request_display(NV2AState *d);
 /**  Note: The caller must set up a clean GL context before invoking. */
 void pgraph_gl_determine_gpu_properties(void);
 GPUProperties *pgraph_gl_get_gpu_properties(void);
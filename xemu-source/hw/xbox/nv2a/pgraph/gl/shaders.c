@@ -760,24 +760,22 @@ void pgraph_gl_bind_shaders(PGRAPHState *pg)
     PGRAPHGLState *r = pg->gl_renderer_state;
 
     bool binding_changed = false;
-    if (r->shader_binding &&
-        !pgraph_glsl_check_shader_state_dirty(pg, &r->shader_binding->state)) {
+    if (r->shader_binding && !pgraph_glsl_check_shader_state_dirty(pg)) {
         nv2a_profile_inc_counter(NV2A_PROF_SHADER_BIND_NOTDIRTY);
         goto update_uniforms;
     }
 
     ShaderBinding *old_binding = r->shader_binding;
-    ShaderState state = pgraph_glsl_get_shader_state(pg);
+    uint64_t shader_state_hash;
+    const ShaderState *state =
+        pgraph_glsl_get_shader_state(pg, &shader_state_hash);
 
     NV2A_GL_DGROUP_BEGIN("%s (%s)", __func__,
-                         state.vsh.is_fixed_function ? "FF" : "PROG");
+                         state->vsh.is_fixed_function ? "FF" : "PROG");
 
     qemu_mutex_lock(&r->shader_cache_lock);
 
-    uint64_t shader_state_hash =
-        fast_hash((uint8_t *)&state, sizeof(ShaderState));
-
-    LruNode *node = lru_lookup(&r->shader_cache, shader_state_hash, &state);
+    LruNode *node = lru_lookup(&r->shader_cache, shader_state_hash, state);
     ShaderBinding *binding = container_of(node, ShaderBinding, node);
 
     if (!binding->initialized && !pgraph_gl_shader_load_from_memory(binding)) {
@@ -789,7 +787,6 @@ void pgraph_gl_bind_shaders(PGRAPHState *pg)
     }
     assert(binding->initialized);
     r->shader_binding = binding;
-    pg->program_data_dirty = false;
 
     qemu_mutex_unlock(&r->shader_cache_lock);
 
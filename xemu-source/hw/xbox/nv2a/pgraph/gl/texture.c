@@ -362,6 +362,8 @@ void pgraph_gl_bind_textures(NV2AState *d)
 
         if (key_out->binding == NULL) {
             // Must create the texture
+            nv2a_profile_add_counter(NV2A_PROF_TEX_UPLOAD_BYTES,
+                                     length + (is_indexed ? palette_length : 0));
             key_out->binding = generate_texture(state, texture_data, palette_data);
             key_out->binding->data_hash = tex_data_hash;
             key_out->binding->scale = 1;
@@ -48,10 +48,46 @@ static void update_memory_buffer(NV2AState *d, hwaddr addr, hwaddr size,
                                            DIRTY_MEMORY_NV2A)) {
         glBufferSubData(GL_ARRAY_BUFFER, addr, size,
                         d->vram_ptr + addr);
+        pgraph_mark_converted_vertex_attributes_possibly_dirty(pg, addr, size);
         nv2a_profile_inc_counter(NV2A_PROF_GEOM_BUFFER_UPDATE_1);
+        nv2a_profile_add_counter(NV2A_PROF_GEOM_BUFFER_UPDATE_BYTES, size);
     }
 }
 
+static void bind_converted_attribute(NV2AState *d, unsigned int attr_index,
+                                     const uint8_t *data, size_t stride,
+                                     unsigned int num_elements, bool cached)
+{
+    PGRAPHState *pg = &d->pgraph;
+    PGRAPHGLState *r = pg->gl_renderer_state;
+    VertexAttribute *attr = &pg->vertex_attributes[attr_index];
+
+    glBindBuffer(GL_ARRAY_BUFFER, r->gl_converted_buffer[attr_index]);
+
+    if (cached) {
+        hwaddr addr = data - d->vram_ptr;
+        VertexConvertLruNode *entry = pgraph_get_converted_vertex_attribute(
+            d, attr->format, addr, stride, num_elements);
+        if (r->gl_converted_buffer_generation[attr_index] !=
+            entry->generation) {
+            glBufferData(GL_ARRAY_BUFFER, entry->size, entry->data,
+                         GL_STREAM_DRAW);
+            r->gl_converted_buffer_generation[attr_index] = entry->generation;
+        }
+    } else {
+        size_t size =
+            pgraph_get_converted_vertex_element_size(attr->format) *
+            num_elements;
+        g_autofree uint8_t *converted = g_malloc(size);
+        pgraph_convert_vertex_attribute(attr->format, data, stride, converted,
+                                        num_elements);
+        glBufferData(GL_ARRAY_BUFFER, size, converted, GL_STREAM_DRAW);
+        r->gl_converted_buffer_generation[attr_index] = 0;
+    }
+
+    glVertexAttribPointer(attr_index, 3, GL_FLOAT, GL_FALSE, 0, 0);
+}
+
 void pgraph_gl_update_entire_memory_buffer(NV2AState *d)
 {
     PGRAPHState *pg = &d->pgraph;
@@ -59,6 +95,10 @@ void pgraph_gl_update_entire_memory_buffer(NV2AState *d)
 
     glBindBuffer(GL_ARRAY_BUFFER, r->gl_memory_buffer);
     glBufferSubData(GL_ARRAY_BUFFER, 0, memory_region_size(d->vram), d->vram_ptr);
+    nv2a_profile_add_counter(NV2A_PROF_GEOM_BUFFER_UPDATE_BYTES,
+                             memory_region_size(d->vram));
+    pgraph_mark_converted_vertex_attributes_possibly_dirty(
+        pg, 0, memory_region_size(d->vram));
 }
 
 void pgraph_gl_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
@@ -79,8 +119,6 @@ void pgraph_gl_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
         NV2A_GL_DGROUP_BEGIN("%s (num_elements: %d)", __func__, num_elements);
     }
 
-    pg->compressed_attrs = 0;
-
     for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
         VertexAttribute *attr = &pg->vertex_attributes[i];
 
@@ -122,8 +160,10 @@ void pgraph_gl_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
             gl_normalize = GL_FALSE;
             break;
         case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP:
-            /* 3 signed, normalized components packed in 32-bits. (11,11,10) */
-            gl_type = GL_INT;
+            /* 3 signed, normalized components packed in 32-bits. (11,11,10)
+             * Expanded to float xyz on the CPU. */
+            gl_type = GL_FLOAT;
+            gl_normalize = GL_FALSE;
             assert(attr->count == 1);
             needs_conversion = true;
             break;
@@ -137,10 +177,6 @@ void pgraph_gl_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
         hwaddr attrib_data_addr;
         size_t stride;
 
-        if (needs_conversion) {
-            pg->compressed_attrs |= (1 << i);
-        }
-
         hwaddr start = 0;
         if (inline_data) {
             glBindBuffer(GL_ARRAY_BUFFER, r->gl_inline_array_buffer);
@@ -155,8 +191,18 @@ void pgraph_gl_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
             attrib_data_addr = attr_data + attr->offset - d->vram_ptr;
             stride = attr->stride;
             start = attrib_data_addr + min_element * stride;
-            update_memory_buffer(d, start, num_elements * stride,
-                                        updated_memory_buffer);
+            if (needs_conversion) {
+                /*
+                 * Converted from the start of the array, so sync all of it
+                 * or writes below min_element go unnoticed by the cache.
+                 */
+                update_memory_buffer(d, attrib_data_addr,
+                                     (max_element + 1) * stride,
+                                     updated_memory_buffer);
+            } else {
+                update_memory_buffer(d, start, num_elements * stride,
+                                     updated_memory_buffer);
+            }
             updated_memory_buffer = true;
         }
 
@@ -180,8 +226,11 @@ void pgraph_gl_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
         }
 
         if (needs_conversion) {
-            glVertexAttribIPointer(i, gl_count, gl_type, stride,
-                                   (void *)attrib_data_addr);
+            const uint8_t *attr_data =
+                inline_data ? (uint8_t *)pg->inline_array + attrib_data_addr :
+                              d->vram_ptr + attrib_data_addr;
+            bind_converted_attribute(d, i, attr_data, stride, max_element + 1,
+                                     !inline_data);
         } else {
             glVertexAttribPointer(i, gl_count, gl_type, gl_normalize, stride,
                                   (void *)attrib_data_addr);
@@ -270,6 +319,9 @@ void pgraph_gl_init_buffers(NV2AState *d)
     assert(max_vertex_attributes >= NV2A_VERTEXSHADER_ATTRIBUTES);
 
     glGenBuffers(NV2A_VERTEXSHADER_ATTRIBUTES, r->gl_inline_buffer);
+    glGenBuffers(NV2A_VERTEXSHADER_ATTRIBUTES, r->gl_converted_buffer);
+    memset(r->gl_converted_buffer_generation, 0,
+           sizeof(r->gl_converted_buffer_generation));
     glGenBuffers(1, &r->gl_inline_array_buffer);
 
     glGenBuffers(1, &r->gl_memory_buffer);
@@ -300,6 +352,9 @@ void pgraph_gl_finalize_buffers(PGRAPHState *pg)
     glDeleteBuffers(NV2A_VERTEXSHADER_ATTRIBUTES, r->gl_inline_buffer);
     memset(r->gl_inline_buffer, 0, sizeof(r->gl_inline_buffer));
 
+    glDeleteBuffers(NV2A_VERTEXSHADER_ATTRIBUTES, r->gl_converted_buffer);
+    memset(r->gl_converted_buffer, 0, sizeof(r->gl_converted_buffer));
+
     glDeleteBuffers(1, &r->gl_inline_array_buffer);
     r->gl_inline_array_buffer = 0;
 
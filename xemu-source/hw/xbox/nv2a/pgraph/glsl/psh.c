@@ -799,6 +799,47 @@ static void define_colorkey_comparator(MString *preflight)
     // clang-format on
 }
 
+/*
+ * The uniform declarations and combiner constant aliases only vary with the
+ * target API, so each variant is generated once and reused.
+ */
+static const char *get_uniform_decls(bool vulkan)
+{
+    static gsize decls[2];
+    gsize *slot = &decls[vulkan];
+
+    if (g_once_init_enter(slot)) {
+        MString *uniforms = mstring_new();
+        const char *u = vulkan ? "" : "uniform ";
+        for (int i = 0; i < ARRAY_SIZE(PshUniformInfo); i++) {
+            const UniformInfo *info = &PshUniformInfo[i];
+            const char *type_str = uniform_element_type_to_str[info->type];
+            if (info->count == 1) {
+                mstring_append_fmt(uniforms, "%s%s %s;\n", u, type_str,
+                                   info->name);
+            } else {
+                mstring_append_fmt(uniforms, "%s%s %s[%zd];\n", u, type_str,
+                                   info->name, info->count);
+            }
+        }
+
+        for (int i = 0; i < 9; i++) {
+            for (int j = 0; j < 2; j++) {
+                mstring_append_fmt(uniforms, "#define c%d_%d consts[%d]\n",
+                                   j, i, i*2+j);
+            }
+        }
+
+        if (vulkan) {
+            mstring_append(uniforms, "};\n");
+        }
+        g_once_init_leave(slot, (gsize)g_strdup(mstring_get_str(uniforms)));
+        mstring_unref(uniforms);
+    }
+
+    return (const char *)*slot;
+}
+
 static MString* psh_convert(struct PixelShader *ps)
 {
     MString *preflight = mstring_new();
@@ -816,28 +857,7 @@ static MString* psh_convert(struct PixelShader *ps)
                            "layout(location = 0) out vec4 fragColor;\n");
     }
 
-    const char *u = ps->opts.vulkan ? "" : "uniform ";
-    for (int i = 0; i < ARRAY_SIZE(PshUniformInfo); i++) {
-        const UniformInfo *info = &PshUniformInfo[i];
-        const char *type_str = uniform_element_type_to_str[info->type];
-        if (info->count == 1) {
-            mstring_append_fmt(preflight, "%s%s %s;\n", u, type_str,
-                               info->name);
-        } else {
-            mstring_append_fmt(preflight, "%s%s %s[%zd];\n", u, type_str,
-                               info->name, info->count);
-        }
-    }
-
-    for (int i = 0; i < 9; i++) {
-        for (int j = 0; j < 2; j++) {
-            mstring_append_fmt(preflight, "#define c%d_%d consts[%d]\n", j, i, i*2+j);
-        }
-    }
-
-    if (ps->opts.vulkan) {
-        mstring_append(preflight, "};\n");
-    }
+    mstring_append(preflight, get_uniform_decls(ps->opts.vulkan));
 
     const char *dotmap_funcs[] = {
         "dotmap_zero_to_one",
@@ -850,7 +870,7 @@ static MString* psh_convert(struct PixelShader *ps)
         "dotmap_hilo_hemisphere",
     };
 
-    mstring_append_fmt(preflight,
+    mstring_append(preflight,
         "float sign1(float x) {\n"
         "    x *= 255.0;\n"
         "    return (x-128.0)/127.0;\n"
@@ -1486,16 +1506,19 @@ static MString* psh_convert(struct PixelShader *ps)
         break;
     }
 
-    MString *final = mstring_new();
+    MString *final = mstring_new_sized(
+        mstring_get_length(preflight) + mstring_get_length(clip) +
+        mstring_get_length(vars) + mstring_get_length(ps->code) + 64);
     mstring_append_fmt(final, "#version %d\n\n", ps->opts.vulkan ? 450 : 400);
-    mstring_append(final, mstring_get_str(preflight));
+    mstring_append_mstring(final, preflight);
     mstring_append(final, "void main() {\n");
-    mstring_append(final, mstring_get_str(clip));
-    mstring_append(final, mstring_get_str(vars));
-    mstring_append(final, mstring_get_str(ps->code));
+    mstring_append_mstring(final, clip);
+    mstring_append_mstring(final, vars);
+    mstring_append_mstring(final, ps->code);
     mstring_append(final, "}\n");
 
     mstring_unref(preflight);
+    mstring_unref(clip);
     mstring_unref(vars);
     mstring_unref(ps->code);
 
@@ -0,0 +1,58 @@
+/*
+ * Geforce NV2A PGRAPH GLSL Shader Generator
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+
+#include "hw/xbox/nv2a/nv2a_regs.h"
+#include "shader-deps.h"
+
+#define REG(r) ((r) / 4)
+#define REGS(r, n) REG(r) ... REG(r) + (n) - 1
+
+/*
+ * Keep in sync with the registers read by pgraph_glsl_set_vsh_state,
+ * pgraph_glsl_set_geom_state and pgraph_glsl_set_psh_state.
+ */
+const uint8_t pgraph_glsl_shader_state_reg_deps[0x2000 / 4] = {
+    [REG(NV_PGRAPH_CONTROL_0)] = SHADER_STATE_ALL,
+    [REG(NV_PGRAPH_CONTROL_3)] = SHADER_STATE_ALL,
+    [REG(NV_PGRAPH_SETUPRASTER)] = SHADER_STATE_GEOM | SHADER_STATE_PSH,
+
+    [REG(NV_PGRAPH_CSV0_C)] = SHADER_STATE_VSH,
+    [REG(NV_PGRAPH_CSV0_D)] = SHADER_STATE_VSH,
+    [REG(NV_PGRAPH_CSV1_A)] = SHADER_STATE_VSH,
+    [REG(NV_PGRAPH_CSV1_B)] = SHADER_STATE_VSH,
+    [REG(NV_PGRAPH_POINTSIZE)] = SHADER_STATE_VSH,
+
+    [REG(NV_PGRAPH_COMBINECTL)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_COMBINESPECFOG0)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_COMBINESPECFOG1)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_SHADERCLIPMODE)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_SHADERCTL)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_SHADERPROG)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_SHADOWCTL)] = SHADER_STATE_PSH,
+    [REG(NV_PGRAPH_ZCOMPRESSOCCLUDE)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_COMBINEALPHAI0, 8)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_COMBINEALPHAO0, 8)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_COMBINECOLORI0, 8)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_COMBINECOLORO0, 8)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_TEXCTL0_0, 4)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_TEXFILTER0, 4)] = SHADER_STATE_PSH,
+    [REGS(NV_PGRAPH_TEXFMT0, 4)] = SHADER_STATE_PSH,
+};
@@ -0,0 +1,45 @@
+/*
+ * Geforce NV2A PGRAPH GLSL Shader Generator
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_NV2A_PGRAPH_GLSL_SHADER_DEPS_H
+#define HW_XBOX_NV2A_PGRAPH_GLSL_SHADER_DEPS_H
+
+#include <stdint.h>
+
+/* Independently rebuilt and hashed parts of ShaderState */
+enum ShaderStatePart {
+    SHADER_STATE_PART_VSH,
+    SHADER_STATE_PART_GEOM,
+    SHADER_STATE_PART_PSH,
+    SHADER_STATE_PART__COUNT,
+};
+
+#define SHADER_STATE_VSH (1 << SHADER_STATE_PART_VSH)
+#define SHADER_STATE_GEOM (1 << SHADER_STATE_PART_GEOM)
+#define SHADER_STATE_PSH (1 << SHADER_STATE_PART_PSH)
+#define SHADER_STATE_ALL \
+    (SHADER_STATE_VSH | SHADER_STATE_GEOM | SHADER_STATE_PSH)
+
+/*
+ * Mask of the ShaderState parts derived from each PGRAPH register, indexed by
+ * register offset / 4.
+ */
+extern const uint8_t pgraph_glsl_shader_state_reg_deps[0x2000 / 4];
+
+#endif
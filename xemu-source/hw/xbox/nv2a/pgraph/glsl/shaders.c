@@ -18,78 +18,73 @@
  */
 
 #include "hw/xbox/nv2a/pgraph/pgraph.h"
+#include "qemu/fast-hash.h"
 #include "shaders.h"
 
-ShaderState pgraph_glsl_get_shader_state(PGRAPHState *pg)
+/*
+ * ShaderState is kept in PGRAPHState and rebuilt one part at a time. Register
+ * writes mark the parts that depend on the written register (see
+ * pgraph_glsl_shader_state_reg_deps), method handlers mark parts that depend
+ * on other PGRAPH state, and the few inputs owned by the renderers are
+ * compared here when binding.
+ */
+static unsigned int get_renderer_dirty_parts(PGRAPHState *pg)
 {
-    pg->program_data_dirty = false; /* fixme */
-
-    ShaderState state;
+    const ShaderState *state = &pg->shader_state;
+    unsigned int parts = 0;
 
-    // We will hash it, so make sure any padding is zeroed
-    memset(&state, 0, sizeof(ShaderState));
-
-    pgraph_glsl_set_vsh_state(pg, &state.vsh);
-    pgraph_glsl_set_geom_state(pg, &state.geom);
-    pgraph_glsl_set_psh_state(pg, &state.psh);
+    if (pg->uniform_attrs != state->vsh.uniform_attrs ||
+        pg->surface_scale_factor != state->vsh.surface_scale_factor) {
+        parts |= SHADER_STATE_VSH;
+    }
+    if (pg->primitive_mode != state->geom.primitive_mode) {
+        parts |= SHADER_STATE_GEOM;
+    }
+    if (pg->surface_shape.zeta_format != state->psh.surface_zeta_format) {
+        parts |= SHADER_STATE_PSH;
+    }
 
-    return state;
+    return parts;
 }
 
-bool pgraph_glsl_check_shader_state_dirty(PGRAPHState *pg,
-                                          const ShaderState *state)
+const ShaderState *pgraph_glsl_get_shader_state(PGRAPHState *pg,
+                                                uint64_t *hash)
 {
-    if (pg->program_data_dirty) {
-        return true;
-    }
+    ShaderState *state = &pg->shader_state;
+    uint64_t *part_hashes = pg->shader_state_part_hashes;
+    unsigned int dirty = pg->shader_state_dirty | get_renderer_dirty_parts(pg);
 
-    unsigned int regs[] = {
-        NV_PGRAPH_COMBINECTL,      NV_PGRAPH_COMBINESPECFOG0,
-        NV_PGRAPH_COMBINESPECFOG1, NV_PGRAPH_CONTROL_0,
-        NV_PGRAPH_CONTROL_3,       NV_PGRAPH_CSV0_C,
-        NV_PGRAPH_CSV0_D,          NV_PGRAPH_CSV1_A,
-        NV_PGRAPH_CSV1_B,          NV_PGRAPH_POINTSIZE,
-        NV_PGRAPH_SETUPRASTER,     NV_PGRAPH_SHADERCLIPMODE,
-        NV_PGRAPH_SHADERCTL,       NV_PGRAPH_SHADERPROG,
-        NV_PGRAPH_SHADOWCTL,       NV_PGRAPH_ZCOMPRESSOCCLUDE,
-    };
-    for (int i = 0; i < ARRAY_SIZE(regs); i++) {
-        if (pgraph_is_reg_dirty(pg, regs[i])) {
-            return true;
+    if (dirty) {
+        // Parts are hashed, so make sure any padding is zeroed
+        if (dirty & SHADER_STATE_VSH) {
+            memset(&state->vsh, 0, sizeof(state->vsh));
+            pgraph_glsl_set_vsh_state(pg, &state->vsh);
+            part_hashes[SHADER_STATE_PART_VSH] =
+                fast_hash((const uint8_t *)&state->vsh, sizeof(state->vsh));
         }
-    }
-
-    int num_stages = pgraph_reg_r(pg, NV_PGRAPH_COMBINECTL) & 0xFF;
-    for (int i = 0; i < num_stages; i++) {
-        if (pgraph_is_reg_dirty(pg, NV_PGRAPH_COMBINEALPHAI0 + i * 4) ||
-            pgraph_is_reg_dirty(pg, NV_PGRAPH_COMBINEALPHAO0 + i * 4) ||
-            pgraph_is_reg_dirty(pg, NV_PGRAPH_COMBINECOLORI0 + i * 4) ||
-            pgraph_is_reg_dirty(pg, NV_PGRAPH_COMBINECOLORO0 + i * 4)) {
-            return true;
+        if (dirty & SHADER_STATE_GEOM) {
+            memset(&state->geom, 0, sizeof(state->geom));
+            pgraph_glsl_set_geom_state(pg, &state->geom);
+            part_hashes[SHADER_STATE_PART_GEOM] =
+                fast_hash((const uint8_t *)&state->geom, sizeof(state->geom));
         }
-    }
-
-    if (pg->uniform_attrs != state->vsh.uniform_attrs ||
-        pg->swizzle_attrs != state->vsh.swizzle_attrs ||
-        pg->compressed_attrs != state->vsh.compressed_attrs ||
-        pg->primitive_mode != state->geom.primitive_mode ||
-        pg->surface_scale_factor != state->vsh.surface_scale_factor ||
-        pg->surface_shape.zeta_format != state->psh.surface_zeta_format) {
-        return true;
-    }
-
-    for (int i = 0; i < 4; i++) {
-        if (pgraph_is_reg_dirty(pg, NV_PGRAPH_TEXCTL0_0 + i * 4) ||
-            pgraph_is_reg_dirty(pg, NV_PGRAPH_TEXFILTER0 + i * 4) ||
-            pgraph_is_reg_dirty(pg, NV_PGRAPH_TEXFMT0 + i * 4)) {
-            return true;
-        }
-
-        if (pg->texture_matrix_enable[i] !=
-            state->vsh.fixed_function.texture_matrix_enable[i]) {
-            return true;
+        if (dirty & SHADER_STATE_PSH) {
+            memset(&state->psh, 0, sizeof(state->psh));
+            pgraph_glsl_set_psh_state(pg, &state->psh);
+            part_hashes[SHADER_STATE_PART_PSH] =
+                fast_hash((const uint8_t *)&state->psh, sizeof(state->psh));
         }
+        pg->shader_state_hash =
+            fast_hash((const uint8_t *)part_hashes,
+                      sizeof(pg->shader_state_part_hashes));
+        pg->shader_state_dirty = 0;
     }
 
-    return false;
+    *hash = pg->shader_state_hash;
+    return state;
+}
+
+bool pgraph_glsl_check_shader_state_dirty(PGRAPHState *pg)
+{
+    return pg->shader_state_dirty || get_renderer_dirty_parts(pg);
 }
@@ -23,6 +23,7 @@
 #include "vsh.h"
 #include "geom.h"
 #include "psh.h"
+#include "shader-deps.h"
 
 typedef struct ShaderState {
     VshState vsh;
@@ -32,9 +33,9 @@ typedef struct ShaderState {
 
 typedef struct PGRAPHState PGRAPHState;
 
-ShaderState pgraph_glsl_get_shader_state(PGRAPHState *pg);
+const ShaderState *pgraph_glsl_get_shader_state(PGRAPHState *pg,
+                                                uint64_t *hash);
 
-bool pgraph_glsl_check_shader_state_dirty(PGRAPHState *pg,
-                                          const ShaderState *state);
+bool pgraph_glsl_check_shader_state_dirty(PGRAPHState *pg);
 
 #endif
@@ -111,9 +111,7 @@ void pgraph_glsl_set_vsh_state(PGRAPHState *pg, VshState *vsh)
 
     vsh->surface_scale_factor = pg->surface_scale_factor; // FIXME
 
-    vsh->compressed_attrs = pg->compressed_attrs;
     vsh->uniform_attrs = pg->uniform_attrs;
-    vsh->swizzle_attrs = pg->swizzle_attrs;
 
     vsh->specular_enable = GET_MASK(pgraph_reg_r(pg, NV_PGRAPH_CSV0_C),
                                     NV_PGRAPH_CSV0_C_SPECULAR_ENABLE);
@@ -158,27 +156,45 @@ void pgraph_glsl_set_vsh_state(PGRAPHState *pg, VshState *vsh)
     }
 }
 
-MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
+/*
+ * The uniform declarations only vary with the target API and whether inline
+ * values are declared, so each variant is generated once and reused.
+ */
+static const char *get_uniform_decls(bool vulkan, bool inline_values)
 {
-    MString *uniforms = mstring_new();
-    const char *u = opts.vulkan ? "" : "uniform ";
-    for (int i = 0; i < ARRAY_SIZE(VshUniformInfo); i++) {
-        const UniformInfo *info = &VshUniformInfo[i];
-        const char *type_str = uniform_element_type_to_str[info->type];
-        if (i == VshUniform_inlineValue &&
-            (!state->uniform_attrs ||
-             opts.use_push_constants_for_uniform_attrs)) {
-            continue;
-        }
-        if (info->count == 1) {
-            mstring_append_fmt(uniforms, "%s%s %s;\n", u, type_str,
-                               info->name);
-        } else {
-            mstring_append_fmt(uniforms, "%s%s %s[%zd];\n", u, type_str,
-                               info->name, info->count);
+    static gsize decls[2][2];
+    gsize *slot = &decls[vulkan][inline_values];
+
+    if (g_once_init_enter(slot)) {
+        MString *uniforms = mstring_new();
+        const char *u = vulkan ? "" : "uniform ";
+        for (int i = 0; i < ARRAY_SIZE(VshUniformInfo); i++) {
+            const UniformInfo *info = &VshUniformInfo[i];
+            const char *type_str = uniform_element_type_to_str[info->type];
+            if (i == VshUniform_inlineValue && !inline_values) {
+                continue;
+            }
+            if (info->count == 1) {
+                mstring_append_fmt(uniforms, "%s%s %s;\n", u, type_str,
+                                   info->name);
+            } else {
+                mstring_append_fmt(uniforms, "%s%s %s[%zd];\n", u, type_str,
+                                   info->name, info->count);
+            }
         }
+        g_once_init_leave(slot, (gsize)g_strdup(mstring_get_str(uniforms)));
+        mstring_unref(uniforms);
     }
 
+    return (const char *)*slot;
+}
+
+MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
+{
+    const char *uniforms = get_uniform_decls(
+        opts.vulkan,
+        state->uniform_attrs && !opts.use_push_constants_for_uniform_attrs);
+
     MString *header = mstring_from_str(
         GLSL_DEFINE(fogPlane, GLSL_C(NV_IGRAPH_XF_XFCTX_FOG))
         GLSL_DEFINE(texMat0, GLSL_C_MAT4(NV_IGRAPH_XF_XFCTX_T0MAT))
@@ -201,13 +217,6 @@ MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
         "vec4 oT2 = vec4(0.0,0.0,0.0,1.0);\n"
         "vec4 oT3 = vec4(0.0,0.0,0.0,1.0);\n"
         "\n"
-        "vec4 decompress_11_11_10(int cmp) {\n"
-        "    float x = float(bitfieldExtract(cmp, 0,  11)) / 1023.0;\n"
-        "    float y = float(bitfieldExtract(cmp, 11, 11)) / 1023.0;\n"
-        "    float z = float(bitfieldExtract(cmp, 22, 10)) / 511.0;\n"
-        "    return vec4(x, y, z, 1);\n"
-        "}\n"
-        "\n"
         // Clamp to range [2^(-64), 2^64] or [-2^64, -2^(-64)].
         "float clampAwayZeroInf(float t) {\n"
         "  if (t > 0.0 || floatBitsToUint(t) == 0) {\n"
@@ -258,27 +267,14 @@ MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
 
     for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
         bool is_uniform = state->uniform_attrs & (1 << i);
-        bool is_swizzled = state->swizzle_attrs & (1 << i);
-        bool is_compressed = state->compressed_attrs & (1 << i);
-
-        assert(!(is_uniform && is_compressed));
-        assert(!(is_uniform && is_swizzled));
 
         if (is_uniform) {
             mstring_append_fmt(header, "vec4 v%d = inlineValue[%d];\n", i,
                                num_uniform_attrs);
             num_uniform_attrs += 1;
         } else {
-            if (state->compressed_attrs & (1 << i)) {
-                mstring_append_fmt(header,
-                                   "layout(location = %d) in int v%d_cmp;\n", i, i);
-            } else if (state->swizzle_attrs & (1 << i)) {
-                mstring_append_fmt(header, "layout(location = %d) in vec4 v%d_sw;\n",
-                                   i, i);
-            } else {
-                mstring_append_fmt(header, "layout(location = %d) in vec4 v%d;\n",
-                                   i, i);
-            }
+            mstring_append_fmt(header, "layout(location = %d) in vec4 v%d;\n",
+                               i, i);
         }
     }
 
@@ -286,18 +282,6 @@ MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
 
     MString *body = mstring_from_str("void main() {\n");
 
-    for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
-        if (state->compressed_attrs & (1 << i)) {
-            mstring_append_fmt(
-                body, "vec4 v%d = decompress_11_11_10(v%d_cmp);\n", i, i);
-        }
-
-        if (state->swizzle_attrs & (1 << i)) {
-            mstring_append_fmt(body, "vec4 v%d = v%d_sw.bgra;\n", i, i);
-        }
-
-    }
-
     if (state->is_fixed_function) {
         pgraph_glsl_gen_vsh_ff(state, header, body);
     } else {
@@ -444,8 +428,10 @@ MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
     mstring_append(body, "}\n");
 
     /* Return combined header + source */
-    MString *output =
-        mstring_from_fmt("#version %d\n\n", opts.vulkan ? 450 : 400);
+    MString *output = mstring_new_sized(
+        strlen(uniforms) + mstring_get_length(header) +
+        mstring_get_length(body) + 256);
+    mstring_append_fmt(output, "#version %d\n\n", opts.vulkan ? 450 : 400);
 
     if (opts.vulkan) {
         // FIXME: Optimize uniforms
@@ -462,16 +448,15 @@ MString *pgraph_glsl_gen_vsh(const VshState *state, GenVshGlslOptions opts)
             "layout(binding = %d, std140) uniform VshUniforms {\n"
             "%s"
             "};\n\n",
-            opts.ubo_binding, mstring_get_str(uniforms));
+            opts.ubo_binding, uniforms);
     } else {
-        mstring_append(
-            output, mstring_get_str(uniforms));
+        mstring_append(output, uniforms);
     }
 
-    mstring_append(output, mstring_get_str(header));
+    mstring_append_mstring(output, header);
     mstring_unref(header);
 
-    mstring_append(output, mstring_get_str(body));
+    mstring_append_mstring(output, body);
     mstring_unref(body);
 
     return output;
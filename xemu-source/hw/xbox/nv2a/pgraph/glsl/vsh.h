@@ -50,9 +50,7 @@ typedef struct ProgrammableVshState {
 typedef struct {
     unsigned int surface_scale_factor;  // FIXME: Remove
 
-    uint16_t compressed_attrs;
     uint16_t uniform_attrs;
-    uint16_t swizzle_attrs;
 
     bool fog_enable;
     enum VshFogMode fog_mode;
@@ -24,12 +24,17 @@
 
 static void pgraph_null_sync(NV2AState *d)
 {
-    qatomic_set(&d->pgraph.sync_pending, false);
-    qemu_event_set(&d->pgraph.sync_complete);
+    DisplayRing *ring = &d->pgraph.display_ring;
+
+    /* Nothing is drawn, the UI falls back to VGA on an empty image */
+    ring->slots[display_ring_back(ring)].texture = 0;
+    display_ring_publish(ring, qemu_clock_get_ns(QEMU_CLOCK_REALTIME));
+    pgraph_sync_complete(&d->pgraph);
 }
 
 static void pgraph_null_flush(NV2AState *d)
 {
+    pgraph_loadvm_complete(&d->pgraph);
     qatomic_set(&d->pgraph.flush_pending, false);
     qemu_event_set(&d->pgraph.flush_complete);
 }
@@ -37,12 +42,13 @@ static void pgraph_null_flush(NV2AState *d)
 static void pgraph_null_process_pending(NV2AState *d)
 {
     if (
-        qatomic_read(&d->pgraph.sync_pending) ||
+        pgraph_display_pending(&d->pgraph) ||
         qatomic_read(&d->pgraph.flush_pending)
         ) {
         qemu_mutex_unlock(&d->pfifo.lock);
         qemu_mutex_lock(&d->pgraph.lock);
-        if (qatomic_read(&d->pgraph.sync_pending)) {
+        if (pgraph_display_pending(&d->pgraph)) {
+            pgraph_sync_begin(&d->pgraph);
             pgraph_null_sync(d);
         }
         if (qatomic_read(&d->pgraph.flush_pending)) {
@@ -111,6 +117,15 @@ static void pgraph_null_surface_update(NV2AState *d, bool upload,
 {
 }
 
+static bool pgraph_null_request_display(NV2AState *d)
+{
+    qemu_mutex_lock(&d->pfifo.lock);
+    qatomic_set(&d->pgraph.sync_pending, true);
+    pfifo_kick(d);
+    qemu_mutex_unlock(&d->pfifo.lock);
+    return true;
+}
+
 static void pgraph_null_init(NV2AState *d, Error **errp)
 {
     PGRAPHState *pg = &d->pgraph;
@@ -136,6 +151,7 @@ static PGRAPHRenderer pgraph_null_renderer = {
         .pre_shutdown_wait = pgraph_null_pre_shutdown_wait,
         .process_pending = pgraph_null_process_pending,
         .process_pending_reports = pgraph_null_process_pending_reports,
+        .request_display = pgraph_null_request_display,
         .surface_update = pgraph_null_surface_update,
     }
 };
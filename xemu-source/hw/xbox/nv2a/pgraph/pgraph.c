@@ -222,9 +222,11 @@ void pgraph_init(NV2AState *d)
     PGRAPHState *pg = &d->pgraph;
     qemu_mutex_init(&pg->lock);
     qemu_mutex_init(&pg->renderer_lock);
-    qemu_event_init(&pg->sync_complete, false);
+    qemu_mutex_init(&pg->sync_lock);
+    qemu_cond_init(&pg->sync_complete);
     qemu_event_init(&pg->flush_complete, false);
     qemu_cond_init(&pg->framebuffer_released);
+    display_ring_init(&pg->display_ring);
     qemu_event_init(&pg->renderer_switch_complete, false);
     pg->renderer_switch_phase = PGRAPH_RENDERER_SWITCH_PHASE_IDLE;
 
@@ -243,6 +245,11 @@ void pgraph_init(NV2AState *d)
         attribute->inline_buffer_populated = false;
     }
 
+    pgraph_init_vertex_convert_cache(pg);
+
+    vram_changed_ranges_init(&pg->loadvm.changed);
+
+    pg->shader_state_dirty = SHADER_STATE_ALL;
     pgraph_clear_dirty_reg_map(pg);
 }
 
@@ -317,6 +324,12 @@ static bool attempt_renderer_init(PGRAPHState *pg)
 
 static void init_renderer(PGRAPHState *pg)
 {
+    /* Renderers track uploads of converted attributes by generation */
+    pgraph_flush_vertex_convert_cache(pg);
+
+    /* Geometry shader state depends on renderer properties */
+    pg->shader_state_dirty = SHADER_STATE_ALL;
+
     if (attempt_renderer_init(pg)) {
         return;  // Success
     }
@@ -351,24 +364,122 @@ void pgraph_destroy(PGRAPHState *pg)
        pg->renderer->ops.finalize(d);
     }
 
+    pgraph_finalize_vertex_convert_cache(pg);
+
+    vram_page_hashes_finalize(&pg->loadvm.page_hashes);
+    vram_changed_ranges_finalize(&pg->loadvm.changed);
+
     qemu_mutex_destroy(&pg->lock);
 }
 
+/*
+ * The UI throttles itself to 60 Hz, so part of its frame can go to waiting
+ * for the image it has just asked for without costing frame rate. Past
+ * that, the newest image already published is shown instead. Frames the
+ * guest flips to are drawn without being asked for, so this only applies
+ * to guests drawing into the displayed surface without flipping.
+ */
+#define DISPLAY_SYNC_BUDGET_NS (4 * SCALE_MS)
+
+/*
+ * The guest has pointed the scanout at a new frame. Have the renderer draw
+ * it into the display ring straight away, so the UI finds it there instead
+ * of asking for it and waiting for the renderer to get around to it.
+ */
+void pgraph_display_flipped(NV2AState *d)
+{
+    PGRAPHState *pg = &d->pgraph;
+
+    /* Nobody is taking images from the ring */
+    if (!qatomic_read(&pg->display_requested)) {
+        return;
+    }
+
+    qemu_mutex_lock(&d->pfifo.lock);
+    qatomic_inc(&pg->display_flips);
+    pfifo_kick(d);
+    qemu_mutex_unlock(&d->pfifo.lock);
+}
+
+static bool pgraph_display_flip_pending(PGRAPHState *pg)
+{
+    return qatomic_read(&pg->display_flips) !=
+           qatomic_read(&pg->display_flips_drawn);
+}
+
+bool pgraph_display_pending(PGRAPHState *pg)
+{
+    return qatomic_read(&pg->sync_pending) || pgraph_display_flip_pending(pg);
+}
+
+void pgraph_sync_begin(PGRAPHState *pg)
+{
+    pg->display_flips_drawing = qatomic_read(&pg->display_flips);
+}
+
+void pgraph_sync_complete(PGRAPHState *pg)
+{
+    qemu_mutex_lock(&pg->sync_lock);
+    qatomic_set(&pg->display_flips_drawn, pg->display_flips_drawing);
+    qatomic_set(&pg->sync_pending, false);
+    qemu_cond_broadcast(&pg->sync_complete);
+    qemu_mutex_unlock(&pg->sync_lock);
+}
+
+static void pgraph_wait_display(PGRAPHState *pg)
+{
+    /* Nothing to show yet, or the frame the guest flipped to is coming */
+    bool wait_all = !display_ring_has_frame(&pg->display_ring) ||
+                    pgraph_display_flip_pending(pg);
+    int64_t deadline =
+        qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + DISPLAY_SYNC_BUDGET_NS;
+
+    qemu_mutex_lock(&pg->sync_lock);
+    while (qatomic_read(&pg->sync_pending)) {
+        if (wait_all) {
+            qemu_cond_wait(&pg->sync_complete, &pg->sync_lock);
+            continue;
+        }
+        int64_t remaining = deadline - qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+        if (remaining <= 0 ||
+            !qemu_cond_timedwait(&pg->sync_complete, &pg->sync_lock,
+                                 DIV_ROUND_UP(remaining, SCALE_MS))) {
+            break;
+        }
+    }
+    qemu_mutex_unlock(&pg->sync_lock);
+}
+
+/*
+ * Returns the newest image straight away if the renderer has already drawn
+ * the frame the guest flipped to last. Otherwise asks for the display and
+ * returns it once drawn, or past the budget above the newest image there is.
+ */
 int nv2a_get_framebuffer_surface(void)
 {
     NV2AState *d = g_nv2a;
     PGRAPHState *pg = &d->pgraph;
-    int s = 0;
+    DisplayRingSlot *slot = NULL;
 
     qemu_mutex_lock(&pg->renderer_lock);
     assert(!pg->framebuffer_in_use);
     pg->framebuffer_in_use = true;
-    if (pg->renderer->ops.get_framebuffer_surface) {
-        s = pg->renderer->ops.get_framebuffer_surface(d);
+    if (qatomic_read(&pg->display_requested) &&
+        !pgraph_display_flip_pending(pg) &&
+        display_ring_has_new_frame(&pg->display_ring)) {
+        slot = display_ring_acquire(&pg->display_ring);
+    } else {
+        bool requested = pg->renderer->ops.request_display &&
+                         pg->renderer->ops.request_display(d);
+        qatomic_set(&pg->display_requested, requested);
+        if (requested) {
+            pgraph_wait_display(pg);
+            slot = display_ring_acquire(&pg->display_ring);
+        }
     }
     qemu_mutex_unlock(&pg->renderer_lock);
 
-    return s;
+    return slot ? slot->texture : 0;
 }
 
 void nv2a_release_framebuffer_surface(void)
@@ -376,36 +487,49 @@ void nv2a_release_framebuffer_surface(void)
     NV2AState *d = g_nv2a;
     PGRAPHState *pg = &d->pgraph;
     qemu_mutex_lock(&pg->renderer_lock);
+    display_ring_presented(&pg->display_ring,
+                           qemu_clock_get_ns(QEMU_CLOCK_REALTIME));
     pg->framebuffer_in_use = false;
     qemu_cond_broadcast(&pg->framebuffer_released);
     qemu_mutex_unlock(&pg->renderer_lock);
 }
 
+/* Callable with or without the BQL, the UI lays out without it */
 void nv2a_set_surface_scale_factor(unsigned int scale)
 {
     NV2AState *d = g_nv2a;
+    bool locked = bql_locked();
 
-    bql_unlock();
+    if (locked) {
+        bql_unlock();
+    }
     qemu_mutex_lock(&d->pgraph.renderer_lock);
     if (d->pgraph.renderer->ops.set_surface_scale_factor) {
         d->pgraph.renderer->ops.set_surface_scale_factor(d, scale);
     }
     qemu_mutex_unlock(&d->pgraph.renderer_lock);
-    bql_lock();
+    if (locked) {
+        bql_lock();
+    }
 }
 
 unsigned int nv2a_get_surface_scale_factor(void)
 {
     NV2AState *d = g_nv2a;
     int s = 1;
+    bool locked = bql_locked();
 
-    bql_unlock();
+    if (locked) {
+        bql_unlock();
+    }
     qemu_mutex_lock(&d->pgraph.renderer_lock);
     if (d->pgraph.renderer->ops.get_surface_scale_factor) {
         s = d->pgraph.renderer->ops.get_surface_scale_factor(d);
     }
     qemu_mutex_unlock(&d->pgraph.renderer_lock);
-    bql_lock();
+    if (locked) {
+        bql_lock();
+    }
 
     return s;
 }
@@ -1725,6 +1849,7 @@ DEF_METHOD_INC(NV097, SET_TEXTURE_MATRIX_ENABLE)
 {
     int slot = (method - NV097_SET_TEXTURE_MATRIX_ENABLE) / 4;
     pg->texture_matrix_enable[slot] = parameter;
+    pg->shader_state_dirty |= SHADER_STATE_VSH;
 }
 
 DEF_METHOD(NV097, SET_POINT_SIZE)
@@ -1924,6 +2049,7 @@ DEF_METHOD_INC(NV097, SET_SPECULAR_PARAMS)
     pg->specular_params[slot] = *(float *)&parameter;
     if (slot == 5) {
         pg->specular_power = reconstruct_specular_power(pg->specular_params);
+        pg->shader_state_dirty |= SHADER_STATE_VSH;
     }
 }
 
@@ -1946,6 +2072,7 @@ DEF_METHOD_INC(NV097, SET_POINT_PARAMS)
 {
     int slot = (method - NV097_SET_POINT_PARAMS) / 4;
     pg->point_params[slot] = *(float *)&parameter; /* FIXME: Where? */
+    pg->shader_state_dirty |= SHADER_STATE_VSH;
 }
 
 DEF_METHOD_INC(NV097, SET_EYE_POSITION)
@@ -2001,7 +2128,7 @@ DEF_METHOD_INC(NV097, SET_TRANSFORM_PROGRAM)
 
     assert(program_load < NV2A_MAX_TRANSFORM_PROGRAM_LENGTH);
     pg->program_data[program_load][slot%4] = parameter;
-    pg->program_data_dirty = true;
+    pg->shader_state_dirty |= SHADER_STATE_VSH;
 
     if (slot % 4 == 3) {
         PG_SET_MASK(NV_PGRAPH_CHEOPS_OFFSET,
@@ -2443,12 +2570,6 @@ DEF_METHOD_INC(NV097, SET_VERTEX_DATA_ARRAY_FORMAT)
         assert(false);
         break;
     }
-
-    if (attr->format == NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP) {
-        pg->compressed_attrs |= (1 << slot);
-    } else {
-        pg->compressed_attrs &= ~(1 << slot);
-    }
 }
 
 DEF_METHOD_INC(NV097, SET_VERTEX_DATA_ARRAY_OFFSET)
@@ -2928,6 +3049,7 @@ DEF_METHOD_INC(NV097, SET_SPECULAR_PARAMS_BACK)
     pg->specular_params_back[slot] = *(float *)&parameter;
     if (slot == 5) {
         pg->specular_power_back = reconstruct_specular_power(pg->specular_params_back);
+        pg->shader_state_dirty |= SHADER_STATE_VSH;
     }
 }
 
@@ -3209,6 +3331,7 @@ void pgraph_process_pending(NV2AState *d)
             if (pg->renderer->ops.finalize) {
                 pg->renderer->ops.finalize(d);
             }
+            display_ring_reset(&pg->display_ring);
         }
 
         init_renderer(pg);
@@ -3251,3 +3374,64 @@ void pgraph_pre_shutdown_wait(NV2AState *d)
     PGRAPHState *pg = &d->pgraph;
     pg->renderer->ops.pre_shutdown_wait(d);
 }
+
+/*
+ * Snapshot load doesn't go through the dirty log, so renderers used to throw
+ * away every cached surface, texture and vertex buffer after it. Instead, VRAM
+ * is hashed page by page before the load and compared afterwards: pages the
+ * load rewrote are marked dirty, as if the guest had written them, and only
+ * caches built from them get revalidated.
+ */
+void pgraph_pre_loadvm(NV2AState *d)
+{
+    PGRAPHState *pg = &d->pgraph;
+
+    if (!pg->loadvm.page_hashes.hashes) {
+        vram_page_hashes_init(&pg->loadvm.page_hashes,
+                              memory_region_size(d->vram), TARGET_PAGE_SIZE);
+    }
+    vram_page_hashes_update(&pg->loadvm.page_hashes, d->vram_ptr);
+    pg->loadvm.page_hashes_valid = true;
+}
+
+static void mark_loadvm_range_changed(void *opaque, size_t offset,
+                                      size_t length)
+{
+    NV2AState *d = opaque;
+
+    vram_changed_ranges_add(&d->pgraph.loadvm.changed, offset, length);
+    memory_region_set_dirty(d->vram, offset, length);
+}
+
+void pgraph_post_loadvm(NV2AState *d)
+{
+    PGRAPHState *pg = &d->pgraph;
+
+    /* Without a pre-load state, renderers fall back to a full flush */
+    pg->loadvm.pending = pg->loadvm.page_hashes_valid;
+    if (!pg->loadvm.pending) {
+        return;
+    }
+    pg->loadvm.page_hashes_valid = false;
+
+    vram_changed_ranges_clear(&pg->loadvm.changed);
+    size_t num_changed =
+        vram_page_hashes_diff(&pg->loadvm.page_hashes, d->vram_ptr,
+                              mark_loadvm_range_changed, d);
+
+    trace_nv2a_pgraph_loadvm_changed(num_changed,
+                                     pg->loadvm.page_hashes.num_pages,
+                                     pg->loadvm.changed.num);
+    nv2a_profile_add_counter(NV2A_PROF_LOADVM_PAGES_CHANGED, num_changed);
+}
+
+bool pgraph_loadvm_range_changed(PGRAPHState *pg, hwaddr addr, hwaddr size)
+{
+    return vram_changed_ranges_overlap(&pg->loadvm.changed, addr, size);
+}
+
+void pgraph_loadvm_complete(PGRAPHState *pg)
+{
+    pg->loadvm.pending = false;
+    vram_changed_ranges_clear(&pg->loadvm.changed);
+}
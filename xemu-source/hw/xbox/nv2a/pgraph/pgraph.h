@@ -25,14 +25,19 @@
 #include "xemu-config.h"
 #include "qemu/osdep.h"
 #include "qemu/bitmap.h"
+#include "qemu/interval-tree.h"
+#include "qemu/lru.h"
 #include "qemu/units.h"
 #include "qemu/thread.h"
 #include "cpu.h"
 
+#include "display_ring.h"
 #include "surface.h"
 #include "texture.h"
 #include "util.h"
+#include "vram_hash.h"
 #include "vsh_regs.h"
+#include "glsl/shaders.h"
 
 typedef struct NV2AState NV2AState;
 typedef struct PGRAPHNullState PGRAPHNullState;
@@ -60,6 +65,26 @@ typedef struct VertexAttribute {
     bool inline_buffer_populated;
 } VertexAttribute;
 
+typedef struct VertexConvertKey {
+    hwaddr addr;
+    uint32_t stride;
+    uint32_t count;
+    uint32_t format;
+} VertexConvertKey;
+
+typedef struct VertexConvertLruNode {
+    LruNode node;
+    VertexConvertKey key;
+    IntervalTreeNode range; /* VRAM the entry is converted from */
+    bool initialized;
+    bool possibly_dirty;
+    uint64_t content_hash;
+    /* Unique id of the converted data, bumped on every (re)conversion */
+    uint64_t generation;
+    uint8_t *data;
+    size_t size;
+} VertexConvertLruNode;
+
 typedef struct Surface {
     bool draw_dirty;
     bool buffer_dirty;
@@ -130,7 +155,12 @@ typedef struct PGRAPHRenderer {
         void (*surface_update)(NV2AState *d, bool upload, bool color_write, bool zeta_write);
         void (*set_surface_scale_factor)(NV2AState *d, unsigned int scale);
         unsigned int (*get_surface_scale_factor)(NV2AState *d);
-        int (*get_framebuffer_surface)(NV2AState *d);
+        /*
+         * Have the display surface drawn into the display ring's back slot
+         * and published, then pgraph_sync_complete() called, without
+         * waiting. False if the display is not backed by a surface.
+         */
+        bool (*request_display)(NV2AState *d);
         GPUProperties *(*get_gpu_properties)(void);
     } ops;
 } PGRAPHRenderer;
@@ -187,7 +217,12 @@ typedef struct PGRAPHState {
 
     uint32_t vertex_state_shader_v0[4];
     uint32_t program_data[NV2A_MAX_TRANSFORM_PROGRAM_LENGTH][VSH_TOKEN_SIZE];
-    bool program_data_dirty;
+
+    /* Shader state, rebuilt per part when marked in shader_state_dirty */
+    ShaderState shader_state;
+    uint64_t shader_state_part_hashes[SHADER_STATE_PART__COUNT];
+    uint64_t shader_state_hash;
+    unsigned int shader_state_dirty;
 
     uint32_t vsh_constants[NV2A_VERTEXSHADER_CONSTANTS][4];
     bool vsh_constants_dirty[NV2A_VERTEXSHADER_CONSTANTS];
@@ -216,9 +251,13 @@ typedef struct PGRAPHState {
     float point_params[8];
 
     VertexAttribute vertex_attributes[NV2A_VERTEXSHADER_ATTRIBUTES];
-    uint16_t compressed_attrs;
     uint16_t uniform_attrs;
-    uint16_t swizzle_attrs;
+
+    /* Host-side expansion of attribute formats shaders cannot consume */
+    Lru vertex_convert_cache;
+    VertexConvertLruNode *vertex_convert_cache_entries;
+    IntervalTreeRoot vertex_convert_ranges; /* Entries in use, by VRAM range */
+    uint64_t vertex_convert_generation;
 
     unsigned int inline_array_length;
     uint32_t inline_array[NV2A_MAX_BATCH_LENGTH];
@@ -248,8 +287,27 @@ typedef struct PGRAPHState {
     bool flush_pending;
     QemuEvent flush_complete;
 
+    /* Revalidation of renderer caches across snapshot load */
+    struct {
+        VramPageHashes page_hashes;
+        bool page_hashes_valid;
+        bool pending;
+        VramChangedRanges changed; /* VRAM the load rewrote */
+    } loadvm;
+
     bool sync_pending;
-    QemuEvent sync_complete;
+    QemuMutex sync_lock;
+    QemuCond sync_complete;
+
+    /* Scanout flips, and the last one drawn into the display ring */
+    uint32_t display_flips;
+    uint32_t display_flips_drawn;
+    uint32_t display_flips_drawing; /* Renderer only */
+    bool display_requested; /* The UI takes its images from the ring */
+
+    /* Images presented to the UI, drawn on sync */
+    DisplayRing display_ring;
+    DisplayRingStats display_ring_reported;
 
     bool framebuffer_in_use;
     QemuCond framebuffer_released;
@@ -282,6 +340,22 @@ void pgraph_pre_savevm_trigger(NV2AState *d);
 void pgraph_pre_savevm_wait(NV2AState *d);
 void pgraph_pre_shutdown_trigger(NV2AState *d);
 void pgraph_pre_shutdown_wait(NV2AState *d);
+void pgraph_pre_loadvm(NV2AState *d);
+void pgraph_post_loadvm(NV2AState *d);
+bool pgraph_loadvm_range_changed(PGRAPHState *pg, hwaddr addr, hwaddr size);
+void pgraph_loadvm_complete(PGRAPHState *pg);
+
+/* PCRTC: the guest pointed the scanout at a new frame */
+void pgraph_display_flipped(NV2AState *d);
+
+/* Renderer: the display was asked for, or the guest flipped to a new frame */
+bool pgraph_display_pending(PGRAPHState *pg);
+
+/* Renderer: about to draw the display */
+void pgraph_sync_begin(PGRAPHState *pg);
+
+/* Renderer: the display has been published, or there is none */
+void pgraph_sync_complete(PGRAPHState *pg);
 
 int pgraph_method(NV2AState *d, unsigned int subchannel, unsigned int method,
                   uint32_t parameter, uint32_t *parameters,
@@ -311,6 +385,8 @@ static inline void pgraph_reg_w(PGRAPHState *pg, unsigned int r, uint32_t v)
     assert(r % 4 == 0);
     if (pg->regs_[r] != v) {
         bitmap_set(pg->regs_dirty, r / sizeof(uint32_t), 1);
+        pg->shader_state_dirty |=
+            pgraph_glsl_shader_state_reg_deps[r / sizeof(uint32_t)];
     }
     pg->regs_[r] = v;
 }
@@ -399,6 +475,19 @@ void pgraph_update_inline_value(VertexAttribute *attr, const uint8_t *data);
 void pgraph_get_inline_values(PGRAPHState *pg, uint16_t attrs,
                                float values[NV2A_VERTEXSHADER_ATTRIBUTES][4],
                                int *count);
+void pgraph_init_vertex_convert_cache(PGRAPHState *pg);
+void pgraph_finalize_vertex_convert_cache(PGRAPHState *pg);
+void pgraph_flush_vertex_convert_cache(PGRAPHState *pg);
+size_t pgraph_get_converted_vertex_element_size(unsigned int format);
+void pgraph_convert_vertex_attribute(unsigned int format, const uint8_t *src,
+                                     size_t stride, uint8_t *dst,
+                                     unsigned int count);
+VertexConvertLruNode *pgraph_get_converted_vertex_attribute(
+    NV2AState *d, unsigned int format, hwaddr addr, size_t stride,
+    unsigned int count);
+void pgraph_mark_converted_vertex_attributes_possibly_dirty(PGRAPHState *pg,
+                                                            hwaddr addr,
+                                                            hwaddr size);
 
 /* RDI */
 uint32_t pgraph_rdi_read(PGRAPHState *pg, unsigned int select,
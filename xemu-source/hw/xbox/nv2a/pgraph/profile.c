@@ -21,6 +21,9 @@
 
 NV2AStats g_nv2a_stats;
 
+/* Main loop BQL hold reported at the last flip */
+static uint64_t reported_main_loop_bql_hold_ns;
+
 void nv2a_profile_increment(void)
 {
     int64_t now = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
@@ -45,6 +48,35 @@ void nv2a_profile_flip_stall(void)
     int64_t render_time = (now-g_nv2a_stats.last_flip_time)/1000;
 
     g_nv2a_stats.frame_working.mspf = render_time;
+
+    int *counters = g_nv2a_stats.frame_working.counters;
+    counters[NV2A_PROF_SHADER_UBO_BYTES_PER_DRAW] =
+        counters[NV2A_PROF_SHADER_UBO_BYTES] /
+        MAX(1, counters[NV2A_PROF_BEGIN_ENDS]);
+    counters[NV2A_PROF_DESC_SET_HIT_RATE] =
+        counters[NV2A_PROF_DESC_SET_HIT] * 100 /
+        MAX(1, counters[NV2A_PROF_DESC_SET_HIT] +
+                   counters[NV2A_PROF_DESC_SET_WRITE]);
+
+    /* Hand-off of display images to the UI since the last flip */
+    PGRAPHState *pg = &g_nv2a->pgraph;
+    DisplayRingStats cur, *prev = &pg->display_ring_reported;
+    display_ring_get_stats(&pg->display_ring, &cur);
+    counters[NV2A_PROF_DISPLAY_PUBLISH] = cur.published - prev->published;
+    counters[NV2A_PROF_DISPLAY_DROPPED] = cur.dropped - prev->dropped;
+    counters[NV2A_PROF_DISPLAY_REPEATED] = cur.repeated - prev->repeated;
+    counters[NV2A_PROF_DISPLAY_LATENCY_US] =
+        (cur.latency_ns - prev->latency_ns) / 1000 /
+        MAX(1, cur.presented - prev->presented);
+    *prev = cur;
+
+    /* BQL hold since the last flip, compare against the mspf above */
+    MainLoopStats main_loop;
+    qemu_main_loop_get_stats(&main_loop);
+    counters[NV2A_PROF_BQL_MAIN_LOOP_US] =
+        (main_loop.bql_hold_ns - reported_main_loop_bql_hold_ns) / 1000;
+    reported_main_loop_bql_hold_ns = main_loop.bql_hold_ns;
+
     g_nv2a_stats.frame_history[g_nv2a_stats.frame_ptr] =
         g_nv2a_stats.frame_working;
     g_nv2a_stats.frame_ptr =
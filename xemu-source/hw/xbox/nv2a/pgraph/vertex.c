@@ -20,6 +20,8 @@
  */
 
 #include "hw/xbox/nv2a/nv2a_int.h"
+#include "qemu/fast-hash.h"
+#include "vertex_convert.h"
 
 void pgraph_update_inline_value(VertexAttribute *attr, const uint8_t *data)
 {
@@ -149,3 +151,190 @@ void pgraph_reset_draw_arrays(PGRAPHState *pg)
     pg->draw_arrays_max_count = 0;
     pg->draw_arrays_prevent_connect = false;
 }
+
+static const size_t vertex_convert_cache_size = 1024;
+
+static hwaddr get_vertex_convert_source_length(const VertexConvertKey *key)
+{
+    /* Both convertible formats are 4 bytes per element */
+    return (hwaddr)(key->count - 1) * key->stride + 4;
+}
+
+static void vertex_convert_cache_entry_init(Lru *lru, LruNode *node,
+                                            const void *key)
+{
+    PGRAPHState *pg = container_of(lru, PGRAPHState, vertex_convert_cache);
+    VertexConvertLruNode *cnode =
+        container_of(node, VertexConvertLruNode, node);
+    memcpy(&cnode->key, key, sizeof(cnode->key));
+    cnode->initialized = false;
+    cnode->possibly_dirty = false;
+
+    cnode->range.start = cnode->key.addr;
+    cnode->range.last =
+        cnode->key.addr + get_vertex_convert_source_length(&cnode->key) - 1;
+    interval_tree_insert(&cnode->range, &pg->vertex_convert_ranges);
+}
+
+static void vertex_convert_cache_entry_post_evict(Lru *lru, LruNode *node)
+{
+    PGRAPHState *pg = container_of(lru, PGRAPHState, vertex_convert_cache);
+    VertexConvertLruNode *cnode =
+        container_of(node, VertexConvertLruNode, node);
+    interval_tree_remove(&cnode->range, &pg->vertex_convert_ranges);
+    g_free(cnode->data);
+    cnode->data = NULL;
+    cnode->size = 0;
+    cnode->initialized = false;
+}
+
+static bool vertex_convert_cache_entry_compare(Lru *lru, LruNode *node,
+                                               const void *key)
+{
+    VertexConvertLruNode *cnode =
+        container_of(node, VertexConvertLruNode, node);
+    return memcmp(&cnode->key, key, sizeof(VertexConvertKey));
+}
+
+void pgraph_init_vertex_convert_cache(PGRAPHState *pg)
+{
+    lru_init(&pg->vertex_convert_cache);
+    pg->vertex_convert_cache_entries =
+        g_malloc0_n(vertex_convert_cache_size, sizeof(VertexConvertLruNode));
+    for (int i = 0; i < vertex_convert_cache_size; i++) {
+        lru_add_free(&pg->vertex_convert_cache,
+                     &pg->vertex_convert_cache_entries[i].node);
+    }
+    pg->vertex_convert_cache.init_node = vertex_convert_cache_entry_init;
+    pg->vertex_convert_cache.compare_nodes = vertex_convert_cache_entry_compare;
+    pg->vertex_convert_cache.post_node_evict =
+        vertex_convert_cache_entry_post_evict;
+    pg->vertex_convert_ranges = (IntervalTreeRoot){ };
+    pg->vertex_convert_generation = 0;
+}
+
+void pgraph_finalize_vertex_convert_cache(PGRAPHState *pg)
+{
+    lru_flush(&pg->vertex_convert_cache);
+    g_free(pg->vertex_convert_cache_entries);
+    pg->vertex_convert_cache_entries = NULL;
+}
+
+void pgraph_flush_vertex_convert_cache(PGRAPHState *pg)
+{
+    lru_flush(&pg->vertex_convert_cache);
+}
+
+/*
+ * Returns the size of one element of the host format an attribute of the given
+ * NV2A format is expanded to, or 0 if the format can be consumed as is.
+ */
+size_t pgraph_get_converted_vertex_element_size(unsigned int format)
+{
+    switch (format) {
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D:
+        return VERTEX_CONVERT_D3D_ELEMENT_SIZE;
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP:
+        return VERTEX_CONVERT_CMP_ELEMENT_SIZE;
+    default:
+        return 0;
+    }
+}
+
+void pgraph_convert_vertex_attribute(unsigned int format, const uint8_t *src,
+                                     size_t stride, uint8_t *dst,
+                                     unsigned int count)
+{
+    switch (format) {
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D:
+        vertex_convert_d3d(src, stride, dst, count);
+        break;
+    case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP:
+        vertex_convert_cmp(src, stride, (float *)dst, count);
+        break;
+    default:
+        assert(!"Attribute format does not need conversion");
+        break;
+    }
+}
+
+/*
+ * Look up the host format expansion of `count` elements starting at VRAM
+ * offset `addr`. Entries are only re-validated against their content hash
+ * once the VRAM range backing them has been reported dirty.
+ */
+VertexConvertLruNode *pgraph_get_converted_vertex_attribute(
+    NV2AState *d, unsigned int format, hwaddr addr, size_t stride,
+    unsigned int count)
+{
+    PGRAPHState *pg = &d->pgraph;
+
+    assert(count > 0);
+
+    VertexConvertKey key;
+    memset(&key, 0, sizeof(key));
+    key.addr = addr;
+    key.stride = stride;
+    key.count = count;
+    key.format = format;
+
+    hwaddr length = get_vertex_convert_source_length(&key);
+    assert(addr + length <= memory_region_size(d->vram));
+    const uint8_t *src = d->vram_ptr + addr;
+
+    uint64_t key_hash = fast_hash((const uint8_t *)&key, sizeof(key));
+    LruNode *node = lru_lookup(&pg->vertex_convert_cache, key_hash, &key);
+    VertexConvertLruNode *entry =
+        container_of(node, VertexConvertLruNode, node);
+
+    if (entry->initialized && !entry->possibly_dirty) {
+        nv2a_profile_inc_counter(NV2A_PROF_ATTR_CONVERT_NOTDIRTY);
+        return entry;
+    }
+
+    uint64_t content_hash = fast_hash(src, length);
+
+    if (entry->initialized) {
+        entry->possibly_dirty = false;
+        if (entry->content_hash == content_hash) {
+            nv2a_profile_inc_counter(NV2A_PROF_ATTR_CONVERT_NOTDIRTY);
+            return entry;
+        }
+    }
+
+    size_t size = pgraph_get_converted_vertex_element_size(format) * count;
+    if (entry->size != size) {
+        g_free(entry->data);
+        entry->data = g_malloc(size);
+        entry->size = size;
+    }
+
+    nv2a_profile_inc_counter(NV2A_PROF_ATTR_CONVERT);
+    pgraph_convert_vertex_attribute(format, src, stride, entry->data, count);
+
+    entry->content_hash = content_hash;
+    entry->generation = ++pg->vertex_convert_generation;
+    entry->initialized = true;
+    entry->possibly_dirty = false;
+
+    return entry;
+}
+
+void pgraph_mark_converted_vertex_attributes_possibly_dirty(PGRAPHState *pg,
+                                                            hwaddr addr,
+                                                            hwaddr size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    hwaddr last = addr + size - 1;
+    IntervalTreeNode *range =
+        interval_tree_iter_first(&pg->vertex_convert_ranges, addr, last);
+
+    for (; range; range = interval_tree_iter_next(range, addr, last)) {
+        VertexConvertLruNode *cnode =
+            container_of(range, VertexConvertLruNode, range);
+        cnode->possibly_dirty = cnode->initialized;
+    }
+}
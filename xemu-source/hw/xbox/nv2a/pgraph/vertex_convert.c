@@ -0,0 +1,146 @@
+/*
+ * QEMU Geforce NV2A vertex attribute format conversion
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "vertex_convert.h"
+
+/*
+ * Helpers for expanding vertex attribute formats that have no native host
+ * equivalent into formats that can be consumed directly by the vertex input
+ * stage, so that generated shaders do not need to decode them.
+ *
+ * Results must match what the vertex shaders previously computed on the GPU:
+ * CMP components are sign-extended and divided (not multiplied by a
+ * reciprocal) by 1023 or 511, without clamping.
+ */
+
+static inline uint32_t load_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void cmp_decode(uint32_t v, float *dst)
+{
+    int32_t x = (int32_t)(v << 21) >> 21;
+    int32_t y = (int32_t)(v << 10) >> 21;
+    int32_t z = (int32_t)v >> 22;
+
+    dst[0] = (float)x / 1023.0f;
+    dst[1] = (float)y / 1023.0f;
+    dst[2] = (float)z / 511.0f;
+}
+
+void vertex_convert_cmp(const uint8_t *src, size_t src_stride, float *dst,
+                        unsigned int count)
+{
+    unsigned int i = 0;
+
+#ifdef __SSE2__
+    const __m128 scale_xy = _mm_set1_ps(1023.0f);
+    const __m128 scale_z = _mm_set1_ps(511.0f);
+
+    /*
+     * Each group of four elements is transposed to xyz0 rows and stored with
+     * overlapping 16-byte writes, the last of which spills one float into the
+     * following element. Stop early enough that the spill is always
+     * overwritten.
+     */
+    for (; i + 4 < count; i += 4) {
+        __m128i v = _mm_set_epi32(load_u32(src + 3 * src_stride),
+                                  load_u32(src + 2 * src_stride),
+                                  load_u32(src + 1 * src_stride),
+                                  load_u32(src));
+        __m128 x = _mm_div_ps(
+            _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 21), 21)),
+            scale_xy);
+        __m128 y = _mm_div_ps(
+            _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 10), 21)),
+            scale_xy);
+        __m128 z = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(v, 22)), scale_z);
+        __m128 w = _mm_setzero_ps();
+
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        _mm_storeu_ps(dst + 0, x);
+        _mm_storeu_ps(dst + 3, y);
+        _mm_storeu_ps(dst + 6, z);
+        _mm_storeu_ps(dst + 9, w);
+
+        src += 4 * src_stride;
+        dst += 12;
+    }
+#endif
+
+    for (; i < count; i++) {
+        cmp_decode(load_u32(src), dst);
+        src += src_stride;
+        dst += 3;
+    }
+}
+
+static inline uint32_t bgra_to_rgba(uint32_t v)
+{
+    return (v & 0xff00ff00) | ((v >> 16) & 0xff) | ((v & 0xff) << 16);
+}
+
+void vertex_convert_d3d(const uint8_t *src, size_t src_stride, uint8_t *dst,
+                        unsigned int count)
+{
+    unsigned int i = 0;
+
+#ifdef __SSE2__
+    const __m128i mask_ga = _mm_set1_epi32(0xff00ff00);
+    const __m128i mask_b = _mm_set1_epi32(0xff);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v;
+        if (src_stride == 4) {
+            v = _mm_loadu_si128((const __m128i *)src);
+        } else {
+            v = _mm_set_epi32(load_u32(src + 3 * src_stride),
+                              load_u32(src + 2 * src_stride),
+                              load_u32(src + 1 * src_stride),
+                              load_u32(src));
+        }
+        __m128i r = _mm_or_si128(
+            _mm_and_si128(v, mask_ga),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), mask_b),
+                         _mm_slli_epi32(_mm_and_si128(v, mask_b), 16)));
+        _mm_storeu_si128((__m128i *)dst, r);
+
+        src += 4 * src_stride;
+        dst += 16;
+    }
+#endif
+
+    for (; i < count; i++) {
+        uint32_t v = bgra_to_rgba(load_u32(src));
+        memcpy(dst, &v, sizeof(v));
+        src += src_stride;
+        dst += 4;
+    }
+}
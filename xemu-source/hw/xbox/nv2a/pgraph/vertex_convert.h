@@ -0,0 +1,46 @@
+/*
+ * QEMU Geforce NV2A vertex attribute format conversion
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_NV2A_PGRAPH_VERTEX_CONVERT_H
+#define HW_XBOX_NV2A_PGRAPH_VERTEX_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size in bytes of one converted CMP element (3 x float) */
+#define VERTEX_CONVERT_CMP_ELEMENT_SIZE (3 * sizeof(float))
+
+/* Size in bytes of one converted UB_D3D element (4 x unorm8, RGBA order) */
+#define VERTEX_CONVERT_D3D_ELEMENT_SIZE 4
+
+/*
+ * Expand `count` packed (11,11,10) signed normalized elements, located
+ * `src_stride` bytes apart, into tightly packed xyz float triples.
+ */
+void vertex_convert_cmp(const uint8_t *src, size_t src_stride, float *dst,
+                        unsigned int count);
+
+/*
+ * Reorder `count` D3D (BGRA) unsigned byte elements, located `src_stride`
+ * bytes apart, into tightly packed RGBA.
+ */
+void vertex_convert_d3d(const uint8_t *src, size_t src_stride, uint8_t *dst,
+                        unsigned int count);
+
+#endif
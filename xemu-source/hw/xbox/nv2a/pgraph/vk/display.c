@@ -506,7 +506,7 @@ static void destroy_display_pipeline(PGRAPHState *pg)
     r->display.display_frag = NULL;
 }
 
-static void create_frame_buffer(PGRAPHState *pg)
+static void create_frame_buffer(PGRAPHState *pg, PGRAPHVkDisplayImage *img)
 {
     PGRAPHVkState *r = pg->vk_renderer_state;
 
@@ -514,32 +514,31 @@ static void create_frame_buffer(PGRAPHState *pg)
         .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
         .renderPass = r->display.render_pass,
         .attachmentCount = 1,
-        .pAttachments = &r->display.image_view,
-        .width = r->display.width,
-        .height = r->display.height,
+        .pAttachments = &img->image_view,
+        .width = img->width,
+        .height = img->height,
         .layers = 1,
     };
     VK_CHECK(vkCreateFramebuffer(r->device, &create_info, NULL,
-                                 &r->display.framebuffer));
+                                 &img->framebuffer));
 }
 
-static void destroy_frame_buffer(PGRAPHState *pg)
+static void destroy_frame_buffer(PGRAPHState *pg, PGRAPHVkDisplayImage *img)
 {
     PGRAPHVkState *r = pg->vk_renderer_state;
-    vkDestroyFramebuffer(r->device, r->display.framebuffer, NULL);
-    r->display.framebuffer = NULL;
+    vkDestroyFramebuffer(r->device, img->framebuffer, NULL);
+    img->framebuffer = NULL;
 }
 
-static void destroy_current_display_image(PGRAPHState *pg)
+static void destroy_display_image(PGRAPHState *pg, PGRAPHVkDisplayImage *d)
 {
     PGRAPHVkState *r = pg->vk_renderer_state;
-    PGRAPHVkDisplayState *d = &r->display;
 
     if (d->image == VK_NULL_HANDLE) {
         return;
     }
 
-    destroy_frame_buffer(pg);
+    destroy_frame_buffer(pg, d);
 
 #if HAVE_EXTERNAL_MEMORY
     glDeleteTextures(1, &d->gl_texture_id);
@@ -569,13 +568,13 @@ static void destroy_current_display_image(PGRAPHState *pg)
 // FIXME: We may need to use two images. One for actually rendering display,
 // and another for GL in the correct tiling mode
 
-static void create_display_image(PGRAPHState *pg, int width, int height)
+static void create_display_image(PGRAPHState *pg, PGRAPHVkDisplayImage *d,
+                                 int width, int height)
 {
     PGRAPHVkState *r = pg->vk_renderer_state;
-    PGRAPHVkDisplayState *d = &r->display;
 
-    if (r->display.image != VK_NULL_HANDLE) {
-        destroy_current_display_image(pg);
+    if (d->image != VK_NULL_HANDLE) {
+        destroy_display_image(pg, d);
     }
 
     const GLint gl_internal_format = GL_RGBA8;
@@ -718,7 +717,7 @@ static void create_display_image(PGRAPHState *pg, int width, int height)
     d->width = image_create_info.extent.width;
     d->height = image_create_info.extent.height;
 
-    create_frame_buffer(pg);
+    create_frame_buffer(pg, d);
 }
 
 static void update_descriptor_set(PGRAPHState *pg, SurfaceBinding *surface)
@@ -859,14 +858,15 @@ static PvideoState get_pvideo_state(PGRAPHState *pg)
     return state;
 }
 
-static void update_uniforms(PGRAPHState *pg, SurfaceBinding *surface)
+static void update_uniforms(PGRAPHState *pg, SurfaceBinding *surface,
+                            PGRAPHVkDisplayImage *img)
 {
     NV2AState *d = container_of(pg, NV2AState, pgraph);
     PGRAPHVkState *r = pg->vk_renderer_state;
     ShaderUniformLayout *l = &r->display.display_frag->push_constants;
 
     int display_size_loc = uniform_index(l, "display_size");  // FIXME: Cache
-    uniform2f(l, display_size_loc, r->display.width, r->display.height);
+    uniform2f(l, display_size_loc, img->width, img->height);
 
     VGADisplayParams vga_display_params;
     d->vga.get_params(&d->vga, &vga_display_params);
@@ -895,7 +895,8 @@ static void update_uniforms(PGRAPHState *pg, SurfaceBinding *surface)
     }
 }
 
-static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
+static void render_display(PGRAPHState *pg, SurfaceBinding *surface,
+                           PGRAPHVkDisplayImage *img)
 {
     NV2AState *d = container_of(pg, NV2AState, pgraph);
     PGRAPHVkState *r = pg->vk_renderer_state;
@@ -913,7 +914,7 @@ static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
         upload_pvideo_image(pg, disp->pvideo.state);
     }
 
-    update_uniforms(pg, surface);
+    update_uniforms(pg, surface, img);
     update_descriptor_set(pg, surface);
 
     VkCommandBuffer cmd = pgraph_vk_begin_single_time_commands(pg);
@@ -925,15 +926,15 @@ static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
                                       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     pgraph_vk_transition_image_layout(
-        pg, cmd, disp->image, VK_FORMAT_R8G8B8A8_UNORM,
+        pg, cmd, img->image, VK_FORMAT_R8G8B8A8_UNORM,
         VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
     VkRenderPassBeginInfo render_pass_begin_info = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
         .renderPass = disp->render_pass,
-        .framebuffer = disp->framebuffer,
-        .renderArea.extent.width = disp->width,
-        .renderArea.extent.height = disp->height,
+        .framebuffer = img->framebuffer,
+        .renderArea.extent.width = img->width,
+        .renderArea.extent.height = img->height,
     };
     vkCmdBeginRenderPass(cmd, &render_pass_begin_info,
                          VK_SUBPASS_CONTENTS_INLINE);
@@ -945,16 +946,16 @@ static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
                             0, NULL);
 
     VkViewport viewport = {
-        .width = disp->width,
-        .height = disp->height,
+        .width = img->width,
+        .height = img->height,
         .minDepth = 0.0,
         .maxDepth = 1.0,
     };
     vkCmdSetViewport(cmd, 0, 1, &viewport);
 
     VkRect2D scissor = {
-        .extent.width = disp->width,
-        .extent.height = disp->height,
+        .extent.width = img->width,
+        .extent.height = img->height,
     };
     vkCmdSetScissor(cmd, 0, 1, &scissor);
 
@@ -980,7 +981,7 @@ static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
                                 &region.extent.height);
 
     vkCmdCopyImage(cmd, surface->image,
-                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, disp->image,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, img->image,
                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 #endif
 
@@ -989,7 +990,7 @@ static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                                       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
-    pgraph_vk_transition_image_layout(pg, cmd, disp->image,
+    pgraph_vk_transition_image_layout(pg, cmd, img->image,
                                       VK_FORMAT_R8G8B8_UNORM,
                                       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -998,7 +999,7 @@ static void render_display(PGRAPHState *pg, SurfaceBinding *surface)
     pgraph_vk_end_single_time_commands(pg, cmd);
     nv2a_profile_inc_counter(NV2A_PROF_QUEUE_SUBMIT_5);
 
-    disp->draw_time = surface->draw_time;
+    img->draw_time = surface->draw_time;
 }
 
 static void create_surface_sampler(PGRAPHState *pg)
@@ -1048,8 +1049,8 @@ void pgraph_vk_finalize_display(PGRAPHState *pg)
 
     destroy_pvideo_image(pg);
 
-    if (r->display.image != VK_NULL_HANDLE) {
-        destroy_current_display_image(pg);
+    for (int i = 0; i < DISPLAY_RING_SIZE; i++) {
+        destroy_display_image(pg, &r->display.images[i]);
     }
 
     destroy_surface_sampler(pg);
@@ -1083,10 +1084,21 @@ void pgraph_vk_render_display(PGRAPHState *pg)
 
     pgraph_apply_scaling_factor(pg, &width, &height);
 
-    PGRAPHVkDisplayState *disp = &r->display;
-    if (!disp->image || disp->width != width || disp->height != height) {
-        create_display_image(pg, width, height);
+    /* Draw into an image the UI is not sampling, complete on return */
+    DisplayRing *ring = &pg->display_ring;
+    int back = display_ring_back(ring);
+    PGRAPHVkDisplayImage *img = &r->display.images[back];
+    if (!img->image || img->width != width || img->height != height) {
+        create_display_image(pg, img, width, height);
     }
 
-    render_display(pg, surface);
+    render_display(pg, surface, img);
+
+    DisplayRingSlot *slot = &ring->slots[back];
+#if HAVE_EXTERNAL_MEMORY
+    slot->texture = img->gl_texture_id;
+#endif
+    slot->width = img->width;
+    slot->height = img->height;
+    display_ring_publish(ring, qemu_clock_get_ns(QEMU_CLOCK_REALTIME));
 }
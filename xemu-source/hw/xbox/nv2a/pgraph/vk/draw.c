@@ -1046,12 +1046,19 @@ static void push_vertex_attr_values(PGRAPHState *pg)
 static void bind_descriptor_sets(PGRAPHState *pg)
 {
     PGRAPHVkState *r = pg->vk_renderer_state;
-    assert(r->descriptor_set_index >= 1);
+
+    if (r->use_push_descriptors) {
+        pgraph_vk_push_descriptor_set(pg);
+        return;
+    }
+
+    assert(r->descriptor_set_binding);
 
     vkCmdBindDescriptorSets(r->command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                             r->pipeline_binding->layout, 0, 1,
-                            &r->descriptor_sets[r->descriptor_set_index - 1], 0,
-                            NULL);
+                            &r->descriptor_set_binding->descriptor_set,
+                            ARRAY_SIZE(r->uniform_buffer_offsets),
+                            r->uniform_buffer_offsets);
 }
 
 static void begin_query(PGRAPHVkState *r)
@@ -1280,7 +1287,7 @@ void pgraph_vk_finish(PGRAPHState *pg, FinishReason finish_reason)
         VK_CHECK(vkWaitForFences(r->device, 1, &r->command_buffer_fence,
                                  VK_TRUE, UINT64_MAX));
 
-        r->descriptor_set_index = 0;
+        r->push_descriptors_dirty = true;
         r->in_command_buffer = false;
         destroy_framebuffers(pg);
 
@@ -1898,6 +1905,7 @@ static void get_size_and_count_for_format(VkFormat fmt, size_t *size, size_t *co
 
 typedef struct VertexBufferRemap {
     uint16_t attributes;
+    uint16_t conversions;
     size_t buffer_space_required;
     struct {
         VkDeviceAddress offset;
@@ -1929,18 +1937,26 @@ static VertexBufferRemap remap_unaligned_attributes(PGRAPHState *pg,
         size_t element_size, element_count;
         get_size_and_count_for_format(attr->format, &element_size, &element_count);
 
+        bool needs_conversion =
+            r->vertex_attribute_conversions & (1 << attr_id);
         bool offset_valid =
             (r->vertex_attribute_offsets[attr_id] % element_size == 0);
         bool stride_valid = (desc->stride % element_size == 0);
 
-        if (offset_valid && stride_valid) {
+        if (offset_valid && stride_valid && !needs_conversion) {
             continue;
         }
 
         remap.attributes |= 1 << attr_id;
         remap.map[attr_id].offset = ROUND_UP(output_offset, element_size);
-        remap.map[attr_id].old_stride = desc->stride;
         remap.map[attr_id].new_stride = element_size * element_count;
+        if (needs_conversion) {
+            remap.conversions |= 1 << attr_id;
+            remap.map[attr_id].old_stride =
+                pg->vertex_attributes[attr_id].stride;
+        } else {
+            remap.map[attr_id].old_stride = desc->stride;
+        }
 
         // fprintf(stderr,
         //         "attr %02d remapped: "
@@ -1988,7 +2004,6 @@ static void copy_remapped_attributes_to_inline_buffer(PGRAPHState *pg,
                                           remap.buffer_space_required, 256));
 
     // FIXME: SIMD memcpy
-    // FIXME: Caching
     // FIXME: Account for only what is drawn
     assert(start_vertex == 0);
     assert(buffer->mapped);
@@ -2002,6 +2017,33 @@ static void copy_remapped_attributes_to_inline_buffer(PGRAPHState *pg,
         VkDeviceSize attr_buffer_offset =
             buffer->buffer_offset + remap.map[attr_id].offset;
 
+        if (remap.conversions & (1 << attr_id)) {
+            VertexConvertLruNode *entry = pgraph_get_converted_vertex_attribute(
+                d, pg->vertex_attributes[attr_id].format,
+                r->vertex_attribute_offsets[attr_id],
+                remap.map[attr_id].old_stride, num_vertices);
+            assert(entry->size ==
+                   remap.map[attr_id].new_stride * num_vertices);
+
+            // Converted data already staged in this command buffer can be
+            // shared with subsequent draws
+            ConvertedAttributeUpload *upload =
+                &r->converted_attribute_uploads[attr_id];
+            if (upload->generation == entry->generation &&
+                upload->submit_count == r->submit_count) {
+                r->vertex_attribute_offsets[attr_id] = upload->offset;
+                continue;
+            }
+
+            memcpy(buffer->mapped + attr_buffer_offset, entry->data,
+                   entry->size);
+            upload->generation = entry->generation;
+            upload->submit_count = r->submit_count;
+            upload->offset = attr_buffer_offset;
+            r->vertex_attribute_offsets[attr_id] = attr_buffer_offset;
+            continue;
+        }
+
         uint8_t *out_ptr = buffer->mapped + attr_buffer_offset;
         uint8_t *in_ptr = d->vram_ptr + r->vertex_attribute_offsets[attr_id];
 
@@ -2149,8 +2191,6 @@ void pgraph_vk_flush_draw(NV2AState *d)
         nv2a_profile_inc_counter(NV2A_PROF_INLINE_ARRAYS);
 
         VkDeviceSize inline_array_data_size = pg->inline_array_length * 4;
-        ensure_buffer_space(pg, BUFFER_VERTEX_INLINE_STAGING,
-                               inline_array_data_size);
 
         unsigned int offset = 0;
         for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
@@ -2175,10 +2215,42 @@ void pgraph_vk_flush_draw(NV2AState *d)
         pgraph_vk_bind_vertex_attributes(d, 0, index_count - 1, true,
                                          vertex_size, index_count - 1);
 
+        // Converted attributes follow the inline array data
+        void *data[1 + NV2A_VERTEXSHADER_ATTRIBUTES];
+        VkDeviceSize sizes[1 + NV2A_VERTEXSHADER_ATTRIBUTES];
+        size_t num_data = 0;
+
+        data[num_data] = pg->inline_array;
+        sizes[num_data++] = inline_array_data_size;
+        VkDeviceSize data_size = inline_array_data_size;
+
+        for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
+            if (!(r->vertex_attribute_conversions & (1 << i))) {
+                continue;
+            }
+            VertexAttribute *attr = &pg->vertex_attributes[i];
+            size_t size =
+                pgraph_get_converted_vertex_element_size(attr->format) *
+                index_count;
+            uint8_t *converted = g_malloc(size);
+            pgraph_convert_vertex_attribute(
+                attr->format,
+                (uint8_t *)pg->inline_array + attr->inline_array_offset,
+                vertex_size, converted, index_count);
+            r->vertex_attribute_offsets[i] = data_size;
+            data[num_data] = converted;
+            sizes[num_data++] = size;
+            data_size += size;
+        }
+
+        ensure_buffer_space(pg, BUFFER_VERTEX_INLINE_STAGING, data_size);
+
         begin_pre_draw(pg);
-        void *inline_array_data = pg->inline_array;
         VkDeviceSize buffer_offset = pgraph_vk_update_vertex_inline_buffer(
-            pg, &inline_array_data, &inline_array_data_size, 1);
+            pg, data, sizes, num_data);
+        for (int i = 1; i < num_data; i++) {
+            g_free(data[i]);
+        }
         pgraph_vk_begin_debug_marker(r, r->command_buffer, RGBA_BLUE,
                                      "Inline Array");
         begin_draw(pg);
@@ -90,13 +90,24 @@ static void pgraph_vk_flush(NV2AState *d)
     PGRAPHState *pg = &d->pgraph;
 
     pgraph_vk_finish(pg, VK_FINISH_REASON_FLUSH);
-    pgraph_vk_surface_flush(d);
-    pgraph_vk_mark_textures_possibly_dirty(d, 0, memory_region_size(d->vram));
-    pgraph_vk_update_vertex_ram_buffer(&d->pgraph, 0, d->vram_ptr,
-                                       memory_region_size(d->vram));
+    if (pg->loadvm.pending) {
+        /*
+         * VRAM the snapshot load changed is marked dirty, textures and the
+         * vertex RAM buffer pick it up like any other guest write.
+         */
+        pgraph_vk_surface_revalidate(d);
+        pgraph_loadvm_complete(pg);
+    } else {
+        pgraph_vk_surface_flush(d);
+        pgraph_vk_mark_textures_possibly_dirty(d, 0,
+                                               memory_region_size(d->vram));
+        pgraph_vk_update_vertex_ram_buffer(&d->pgraph, 0, d->vram_ptr,
+                                           memory_region_size(d->vram));
+    }
     for (int i = 0; i < 4; i++) {
         pg->texture_dirty[i] = true;
     }
+    pgraph_vk_invalidate_uniforms(pg);
 
     /* FIXME: Flush more? */
 
@@ -109,8 +120,7 @@ static void pgraph_vk_sync(NV2AState *d)
     PGRAPHState *pg = &d->pgraph;
     pgraph_vk_render_display(pg);
 
-    qatomic_set(&d->pgraph.sync_pending, false);
-    qemu_event_set(&d->pgraph.sync_complete);
+    pgraph_sync_complete(pg);
 }
 
 static void pgraph_vk_process_pending(NV2AState *d)
@@ -119,7 +129,7 @@ static void pgraph_vk_process_pending(NV2AState *d)
 
     if (qatomic_read(&r->downloads_pending) ||
         qatomic_read(&r->download_dirty_surfaces_pending) ||
-        qatomic_read(&d->pgraph.sync_pending) ||
+        pgraph_display_pending(&d->pgraph) ||
         qatomic_read(&d->pgraph.flush_pending)
     ) {
         qemu_mutex_unlock(&d->pfifo.lock);
@@ -130,7 +140,8 @@ static void pgraph_vk_process_pending(NV2AState *d)
         if (qatomic_read(&r->download_dirty_surfaces_pending)) {
             pgraph_vk_download_dirty_surfaces(d);
         }
-        if (qatomic_read(&d->pgraph.sync_pending)) {
+        if (pgraph_display_pending(&d->pgraph)) {
+            pgraph_sync_begin(&d->pgraph);
             pgraph_vk_sync(d);
         }
         if (qatomic_read(&d->pgraph.flush_pending)) {
@@ -169,10 +180,9 @@ static void pgraph_vk_pre_shutdown_wait(NV2AState *d)
     // qemu_event_wait(&d->pgraph.vk_renderer_state->shader_cache_writeback_complete);   
 }
 
-static int pgraph_vk_get_framebuffer_surface(NV2AState *d)
+static bool pgraph_vk_request_display(NV2AState *d)
 {
     PGRAPHState *pg = &d->pgraph;
-    PGRAPHVkState *r = pg->vk_renderer_state;
 
     qemu_mutex_lock(&d->pfifo.lock);
 
@@ -183,7 +193,7 @@ static int pgraph_vk_get_framebuffer_surface(NV2AState *d)
         d, d->pcrtc.start + vga_display_params.line_offset);
     if (surface == NULL || !surface->color) {
         qemu_mutex_unlock(&d->pfifo.lock);
-        return 0;
+        return false;
     }
 
     assert(surface->color);
@@ -191,16 +201,14 @@ static int pgraph_vk_get_framebuffer_surface(NV2AState *d)
     surface->frame_time = pg->frame_time;
 
 #if HAVE_EXTERNAL_MEMORY
-    qemu_event_reset(&d->pgraph.sync_complete);
     qatomic_set(&pg->sync_pending, true);
     pfifo_kick(d);
     qemu_mutex_unlock(&d->pfifo.lock);
-    qemu_event_wait(&d->pgraph.sync_complete);
-    return r->display.gl_texture_id;
+    return true;
 #else
     qemu_mutex_unlock(&d->pfifo.lock);
     pgraph_vk_wait_for_surface_download(surface);
-    return 0;
+    return false;
 #endif
 }
 
@@ -228,7 +236,7 @@ static PGRAPHRenderer pgraph_vk_renderer = {
         .surface_update = pgraph_vk_surface_update,
         .set_surface_scale_factor = pgraph_vk_set_surface_scale_factor,
         .get_surface_scale_factor = pgraph_vk_get_surface_scale_factor,
-        .get_framebuffer_surface = pgraph_vk_get_framebuffer_surface,
+        .request_display = pgraph_vk_request_display,
         .get_gpu_properties = pgraph_vk_get_gpu_properties,
     }
 };
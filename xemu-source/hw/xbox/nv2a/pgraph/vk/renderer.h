@@ -51,6 +51,12 @@ typedef struct MemorySyncRequirement {
     hwaddr addr, size;
 } MemorySyncRequirement;
 
+typedef struct ConvertedAttributeUpload {
+    uint64_t generation;
+    uint32_t submit_count;
+    VkDeviceSize offset;
+} ConvertedAttributeUpload;
+
 typedef struct RenderPassState {
     VkFormat color_format;
     VkFormat zeta_format;
@@ -80,6 +86,21 @@ typedef struct PipelineBinding {
     bool has_dynamic_line_width;
 } PipelineBinding;
 
+typedef struct DescriptorSetKey {
+    VkBuffer ubo_buffer;
+    VkDeviceSize ubo_ranges[2];
+    VkImageView image_views[NV2A_MAX_TEXTURES];
+    VkSampler samplers[NV2A_MAX_TEXTURES];
+} DescriptorSetKey;
+
+typedef struct DescriptorSetBinding {
+    LruNode node;
+    DescriptorSetKey key;
+    VkDescriptorSet descriptor_set;
+    uint32_t submit_time;
+    bool written;
+} DescriptorSetBinding;
+
 enum Buffer {
     BUFFER_STAGING_DST,
     BUFFER_STAGING_SRC,
@@ -154,6 +175,7 @@ typedef struct ShaderModuleInfo {
     SpvReflectDescriptorSet **descriptor_sets;
     ShaderUniformLayout uniforms;
     ShaderUniformLayout push_constants;
+    uint64_t uniform_epoch; // Last uniform row epoch synced into `uniforms`
 } ShaderModuleInfo;
 
 typedef struct ShaderModuleCacheKey {
@@ -256,6 +278,25 @@ typedef struct PvideoState {
     uint32_t color_key;
 } PvideoState;
 
+typedef struct PGRAPHVkDisplayImage {
+    VkFramebuffer framebuffer;
+    VkImage image;
+    VkImageView image_view;
+    VkDeviceMemory memory;
+
+    int width, height;
+    int draw_time;
+
+    // OpenGL Interop
+#ifdef WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+    GLuint gl_memory_obj;
+    GLuint gl_texture_id;
+} PGRAPHVkDisplayImage;
+
 typedef struct PGRAPHVkDisplayState {
     ShaderModuleInfo *display_frag;
 
@@ -267,11 +308,6 @@ typedef struct PGRAPHVkDisplayState {
     VkPipeline pipeline;
 
     VkRenderPass render_pass;
-    VkFramebuffer framebuffer;
-
-    VkImage image;
-    VkImageView image_view;
-    VkDeviceMemory memory;
     VkSampler sampler;
 
     struct {
@@ -283,17 +319,8 @@ typedef struct PGRAPHVkDisplayState {
         VkSampler sampler;
     } pvideo;
 
-    int width, height;
-    int draw_time;
-
-    // OpenGL Interop
-#ifdef WIN32
-    HANDLE handle;
-#else
-    int fd;
-#endif
-    GLuint gl_memory_obj;
-    GLuint gl_texture_id;
+    /* One per display ring slot, shared with the UI's GL context */
+    PGRAPHVkDisplayImage images[DISPLAY_RING_SIZE];
 } PGRAPHVkDisplayState;
 
 typedef struct ComputePipelineKey {
@@ -327,6 +354,7 @@ typedef struct PGRAPHVkState {
     bool debug_utils_extension_enabled;
     bool custom_border_color_extension_enabled;
     bool memory_budget_extension_enabled;
+    bool push_descriptor_extension_enabled;
 
     VkPhysicalDevice physical_device;
     VkPhysicalDeviceFeatures enabled_physical_device_features;
@@ -367,7 +395,12 @@ typedef struct PGRAPHVkState {
     VkDescriptorPool descriptor_pool;
     VkDescriptorSetLayout descriptor_set_layout;
     VkDescriptorSet descriptor_sets[1024];
-    int descriptor_set_index;
+    Lru descriptor_set_cache;
+    DescriptorSetBinding *descriptor_set_cache_entries;
+    DescriptorSetBinding *descriptor_set_binding;
+    bool use_push_descriptors;
+    bool push_descriptors_dirty;
+    VkPipelineLayout push_descriptor_layout;
 
     StorageBuffer storage_buffers[BUFFER_COUNT];
 
@@ -383,6 +416,9 @@ typedef struct PGRAPHVkState {
     VkVertexInputBindingDescription vertex_binding_descriptions[NV2A_VERTEXSHADER_ATTRIBUTES];
     int num_active_vertex_binding_descriptions;
     hwaddr vertex_attribute_offsets[NV2A_VERTEXSHADER_ATTRIBUTES];
+    uint16_t vertex_attribute_conversions;
+    ConvertedAttributeUpload
+        converted_attribute_uploads[NV2A_VERTEXSHADER_ATTRIBUTES];
 
     QTAILQ_HEAD(, SurfaceBinding) surfaces;
     QTAILQ_HEAD(, SurfaceBinding) invalid_surfaces;
@@ -410,9 +446,15 @@ typedef struct PGRAPHVkState {
     ShaderModuleCacheEntry *shader_module_cache_entries;
 
     // FIXME: Merge these into a structure
-    uint64_t uniform_buffer_hashes[2];
-    size_t uniform_buffer_offsets[2];
-    bool uniforms_changed;
+    uint32_t uniform_buffer_offsets[2]; // Dynamic offsets into BUFFER_UNIFORM
+    bool uniforms_changed[2];
+
+    // Epoch at which each vertex program constant row was last modified
+    uint64_t uniform_epoch;
+    uint64_t vsh_constant_epochs[NV2A_VERTEXSHADER_CONSTANTS];
+    uint64_t ltctxa_epochs[NV2A_LTCTXA_COUNT];
+    uint64_t ltctxb_epochs[NV2A_LTCTXB_COUNT];
+    uint64_t ltc1_epochs[NV2A_LTC1_COUNT];
 
     VkQueryPool query_pool;
     int max_queries_in_flight; // FIXME: Move out to constant
@@ -509,6 +551,7 @@ VkDeviceSize pgraph_vk_update_vertex_inline_buffer(PGRAPHState *pg, void **data,
 void pgraph_vk_init_surfaces(PGRAPHState *pg);
 void pgraph_vk_finalize_surfaces(PGRAPHState *pg);
 void pgraph_vk_surface_flush(NV2AState *d);
+void pgraph_vk_surface_revalidate(NV2AState *d);
 void pgraph_vk_process_pending_downloads(NV2AState *d);
 void pgraph_vk_surface_download_if_dirty(NV2AState *d, SurfaceBinding *surface);
 SurfaceBinding *pgraph_vk_surface_get_within(NV2AState *d, hwaddr addr);
@@ -554,7 +597,11 @@ void pgraph_vk_trim_texture_cache(PGRAPHState *pg);
 void pgraph_vk_init_shaders(PGRAPHState *pg);
 void pgraph_vk_finalize_shaders(PGRAPHState *pg);
 void pgraph_vk_update_descriptor_sets(PGRAPHState *pg);
+void pgraph_vk_push_descriptor_set(PGRAPHState *pg);
+void pgraph_vk_invalidate_descriptor_sets(PGRAPHVkState *r,
+                                          TextureBinding *texture);
 void pgraph_vk_bind_shaders(PGRAPHState *pg);
+void pgraph_vk_invalidate_uniforms(PGRAPHState *pg);
 
 // reports.c
 void pgraph_vk_init_reports(PGRAPHState *pg);
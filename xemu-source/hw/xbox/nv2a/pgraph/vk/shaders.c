@@ -36,7 +36,7 @@ static void create_descriptor_pool(PGRAPHState *pg)
 
     VkDescriptorPoolSize pool_sizes[] = {
         {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .descriptorCount = 2 * num_sets,
         },
         {
@@ -68,18 +68,26 @@ static void create_descriptor_set_layout(PGRAPHState *pg)
 {
     PGRAPHVkState *r = pg->vk_renderer_state;
 
+    /*
+     * Push descriptors cannot use dynamic uniform buffers, so the uniform
+     * buffer offsets are written into the pushed descriptors instead.
+     */
+    VkDescriptorType ubo_type = r->use_push_descriptors ?
+                                    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER :
+                                    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
     VkDescriptorSetLayoutBinding bindings[2 + NV2A_MAX_TEXTURES];
 
     bindings[0] = (VkDescriptorSetLayoutBinding){
         .binding = VSH_UBO_BINDING,
         .descriptorCount = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorType = ubo_type,
         .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
     };
     bindings[1] = (VkDescriptorSetLayoutBinding){
         .binding = PSH_UBO_BINDING,
         .descriptorCount = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorType = ubo_type,
         .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
     };
     for (int i = 0; i < NV2A_MAX_TEXTURES; i++) {
@@ -92,6 +100,9 @@ static void create_descriptor_set_layout(PGRAPHState *pg)
     }
     VkDescriptorSetLayoutCreateInfo layout_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .flags = r->use_push_descriptors ?
+                     VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR :
+                     0,
         .bindingCount = ARRAY_SIZE(bindings),
         .pBindings = bindings,
     };
@@ -137,75 +148,134 @@ static void destroy_descriptor_sets(PGRAPHState *pg)
     }
 }
 
-void pgraph_vk_update_descriptor_sets(PGRAPHState *pg)
+static void descriptor_set_cache_entry_init(Lru *lru, LruNode *node,
+                                            const void *key)
 {
-    PGRAPHVkState *r = pg->vk_renderer_state;
+    DescriptorSetBinding *snode =
+        container_of(node, DescriptorSetBinding, node);
+    memcpy(&snode->key, key, sizeof(DescriptorSetKey));
+    snode->written = false;
+}
 
-    bool need_uniform_write =
-        r->uniforms_changed ||
-        !r->storage_buffers[BUFFER_UNIFORM_STAGING].buffer_offset;
+static bool descriptor_set_cache_entry_pre_evict(Lru *lru, LruNode *node)
+{
+    PGRAPHVkState *r =
+        container_of(lru, PGRAPHVkState, descriptor_set_cache);
+    DescriptorSetBinding *snode =
+        container_of(node, DescriptorSetBinding, node);
 
-    if (!(r->shader_bindings_changed || r->texture_bindings_changed ||
-          (r->descriptor_set_index == 0) || need_uniform_write)) {
-        return; // Nothing changed
+    if (snode == r->descriptor_set_binding) {
+        return false;
     }
 
-    ShaderBinding *binding = r->shader_binding;
-    ShaderUniformLayout *layouts[] = { &binding->vsh.module_info->uniforms,
-                                       &binding->psh.module_info->uniforms };
-    VkDeviceSize ubo_buffer_total_size = 0;
-    for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
-        ubo_buffer_total_size += layouts[i]->total_size;
+    // Used in command buffer
+    if (r->in_command_buffer && snode->submit_time == r->submit_count) {
+        return false;
     }
-    bool need_ubo_staging_buffer_reset =
-        r->uniforms_changed &&
-        !pgraph_vk_buffer_has_space_for(pg, BUFFER_UNIFORM_STAGING,
-                                        ubo_buffer_total_size,
-                                        r->device_props.limits.minUniformBufferOffsetAlignment);
 
-    bool need_descriptor_write_reset =
-        (r->descriptor_set_index >= ARRAY_SIZE(r->descriptor_sets));
+    return true;
+}
 
-    if (need_descriptor_write_reset || need_ubo_staging_buffer_reset) {
-        pgraph_vk_finish(pg, VK_FINISH_REASON_NEED_BUFFER_SPACE);
-        need_uniform_write = true;
+static bool descriptor_set_cache_entry_compare(Lru *lru, LruNode *node,
+                                               const void *key)
+{
+    DescriptorSetBinding *snode =
+        container_of(node, DescriptorSetBinding, node);
+    return memcmp(&snode->key, key, sizeof(DescriptorSetKey));
+}
+
+static void descriptor_set_cache_init(PGRAPHState *pg)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
+    const size_t cache_size = ARRAY_SIZE(r->descriptor_sets);
+    lru_init(&r->descriptor_set_cache);
+    r->descriptor_set_cache_entries =
+        g_malloc_n(cache_size, sizeof(DescriptorSetBinding));
+    assert(r->descriptor_set_cache_entries != NULL);
+    for (int i = 0; i < cache_size; i++) {
+        r->descriptor_set_cache_entries[i].descriptor_set =
+            r->descriptor_sets[i];
+        lru_add_free(&r->descriptor_set_cache,
+                     &r->descriptor_set_cache_entries[i].node);
     }
+    r->descriptor_set_cache.init_node = descriptor_set_cache_entry_init;
+    r->descriptor_set_cache.compare_nodes = descriptor_set_cache_entry_compare;
+    r->descriptor_set_cache.pre_node_evict =
+        descriptor_set_cache_entry_pre_evict;
+    r->descriptor_set_binding = NULL;
+}
 
-    VkWriteDescriptorSet descriptor_writes[2 + NV2A_MAX_TEXTURES];
+static void descriptor_set_cache_finalize(PGRAPHState *pg)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
 
-    assert(r->descriptor_set_index < ARRAY_SIZE(r->descriptor_sets));
+    r->descriptor_set_binding = NULL;
+    lru_flush(&r->descriptor_set_cache);
+    g_free(r->descriptor_set_cache_entries);
+    r->descriptor_set_cache_entries = NULL;
+}
 
-    if (need_uniform_write) {
-        for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
-            void *data = layouts[i]->allocation;
-            VkDeviceSize size = layouts[i]->total_size;
-            r->uniform_buffer_offsets[i] = pgraph_vk_append_to_buffer(
-                pg, BUFFER_UNIFORM_STAGING, &data, &size, 1,
-                r->device_props.limits.minUniformBufferOffsetAlignment);
-        }
+void pgraph_vk_invalidate_descriptor_sets(PGRAPHVkState *r,
+                                          TextureBinding *texture)
+{
+    if (r->use_push_descriptors || !r->descriptor_set_cache_entries) {
+        return;
+    }
 
-        r->uniforms_changed = false;
+    /*
+     * The texture is not referenced by the current command buffer (or it
+     * could not have been evicted), so neither are any sets referring to it.
+     */
+    for (int i = 0; i < ARRAY_SIZE(r->descriptor_sets); i++) {
+        DescriptorSetBinding *snode = &r->descriptor_set_cache_entries[i];
+        if (!lru_is_node_in_use(&r->descriptor_set_cache, &snode->node)) {
+            continue;
+        }
+        for (int j = 0; j < NV2A_MAX_TEXTURES; j++) {
+            if (snode->key.image_views[j] == texture->image_view ||
+                snode->key.samplers[j] == texture->sampler) {
+                if (snode == r->descriptor_set_binding) {
+                    r->descriptor_set_binding = NULL;
+                }
+                lru_release_node(&r->descriptor_set_cache, &snode->node);
+                break;
+            }
+        }
     }
+}
+
+static void write_descriptor_set(PGRAPHState *pg, VkDescriptorSet set,
+                                 VkWriteDescriptorSet *descriptor_writes,
+                                 VkDescriptorBufferInfo *ubo_buffer_infos,
+                                 VkDescriptorImageInfo *image_infos)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
+    ShaderBinding *binding = r->shader_binding;
+    ShaderUniformLayout *layouts[] = { &binding->vsh.module_info->uniforms,
+                                       &binding->psh.module_info->uniforms };
 
-    VkDescriptorBufferInfo ubo_buffer_infos[2];
     for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
         ubo_buffer_infos[i] = (VkDescriptorBufferInfo){
             .buffer = r->storage_buffers[BUFFER_UNIFORM].buffer,
-            .offset = r->uniform_buffer_offsets[i],
+            .offset = r->use_push_descriptors ? r->uniform_buffer_offsets[i] :
+                                                0,
             .range = layouts[i]->total_size,
         };
         descriptor_writes[i] = (VkWriteDescriptorSet){
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = r->descriptor_sets[r->descriptor_set_index],
+            .dstSet = set,
             .dstBinding = i == 0 ? VSH_UBO_BINDING : PSH_UBO_BINDING,
             .dstArrayElement = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = r->use_push_descriptors ?
+                                  VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER :
+                                  VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .descriptorCount = 1,
             .pBufferInfo = &ubo_buffer_infos[i],
         };
     }
 
-    VkDescriptorImageInfo image_infos[NV2A_MAX_TEXTURES];
     for (int i = 0; i < NV2A_MAX_TEXTURES; i++) {
         image_infos[i] = (VkDescriptorImageInfo){
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
@@ -214,7 +284,7 @@ void pgraph_vk_update_descriptor_sets(PGRAPHState *pg)
         };
         descriptor_writes[2 + i] = (VkWriteDescriptorSet){
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = r->descriptor_sets[r->descriptor_set_index],
+            .dstSet = set,
             .dstBinding = PSH_TEX_BINDING + i,
             .dstArrayElement = 0,
             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
@@ -222,10 +292,166 @@ void pgraph_vk_update_descriptor_sets(PGRAPHState *pg)
             .pImageInfo = &image_infos[i],
         };
     }
+}
+
+void pgraph_vk_push_descriptor_set(PGRAPHState *pg)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
+    assert(r->use_push_descriptors);
+
+    /*
+     * Pushed descriptors stay bound for subsequent draws in the same command
+     * buffer as long as the pipeline layout does not change.
+     */
+    if (!r->push_descriptors_dirty &&
+        r->push_descriptor_layout == r->pipeline_binding->layout) {
+        return;
+    }
+
+    VkWriteDescriptorSet descriptor_writes[2 + NV2A_MAX_TEXTURES];
+    VkDescriptorBufferInfo ubo_buffer_infos[2];
+    VkDescriptorImageInfo image_infos[NV2A_MAX_TEXTURES];
+    write_descriptor_set(pg, VK_NULL_HANDLE, descriptor_writes,
+                         ubo_buffer_infos, image_infos);
+
+    vkCmdPushDescriptorSetKHR(r->command_buffer,
+                              VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              r->pipeline_binding->layout, 0,
+                              ARRAY_SIZE(descriptor_writes), descriptor_writes);
+
+    r->push_descriptors_dirty = false;
+    r->push_descriptor_layout = r->pipeline_binding->layout;
+    nv2a_profile_inc_counter(NV2A_PROF_DESC_SET_PUSH);
+}
+
+static void get_descriptor_set_key(PGRAPHState *pg, DescriptorSetKey *key)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
+    ShaderBinding *binding = r->shader_binding;
+
+    memset(key, 0, sizeof(*key));
+    key->ubo_buffer = r->storage_buffers[BUFFER_UNIFORM].buffer;
+    key->ubo_ranges[0] = binding->vsh.module_info->uniforms.total_size;
+    key->ubo_ranges[1] = binding->psh.module_info->uniforms.total_size;
+    for (int i = 0; i < NV2A_MAX_TEXTURES; i++) {
+        key->image_views[i] = r->texture_bindings[i]->image_view;
+        key->samplers[i] = r->texture_bindings[i]->sampler;
+    }
+}
+
+void pgraph_vk_update_descriptor_sets(PGRAPHState *pg)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
+    ShaderBinding *binding = r->shader_binding;
+    ShaderUniformLayout *layouts[] = { &binding->vsh.module_info->uniforms,
+                                       &binding->psh.module_info->uniforms };
+    const VkDeviceSize ubo_alignment =
+        r->device_props.limits.minUniformBufferOffsetAlignment;
+
+    /*
+     * Uniform buffers are bound with dynamic offsets (or pushed along with
+     * the other descriptors), so a descriptor set only needs to be looked up
+     * when the bound shaders or textures change. Uniform data is appended to
+     * the staging ring only for the stages whose values changed, or for both
+     * stages once the ring has been reset by a submit.
+     */
+    bool need_descriptor_write = r->shader_bindings_changed ||
+                                 r->texture_bindings_changed ||
+                                 (!r->use_push_descriptors &&
+                                  !r->descriptor_set_binding);
+    bool staging_reset =
+        !r->storage_buffers[BUFFER_UNIFORM_STAGING].buffer_offset;
+    bool need_uniform_write[ARRAY_SIZE(layouts)];
+    VkDeviceSize ubo_upload_size = 0;
+    for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
+        need_uniform_write[i] = r->uniforms_changed[i] || staging_reset ||
+                                r->shader_bindings_changed;
+        if (need_uniform_write[i]) {
+            ubo_upload_size +=
+                ROUND_UP(layouts[i]->total_size, ubo_alignment);
+        }
+    }
+
+    if (r->descriptor_set_binding) {
+        r->descriptor_set_binding->submit_time = r->submit_count;
+    }
+
+    if (!need_descriptor_write && !ubo_upload_size) {
+        return; // Nothing changed
+    }
+
+    bool need_ubo_staging_buffer_reset =
+        ubo_upload_size &&
+        !pgraph_vk_buffer_has_space_for(pg, BUFFER_UNIFORM_STAGING,
+                                        ubo_upload_size, ubo_alignment);
+
+    DescriptorSetKey key;
+    uint64_t hash = 0;
+    bool need_descriptor_set_reset = false;
+    if (need_descriptor_write && !r->use_push_descriptors) {
+        get_descriptor_set_key(pg, &key);
+        hash = fast_hash((void *)&key, sizeof(key));
+
+        // Every cached set may be referenced by the current command buffer
+        need_descriptor_set_reset =
+            !lru_contains(&r->descriptor_set_cache, hash, &key) &&
+            !lru_has_free(&r->descriptor_set_cache) &&
+            !lru_try_evict_one(&r->descriptor_set_cache);
+    }
+
+    if (need_descriptor_set_reset || need_ubo_staging_buffer_reset) {
+        pgraph_vk_finish(pg, VK_FINISH_REASON_NEED_BUFFER_SPACE);
+        for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
+            need_uniform_write[i] = true;
+        }
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
+        if (!need_uniform_write[i]) {
+            continue;
+        }
+        void *data = layouts[i]->allocation;
+        VkDeviceSize size = layouts[i]->total_size;
+        r->uniform_buffer_offsets[i] = pgraph_vk_append_to_buffer(
+            pg, BUFFER_UNIFORM_STAGING, &data, &size, 1, ubo_alignment);
+        r->uniforms_changed[i] = false;
+        r->push_descriptors_dirty = true;
+        nv2a_profile_add_counter(NV2A_PROF_SHADER_UBO_BYTES, size);
+    }
+
+    if (!need_descriptor_write) {
+        return;
+    }
+
+    if (r->use_push_descriptors) {
+        r->push_descriptors_dirty = true;
+        return;
+    }
 
-    vkUpdateDescriptorSets(r->device, 6, descriptor_writes, 0, NULL);
+    LruNode *node = lru_lookup(&r->descriptor_set_cache, hash, &key);
+    DescriptorSetBinding *snode =
+        container_of(node, DescriptorSetBinding, node);
+    snode->submit_time = r->submit_count;
+    r->descriptor_set_binding = snode;
 
-    r->descriptor_set_index++;
+    if (snode->written) {
+        nv2a_profile_inc_counter(NV2A_PROF_DESC_SET_HIT);
+        return;
+    }
+
+    VkWriteDescriptorSet descriptor_writes[2 + NV2A_MAX_TEXTURES];
+    VkDescriptorBufferInfo ubo_buffer_infos[2];
+    VkDescriptorImageInfo image_infos[NV2A_MAX_TEXTURES];
+    write_descriptor_set(pg, snode->descriptor_set, descriptor_writes,
+                         ubo_buffer_infos, image_infos);
+
+    vkUpdateDescriptorSets(r->device, ARRAY_SIZE(descriptor_writes),
+                           descriptor_writes, 0, NULL);
+    snode->written = true;
+    nv2a_profile_inc_counter(NV2A_PROF_DESC_SET_WRITE);
 }
 
 static void update_shader_uniform_locs(ShaderBinding *binding)
@@ -416,28 +642,160 @@ static void shader_cache_finalize(PGRAPHState *pg)
 }
 
 static ShaderBinding *get_shader_binding_for_state(PGRAPHVkState *r,
-                                                   const ShaderState *state)
+                                                   const ShaderState *state,
+                                                   uint64_t hash)
 {
-    uint64_t hash = fast_hash((void *)state, sizeof(*state));
     LruNode *node = lru_lookup(&r->shader_cache, hash, state);
     ShaderBinding *binding = container_of(node, ShaderBinding, node);
     NV2A_VK_DPRINTF("shader state hash: %016" PRIx64 " %p", hash, binding);
     return binding;
 }
 
-static void apply_uniform_updates(ShaderUniformLayout *layout,
+/*
+ * Vertex program constant arrays that are synchronized row by row. Register
+ * writes to these arrays flag the affected rows in PGRAPHState, which are
+ * collected here into per-row modification epochs so that each shader module
+ * only needs to copy the rows modified since it was last bound.
+ */
+typedef struct TrackedUniformArray {
+    int uniform;
+    size_t values_offset; // uint32_t [count][4] in PGRAPHState
+    size_t dirty_offset; // bool [count] in PGRAPHState
+    size_t epochs_offset; // uint64_t [count] in PGRAPHVkState
+    int count;
+    bool fixed_function_only;
+} TrackedUniformArray;
+
+static const TrackedUniformArray tracked_vsh_uniforms[] = {
+    { VshUniform_c, offsetof(PGRAPHState, vsh_constants),
+      offsetof(PGRAPHState, vsh_constants_dirty),
+      offsetof(PGRAPHVkState, vsh_constant_epochs),
+      NV2A_VERTEXSHADER_CONSTANTS, false },
+    { VshUniform_ltctxa, offsetof(PGRAPHState, ltctxa),
+      offsetof(PGRAPHState, ltctxa_dirty),
+      offsetof(PGRAPHVkState, ltctxa_epochs), NV2A_LTCTXA_COUNT, true },
+    { VshUniform_ltctxb, offsetof(PGRAPHState, ltctxb),
+      offsetof(PGRAPHState, ltctxb_dirty),
+      offsetof(PGRAPHVkState, ltctxb_epochs), NV2A_LTCTXB_COUNT, true },
+    { VshUniform_ltc1, offsetof(PGRAPHState, ltc1),
+      offsetof(PGRAPHState, ltc1_dirty),
+      offsetof(PGRAPHVkState, ltc1_epochs), NV2A_LTC1_COUNT, true },
+};
+
+static void collect_dirty_uniform_rows(PGRAPHState *pg)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+    uint64_t epoch = r->uniform_epoch + 1;
+    bool any_dirty = false;
+
+    for (int i = 0; i < ARRAY_SIZE(tracked_vsh_uniforms); i++) {
+        const TrackedUniformArray *t = &tracked_vsh_uniforms[i];
+        bool *dirty = (bool *)((char *)pg + t->dirty_offset);
+        uint64_t *epochs = (uint64_t *)((char *)r + t->epochs_offset);
+
+        for (int row = 0; row < t->count; row++) {
+            if (dirty[row]) {
+                dirty[row] = false;
+                epochs[row] = epoch;
+                any_dirty = true;
+            }
+        }
+    }
+
+    if (any_dirty) {
+        r->uniform_epoch = epoch;
+    }
+}
+
+void pgraph_vk_invalidate_uniforms(PGRAPHState *pg)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+    uint64_t epoch = ++r->uniform_epoch;
+
+    for (int i = 0; i < ARRAY_SIZE(tracked_vsh_uniforms); i++) {
+        const TrackedUniformArray *t = &tracked_vsh_uniforms[i];
+        bool *dirty = (bool *)((char *)pg + t->dirty_offset);
+        uint64_t *epochs = (uint64_t *)((char *)r + t->epochs_offset);
+
+        for (int row = 0; row < t->count; row++) {
+            dirty[row] = false;
+            epochs[row] = epoch;
+        }
+    }
+}
+
+static bool sync_uniform_rows(PGRAPHState *pg, ShaderModuleInfo *module_info,
+                              const VshState *state, const int *locs)
+{
+    PGRAPHVkState *r = pg->vk_renderer_state;
+    ShaderUniformLayout *layout = &module_info->uniforms;
+    bool changed = false;
+
+    if (module_info->uniform_epoch == r->uniform_epoch) {
+        return false;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(tracked_vsh_uniforms); i++) {
+        const TrackedUniformArray *t = &tracked_vsh_uniforms[i];
+        int loc = locs[t->uniform];
+        if (loc == -1 || (t->fixed_function_only && !state->is_fixed_function)) {
+            continue;
+        }
+
+        const uint32_t(*values)[4] =
+            (const uint32_t(*)[4])((const char *)pg + t->values_offset);
+        const uint64_t *epochs =
+            (const uint64_t *)((const char *)r + t->epochs_offset);
+        ShaderUniform *u = &layout->uniforms[loc - 1];
+        char *p_out = uniform_ptr(layout, loc);
+        int count = MIN(t->count, u->dim_a);
+
+        for (int row = 0; row < count; row++, p_out += u->stride) {
+            if (epochs[row] > module_info->uniform_epoch &&
+                memcmp(p_out, values[row], sizeof(values[row]))) {
+                memcpy(p_out, values[row], sizeof(values[row]));
+                changed = true;
+            }
+        }
+    }
+
+    module_info->uniform_epoch = r->uniform_epoch;
+
+    return changed;
+}
+
+static bool apply_uniform_updates(ShaderUniformLayout *layout,
                                   const UniformInfo *info, int *locs,
                                   void *values, size_t count)
 {
+    bool changed = false;
+
     for (int i = 0; i < count; i++) {
-        if (locs[i] != -1) {
-            uniform_copy(layout, locs[i], (char*)values + info[i].val_offs,
-                         4, (info[i].size * info[i].count) / 4);
+        if (locs[i] == -1) {
+            continue;
+        }
+
+        ShaderUniform *u = &layout->uniforms[locs[i] - 1];
+        const size_t element_size = 4 * u->dim_v;
+        size_t bytes_remaining = info[i].size * info[i].count;
+        char *p_out = uniform_ptr(layout, locs[i]);
+        char *p_in = (char *)values + info[i].val_offs;
+
+        for (int index = 0; bytes_remaining; index++) {
+            assert(index < u->dim_a);
+            if (memcmp(p_out, p_in, element_size)) {
+                memcpy(p_out, p_in, element_size);
+                changed = true;
+            }
+            bytes_remaining -= element_size;
+            p_out += u->stride;
+            p_in += element_size;
         }
     }
+
+    return changed;
 }
 
-// FIXME: Dirty tracking
 static void update_shader_uniforms(PGRAPHState *pg)
 {
     NV2A_VK_DGROUP_BEGIN("%s", __func__);
@@ -447,15 +805,25 @@ static void update_shader_uniforms(PGRAPHState *pg)
 
     assert(r->shader_binding);
     ShaderBinding *binding = r->shader_binding;
-    ShaderUniformLayout *layouts[] = { &binding->vsh.module_info->uniforms,
-                                       &binding->psh.module_info->uniforms };
+
+    collect_dirty_uniform_rows(pg);
+
+    /* Constant arrays are synchronized separately, see sync_uniform_rows */
+    VshUniformLocs vsh_locs;
+    memcpy(vsh_locs, binding->vsh.uniform_locs, sizeof(vsh_locs));
+    for (int i = 0; i < ARRAY_SIZE(tracked_vsh_uniforms); i++) {
+        vsh_locs[tracked_vsh_uniforms[i].uniform] = -1;
+    }
 
     VshUniformValues vsh_values;
-    pgraph_glsl_set_vsh_uniform_values(pg, &binding->state.vsh,
-                                  binding->vsh.uniform_locs, &vsh_values);
-    apply_uniform_updates(&binding->vsh.module_info->uniforms, VshUniformInfo,
-                          binding->vsh.uniform_locs, &vsh_values,
-                          VshUniform__COUNT);
+    pgraph_glsl_set_vsh_uniform_values(pg, &binding->state.vsh, vsh_locs,
+                                       &vsh_values);
+    bool vsh_changed = apply_uniform_updates(
+        &binding->vsh.module_info->uniforms, VshUniformInfo, vsh_locs,
+        &vsh_values, VshUniform__COUNT);
+    vsh_changed |= sync_uniform_rows(pg, binding->vsh.module_info,
+                                     &binding->state.vsh,
+                                     binding->vsh.uniform_locs);
 
     PshUniformValues psh_values;
     pgraph_glsl_set_psh_uniform_values(pg, binding->psh.uniform_locs,
@@ -474,18 +842,14 @@ static void update_shader_uniforms(PGRAPHState *pg)
 
         psh_values.texScale[i] = scale;
     }
-    apply_uniform_updates(&binding->psh.module_info->uniforms, PshUniformInfo,
-                          binding->psh.uniform_locs, &psh_values,
-                          PshUniform__COUNT);
+    bool psh_changed = apply_uniform_updates(
+        &binding->psh.module_info->uniforms, PshUniformInfo,
+        binding->psh.uniform_locs, &psh_values, PshUniform__COUNT);
 
-    for (int i = 0; i < ARRAY_SIZE(layouts); i++) {
-        uint64_t hash =
-            fast_hash(layouts[i]->allocation, layouts[i]->total_size);
-        r->uniforms_changed |= (hash != r->uniform_buffer_hashes[i]);
-        r->uniform_buffer_hashes[i] = hash;
-    }
+    r->uniforms_changed[0] |= vsh_changed;
+    r->uniforms_changed[1] |= psh_changed;
 
-    nv2a_profile_inc_counter(r->uniforms_changed ?
+    nv2a_profile_inc_counter((vsh_changed || psh_changed) ?
                                  NV2A_PROF_SHADER_UBO_DIRTY :
                                  NV2A_PROF_SHADER_UBO_NOTDIRTY);
 
@@ -500,12 +864,13 @@ void pgraph_vk_bind_shaders(PGRAPHState *pg)
 
     r->shader_bindings_changed = false;
 
-    if (!r->shader_binding ||
-        pgraph_glsl_check_shader_state_dirty(pg, &r->shader_binding->state)) {
-        ShaderState new_state = pgraph_glsl_get_shader_state(pg);
-        if (!r->shader_binding || memcmp(&r->shader_binding->state, &new_state,
-                                         sizeof(ShaderState))) {
-            r->shader_binding = get_shader_binding_for_state(r, &new_state);
+    if (!r->shader_binding || pgraph_glsl_check_shader_state_dirty(pg)) {
+        uint64_t hash;
+        const ShaderState *new_state = pgraph_glsl_get_shader_state(pg, &hash);
+        if (!r->shader_binding || r->shader_binding->node.hash != hash ||
+            memcmp(&r->shader_binding->state, new_state,
+                   sizeof(ShaderState))) {
+            r->shader_binding = get_shader_binding_for_state(r, new_state, hash);
             r->shader_bindings_changed = true;
         }
     } else {
@@ -522,10 +887,17 @@ void pgraph_vk_init_shaders(PGRAPHState *pg)
     PGRAPHVkState *r = pg->vk_renderer_state;
 
     pgraph_vk_init_glsl_compiler();
-    create_descriptor_pool(pg);
+    r->use_push_descriptors = r->push_descriptor_extension_enabled;
     create_descriptor_set_layout(pg);
-    create_descriptor_sets(pg);
+    if (!r->use_push_descriptors) {
+        create_descriptor_pool(pg);
+        create_descriptor_sets(pg);
+        descriptor_set_cache_init(pg);
+    }
+    r->push_descriptors_dirty = true;
+    r->push_descriptor_layout = VK_NULL_HANDLE;
     shader_cache_init(pg);
+    pgraph_vk_invalidate_uniforms(pg);
 
     r->use_push_constants_for_uniform_attrs =
         (r->device_props.limits.maxPushConstantsSize >=
@@ -534,9 +906,14 @@ void pgraph_vk_init_shaders(PGRAPHState *pg)
 
 void pgraph_vk_finalize_shaders(PGRAPHState *pg)
 {
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
     shader_cache_finalize(pg);
-    destroy_descriptor_sets(pg);
+    if (!r->use_push_descriptors) {
+        descriptor_set_cache_finalize(pg);
+        destroy_descriptor_sets(pg);
+        destroy_descriptor_pool(pg);
+    }
     destroy_descriptor_set_layout(pg);
-    destroy_descriptor_pool(pg);
     pgraph_vk_finalize_glsl_compiler();
 }
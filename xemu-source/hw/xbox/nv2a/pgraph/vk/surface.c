@@ -944,6 +944,7 @@ void pgraph_vk_upload_surface_data(NV2AState *d, SurfaceBinding *surface,
     }
 
     nv2a_profile_inc_counter(NV2A_PROF_SURF_UPLOAD);
+    nv2a_profile_add_counter(NV2A_PROF_SURF_UPLOAD_BYTES, surface->size);
 
     pgraph_vk_finish(pg, VK_FINISH_REASON_SURFACE_CREATE); // FIXME: SURFACE_UP
 
@@ -1743,3 +1744,46 @@ void pgraph_vk_surface_flush(NV2AState *d)
 
     pgraph_vk_reload_surface_scale_factor(pg);
 }
+
+/*
+ * Used in place of pgraph_vk_surface_flush after a snapshot load. Surfaces
+ * are kept, but whatever was drawn since they were last synced with RAM is
+ * discarded, and those over memory the load rewrote are uploaded again.
+ */
+void pgraph_vk_surface_revalidate(NV2AState *d)
+{
+    PGRAPHState *pg = &d->pgraph;
+    PGRAPHVkState *r = pg->vk_renderer_state;
+
+    unsigned int scale_factor = pg->surface_scale_factor;
+    pgraph_vk_reload_surface_scale_factor(pg);
+    bool rescaled = pg->surface_scale_factor != scale_factor;
+
+    pg->surface_color.draw_dirty = false;
+    pg->surface_zeta.draw_dirty = false;
+    memset(&pg->last_surface_shape, 0, sizeof(pg->last_surface_shape));
+    unbind_surface(d, true);
+    unbind_surface(d, false);
+
+    SurfaceBinding *s, *next;
+    QTAILQ_FOREACH_SAFE(s, &r->surfaces, entry, next) {
+        if (rescaled) {
+            /* Sized for the previous scale factor, as in the flush path */
+            invalidate_surface(d, s);
+            nv2a_profile_inc_counter(NV2A_PROF_LOADVM_SURF_STALE);
+        } else if (s->draw_dirty ||
+                   pgraph_loadvm_range_changed(pg, s->vram_addr, s->size)) {
+            trace_nv2a_pgraph_surface_loadvm_stale(s->vram_addr);
+            s->draw_dirty = false;
+            s->download_pending = false;
+            s->upload_pending = true;
+            s->cleared = false;
+            nv2a_profile_inc_counter(NV2A_PROF_LOADVM_SURF_STALE);
+        } else {
+            nv2a_profile_inc_counter(NV2A_PROF_LOADVM_SURF_KEPT);
+        }
+    }
+    if (rescaled) {
+        prune_invalid_surfaces(r, 0);
+    }
+}
@@ -500,6 +500,7 @@ static void upload_texture_image(PGRAPHState *pg, int texture_idx,
 
     assert(texture_data_size <=
            r->storage_buffers[BUFFER_STAGING_SRC].buffer_size);
+    nv2a_profile_add_counter(NV2A_PROF_TEX_UPLOAD_BYTES, texture_data_size);
 
     // Copy texture data to mapped device buffer
     uint8_t *mapped_memory_ptr;
@@ -1498,6 +1499,7 @@ static void texture_cache_entry_post_evict(Lru *lru, LruNode *node)
 {
     PGRAPHVkState *r = container_of(lru, PGRAPHVkState, texture_cache);
     TextureBinding *snode = container_of(node, TextureBinding, node);
+    pgraph_vk_invalidate_descriptor_sets(r, snode);
     texture_cache_release_node_resources(r, snode);
 }
 
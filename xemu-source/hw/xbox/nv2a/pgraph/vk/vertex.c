@@ -61,7 +61,9 @@ void pgraph_vk_update_vertex_ram_buffer(PGRAPHState *pg, hwaddr offset,
     }
 
     nv2a_profile_inc_counter(NV2A_PROF_GEOM_BUFFER_UPDATE_1);
+    nv2a_profile_add_counter(NV2A_PROF_GEOM_BUFFER_UPDATE_BYTES, size);
     memcpy(r->storage_buffers[BUFFER_VERTEX_RAM].mapped + offset, data, size);
+    pgraph_mark_converted_vertex_attributes_possibly_dirty(pg, offset, size);
 
     bitmap_set(r->uploaded_bitmap, start_bit, nbits);
 }
@@ -132,12 +134,11 @@ void pgraph_vk_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
         NV2A_VK_DGROUP_BEGIN("%s (num_elements: %d)", __func__, num_elements);
     }
 
-    pg->compressed_attrs = 0;
     pg->uniform_attrs = 0;
-    pg->swizzle_attrs = 0;
 
     r->num_active_vertex_attribute_descriptions = 0;
     r->num_active_vertex_binding_descriptions = 0;
+    r->vertex_attribute_conversions = 0;
 
     for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
         VertexAttribute *attr = &pg->vertex_attributes[i];
@@ -156,13 +157,14 @@ void pgraph_vk_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
 
         VkFormat vk_format;
         bool needs_conversion = false;
-        bool d3d_swizzle = false;
 
         switch (attr->format) {
         case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_D3D:
+            /* BGRA, reordered to RGBA on the CPU */
             assert(attr->count == 4);
-            d3d_swizzle = true;
-            /* fallthru */
+            vk_format = VK_FORMAT_R8G8B8A8_UNORM;
+            needs_conversion = true;
+            break;
         case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_UB_OGL:
             assert(attr->count <= ARRAY_SIZE(ub_to_count));
             vk_format = ub_to_count[attr->count - 1];
@@ -180,9 +182,9 @@ void pgraph_vk_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
             vk_format = s32k_to_count[attr->count - 1];
             break;
         case NV097_SET_VERTEX_DATA_ARRAY_FORMAT_TYPE_CMP:
-            vk_format =
-                VK_FORMAT_R32_SINT; // VK_FORMAT_B10G11R11_UFLOAT_PACK32 ??
-            /* 3 signed, normalized components packed in 32-bits. (11,11,10) */
+            /* 3 signed, normalized components packed in 32-bits. (11,11,10)
+             * Expanded to float xyz on the CPU. */
+            vk_format = VK_FORMAT_R32G32B32_SFLOAT;
             assert(attr->count == 1);
             needs_conversion = true;
             break;
@@ -209,7 +211,16 @@ void pgraph_vk_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
             attrib_data_addr = attr_data + attr->offset - d->vram_ptr;
             stride = attr->stride;
             start = attrib_data_addr + min_element * stride;
-            update_memory_buffer(d, start, num_elements * stride);
+            if (needs_conversion) {
+                /*
+                 * Converted from the start of the array, so sync all of it
+                 * or writes below min_element go unnoticed by the cache.
+                 */
+                update_memory_buffer(d, attrib_data_addr,
+                                     (max_element + 1) * stride);
+            } else {
+                update_memory_buffer(d, start, num_elements * stride);
+            }
         }
 
         uint32_t provoking_element_index = provoking_element - min_element;
@@ -246,7 +257,10 @@ void pgraph_vk_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
             [r->num_active_vertex_binding_descriptions++] =
             (VkVertexInputBindingDescription){
                 .binding = r->vertex_attribute_to_description_location[i],
-                .stride = stride,
+                .stride = needs_conversion ?
+                              pgraph_get_converted_vertex_element_size(
+                                  attr->format) :
+                              stride,
                 .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
             };
 
@@ -261,10 +275,7 @@ void pgraph_vk_bind_vertex_attributes(NV2AState *d, unsigned int min_element,
         r->vertex_attribute_offsets[i] = attrib_data_addr;
 
         if (needs_conversion) {
-            pg->compressed_attrs |= (1 << i);
-        }
-        if (d3d_swizzle) {
-            pg->swizzle_attrs |= (1 << i);
+            r->vertex_attribute_conversions |= (1 << i);
         }
 
         NV2A_VK_DGROUP_END();
@@ -278,12 +289,11 @@ void pgraph_vk_bind_vertex_attributes_inline(NV2AState *d)
     PGRAPHState *pg = &d->pgraph;
     PGRAPHVkState *r = pg->vk_renderer_state;
 
-    pg->compressed_attrs = 0;
     pg->uniform_attrs = 0;
-    pg->swizzle_attrs = 0;
 
     r->num_active_vertex_attribute_descriptions = 0;
     r->num_active_vertex_binding_descriptions = 0;
+    r->vertex_attribute_conversions = 0;
 
     for (int i = 0; i < NV2A_VERTEXSHADER_ATTRIBUTES; i++) {
         VertexAttribute *attr = &pg->vertex_attributes[i];
@@ -0,0 +1,136 @@
+/*
+ * QEMU Geforce NV2A per-page VRAM content hashes
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "qemu/fast-hash.h"
+#include "vram_hash.h"
+
+void vram_page_hashes_init(VramPageHashes *h, size_t vram_size,
+                           size_t page_size)
+{
+    assert(page_size && vram_size % page_size == 0);
+    h->page_size = page_size;
+    h->num_pages = vram_size / page_size;
+    h->hashes = calloc(h->num_pages, sizeof(*h->hashes));
+    assert(h->hashes != NULL);
+}
+
+void vram_page_hashes_finalize(VramPageHashes *h)
+{
+    free(h->hashes);
+    h->hashes = NULL;
+    h->num_pages = 0;
+}
+
+void vram_page_hashes_update(VramPageHashes *h, const uint8_t *vram)
+{
+    for (size_t i = 0; i < h->num_pages; i++) {
+        h->hashes[i] = fast_hash(vram + i * h->page_size, h->page_size);
+    }
+}
+
+size_t vram_page_hashes_diff(VramPageHashes *h, const uint8_t *vram,
+                             VramChangedRangeFunc func, void *opaque)
+{
+    size_t num_changed = 0;
+    size_t run_start = 0;
+    bool in_run = false;
+
+    for (size_t i = 0; i < h->num_pages; i++) {
+        uint64_t hash = fast_hash(vram + i * h->page_size, h->page_size);
+        bool changed = hash != h->hashes[i];
+        h->hashes[i] = hash;
+
+        if (changed) {
+            num_changed++;
+            if (!in_run) {
+                run_start = i;
+                in_run = true;
+            }
+        } else if (in_run) {
+            func(opaque, run_start * h->page_size,
+                 (i - run_start) * h->page_size);
+            in_run = false;
+        }
+    }
+
+    if (in_run) {
+        func(opaque, run_start * h->page_size,
+             (h->num_pages - run_start) * h->page_size);
+    }
+
+    return num_changed;
+}
+
+void vram_changed_ranges_init(VramChangedRanges *c)
+{
+    c->num = 0;
+    c->capacity = 0;
+    c->offsets = NULL;
+    c->lengths = NULL;
+}
+
+void vram_changed_ranges_finalize(VramChangedRanges *c)
+{
+    free(c->offsets);
+    free(c->lengths);
+    vram_changed_ranges_init(c);
+}
+
+void vram_changed_ranges_clear(VramChangedRanges *c)
+{
+    c->num = 0;
+}
+
+void vram_changed_ranges_add(VramChangedRanges *c, size_t offset,
+                             size_t length)
+{
+    assert(c->num == 0 ||
+           offset > c->offsets[c->num - 1] + c->lengths[c->num - 1]);
+
+    if (c->num == c->capacity) {
+        c->capacity = c->capacity ? c->capacity * 2 : 64;
+        c->offsets = realloc(c->offsets, c->capacity * sizeof(*c->offsets));
+        c->lengths = realloc(c->lengths, c->capacity * sizeof(*c->lengths));
+        assert(c->offsets != NULL && c->lengths != NULL);
+    }
+    c->offsets[c->num] = offset;
+    c->lengths[c->num] = length;
+    c->num++;
+}
+
+bool vram_changed_ranges_overlap(const VramChangedRanges *c, size_t addr,
+                                 size_t size)
+{
+    /* Find the last range starting before the end of [addr, addr + size) */
+    size_t lo = 0, hi = c->num;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (c->offsets[mid] < addr + size) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* Ranges don't overlap each other, so only that one can reach addr */
+    return lo > 0 && addr < c->offsets[lo - 1] + c->lengths[lo - 1];
+}
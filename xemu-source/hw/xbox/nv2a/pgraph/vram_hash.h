@@ -0,0 +1,80 @@
+/*
+ * QEMU Geforce NV2A per-page VRAM content hashes
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HW_XBOX_NV2A_PGRAPH_VRAM_HASH_H
+#define HW_XBOX_NV2A_PGRAPH_VRAM_HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Content hash of every page of VRAM, taken at one point in time. Comparing
+ * against a later state tells which pages were rewritten in between, without
+ * relying on the dirty log (which e.g. a snapshot load does not update).
+ */
+typedef struct VramPageHashes {
+    size_t page_size;
+    size_t num_pages;
+    uint64_t *hashes;
+} VramPageHashes;
+
+/* Called for each run of consecutive changed pages */
+typedef void (*VramChangedRangeFunc)(void *opaque, size_t offset,
+                                     size_t length);
+
+void vram_page_hashes_init(VramPageHashes *h, size_t vram_size,
+                           size_t page_size);
+void vram_page_hashes_finalize(VramPageHashes *h);
+
+/* Record the current contents of `vram` */
+void vram_page_hashes_update(VramPageHashes *h, const uint8_t *vram);
+
+/*
+ * Rehash `vram`, calling `func` for each range of pages whose contents
+ * differ from the recorded state, then record the new state. Returns the
+ * number of changed pages.
+ */
+size_t vram_page_hashes_diff(VramPageHashes *h, const uint8_t *vram,
+                             VramChangedRangeFunc func, void *opaque);
+
+/*
+ * The ranges reported by one vram_page_hashes_diff(), in ascending order and
+ * not adjacent, for looking up whether a cached object is over any of them.
+ */
+typedef struct VramChangedRanges {
+    size_t num;
+    size_t capacity;
+    size_t *offsets;
+    size_t *lengths;
+} VramChangedRanges;
+
+void vram_changed_ranges_init(VramChangedRanges *c);
+void vram_changed_ranges_finalize(VramChangedRanges *c);
+void vram_changed_ranges_clear(VramChangedRanges *c);
+
+/* Append a range past all previous ones, as a VramChangedRangeFunc would */
+void vram_changed_ranges_add(VramChangedRanges *c, size_t offset,
+                             size_t length);
+
+/* Whether [addr, addr + size) overlaps any recorded range */
+bool vram_changed_ranges_overlap(const VramChangedRanges *c, size_t addr,
+                                 size_t size);
+
+#endif
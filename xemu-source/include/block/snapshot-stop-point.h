@@ -0,0 +1,74 @@
+/*
+ * Internal snapshots of the disk at an earlier stop point
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCK_SNAPSHOT_STOP_POINT_H
+#define BLOCK_SNAPSHOT_STOP_POINT_H
+
+#include "block/snapshot.h"
+
+/*
+ * A save with the guest running captures device state at a short stop
+ * point and the VM state afterwards, while the guest keeps writing to its
+ * disk. The disk is captured at the stop point in a temporary internal
+ * snapshot. qcow2 keeps the VM state inside the snapshot, so the snapshot
+ * itself is created by switching the disk back to the stop point, writing
+ * the VM state and creating it there, then returning to the contents the
+ * guest has written since, which are kept in a second temporary snapshot
+ * meanwhile.
+ *
+ * These run under the BQL, on every disk taking part in snapshots.
+ */
+
+/* Temporary snapshots are named with this prefix, and hidden from lists */
+#define BDRV_STOP_POINT_PREFIX "xemu-background-"
+#define BDRV_STOP_POINT_DISK BDRV_STOP_POINT_PREFIX "disk"
+#define BDRV_STOP_POINT_CURRENT BDRV_STOP_POINT_PREFIX "current"
+
+/*
+ * Before a save: drop a capture left behind by an earlier one. Fails if the
+ * disk could not be returned to its current contents after an earlier save,
+ * as they are still held in BDRV_STOP_POINT_CURRENT.
+ */
+int bdrv_stop_point_prepare(Error **errp);
+
+/* With the guest stopped: capture the disk as it is now */
+int bdrv_stop_point_capture(BlockDriverState *vm_state_bs,
+                            const QEMUSnapshotInfo *sn, Error **errp);
+
+/*
+ * Writes the VM state into `bs` with bdrv_save_vmstate(). Returns its size,
+ * or a negative errno.
+ */
+typedef int64_t BdrvStopPointWriteVMState(BlockDriverState *bs, void *opaque);
+
+/*
+ * Create `sn` from the captured disk and the VM state written by
+ * `write_vmstate`, and return the disk to what the guest has written since
+ * the capture. Guest disk I/O waits until this returns. A snapshot with the
+ * same name is replaced only once the new one exists.
+ */
+bool bdrv_stop_point_create(QEMUSnapshotInfo *sn,
+                            BlockDriverState *vm_state_bs,
+                            BdrvStopPointWriteVMState *write_vmstate,
+                            void *opaque, Error **errp);
+
+/* Delete the capture once done with it */
+void bdrv_stop_point_release(void);
+
+#endif
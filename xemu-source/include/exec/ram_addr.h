@@ -240,11 +240,12 @@ static inline bool cpu_physical_memory_is_clean(ram_addr_t addr)
 {
     bool nv2a = cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_NV2A);
     bool nv2a_tex = cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_NV2A_TEX);
+    bool apu = cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_APU);
     bool vga = cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_VGA);
     bool code = cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_CODE);
     bool migration =
         cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_MIGRATION);
-    return !(nv2a && nv2a_tex && vga && code && migration);
+    return !(nv2a && nv2a_tex && apu && vga && code && migration);
 }
 
 static inline uint8_t cpu_physical_memory_range_includes_clean(ram_addr_t start,
@@ -261,6 +262,10 @@ static inline uint8_t cpu_physical_memory_range_includes_clean(ram_addr_t start,
         !cpu_physical_memory_all_dirty(start, length, DIRTY_MEMORY_NV2A_TEX)) {
         ret |= (1 << DIRTY_MEMORY_NV2A_TEX);
     }
+    if (mask & (1 << DIRTY_MEMORY_APU) &&
+        !cpu_physical_memory_all_dirty(start, length, DIRTY_MEMORY_APU)) {
+        ret |= (1 << DIRTY_MEMORY_APU);
+    }
     if (mask & (1 << DIRTY_MEMORY_VGA) &&
         !cpu_physical_memory_all_dirty(start, length, DIRTY_MEMORY_VGA)) {
         ret |= (1 << DIRTY_MEMORY_VGA);
@@ -342,6 +347,10 @@ static inline void cpu_physical_memory_set_dirty_range(ram_addr_t start,
                 bitmap_set_atomic(blocks[DIRTY_MEMORY_NV2A_TEX]->blocks[idx],
                                   offset, next - page);
             }
+            if (unlikely(mask & (1 << DIRTY_MEMORY_APU))) {
+                bitmap_set_atomic(blocks[DIRTY_MEMORY_APU]->blocks[idx],
+                                  offset, next - page);
+            }
 
             page = next;
             idx++;
@@ -402,6 +411,7 @@ uint64_t cpu_physical_memory_set_dirty_lebitmap(unsigned long *bitmap,
                     qatomic_or(&blocks[DIRTY_MEMORY_VGA][idx][offset], temp);
                     qatomic_or(&blocks[DIRTY_MEMORY_NV2A][idx][offset], temp);
                     qatomic_or(&blocks[DIRTY_MEMORY_NV2A_TEX][idx][offset], temp);
+                    qatomic_or(&blocks[DIRTY_MEMORY_APU][idx][offset], temp);
 
                     if (global_dirty_tracking) {
                         qatomic_or(
@@ -491,6 +501,7 @@ static inline void cpu_physical_memory_clear_dirty_range(ram_addr_t start,
     cpu_physical_memory_test_and_clear_dirty(start, length, DIRTY_MEMORY_VGA);
     cpu_physical_memory_test_and_clear_dirty(start, length, DIRTY_MEMORY_NV2A);
     cpu_physical_memory_test_and_clear_dirty(start, length, DIRTY_MEMORY_NV2A_TEX);
+    cpu_physical_memory_test_and_clear_dirty(start, length, DIRTY_MEMORY_APU);
     cpu_physical_memory_test_and_clear_dirty(start, length, DIRTY_MEMORY_CODE);
 }
 
@@ -62,6 +62,23 @@ bool delete_snapshot(const char *name,
                     bool has_devices, strList *devices,
                     Error **errp);
 
+#ifdef XBOX
+/**
+ * save_snapshot_background_start: Start streaming VM state in the background.
+ * @ioc: channel to write the VM state stream to
+ * @errp: pointer to error object
+ *
+ * Device state is captured while the VM is briefly stopped in
+ * RUN_STATE_SAVE_VM. Guest RAM is then written out copy-on-write, using
+ * userfaultfd write protection, while the VM runs again. Completion is
+ * signalled through migration notifiers; the caller is responsible for
+ * storing the stream and creating the disk snapshots.
+ * On success, return %true.
+ * On failure, store an error through @errp and return %false.
+ */
+bool save_snapshot_background_start(struct QIOChannel *ioc, Error **errp);
+#endif
+
 /**
  * load_snapshot_resume: Restore runstate after loading snapshot.
  * @state: state to restore
@@ -0,0 +1,111 @@
+/*
+ * Host CPU topology and thread layout
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QEMU_CPU_TOPOLOGY_H
+#define QEMU_CPU_TOPOLOGY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CPU_TOPOLOGY_MAX_CPUS 256
+#define CPU_SET_BITS_PER_WORD (8 * sizeof(unsigned long))
+#define CPU_SET_WORDS (CPU_TOPOLOGY_MAX_CPUS / CPU_SET_BITS_PER_WORD)
+
+/* In the layout taken by qemu_thread_set_affinity() */
+typedef struct CpuSet {
+    unsigned long bits[CPU_SET_WORDS];
+} CpuSet;
+
+void cpu_set_clear(CpuSet *set);
+void cpu_set_add(CpuSet *set, int cpu);
+bool cpu_set_has(const CpuSet *set, int cpu);
+int cpu_set_count(const CpuSet *set);
+void cpu_set_union(CpuSet *dst, const CpuSet *src);
+bool cpu_set_equal(const CpuSet *a, const CpuSet *b);
+
+/* Parse a sysfs cpu list such as "0-3,8,10-11" */
+bool cpu_set_parse_list(CpuSet *set, const char *list);
+
+/* Format as a cpu list, truncated to fit `size` */
+void cpu_set_format(const CpuSet *set, char *buf, size_t size);
+
+/* A physical core and its SMT siblings */
+typedef struct CpuTopologyCore {
+    CpuSet cpus;
+    int first_cpu;
+    int package;
+    int cluster;  /* Cores sharing an L2 on hybrid and big.LITTLE parts */
+    int llc;      /* First cpu sharing the last level cache */
+    int capacity; /* Relative performance, larger is faster */
+} CpuTopologyCore;
+
+typedef struct CpuTopology {
+    CpuSet online;
+    int num_cpus;
+    int num_cores;
+    bool smt;
+    bool hybrid; /* Cores differ in capacity */
+    CpuTopologyCore cores[CPU_TOPOLOGY_MAX_CPUS];
+} CpuTopology;
+
+/*
+ * Read the topology below `root`, normally "/sys/devices/system/cpu". Cores
+ * are ordered fastest first, then grouped by last level cache and cluster.
+ * Returns false if the topology could not be read.
+ */
+bool cpu_topology_read(CpuTopology *topo, const char *root);
+
+/* Drop cpus outside `allowed`, e.g. those excluded by taskset or a cpuset */
+void cpu_topology_restrict(CpuTopology *topo, const CpuSet *allowed);
+
+/* Emulator thread classes, in the order they are given cores */
+typedef enum ThreadClass {
+    THREAD_CLASS_VCPU,
+    THREAD_CLASS_PFIFO,
+    THREAD_CLASS_RENDER,
+    THREAD_CLASS_APU,
+    THREAD_CLASS_DSP,
+    THREAD_CLASS_INPUT,
+    THREAD_CLASS_MAIN_LOOP,
+    THREAD_CLASS_VOICE,
+    THREAD_CLASS__COUNT
+} ThreadClass;
+
+typedef enum ThreadPlacementPolicy {
+    THREAD_PLACEMENT_OFF,     /* Threads float over all online cpus */
+    THREAD_PLACEMENT_SPREAD,  /* One physical core per thread */
+    THREAD_PLACEMENT_COMPACT, /* Fill SMT siblings before the next core */
+    THREAD_PLACEMENT__COUNT
+} ThreadPlacementPolicy;
+
+extern const char *const thread_class_names[THREAD_CLASS__COUNT];
+extern const char *const thread_placement_policy_names[THREAD_PLACEMENT__COUNT];
+
+/*
+ * The cpus for thread `index` of class `cls`, given `counts` threads of each
+ * class. With the spread policy, threads are handed whole physical cores in
+ * class order. Once cores run out, the remaining threads share the cores
+ * past those of the vCPU, PFIFO and render threads.
+ */
+void cpu_topology_layout(const CpuTopology *topo, ThreadPlacementPolicy policy,
+                         const int counts[THREAD_CLASS__COUNT], ThreadClass cls,
+                         int index, CpuSet *cpus);
+
+#endif
@@ -99,6 +99,12 @@ bool lru_is_node_in_use(Lru *lru, LruNode *node)
 	return QTAILQ_IN_USE(node, next_bin);
 }
 
+static inline
+bool lru_has_free(Lru *lru)
+{
+	return lru->num_free > 0;
+}
+
 static inline
 void lru_evict_node(Lru *lru, LruNode *node)
 {
@@ -116,6 +122,15 @@ void lru_evict_node(Lru *lru, LruNode *node)
 	lru->num_free += 1;
 }
 
+/* Evict a node and make it the next one to be reused. */
+static inline
+void lru_release_node(Lru *lru, LruNode *node)
+{
+	lru_evict_node(lru, node);
+	QTAILQ_REMOVE(&lru->global, node, next_global);
+	QTAILQ_INSERT_TAIL(&lru->global, node, next_global);
+}
+
 static inline
 LruNode *lru_try_evict_one(Lru *lru)
 {
@@ -171,6 +186,22 @@ bool lru_contains_hash(Lru *lru, uint64_t hash)
 	return false;
 }
 
+/* As lru_contains_hash, but also compares the key. Does not touch the node. */
+static inline
+bool lru_contains(Lru *lru, uint64_t hash, const void *key)
+{
+	unsigned int bin = lru_hash_to_bin(lru, hash);
+	LruNode *iter;
+
+	QTAILQ_FOREACH(iter, &lru->bins[bin], next_bin) {
+		if ((iter->hash == hash) && !lru->compare_nodes(lru, iter, key)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static inline
 LruNode *lru_lookup(Lru *lru, uint64_t hash, const void *key)
 {
@@ -217,9 +248,7 @@ void lru_flush(Lru *lru)
 				can_evict = lru->pre_node_evict(lru, iter);
 			}
 			if (can_evict) {
-				lru_evict_node(lru, iter);
-				QTAILQ_REMOVE(&lru->global, iter, next_global);
-				QTAILQ_INSERT_TAIL(&lru->global, iter, next_global);
+				lru_release_node(lru, iter);
 			}
 		}
 	}
@@ -0,0 +1,84 @@
+/*
+ * Coalescing of main loop wakeups
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QEMU_MAIN_LOOP_NOTIFY_H
+#define QEMU_MAIN_LOOP_NOTIFY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Decides when a notification must actually kick the main loop out of its
+ * poll. The loop marks itself sleeping before it looks at anything that
+ * decides whether and how long to sleep: pending requests, timers and file
+ * descriptors. A notification that finds it awake can be dropped, because
+ * the change it announces is seen on the way into the next poll.
+ * Notifications made while a kick is already pending fold into that kick.
+ */
+
+typedef struct MainLoopNotifyStats {
+    uint64_t wakeups;          /* Returns from poll */
+    uint64_t kicked_wakeups;   /* ...with a kick pending */
+    uint64_t notifies;         /* Calls to main_loop_notify() */
+    uint64_t kicks;            /* ...that had to signal the loop */
+    uint64_t coalesced;        /* ...folded into a pending kick */
+    uint64_t skipped;          /* ...made while the loop was awake */
+} MainLoopNotifyStats;
+
+typedef struct MainLoopNotify {
+    bool sleeping;
+    bool kicked;
+    MainLoopNotifyStats stats;
+} MainLoopNotify;
+
+void main_loop_notify_init(MainLoopNotify *n);
+
+/*
+ * Called by the main loop before it checks for pending requests and
+ * computes its poll timeout
+ */
+void main_loop_notify_prepare(MainLoopNotify *n);
+
+/*
+ * Called from any thread after changing state the main loop waits on.
+ * Returns true if the caller must signal the loop's event.
+ */
+bool main_loop_notify(MainLoopNotify *n);
+
+/* Called by the main loop on return from poll. Returns true if kicked. */
+bool main_loop_notify_wake(MainLoopNotify *n);
+
+void main_loop_notify_get_stats(MainLoopNotify *n, MainLoopNotifyStats *stats);
+
+/*
+ * Implemented in main-loop.c, declared here so the UI can read them without
+ * pulling in the block layer headers.
+ */
+typedef struct MainLoopStats {
+    MainLoopNotifyStats notify;
+    uint64_t bql_hold_ns;     /* Main loop holding the BQL between polls */
+    uint64_t handoffs;
+    uint64_t handoff_wait_ns; /* Waiting for the main loop to park */
+    uint64_t handoff_hold_ns; /* Main loop parked */
+} MainLoopStats;
+
+/* Totals since startup */
+void qemu_main_loop_get_stats(MainLoopStats *stats);
+
+#endif
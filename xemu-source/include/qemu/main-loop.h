@@ -28,6 +28,7 @@
 #include "block/aio.h"
 #include "qom/object.h"
 #include "sysemu/event-loop-base.h"
+#include "qemu/main-loop-notify.h"
 
 #define SIG_IPI SIGUSR1
 
@@ -91,11 +92,39 @@ int qemu_init_main_loop(Error **errp);
  */
 void main_loop_wait(int nonblocking);
 
+/**
+ * main_loop_prepare_wait: Arm wakeups for the next main_loop_wait().
+ *
+ * qemu_notify_event() only signals the main loop when it may be about to
+ * sleep. A caller that checks its own request flags before calling
+ * main_loop_wait() must call this before the check, or a request made
+ * between the check and the wait is not seen until something else wakes
+ * the loop. main_loop_wait() calls it too, for callers without such flags.
+ */
+void main_loop_prepare_wait(void);
+
 /**
  * qemu_get_aio_context: Return the main loop's AioContext
  */
 AioContext *qemu_get_aio_context(void);
 
+/**
+ * qemu_get_main_context: Return the glib main context of the main loop.
+ *
+ * This is not the glib default context, so sources for the main loop must
+ * be attached here rather than with g_idle_add() and friends.
+ */
+GMainContext *qemu_get_main_context(void);
+
+/**
+ * qemu_main_context_source_remove: Remove a source of the main loop.
+ *
+ * Use in place of g_source_remove() for sources attached to
+ * qemu_get_main_context(), such as chardev watches. Returns false if
+ * @tag was not found.
+ */
+bool qemu_main_context_source_remove(guint tag);
+
 /**
  * qemu_notify_event: Force processing of pending events.
  *
@@ -409,9 +438,19 @@ void main_loop_poll_add_notifier(Notifier *notify);
 void main_loop_poll_remove_notifier(Notifier *notify);
 
 #ifdef XBOX
-void qemu_init_main_loop_lock(void);
-void qemu_mutex_lock_main_loop(void);
-void qemu_mutex_unlock_main_loop(void);
+/**
+ * qemu_main_loop_handoff_begin: Stop the main loop from running.
+ *
+ * For actions on the UI thread that poll the main AioContext themselves
+ * (e.g. changing discs or loading snapshots) and so must not run alongside
+ * the main loop. The main loop parks at its next wakeup, without the BQL,
+ * until qemu_main_loop_handoff_end() is called.
+ *
+ * Must be called with the BQL held; it is released while waiting for the
+ * main loop to park. Calls nest, and do nothing on the main loop thread.
+ */
+void qemu_main_loop_handoff_begin(void);
+void qemu_main_loop_handoff_end(void);
 #endif
 
 #endif
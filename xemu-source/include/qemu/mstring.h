@@ -9,6 +9,14 @@ typedef struct {
     int refcnt;
 } MString;
 
+/*
+ * Strings are recycled through a small per-thread pool so that shader
+ * generation, which creates and drops many short-lived strings, reuses
+ * already-grown buffers instead of repeatedly allocating and reallocating.
+ */
+MString *mstring_new_sized(size_t reserve);
+void mstring_release(MString *mstr);
+
 static inline void mstring_ref(MString *mstr)
 {
     mstr->refcnt++;
@@ -18,8 +26,7 @@ static inline void mstring_unref(MString *mstr)
 {
     mstr->refcnt--;
     if (mstr->refcnt == 0) {
-        g_string_free(mstr->gstr, true);
-        g_free(mstr);
+        mstring_release(mstr);
     }
 }
 
@@ -27,31 +34,31 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(MString, mstring_unref)
 
 static inline MString *mstring_new(void)
 {
-    MString *mstr = g_malloc(sizeof(MString));
-    mstr->refcnt = 1;
-    mstr->gstr = g_string_new("");
-    return mstr;
+    return mstring_new_sized(0);
+}
+
+static inline void mstring_append_len(MString *mstr, const char *str,
+                                      size_t len)
+{
+    g_string_append_len(mstr->gstr, str, len);
 }
 
 static inline MString *mstring_from_str(const char *str)
 {
-    MString *mstr = g_malloc(sizeof(MString));
-    mstr->refcnt = 1;
-    mstr->gstr = g_string_new(str);
+    size_t len = strlen(str);
+    MString *mstr = mstring_new_sized(len);
+    mstring_append_len(mstr, str, len);
     return mstr;
 }
 
 static inline __attribute__((format(printf, 1, 2))) MString *
 mstring_from_fmt(const char *fmt, ...)
 {
-    MString *mstr = g_malloc(sizeof(MString));
-    mstr->refcnt = 1;
+    MString *mstr = mstring_new();
 
     va_list args;
     va_start(args, fmt);
-    // FIXME: Use g_string_new_take (GLib 2.78+)
-    g_autofree gchar *str = g_strdup_vprintf(fmt, args);
-    mstr->gstr = g_string_new(str);
+    g_string_append_vprintf(mstr->gstr, fmt, args);
     va_end(args);
 
     return mstr;
@@ -81,4 +88,9 @@ static inline size_t mstring_get_length(MString *mstr)
     return mstr->gstr->len;
 }
 
+static inline void mstring_append_mstring(MString *mstr, MString *other)
+{
+    g_string_append_len(mstr->gstr, other->gstr->str, other->gstr->len);
+}
+
 #endif
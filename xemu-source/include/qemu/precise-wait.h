@@ -0,0 +1,82 @@
+/*
+ * Precise deadline waits
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QEMU_PRECISE_WAIT_H
+#define QEMU_PRECISE_WAIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Wait for a deadline by sleeping until shortly before it, then spinning
+ * for the remainder. The spin margin tracks how late the sleeps wake up, so
+ * only a few microseconds are spun on a host with precise sleeps.
+ */
+
+/*
+ * How late waits returned past their deadline. Bucket 0 counts waits that
+ * were less than 1 us late, bucket i > 0 waits between 2^(i-1) and 2^i us
+ * late, and the last bucket everything beyond.
+ */
+#define PRECISE_WAIT_HIST_BUCKETS 16
+
+typedef struct PreciseWaitStats {
+    uint64_t waits;       /* Waits that ran until their deadline */
+    uint64_t interrupted; /* Waits ended early by an event */
+    uint64_t sleep_ns;    /* Time spent sleeping */
+    uint64_t spin_ns;     /* Time spent spinning */
+    uint64_t late_hist[PRECISE_WAIT_HIST_BUCKETS];
+} PreciseWaitStats;
+
+typedef struct PreciseWait {
+    int64_t margin_ns;   /* Wake up this long before the deadline */
+    int64_t min_margin_ns;
+    int64_t max_margin_ns;
+    int64_t late_avg_ns; /* Smoothed lateness of sleeps, and its deviation */
+    int64_t late_dev_ns;
+    PreciseWaitStats *stats; /* Updated atomically, may be shared */
+} PreciseWait;
+
+typedef int64_t (*PreciseWaitClockFunc)(void);
+
+/*
+ * Sleep for up to `timeout_ns`. Returns 0 on timeout, or a non-zero value
+ * if the wait was ended by an event, which is passed on to the caller.
+ */
+typedef int (*PreciseWaitSleepFunc)(void *opaque, int64_t timeout_ns);
+
+void precise_wait_init(PreciseWait *w, int64_t min_margin_ns,
+                       int64_t max_margin_ns, PreciseWaitStats *stats);
+
+/*
+ * Wait until `deadline` as read from `clock`. Returns 0 once the deadline
+ * has passed, or the first non-zero result of `sleep`.
+ */
+int precise_wait_until(PreciseWait *w, int64_t deadline,
+                       PreciseWaitClockFunc clock, PreciseWaitSleepFunc sleep,
+                       void *opaque);
+
+/* The histogram bucket of a wait that returned `late_ns` past its deadline */
+int precise_wait_hist_bucket(int64_t late_ns);
+
+/* Copy `src`, which may be updated concurrently */
+void precise_wait_stats_read(PreciseWaitStats *dst,
+                             const PreciseWaitStats *src);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Placement of emulator threads on host cores
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QEMU_THREAD_PLACEMENT_H
+#define QEMU_THREAD_PLACEMENT_H
+
+#include "qemu/cpu-topology.h"
+
+/*
+ * Threads announce their class with thread_placement_enter() when they
+ * start. Affinity is then kept in line with the layout for the current
+ * policy as threads come and go or the policy changes. Setting
+ * XEMU_VCPU_AFFINITY=N pins the vCPU thread to cpu N regardless of policy.
+ */
+
+typedef enum ThreadSchedPolicy {
+    THREAD_SCHED_DEFAULT, /* SCHED_OTHER, priority is the nice value */
+    THREAD_SCHED_BATCH,   /* SCHED_BATCH, priority is the nice value */
+    THREAD_SCHED_IDLE,
+    THREAD_SCHED_FIFO,    /* Real-time, priority is 1 to 99 */
+    THREAD_SCHED_RR,
+    THREAD_SCHED__COUNT
+} ThreadSchedPolicy;
+
+typedef struct ThreadClassConfig {
+    ThreadSchedPolicy sched;
+    int priority;
+} ThreadClassConfig;
+
+typedef struct ThreadPlacementConfig {
+    ThreadPlacementPolicy policy;
+    ThreadClassConfig classes[THREAD_CLASS__COUNT];
+} ThreadPlacementConfig;
+
+typedef struct ThreadPlacementInfo {
+    ThreadClass cls;
+    int index;
+    int tid;
+    CpuSet cpus;  /* Empty if the thread has not been pinned */
+    int error;    /* errno of the last failed affinity or scheduler change */
+} ThreadPlacementInfo;
+
+/* Read the host topology and apply `config` to threads entered so far */
+void thread_placement_init(const ThreadPlacementConfig *config);
+
+void thread_placement_set_policy(ThreadPlacementPolicy policy);
+ThreadPlacementPolicy thread_placement_get_policy(void);
+
+/* Called by a thread as it starts, and before it exits */
+void thread_placement_enter(ThreadClass cls, int index);
+void thread_placement_leave(void);
+
+/* NULL if the host topology is not known */
+const CpuTopology *thread_placement_get_topology(void);
+
+/* Fill `info` with up to `max` threads ordered by class. Returns the count. */
+int thread_placement_get_layout(ThreadPlacementInfo *info, int max);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "qemu/bitops.h"
 #include "qemu/notify.h"
+#include "qemu/precise-wait.h"
 #include "qemu/host-utils.h"
 
 #define NANOSECONDS_PER_SECOND 1000000000LL
@@ -756,6 +757,31 @@ int qemu_timeout_ns_to_ms(int64_t ns);
  */
 int qemu_poll_ns(GPollFD *fds, guint nfds, int64_t timeout);
 
+#ifdef XBOX
+/**
+ * qemu_poll_deadline_ns:
+ * @fds: Array of file descriptors
+ * @nfds: number of file descriptors
+ * @timeout: timeout in nanoseconds
+ *
+ * Like qemu_poll_ns, but the timeout is waited for to within a few
+ * microseconds, spinning briefly before it expires. For the main loop,
+ * whose timeout is the next guest timer deadline.
+ *
+ * Returns: number of fds ready
+ */
+int qemu_poll_deadline_ns(GPollFD *fds, guint nfds, int64_t timeout);
+
+/**
+ * qemu_poll_get_wait_stats:
+ * @stats: the statistics
+ *
+ * Get how precisely qemu_poll_deadline_ns() timeouts have been waited for
+ * so far.
+ */
+void qemu_poll_get_wait_stats(PreciseWaitStats *stats);
+#endif
+
 /**
  * qemu_soonest_timeout:
  * @timeout1: first timeout in nanoseconds (or -1 for infinite)
@@ -3635,7 +3635,12 @@ static void *bg_migration_thread(void *opaque)
 
     bql_lock();
 
+#ifdef XBOX
+    /* Stop as for savevm, so NV2A writes back dirty surfaces to RAM first */
+    if (migration_stop_vm(s, RUN_STATE_SAVE_VM)) {
+#else
     if (migration_stop_vm(s, RUN_STATE_PAUSED)) {
+#endif
         goto fail;
     }
     /*
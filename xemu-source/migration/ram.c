@@ -59,6 +59,9 @@
 #include "sysemu/runstate.h"
 #include "rdma.h"
 #include "options.h"
+#ifdef XBOX
+#include "snapshot-ram.h"
+#endif
 #include "sysemu/dirtylimit.h"
 #include "sysemu/kvm.h"
 
@@ -90,6 +93,10 @@
 #define RAM_SAVE_FLAG_XBZRLE   0x40
 /* 0x80 is reserved in rdma.h for RAM_SAVE_FLAG_HOOK */
 #define RAM_SAVE_FLAG_MULTIFD_FLUSH    0x200
+#ifdef XBOX
+/* A chunk of pages in snapshot encoding, see snapshot-ram.h */
+#define RAM_SAVE_FLAG_XBOX_CHUNK       0x100
+#endif
 /* We can't use any flag that is bigger than 0x200 */
 
 /*
@@ -414,6 +421,15 @@ struct RAMState {
      * RAM migration.
      */
     unsigned int postcopy_bmap_sync_requested;
+
+#ifdef XBOX
+    /* Snapshot encoding: workers, and the chunk being gathered */
+    SnapshotRamPool *snapshot_pool;
+    SnapshotRamJob *snapshot_job;
+    uint64_t snapshot_chunks;
+    uint64_t snapshot_pages;
+    uint64_t snapshot_bytes;
+#endif
 };
 typedef struct RAMState RAMState;
 
@@ -2035,6 +2051,142 @@ static int ram_save_target_page_multifd(RAMState *rs, PageSearchStatus *pss)
     return ram_save_multifd_page(block, offset);
 }
 
+#ifdef XBOX
+/*
+ * Snapshot encoding is used for savevm streams saved with the VM stopped
+ * (so pages can be read by the workers after they have been queued) and
+ * without any of the migration features that need page-wise records.
+ * savevm sets up RAM with no migration running, unlike migrate and
+ * background snapshots, which go through the setup state first.
+ */
+static bool ram_save_snapshot_enabled(void)
+{
+    return snapshot_ram_save_enabled() && !migration_is_running() &&
+           !runstate_is_running() &&
+           !migrate_background_snapshot() && !migrate_postcopy_ram() &&
+           !migrate_mapped_ram() && !migrate_xbzrle() && !migrate_rdma() &&
+           !migration_in_colo_state();
+}
+
+static void ram_save_snapshot_chunk(RAMState *rs, SnapshotRamJob *job)
+{
+    PageSearchStatus *pss = &rs->pss[RAM_CHANNEL_PRECOPY];
+    QEMUFile *f = pss->pss_channel;
+    SnapshotChunk *c = &job->chunk;
+    size_t len;
+
+    len = save_page_header(pss, f, job->block,
+                           job->offset | RAM_SAVE_FLAG_XBOX_CHUNK);
+    qemu_put_byte(f, c->num_pages);
+    qemu_put_buffer(f, c->kinds, c->num_pages);
+    qemu_put_byte(f, c->codec);
+    qemu_put_be64(f, snapshot_chunk_uses_base(c) ? snapshot_ram_base_id() : 0);
+    qemu_put_be32(f, c->payload_len);
+    qemu_put_buffer(f, c->payload, c->payload_len);
+    len += 1 + c->num_pages + 1 + 8 + 4 + c->payload_len;
+    ram_transferred_add(len);
+
+    for (int i = 0; i < c->num_pages; i++) {
+        if (c->kinds[i] == SNAPSHOT_PAGE_ZERO) {
+            stat64_add(&mig_stats.zero_pages, 1);
+        } else {
+            stat64_add(&mig_stats.normal_pages, 1);
+        }
+    }
+
+    rs->snapshot_chunks++;
+    rs->snapshot_pages += c->num_pages;
+    rs->snapshot_bytes += len;
+}
+
+static void ram_save_snapshot_submit(RAMState *rs)
+{
+    SnapshotRamJob *job = rs->snapshot_job;
+
+    job->base = NULL;
+    if (snapshot_ram_save_delta()) {
+        job->base = snapshot_ram_base_find(job->block, job->offset,
+                                           job->chunk.num_pages *
+                                               TARGET_PAGE_SIZE);
+    }
+    snapshot_ram_job_submit(rs->snapshot_pool, job);
+    rs->snapshot_job = NULL;
+}
+
+/* Write out all queued chunks, in order */
+static void ram_save_snapshot_flush(RAMState *rs)
+{
+    SnapshotRamJob *job;
+
+    if (!rs->snapshot_pool) {
+        return;
+    }
+
+    if (rs->snapshot_job) {
+        ram_save_snapshot_submit(rs);
+    }
+    while ((job = snapshot_ram_job_collect(rs->snapshot_pool))) {
+        ram_save_snapshot_chunk(rs, job);
+    }
+
+    trace_ram_save_snapshot_chunks(rs->snapshot_chunks, rs->snapshot_pages,
+                                   rs->snapshot_bytes);
+}
+
+/* Wait for queued chunks without writing them, e.g. on failure */
+static void ram_save_snapshot_discard(RAMState *rs)
+{
+    if (!rs || !rs->snapshot_pool) {
+        return;
+    }
+
+    rs->snapshot_job = NULL;
+    while (snapshot_ram_job_collect(rs->snapshot_pool)) {
+    }
+    rs->snapshot_pool = NULL;
+}
+
+/**
+ * ram_save_target_page_snapshot: add one target page to the current chunk
+ *
+ * Consecutive pages are gathered into a chunk, which is encoded by the
+ * snapshot workers once complete. Returns 1.
+ *
+ * @rs: current RAM state
+ * @pss: data about the page we want to send
+ */
+static int ram_save_target_page_snapshot(RAMState *rs, PageSearchStatus *pss)
+{
+    SnapshotRamJob *job = rs->snapshot_job;
+    ram_addr_t offset = ((ram_addr_t)pss->page) << TARGET_PAGE_BITS;
+
+    if (job && (job->block != pss->block ||
+                job->offset + job->chunk.num_pages * TARGET_PAGE_SIZE !=
+                    offset ||
+                job->chunk.num_pages == SNAPSHOT_CHUNK_MAX_PAGES)) {
+        ram_save_snapshot_submit(rs);
+        job = NULL;
+    }
+
+    if (!job) {
+        while (!(job = snapshot_ram_job_alloc(rs->snapshot_pool))) {
+            SnapshotRamJob *done = snapshot_ram_job_collect(rs->snapshot_pool);
+            ram_save_snapshot_chunk(rs, done);
+        }
+        job->decode = false;
+        job->compress = snapshot_ram_save_compress();
+        job->block = pss->block;
+        job->offset = offset;
+        job->host = pss->block->host + offset;
+        job->chunk.num_pages = 0;
+        rs->snapshot_job = job;
+    }
+
+    job->chunk.num_pages++;
+    return 1;
+}
+#endif
+
 /* Should be called before sending a host page */
 static void pss_host_page_prepare(PageSearchStatus *pss)
 {
@@ -2387,6 +2539,9 @@ static void ram_save_cleanup(void *opaque)
 
     xbzrle_cleanup();
     multifd_ram_save_cleanup();
+#ifdef XBOX
+    ram_save_snapshot_discard(*rsp);
+#endif
     ram_state_cleanup(rsp);
     g_free(migration_ops);
     migration_ops = NULL;
@@ -3060,6 +3215,11 @@ static int ram_save_setup(QEMUFile *f, void *opaque, Error **errp)
     if (migrate_multifd()) {
         multifd_ram_save_setup();
         migration_ops->ram_save_target_page = ram_save_target_page_multifd;
+#ifdef XBOX
+    } else if (ram_save_snapshot_enabled()) {
+        (*rsp)->snapshot_pool = snapshot_ram_pool_get(TARGET_PAGE_SIZE);
+        migration_ops->ram_save_target_page = ram_save_target_page_snapshot;
+#endif
     } else {
         migration_ops->ram_save_target_page = ram_save_target_page_legacy;
     }
@@ -3217,6 +3377,9 @@ out:
             }
         }
 
+#ifdef XBOX
+        ram_save_snapshot_flush(rs);
+#endif
         qemu_put_be64(f, RAM_SAVE_FLAG_EOS);
         ram_transferred_add(8);
         ret = qemu_fflush(f);
@@ -3300,6 +3463,12 @@ static int ram_save_complete(QEMUFile *f, void *opaque)
         }
     }
 
+#ifdef XBOX
+    ram_save_snapshot_flush(rs);
+    if (rs->snapshot_pool) {
+        snapshot_ram_save_complete();
+    }
+#endif
     qemu_put_be64(f, RAM_SAVE_FLAG_EOS);
     return qemu_fflush(f);
 }
@@ -4104,6 +4273,107 @@ static int parse_ramblocks(QEMUFile *f, ram_addr_t total_ram_bytes)
     return ret;
 }
 
+#ifdef XBOX
+/* Set once a snapshot chunk has been seen */
+static SnapshotRamPool *ram_load_snapshot_pool;
+
+/* Wait for all chunks queued by ram_load_snapshot_chunk */
+static int ram_load_snapshot_sync(void)
+{
+    SnapshotRamPool *pool = ram_load_snapshot_pool;
+    SnapshotRamJob *job;
+    int ret = 0;
+
+    if (!pool) {
+        return 0;
+    }
+
+    while ((job = snapshot_ram_job_collect(pool))) {
+        if (job->ret < 0 && !ret) {
+            error_report("Failed to decode snapshot RAM at %s:" RAM_ADDR_FMT,
+                         job->block->idstr, job->offset);
+            ret = job->ret;
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * Read a chunk written by ram_save_snapshot_chunk and queue it for
+ * decoding. Chunks are only complete after ram_load_snapshot_sync.
+ */
+static int ram_load_snapshot_chunk(QEMUFile *f, RAMBlock *block,
+                                   ram_addr_t addr)
+{
+    SnapshotRamPool *pool;
+    SnapshotRamJob *job;
+    SnapshotChunk *c;
+    uint64_t base_id;
+    size_t len;
+
+    if (!block || migration_incoming_colo_enabled()) {
+        error_report("Unexpected snapshot RAM chunk");
+        return -EINVAL;
+    }
+
+    pool = ram_load_snapshot_pool = snapshot_ram_pool_get(TARGET_PAGE_SIZE);
+    while (!(job = snapshot_ram_job_alloc(pool))) {
+        job = snapshot_ram_job_collect(pool);
+        if (job->ret < 0) {
+            error_report("Failed to decode snapshot RAM at %s:" RAM_ADDR_FMT,
+                         job->block->idstr, job->offset);
+            return job->ret;
+        }
+    }
+
+    c = &job->chunk;
+    c->num_pages = qemu_get_byte(f);
+    len = c->num_pages * TARGET_PAGE_SIZE;
+    if (!c->num_pages || c->num_pages > SNAPSHOT_CHUNK_MAX_PAGES ||
+        !offset_in_ramblock(block, addr) ||
+        !offset_in_ramblock(block, addr + len - 1)) {
+        error_report("Illegal snapshot RAM chunk at %s:" RAM_ADDR_FMT,
+                     block->idstr, addr);
+        return -EINVAL;
+    }
+    qemu_get_buffer(f, c->kinds, c->num_pages);
+    c->codec = qemu_get_byte(f);
+    base_id = qemu_get_be64(f);
+    c->payload_len = qemu_get_be32(f);
+    if (c->payload_len > c->payload_cap) {
+        error_report("Illegal snapshot RAM chunk at %s:" RAM_ADDR_FMT,
+                     block->idstr, addr);
+        return -EINVAL;
+    }
+    qemu_get_buffer(f, c->payload, c->payload_len);
+    if (qemu_file_get_error(f)) {
+        return qemu_file_get_error(f);
+    }
+
+    job->base = NULL;
+    if (base_id) {
+        if (base_id == snapshot_ram_base_id()) {
+            job->base = snapshot_ram_base_find(block, addr, len);
+        }
+        if (!job->base) {
+            error_report("Snapshot is a delta of a snapshot that is not "
+                         "loaded");
+            return -EINVAL;
+        }
+    }
+
+    job->decode = true;
+    job->block = block;
+    job->offset = addr;
+    job->host = host_from_ram_block_offset(block, addr);
+    ramblock_recv_bitmap_set_range(block, job->host, c->num_pages);
+    snapshot_ram_job_submit(pool, job);
+
+    return 0;
+}
+#endif
+
 /**
  * ram_load_precopy: load pages in precopy case
  *
@@ -4257,6 +4527,13 @@ static int ram_load_precopy(QEMUFile *f)
                 qemu_file_set_error(f, ret);
             }
             break;
+#ifdef XBOX
+        case RAM_SAVE_FLAG_XBOX_CHUNK:
+            ret = ram_load_snapshot_chunk(
+                f, ram_block_from_stream(mis, f, flags, RAM_CHANNEL_PRECOPY),
+                addr);
+            break;
+#endif
         default:
             error_report("Unknown combination of migration flags: 0x%x", flags);
             ret = -EINVAL;
@@ -4269,6 +4546,14 @@ static int ram_load_precopy(QEMUFile *f)
         }
     }
 
+#ifdef XBOX
+    /* Chunks decode in the background, finish them before anything else */
+    int sync_ret = ram_load_snapshot_sync();
+    if (!ret) {
+        ret = sync_ret;
+    }
+#endif
+
     return ret;
 }
 
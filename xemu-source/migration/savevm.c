@@ -68,6 +68,7 @@
 #include "yank_functions.h"
 #include "sysemu/qtest.h"
 #include "options.h"
+#include "channel.h"
 
 #include "ui/xemu-snapshots.h"
 
@@ -3151,6 +3152,14 @@ bool save_snapshot(const char *name, bool overwrite, const char *vmstate,
         goto the_end;
     }
 
+#ifdef XBOX
+    ret = xemu_snapshots_save_extra_data_finish(bs, &vm_state_size);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Could not write snapshot thumbnail");
+        goto the_end;
+    }
+#endif
+
     ret = bdrv_all_create_snapshot(sn, bs, vm_state_size,
                                    has_devices, devices, errp);
     if (ret < 0) {
@@ -3167,6 +3176,73 @@ bool save_snapshot(const char *name, bool overwrite, const char *vmstate,
     return ret == 0;
 }
 
+#ifdef XBOX
+static bool background_snapshot_active;
+static NotifierWithReturn background_snapshot_notifier;
+
+static int background_snapshot_notify(NotifierWithReturn *notifier,
+                                      MigrationEvent *e, Error **errp)
+{
+    if (background_snapshot_active && e->type != MIG_EVENT_PRECOPY_SETUP) {
+        MigrationState *s = migrate_get_current();
+        s->capabilities[MIGRATION_CAPABILITY_BACKGROUND_SNAPSHOT] = false;
+        background_snapshot_active = false;
+    }
+    return 0;
+}
+
+bool save_snapshot_background_start(QIOChannel *ioc, Error **errp)
+{
+    MigrationState *s = migrate_get_current();
+    bool new_caps[MIGRATION_CAPABILITY__MAX];
+
+    GLOBAL_STATE_CODE();
+
+    if (migration_is_running()) {
+        error_setg(errp, "There's a migration process in progress");
+        return false;
+    }
+
+    if (migration_is_blocked(errp)) {
+        return false;
+    }
+
+    if (!replay_can_snapshot()) {
+        error_setg(errp, "Record/replay does not allow making snapshot "
+                   "right now. Try once more later.");
+        return false;
+    }
+
+    memcpy(new_caps, s->capabilities, sizeof(new_caps));
+    new_caps[MIGRATION_CAPABILITY_BACKGROUND_SNAPSHOT] = true;
+    if (!migrate_caps_check(s->capabilities, new_caps, errp)) {
+        return false;
+    }
+
+    if (!background_snapshot_notifier.notify) {
+        migration_add_notifier(&background_snapshot_notifier,
+                               background_snapshot_notify);
+    }
+
+    s->capabilities[MIGRATION_CAPABILITY_BACKGROUND_SNAPSHOT] = true;
+    if (migrate_init(s, errp)) {
+        s->capabilities[MIGRATION_CAPABILITY_BACKGROUND_SNAPSHOT] = false;
+        return false;
+    }
+
+    if (!yank_register_instance(MIGRATION_YANK_INSTANCE, errp)) {
+        s->capabilities[MIGRATION_CAPABILITY_BACKGROUND_SNAPSHOT] = false;
+        migrate_set_state(&s->state, MIGRATION_STATUS_SETUP,
+                          MIGRATION_STATUS_FAILED);
+        return false;
+    }
+
+    background_snapshot_active = true;
+    migration_channel_connect(s, ioc, NULL, NULL);
+    return true;
+}
+#endif
+
 void qmp_xen_save_devices_state(const char *filename, bool has_live, bool live,
                                 Error **errp)
 {
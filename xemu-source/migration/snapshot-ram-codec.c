@@ -0,0 +1,244 @@
+/*
+ * Xbox snapshot RAM chunk encoding
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "snapshot-ram-codec.h"
+
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+
+/* Favour speed, snapshots are taken and loaded interactively */
+#define SNAPSHOT_ZSTD_LEVEL 1
+#endif
+
+void snapshot_chunk_init(SnapshotChunk *c, size_t page_size)
+{
+    size_t max_len = SNAPSHOT_CHUNK_MAX_PAGES * page_size;
+
+    assert(page_size % sizeof(uint64_t) == 0);
+    memset(c, 0, sizeof(*c));
+    c->page_size = page_size;
+    c->payload_cap = max_len;
+#ifdef CONFIG_ZSTD
+    c->payload_cap = ZSTD_compressBound(max_len);
+#endif
+    c->payload = g_malloc(c->payload_cap);
+    c->scratch = g_malloc(max_len);
+}
+
+void snapshot_chunk_finalize(SnapshotChunk *c)
+{
+#ifdef CONFIG_ZSTD
+    ZSTD_freeCCtx(c->zstd_cctx);
+    ZSTD_freeDCtx(c->zstd_dctx);
+#endif
+    g_free(c->payload);
+    g_free(c->scratch);
+    memset(c, 0, sizeof(*c));
+}
+
+bool snapshot_chunk_can_compress(void)
+{
+#ifdef CONFIG_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+static size_t count_zero_words(const uint64_t *words, size_t num_words)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < num_words; i++) {
+        count += words[i] == 0;
+    }
+    return count;
+}
+
+static void xor_page(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+                     size_t num_words)
+{
+    for (size_t i = 0; i < num_words; i++) {
+        dst[i] = a[i] ^ b[i];
+    }
+}
+
+/* Pack DATA and XOR pages into scratch, returns the packed length */
+static size_t classify_pages(SnapshotChunk *c, const uint8_t *pages,
+                             const uint8_t *base)
+{
+    const size_t page_size = c->page_size;
+    const size_t num_words = page_size / sizeof(uint64_t);
+    size_t len = 0;
+
+    for (size_t i = 0; i < c->num_pages; i++) {
+        const uint8_t *page = pages + i * page_size;
+        const uint8_t *base_page = base ? base + i * page_size : NULL;
+        uint8_t *out = c->scratch + len;
+
+        if (base_page && !memcmp(page, base_page, page_size)) {
+            c->kinds[i] = SNAPSHOT_PAGE_SAME;
+            continue;
+        }
+
+        size_t raw_zeros = count_zero_words((const uint64_t *)page, num_words);
+        if (raw_zeros == num_words) {
+            c->kinds[i] = SNAPSHOT_PAGE_ZERO;
+            continue;
+        }
+
+        /* Keep the delta only if it is sparser than the page itself */
+        if (base_page) {
+            xor_page((uint64_t *)out, (const uint64_t *)page,
+                     (const uint64_t *)base_page, num_words);
+            if (count_zero_words((uint64_t *)out, num_words) > raw_zeros) {
+                c->kinds[i] = SNAPSHOT_PAGE_XOR;
+                len += page_size;
+                continue;
+            }
+        }
+
+        c->kinds[i] = SNAPSHOT_PAGE_DATA;
+        memcpy(out, page, page_size);
+        len += page_size;
+    }
+
+    return len;
+}
+
+void snapshot_chunk_encode(SnapshotChunk *c, const uint8_t *pages,
+                           const uint8_t *base, size_t num_pages,
+                           bool compress)
+{
+    assert(num_pages > 0 && num_pages <= SNAPSHOT_CHUNK_MAX_PAGES);
+    c->num_pages = num_pages;
+
+    size_t len = classify_pages(c, pages, base);
+
+    c->codec = SNAPSHOT_CODEC_NONE;
+    c->payload_len = len;
+    if (!len) {
+        return;
+    }
+
+#ifdef CONFIG_ZSTD
+    if (compress) {
+        if (!c->zstd_cctx) {
+            c->zstd_cctx = ZSTD_createCCtx();
+            assert(c->zstd_cctx);
+        }
+        size_t ret = ZSTD_compressCCtx(c->zstd_cctx, c->payload, c->payload_cap,
+                                       c->scratch, len, SNAPSHOT_ZSTD_LEVEL);
+        if (!ZSTD_isError(ret) && ret < len) {
+            c->codec = SNAPSHOT_CODEC_ZSTD;
+            c->payload_len = ret;
+            return;
+        }
+    }
+#endif
+
+    memcpy(c->payload, c->scratch, len);
+}
+
+bool snapshot_chunk_uses_base(const SnapshotChunk *c)
+{
+    for (size_t i = 0; i < c->num_pages; i++) {
+        if (c->kinds[i] == SNAPSHOT_PAGE_SAME ||
+            c->kinds[i] == SNAPSHOT_PAGE_XOR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int snapshot_chunk_decode(SnapshotChunk *c, uint8_t *pages,
+                          const uint8_t *base)
+{
+    const size_t page_size = c->page_size;
+    const size_t num_words = page_size / sizeof(uint64_t);
+    size_t len = 0;
+
+    if (c->num_pages == 0 || c->num_pages > SNAPSHOT_CHUNK_MAX_PAGES) {
+        return -EINVAL;
+    }
+    for (size_t i = 0; i < c->num_pages; i++) {
+        if (c->kinds[i] >= SNAPSHOT_PAGE__COUNT) {
+            return -EINVAL;
+        }
+        if (c->kinds[i] == SNAPSHOT_PAGE_DATA ||
+            c->kinds[i] == SNAPSHOT_PAGE_XOR) {
+            len += page_size;
+        }
+    }
+    if (!base && snapshot_chunk_uses_base(c)) {
+        return -EINVAL;
+    }
+
+    const uint8_t *data;
+    switch (c->codec) {
+    case SNAPSHOT_CODEC_NONE:
+        if (c->payload_len != len) {
+            return -EINVAL;
+        }
+        data = c->payload;
+        break;
+#ifdef CONFIG_ZSTD
+    case SNAPSHOT_CODEC_ZSTD: {
+        if (!c->zstd_dctx) {
+            c->zstd_dctx = ZSTD_createDCtx();
+            assert(c->zstd_dctx);
+        }
+        size_t ret = ZSTD_decompressDCtx(c->zstd_dctx, c->scratch, len,
+                                         c->payload, c->payload_len);
+        if (ZSTD_isError(ret) || ret != len) {
+            return -EINVAL;
+        }
+        data = c->scratch;
+        break;
+    }
+#endif
+    default:
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < c->num_pages; i++) {
+        uint8_t *page = pages + i * page_size;
+        const uint8_t *base_page = base ? base + i * page_size : NULL;
+
+        switch (c->kinds[i]) {
+        case SNAPSHOT_PAGE_ZERO:
+            memset(page, 0, page_size);
+            break;
+        case SNAPSHOT_PAGE_DATA:
+            memcpy(page, data, page_size);
+            data += page_size;
+            break;
+        case SNAPSHOT_PAGE_SAME:
+            memcpy(page, base_page, page_size);
+            break;
+        case SNAPSHOT_PAGE_XOR:
+            xor_page((uint64_t *)page, (const uint64_t *)data,
+                     (const uint64_t *)base_page, num_words);
+            data += page_size;
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Xbox snapshot RAM chunk encoding
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIGRATION_SNAPSHOT_RAM_CODEC_H
+#define MIGRATION_SNAPSHOT_RAM_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A chunk is a run of consecutive guest pages. Each page is classified as
+ * one of the kinds below; the contents of DATA and XOR pages are packed
+ * back to back into a payload, which is then optionally compressed.
+ *
+ * SAME and XOR pages are relative to a base image of the same pages (e.g.
+ * a previously saved snapshot) which must be supplied again on decode.
+ */
+#define SNAPSHOT_CHUNK_MAX_PAGES 64
+
+enum {
+    SNAPSHOT_PAGE_ZERO = 0, /* All zero, no payload */
+    SNAPSHOT_PAGE_DATA = 1, /* Raw page in payload */
+    SNAPSHOT_PAGE_SAME = 2, /* Identical to base, no payload */
+    SNAPSHOT_PAGE_XOR  = 3, /* Page XOR base in payload */
+    SNAPSHOT_PAGE__COUNT
+};
+
+enum {
+    SNAPSHOT_CODEC_NONE = 0,
+    SNAPSHOT_CODEC_ZSTD = 1,
+    SNAPSHOT_CODEC__COUNT
+};
+
+typedef struct SnapshotChunk {
+    size_t page_size;
+    size_t num_pages;
+    uint8_t kinds[SNAPSHOT_CHUNK_MAX_PAGES];
+    uint8_t codec;
+
+    /* Encoded payload, up to payload_cap bytes */
+    uint8_t *payload;
+    size_t payload_len;
+    size_t payload_cap;
+
+    /* Unpacked payload, SNAPSHOT_CHUNK_MAX_PAGES pages */
+    uint8_t *scratch;
+
+    void *zstd_cctx;
+    void *zstd_dctx;
+} SnapshotChunk;
+
+void snapshot_chunk_init(SnapshotChunk *c, size_t page_size);
+void snapshot_chunk_finalize(SnapshotChunk *c);
+
+/* Whether SNAPSHOT_CODEC_ZSTD is available in this build */
+bool snapshot_chunk_can_compress(void);
+
+/*
+ * Encode `num_pages` pages starting at `pages`. `base` points to the same
+ * pages of the base image, or is NULL for a standalone chunk.
+ */
+void snapshot_chunk_encode(SnapshotChunk *c, const uint8_t *pages,
+                           const uint8_t *base, size_t num_pages,
+                           bool compress);
+
+/*
+ * Decode the chunk described by num_pages, kinds, codec and payload into
+ * `pages`. Returns 0 on success, or -EINVAL if the chunk is malformed or
+ * needs a base image that was not supplied.
+ */
+int snapshot_chunk_decode(SnapshotChunk *c, uint8_t *pages,
+                          const uint8_t *base);
+
+/* Whether any page of the chunk refers to the base image */
+bool snapshot_chunk_uses_base(const SnapshotChunk *c);
+
+#endif
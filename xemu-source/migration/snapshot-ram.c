@@ -0,0 +1,303 @@
+/*
+ * Xbox snapshot RAM encoding
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cutils.h"
+#include "qemu/fast-hash.h"
+#include "qemu/main-loop.h"
+#include "qemu/rcu.h"
+#include "qemu/thread.h"
+#include "exec/ramblock.h"
+#include "ram.h"
+#include "snapshot-ram.h"
+#include "trace.h"
+
+#define SNAPSHOT_RAM_MAX_THREADS 8
+#define SNAPSHOT_RAM_JOBS_PER_THREAD 4
+
+struct SnapshotRamPool {
+    QemuMutex lock;
+    QemuCond work_cond;
+    QemuCond done_cond;
+    QemuThread *threads;
+    int num_threads;
+
+    SnapshotRamJob *jobs;
+    unsigned int num_jobs;
+    /* Free running counters, index jobs modulo num_jobs */
+    unsigned int head; /* Next to hand out */
+    unsigned int next; /* Next for a worker to pick up */
+    unsigned int tail; /* Oldest in flight */
+};
+
+typedef struct SnapshotRamBaseBlock {
+    char idstr[256];
+    uint8_t *data;
+    size_t length;
+} SnapshotRamBaseBlock;
+
+static struct {
+    char *name;
+    uint64_t id;
+    GArray *blocks;
+    /* Computes `id` from `blocks` once the copy is done */
+    QemuThread hash_thread;
+    bool hashing;
+} snapshot_ram_base;
+
+static struct {
+    bool enabled;
+    bool compress;
+    bool delta;
+    char *capture;
+} snapshot_ram_save;
+
+static SnapshotRamPool *snapshot_ram_pool;
+
+static void *snapshot_ram_worker(void *opaque)
+{
+    SnapshotRamPool *pool = opaque;
+
+    qemu_mutex_lock(&pool->lock);
+    while (true) {
+        while (pool->next == pool->head) {
+            qemu_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        SnapshotRamJob *job = &pool->jobs[pool->next++ % pool->num_jobs];
+        qemu_mutex_unlock(&pool->lock);
+
+        if (job->decode) {
+            job->ret = snapshot_chunk_decode(&job->chunk, job->host, job->base);
+        } else {
+            snapshot_chunk_encode(&job->chunk, job->host, job->base,
+                                  job->chunk.num_pages, job->compress);
+            job->ret = 0;
+        }
+
+        qemu_mutex_lock(&pool->lock);
+        job->done = true;
+        qemu_cond_broadcast(&pool->done_cond);
+    }
+
+    return NULL;
+}
+
+SnapshotRamPool *snapshot_ram_pool_get(size_t page_size)
+{
+    if (snapshot_ram_pool) {
+        assert(snapshot_ram_pool->jobs[0].chunk.page_size == page_size);
+        return snapshot_ram_pool;
+    }
+
+    SnapshotRamPool *pool = g_new0(SnapshotRamPool, 1);
+    pool->num_threads = MAX(1, MIN(g_get_num_processors() - 1,
+                                   SNAPSHOT_RAM_MAX_THREADS));
+    pool->num_jobs = pool->num_threads * SNAPSHOT_RAM_JOBS_PER_THREAD;
+    pool->jobs = g_new0(SnapshotRamJob, pool->num_jobs);
+    for (int i = 0; i < pool->num_jobs; i++) {
+        snapshot_chunk_init(&pool->jobs[i].chunk, page_size);
+    }
+
+    qemu_mutex_init(&pool->lock);
+    qemu_cond_init(&pool->work_cond);
+    qemu_cond_init(&pool->done_cond);
+    pool->threads = g_new0(QemuThread, pool->num_threads);
+    for (int i = 0; i < pool->num_threads; i++) {
+        qemu_thread_create(&pool->threads[i], "snapshot-ram",
+                           snapshot_ram_worker, pool, QEMU_THREAD_DETACHED);
+    }
+
+    snapshot_ram_pool = pool;
+    return pool;
+}
+
+SnapshotRamJob *snapshot_ram_job_alloc(SnapshotRamPool *pool)
+{
+    if (pool->head - pool->tail == pool->num_jobs) {
+        return NULL;
+    }
+
+    SnapshotRamJob *job = &pool->jobs[pool->head % pool->num_jobs];
+    job->done = false;
+    job->ret = 0;
+    return job;
+}
+
+void snapshot_ram_job_submit(SnapshotRamPool *pool, SnapshotRamJob *job)
+{
+    assert(job == &pool->jobs[pool->head % pool->num_jobs]);
+
+    qemu_mutex_lock(&pool->lock);
+    pool->head++;
+    qemu_cond_signal(&pool->work_cond);
+    qemu_mutex_unlock(&pool->lock);
+}
+
+SnapshotRamJob *snapshot_ram_job_collect(SnapshotRamPool *pool)
+{
+    if (pool->tail == pool->head) {
+        return NULL;
+    }
+
+    SnapshotRamJob *job = &pool->jobs[pool->tail % pool->num_jobs];
+
+    qemu_mutex_lock(&pool->lock);
+    while (!job->done) {
+        qemu_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pool->tail++;
+    qemu_mutex_unlock(&pool->lock);
+
+    return job;
+}
+
+void snapshot_ram_save_begin(bool compress, bool delta, const char *capture)
+{
+    snapshot_ram_save.enabled = true;
+    snapshot_ram_save.compress = compress && snapshot_chunk_can_compress();
+    snapshot_ram_save.delta = delta && snapshot_ram_base.blocks;
+    snapshot_ram_save.capture = g_strdup(capture);
+}
+
+void snapshot_ram_save_complete(void)
+{
+    if (snapshot_ram_save.capture) {
+        snapshot_ram_base_capture(snapshot_ram_save.capture);
+    }
+}
+
+void snapshot_ram_save_end(void)
+{
+    g_free(snapshot_ram_save.capture);
+    memset(&snapshot_ram_save, 0, sizeof(snapshot_ram_save));
+}
+
+bool snapshot_ram_save_enabled(void)
+{
+    return snapshot_ram_save.enabled;
+}
+
+bool snapshot_ram_save_compress(void)
+{
+    return snapshot_ram_save.compress;
+}
+
+bool snapshot_ram_save_delta(void)
+{
+    return snapshot_ram_save.delta;
+}
+
+static void *snapshot_ram_base_hash(void *opaque)
+{
+    uint64_t id = 0;
+
+    for (int i = 0; i < snapshot_ram_base.blocks->len; i++) {
+        SnapshotRamBaseBlock *b = &g_array_index(snapshot_ram_base.blocks,
+                                                 SnapshotRamBaseBlock, i);
+        id = id * 31 + fast_hash(b->data, b->length);
+    }
+
+    snapshot_ram_base.id = id ?: 1;
+    trace_snapshot_ram_base_capture(snapshot_ram_base.name,
+                                    snapshot_ram_base.id);
+    return NULL;
+}
+
+static void snapshot_ram_base_hash_wait(void)
+{
+    if (snapshot_ram_base.hashing) {
+        qemu_thread_join(&snapshot_ram_base.hash_thread);
+        snapshot_ram_base.hashing = false;
+    }
+}
+
+void snapshot_ram_base_release(void)
+{
+    if (!snapshot_ram_base.blocks) {
+        return;
+    }
+
+    snapshot_ram_base_hash_wait();
+
+    for (int i = 0; i < snapshot_ram_base.blocks->len; i++) {
+        qemu_vfree(g_array_index(snapshot_ram_base.blocks,
+                                 SnapshotRamBaseBlock, i).data);
+    }
+    g_array_free(snapshot_ram_base.blocks, true);
+    g_free(snapshot_ram_base.name);
+    memset(&snapshot_ram_base, 0, sizeof(snapshot_ram_base));
+}
+
+void snapshot_ram_base_capture(const char *name)
+{
+    RAMBlock *block;
+
+    assert(bql_locked());
+    snapshot_ram_base_release();
+
+    snapshot_ram_base.blocks = g_array_new(false, true,
+                                           sizeof(SnapshotRamBaseBlock));
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        RAMBLOCK_FOREACH_MIGRATABLE(block) {
+            SnapshotRamBaseBlock b = { 0 };
+            pstrcpy(b.idstr, sizeof(b.idstr), block->idstr);
+            b.length = block->used_length;
+            b.data = qemu_memalign(qemu_real_host_page_size(), b.length);
+            memcpy(b.data, block->host, b.length);
+            g_array_append_val(snapshot_ram_base.blocks, b);
+        }
+    }
+
+    snapshot_ram_base.name = g_strdup(name);
+
+    /* Only the copy needs the VM stopped, hash it once the VM goes on */
+    snapshot_ram_base.hashing = true;
+    qemu_thread_create(&snapshot_ram_base.hash_thread, "snapshot-hash",
+                       snapshot_ram_base_hash, NULL, QEMU_THREAD_JOINABLE);
+}
+
+bool snapshot_ram_base_is(const char *name)
+{
+    return snapshot_ram_base.name && !strcmp(snapshot_ram_base.name, name);
+}
+
+uint64_t snapshot_ram_base_id(void)
+{
+    snapshot_ram_base_hash_wait();
+    return snapshot_ram_base.id;
+}
+
+const uint8_t *snapshot_ram_base_find(RAMBlock *block, ram_addr_t offset,
+                                      size_t length)
+{
+    if (!snapshot_ram_base.blocks) {
+        return NULL;
+    }
+
+    for (int i = 0; i < snapshot_ram_base.blocks->len; i++) {
+        SnapshotRamBaseBlock *b = &g_array_index(snapshot_ram_base.blocks,
+                                                 SnapshotRamBaseBlock, i);
+        if (!strcmp(b->idstr, block->idstr)) {
+            return offset + length <= b->length ? b->data + offset : NULL;
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,97 @@
+/*
+ * Xbox snapshot RAM encoding
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIGRATION_SNAPSHOT_RAM_H
+#define MIGRATION_SNAPSHOT_RAM_H
+
+#include "exec/cpu-common.h"
+#include "snapshot-ram-codec.h"
+
+/*
+ * Internal snapshots taken by the UI can store RAM as chunks of pages
+ * (see snapshot-ram-codec.h) rather than one record per page. Chunks are
+ * encoded and decoded on a pool of worker threads while the migration
+ * thread keeps reading or writing the stream in order.
+ *
+ * A copy of the RAM of one snapshot can be retained as the delta base, so
+ * that later snapshots only store the pages that differ from it.
+ */
+
+typedef struct SnapshotRamJob {
+    bool decode;
+    bool compress;
+    RAMBlock *block;
+    ram_addr_t offset;
+    uint8_t *host;
+    const uint8_t *base;
+    SnapshotChunk chunk;
+    int ret;
+    bool done;
+} SnapshotRamJob;
+
+typedef struct SnapshotRamPool SnapshotRamPool;
+
+/* The worker pool, created on first use */
+SnapshotRamPool *snapshot_ram_pool_get(size_t page_size);
+
+/*
+ * Jobs are handed out, submitted and collected in FIFO order by a single
+ * owner thread. Returns NULL if all jobs are in flight, in which case the
+ * oldest one must be collected first.
+ */
+SnapshotRamJob *snapshot_ram_job_alloc(SnapshotRamPool *pool);
+void snapshot_ram_job_submit(SnapshotRamPool *pool, SnapshotRamJob *job);
+
+/*
+ * Wait for the oldest submitted job and return it, or NULL if none is in
+ * flight. The job stays valid until the next call to snapshot_ram_job_alloc.
+ */
+SnapshotRamJob *snapshot_ram_job_collect(SnapshotRamPool *pool);
+
+/*
+ * Select the encoding for the RAM of the next savevm stream. Only takes
+ * effect for streams that are saved with the VM stopped. If `capture` is
+ * set, the saved RAM is retained as the delta base of that name once the
+ * stream is complete.
+ */
+void snapshot_ram_save_begin(bool compress, bool delta, const char *capture);
+void snapshot_ram_save_complete(void);
+void snapshot_ram_save_end(void);
+bool snapshot_ram_save_enabled(void);
+bool snapshot_ram_save_compress(void);
+bool snapshot_ram_save_delta(void);
+
+/*
+ * Copy the current RAM as delta base `name`. Must be called with the VM
+ * stopped, right after the snapshot was saved or loaded. The content
+ * identifier is computed in the background; snapshot_ram_base_id() waits
+ * for it.
+ */
+void snapshot_ram_base_capture(const char *name);
+void snapshot_ram_base_release(void);
+bool snapshot_ram_base_is(const char *name);
+
+/* Content identifier of the base, 0 if there is none */
+uint64_t snapshot_ram_base_id(void);
+
+/* The base copy of `length` bytes at `offset` in `block`, or NULL */
+const uint8_t *snapshot_ram_base_find(RAMBlock *block, ram_addr_t offset,
+                                      size_t length);
+
+#endif
@@ -831,7 +831,12 @@ int qemu_main_loop(void)
 {
     int status = EXIT_SUCCESS;
 
-    while (!main_loop_should_exit(&status)) {
+    for (;;) {
+        /* Requests made after the check below must wake the wait */
+        main_loop_prepare_wait();
+        if (main_loop_should_exit(&status)) {
+            break;
+        }
         main_loop_wait(false);
     }
 
@@ -866,11 +871,6 @@ void qemu_init_subsystems(void)
     qemu_init_cpu_list();
     qemu_init_cpu_loop();
 
-#ifdef XBOX
-    qemu_init_main_loop_lock();
-    qemu_mutex_lock_main_loop();
-#endif
-
     bql_lock();
 
     atexit(qemu_run_exit_notifiers);
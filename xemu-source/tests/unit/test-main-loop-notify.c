@@ -0,0 +1,132 @@
+/*
+ * Tests for main loop wakeups
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/main-loop.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+
+/* How long a missed wakeup leaves the loop asleep before the test fails */
+#define WATCHDOG_MS 5000
+
+static bool requested;
+static bool timed_out;
+static QemuEvent in_window;
+static QemuEvent notified;
+
+static void watchdog_cb(void *opaque)
+{
+    timed_out = true;
+}
+
+static void drain(void)
+{
+    for (int i = 0; i < 16; i++) {
+        main_loop_wait(true);
+    }
+}
+
+/*
+ * Wait the way qemu_main_loop() does, with a request flag checked outside
+ * main_loop_wait(), and have another thread post a request in between.
+ */
+static void *request_thread(void *opaque)
+{
+    int64_t delay_ms = (intptr_t)opaque;
+
+    qemu_event_wait(&in_window);
+    if (delay_ms) {
+        g_usleep(delay_ms * 1000);
+    }
+    qatomic_set(&requested, true);
+    qemu_notify_event();
+    qemu_event_set(&notified);
+    return NULL;
+}
+
+static void run_request(int64_t delay_ms, bool wait_for_request)
+{
+    QEMUTimer *watchdog = timer_new_ms(QEMU_CLOCK_REALTIME, watchdog_cb, NULL);
+    QemuThread thread;
+
+    drain();
+    qatomic_set(&requested, false);
+    timed_out = false;
+    qemu_event_reset(&in_window);
+    qemu_event_reset(&notified);
+    qemu_thread_create(&thread, "request", request_thread,
+                       (void *)(intptr_t)delay_ms, QEMU_THREAD_JOINABLE);
+    timer_mod(watchdog,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + WATCHDOG_MS);
+
+    for (bool released = false;; released = true) {
+        main_loop_prepare_wait();
+        if (qatomic_read(&requested) || timed_out) {
+            break;
+        }
+        if (!released) {
+            qemu_event_set(&in_window);
+            if (wait_for_request) {
+                /* The request lands after the check, before the loop sleeps */
+                qemu_event_wait(&notified);
+            }
+        }
+        main_loop_wait(false);
+    }
+    g_assert_false(timed_out);
+
+    qemu_thread_join(&thread);
+    timer_free(watchdog);
+}
+
+static void test_request_before_wait(void)
+{
+    run_request(0, true);
+}
+
+static void test_request_while_waiting(void)
+{
+    run_request(20, false);
+}
+
+static void test_request_while_awake(void)
+{
+    for (int i = 0; i < 100; i++) {
+        run_request(0, false);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qemu_init_main_loop(&error_abort);
+    qemu_event_init(&in_window, false);
+    qemu_event_init(&notified, false);
+
+    g_test_add_func("/main-loop/notify/request-before-wait",
+                    test_request_before_wait);
+    g_test_add_func("/main-loop/notify/request-while-waiting",
+                    test_request_while_waiting);
+    g_test_add_func("/main-loop/notify/request-while-awake",
+                    test_request_while_awake);
+
+    return g_test_run();
+}
@@ -0,0 +1,277 @@
+/*
+ * Tests for snapshots of the disk at an earlier stop point
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "block/block.h"
+#include "block/snapshot-stop-point.h"
+#include "qapi/error.h"
+#include "qapi/qmp/qdict.h"
+#include "qemu/cutils.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "qemu/units.h"
+#include "sysemu/block-backend.h"
+
+#define IMG_SIZE (64 * MiB)
+#define VM_STATE_SIZE (4 * MiB)
+
+/* Two places on the disk, a cluster apart */
+#define OFFSET_A 0
+#define OFFSET_B (64 * KiB)
+#define IO_SIZE (4 * KiB)
+
+static char *img_path;
+
+static BlockBackend *open_image(void)
+{
+    int fd;
+    QDict *qdict;
+
+    img_path = g_strdup_printf("%s/stop-point.XXXXXX", g_get_tmp_dir());
+    fd = mkstemp(img_path);
+    g_assert(fd >= 0);
+    close(fd);
+    bdrv_img_create(img_path, "qcow2", NULL, NULL, NULL, IMG_SIZE,
+                    BDRV_O_RDWR, true, &error_abort);
+
+    qdict = qdict_new();
+    qdict_put_str(qdict, "driver", "qcow2");
+    qdict_put_str(qdict, "file.driver", "file");
+    qdict_put_str(qdict, "file.filename", img_path);
+
+    return blk_new_open(NULL, NULL, qdict, BDRV_O_RDWR, &error_abort);
+}
+
+static void close_image(BlockBackend *blk)
+{
+    blk_unref(blk);
+    unlink(img_path);
+    g_free(img_path);
+}
+
+static void write_pattern(BlockBackend *blk, int64_t offset, int pattern)
+{
+    g_autofree uint8_t *buf = g_malloc(IO_SIZE);
+
+    memset(buf, pattern, IO_SIZE);
+    g_assert_cmpint(blk_pwrite(blk, offset, IO_SIZE, buf, 0), ==, 0);
+}
+
+static void check_pattern(BlockBackend *blk, int64_t offset, int pattern)
+{
+    g_autofree uint8_t *buf = g_malloc(IO_SIZE);
+    int i;
+
+    g_assert_cmpint(blk_pread(blk, offset, IO_SIZE, buf, 0), ==, 0);
+    for (i = 0; i < IO_SIZE; i++) {
+        g_assert_cmpint(buf[i], ==, pattern);
+    }
+}
+
+static void fill_vm_state(uint8_t *buf, int seed)
+{
+    int i;
+
+    for (i = 0; i < VM_STATE_SIZE; i++) {
+        buf[i] = i * 31 + seed;
+    }
+}
+
+static int64_t write_vm_state(BlockDriverState *bs, void *opaque)
+{
+    g_autofree uint8_t *buf = g_malloc(VM_STATE_SIZE);
+    int ret;
+
+    fill_vm_state(buf, GPOINTER_TO_INT(opaque));
+    ret = bdrv_save_vmstate(bs, buf, 0, VM_STATE_SIZE);
+
+    return ret < 0 ? ret : VM_STATE_SIZE;
+}
+
+static void check_vm_state(BlockDriverState *bs, int seed)
+{
+    g_autofree uint8_t *expected = g_malloc(VM_STATE_SIZE);
+    g_autofree uint8_t *buf = g_malloc(VM_STATE_SIZE);
+
+    fill_vm_state(expected, seed);
+    g_assert_cmpint(bdrv_load_vmstate(bs, buf, 0, VM_STATE_SIZE), ==, 0);
+    g_assert(memcmp(buf, expected, VM_STATE_SIZE) == 0);
+}
+
+static int count_snapshots(BlockDriverState *bs, const char *prefix)
+{
+    QEMUSnapshotInfo *sn_tab;
+    int n, i, count = 0;
+
+    n = bdrv_snapshot_list(bs, &sn_tab);
+    g_assert_cmpint(n, >=, 0);
+    for (i = 0; i < n; i++) {
+        if (g_str_has_prefix(sn_tab[i].name, prefix)) {
+            count++;
+        }
+    }
+    g_free(sn_tab);
+
+    return count;
+}
+
+/* What a save with the guest running does, with the guest writing 'new' */
+static void save(BlockBackend *blk, const char *name, int old, int new)
+{
+    BlockDriverState *bs = blk_bs(blk);
+    QEMUSnapshotInfo sn = { 0 };
+
+    pstrcpy(sn.name, sizeof(sn.name), name);
+    g_assert_cmpint(bdrv_stop_point_prepare(&error_abort), ==, 0);
+
+    check_pattern(blk, OFFSET_A, old);
+    g_assert_cmpint(bdrv_stop_point_capture(bs, &sn, &error_abort), ==, 0);
+
+    /* The guest keeps running while the VM state is gathered */
+    write_pattern(blk, OFFSET_A, new);
+    write_pattern(blk, OFFSET_B, new);
+
+    g_assert(bdrv_stop_point_create(&sn, bs, write_vm_state,
+                                    GINT_TO_POINTER(new), &error_abort));
+    bdrv_stop_point_release();
+}
+
+static void test_create(void)
+{
+    BlockBackend *blk = open_image();
+    BlockDriverState *bs = blk_bs(blk);
+
+    write_pattern(blk, OFFSET_A, 0xa1);
+    write_pattern(blk, OFFSET_B, 0xa2);
+    save(blk, "slot", 0xa1, 0xb0);
+
+    /* Writes after the stop point survive, the temporary snapshots don't */
+    check_pattern(blk, OFFSET_A, 0xb0);
+    check_pattern(blk, OFFSET_B, 0xb0);
+    g_assert_cmpint(count_snapshots(bs, BDRV_STOP_POINT_PREFIX), ==, 0);
+    g_assert_cmpint(count_snapshots(bs, "slot"), ==, 1);
+
+    /* The snapshot holds the disk at the stop point */
+    g_assert_cmpint(bdrv_all_goto_snapshot("slot", false, NULL,
+                                           &error_abort), ==, 0);
+    check_pattern(blk, OFFSET_A, 0xa1);
+    check_pattern(blk, OFFSET_B, 0xa2);
+    check_vm_state(bs, 0xb0);
+
+    close_image(blk);
+}
+
+static void test_replace(void)
+{
+    BlockBackend *blk = open_image();
+    BlockDriverState *bs = blk_bs(blk);
+
+    write_pattern(blk, OFFSET_A, 0xa0);
+    save(blk, "slot", 0xa0, 0xb0);
+    save(blk, "slot", 0xb0, 0xc0);
+
+    check_pattern(blk, OFFSET_A, 0xc0);
+    g_assert_cmpint(count_snapshots(bs, BDRV_STOP_POINT_PREFIX), ==, 0);
+    g_assert_cmpint(count_snapshots(bs, "slot"), ==, 1);
+
+    g_assert_cmpint(bdrv_all_goto_snapshot("slot", false, NULL,
+                                           &error_abort), ==, 0);
+    check_pattern(blk, OFFSET_A, 0xb0);
+    check_vm_state(bs, 0xc0);
+
+    close_image(blk);
+}
+
+static void test_leftover(void)
+{
+    BlockBackend *blk = open_image();
+    BlockDriverState *bs = blk_bs(blk);
+    QEMUSnapshotInfo sn = { 0 };
+    Error *err = NULL;
+
+    /* A save that could not return to the current contents */
+    pstrcpy(sn.name, sizeof(sn.name), BDRV_STOP_POINT_CURRENT);
+    g_assert_cmpint(bdrv_all_create_snapshot(&sn, bs, 0, false, NULL,
+                                             &error_abort), ==, 0);
+
+    g_assert_cmpint(bdrv_stop_point_prepare(&err), <, 0);
+    error_free_or_abort(&err);
+
+    close_image(blk);
+}
+
+/*
+ * The guest is paused while the disk is captured, and its disk I/O waits
+ * while the snapshot is created. A save with the guest stopped pauses for
+ * both, and for writing the VM state.
+ */
+static void test_pause(void)
+{
+    BlockBackend *blk = open_image();
+    BlockDriverState *bs = blk_bs(blk);
+    QEMUSnapshotInfo sn = { 0 };
+    int64_t start, stopped, captured, created;
+    int64_t size;
+
+    write_pattern(blk, OFFSET_A, 0xa0);
+
+    pstrcpy(sn.name, sizeof(sn.name), "stopped");
+    start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    bdrv_drained_begin(bs);
+    size = write_vm_state(bs, GINT_TO_POINTER(0));
+    g_assert_cmpint(size, ==, VM_STATE_SIZE);
+    g_assert_cmpint(bdrv_all_create_snapshot(&sn, bs, size, false, NULL,
+                                             &error_abort), ==, 0);
+    bdrv_drained_end(bs);
+    stopped = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start;
+
+    pstrcpy(sn.name, sizeof(sn.name), "running");
+    g_assert_cmpint(bdrv_stop_point_prepare(&error_abort), ==, 0);
+    start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    g_assert_cmpint(bdrv_stop_point_capture(bs, &sn, &error_abort), ==, 0);
+    captured = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start;
+
+    write_pattern(blk, OFFSET_A, 0xb0);
+
+    start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    g_assert(bdrv_stop_point_create(&sn, bs, write_vm_state,
+                                    GINT_TO_POINTER(0), &error_abort));
+    created = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start;
+    bdrv_stop_point_release();
+
+    g_test_message("stopped: paused %.3f ms", stopped / 1e6);
+    g_test_message("running: paused %.3f ms, disk I/O held %.3f ms",
+                   captured / 1e6, created / 1e6);
+
+    close_image(blk);
+}
+
+int main(int argc, char **argv)
+{
+    qemu_init_main_loop(&error_fatal);
+    bdrv_init();
+
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/snapshot-stop-point/create", test_create);
+    g_test_add_func("/snapshot-stop-point/replace", test_replace);
+    g_test_add_func("/snapshot-stop-point/leftover", test_leftover);
+    g_test_add_func("/snapshot-stop-point/pause", test_pause);
+
+    return g_test_run();
+}
@@ -0,0 +1,184 @@
+/*
+ * Crosscheck and benchmark ADPCM block decoding.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hw/xbox/mcpx/apu/vp/adpcm.h"
+
+#define NUM_BLOCKS 4096
+#define NUM_ITERATIONS 10
+#define NUM_RANDOM_BLOCKS 200000
+
+static void random_block(uint8_t *block, int channels, int valid)
+{
+    for (int i = 0; i < ADPCM_BLOCK_SIZE * channels; i++) {
+        block[i] = rand();
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        uint8_t *header = &block[ch * 4];
+        if (valid) {
+            header[2] = rand() % 89;
+            header[3] = 0;
+        } else {
+            switch (rand() % 3) {
+            case 0: header[2] = 89 + rand() % (256 - 89); break;
+            case 1: header[3] = 1 + rand() % 255; break;
+            default: break;
+            }
+        }
+    }
+}
+
+static void check_block(const uint8_t *block, int channels)
+{
+    int16_t expected[ADPCM_DECODED_SAMPLES * 2];
+    int16_t actual[ADPCM_DECODED_SAMPLES * 2];
+
+    memset(expected, 0x55, sizeof(expected));
+    memset(actual, 0x55, sizeof(actual));
+
+    int expected_n = adpcm_decode_block(expected, block,
+                                        ADPCM_BLOCK_SIZE * channels, channels);
+    int actual_n = adpcm_decode_block_fast(actual, block, channels);
+    assert(actual_n == expected_n);
+
+    /* Only compare what the caller may use */
+    size_t len = expected_n ? ADPCM_DECODED_SAMPLES * channels : 0;
+    if (memcmp(actual, expected, len * sizeof(int16_t))) {
+        for (size_t i = 0; i < len; i++) {
+            if (actual[i] != expected[i]) {
+                fprintf(stderr, "\nMismatch at sample %zu (%d channels): "
+                        "%d != %d\n", i, channels, actual[i], expected[i]);
+                break;
+            }
+        }
+        assert(0);
+    }
+}
+
+static void crosscheck_decode(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    uint8_t block[ADPCM_BLOCK_SIZE * 2];
+
+    srand(1);
+    for (int channels = 1; channels <= 2; channels++) {
+        for (int i = 0; i < NUM_RANDOM_BLOCKS; i++) {
+            random_block(block, channels, 1);
+            check_block(block, channels);
+        }
+        for (int i = 0; i < NUM_RANDOM_BLOCKS / 10; i++) {
+            random_block(block, channels, 0);
+            check_block(block, channels);
+        }
+
+        /* Drive the predictor into both rails */
+        for (int fill = 0; fill < 256; fill++) {
+            memset(block, fill, sizeof(block));
+            for (int ch = 0; ch < channels; ch++) {
+                block[ch * 4 + 2] = fill % 89;
+                block[ch * 4 + 3] = 0;
+            }
+            check_block(block, channels);
+        }
+    }
+
+    fprintf(stderr, "ok\n");
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *times)
+{
+    qsort(times, NUM_ITERATIONS, sizeof(times[0]), cmp_double);
+    double avg = 0;
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        avg += times[i];
+    }
+    avg /= NUM_ITERATIONS;
+    printf("%-26s ns/block min %.1f max %.1f avg %.1f med %.1f\n", name,
+           times[0], times[NUM_ITERATIONS - 1], avg,
+           times[NUM_ITERATIONS / 2]);
+}
+
+static void bench(void)
+{
+    static uint8_t blocks[NUM_BLOCKS][ADPCM_BLOCK_SIZE * 2];
+    int16_t out[ADPCM_DECODED_SAMPLES * 2];
+    double times[NUM_ITERATIONS];
+    volatile int16_t sink = 0;
+
+    srand(2);
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        random_block(blocks[i], 2, 1);
+    }
+
+    for (int channels = 1; channels <= 2; channels++) {
+        char name[32];
+
+        for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+            double start = now_us();
+            for (int i = 0; i < NUM_BLOCKS; i++) {
+                adpcm_decode_block(out, blocks[i], ADPCM_BLOCK_SIZE * channels,
+                                   channels);
+                sink += out[i % ADPCM_DECODED_SAMPLES];
+            }
+            times[iter] = (now_us() - start) * 1e3 / NUM_BLOCKS;
+        }
+        snprintf(name, sizeof(name), "decode %s (reference)",
+                 channels == 1 ? "mono" : "stereo");
+        report(name, times);
+
+        for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+            double start = now_us();
+            for (int i = 0; i < NUM_BLOCKS; i++) {
+                adpcm_decode_block_fast(out, blocks[i], channels);
+                sink += out[i % ADPCM_DECODED_SAMPLES];
+            }
+            times[iter] = (now_us() - start) * 1e3 / NUM_BLOCKS;
+        }
+        snprintf(name, sizeof(name), "decode %s (fast)",
+                 channels == 1 ? "mono" : "stereo");
+        report(name, times);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    adpcm_init_tables();
+    crosscheck_decode();
+    bench();
+    return 0;
+}
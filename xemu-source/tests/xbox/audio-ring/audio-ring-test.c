@@ -0,0 +1,552 @@
+/*
+ * Crosscheck and measure the MCPX audio output ring.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef USE_SDL
+#include <SDL.h>
+#endif
+
+#include "hw/xbox/mcpx/apu/audio_ring.h"
+
+#define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
+
+/* Same sizing as the APU */
+#define SAMPLE_RATE 48000
+#define BYTES_PER_SEC (SAMPLE_RATE * MCPX_AUDIO_RING_FRAME_SIZE)
+#define EP_FRAME_SAMPLES 256
+#define EP_FRAME_SIZE (EP_FRAME_SAMPLES * MCPX_AUDIO_RING_FRAME_SIZE)
+#define CALLBACK_SAMPLES 512
+#define CALLBACK_SIZE (CALLBACK_SAMPLES * MCPX_AUDIO_RING_FRAME_SIZE)
+#define RING_SIZE (16 * 1024)
+#define MIN_LATENCY (2 * 1024)
+#define MAX_LATENCY (8 * 1024)
+#define SHRINK_AFTER (30 * BYTES_PER_SEC)
+#define WAIT_MS 5
+
+/*
+ * Without SDL, the threaded scenarios run this many times faster than real
+ * time, with both the producer and the simulated device scaled alike.
+ */
+#define TIME_SCALE 2
+#define SCENARIO_SECONDS 8
+
+#define NUM_ITERATIONS 10
+#define NUM_FRAMES 100000
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sleep_until_us(double t)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)(t / 1e6);
+    ts.tv_nsec = (long)((t - ts.tv_sec * 1e6) * 1e3);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+           EINTR) {
+    }
+}
+
+/* Sample values carry a running sequence number so gaps can be detected */
+static inline int16_t seq_sample(uint32_t seq)
+{
+    return (int16_t)(seq % 30000 + 1);
+}
+
+static void fill_frame(int16_t *buf, uint32_t *seq, int samples)
+{
+    for (int i = 0; i < samples; i++) {
+        buf[2 * i] = seq_sample(*seq);
+        buf[2 * i + 1] = -seq_sample(*seq);
+        (*seq)++;
+    }
+}
+
+static void crosscheck_fifo(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    MCPXAudioRing r;
+    mcpx_audio_ring_init(&r, RING_SIZE, 0, 0, 0, SHRINK_AFTER);
+
+    static uint8_t src[RING_SIZE], dst[RING_SIZE];
+    uint32_t wseq = 0, rseq = 0;
+
+    srand(1);
+    for (int iter = 0; iter < 100000; iter++) {
+        uint32_t n = (rand() % (RING_SIZE / 4)) * 4;
+        for (uint32_t i = 0; i < n; i++) {
+            src[i] = wseq + i;
+        }
+        uint32_t written = mcpx_audio_ring_write(&r, src, n);
+        assert(written <= n);
+        assert(mcpx_audio_ring_used(&r) <= RING_SIZE);
+        wseq += written;
+
+        uint32_t used = mcpx_audio_ring_used(&r);
+        uint32_t m = (rand() % (used / 4 + 1)) * 4;
+        mcpx_audio_ring_read(&r, dst, m);
+        for (uint32_t i = 0; i < m; i++) {
+            assert(dst[i] == (uint8_t)(rseq + i));
+        }
+        rseq += m;
+    }
+
+    /* Reading past the end pads with silence and counts an underrun */
+    uint32_t used = mcpx_audio_ring_used(&r);
+    assert(used + 8 <= RING_SIZE);
+    memset(dst, 0x55, used + 8);
+    mcpx_audio_ring_read(&r, dst, used + 8);
+    for (uint32_t i = 0; i < used; i++) {
+        assert(dst[i] == (uint8_t)(rseq + i));
+    }
+    for (uint32_t i = used; i < used + 8; i++) {
+        assert(dst[i] == 0);
+    }
+    MCPXAudioRingStats stats;
+    mcpx_audio_ring_get_stats(&r, &stats);
+    assert(stats.underruns == 1 && stats.used == 0);
+
+    mcpx_audio_ring_destroy(&r);
+    fprintf(stderr, "ok\n");
+}
+
+static void crosscheck_latency(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    MCPXAudioRing r;
+    mcpx_audio_ring_init(&r, RING_SIZE, MIN_LATENCY, MAX_LATENCY,
+                         EP_FRAME_SIZE, 16 * CALLBACK_SIZE);
+    static uint8_t buf[CALLBACK_SIZE];
+    memset(buf, 1, sizeof(buf));
+
+    /* Nothing is played until the target is reached */
+    mcpx_audio_ring_write(&r, buf, MIN_LATENCY - 4);
+    mcpx_audio_ring_read(&r, buf, CALLBACK_SIZE);
+    assert(buf[0] == 0 && mcpx_audio_ring_used(&r) == MIN_LATENCY - 4);
+    assert(mcpx_audio_ring_needs_data(&r));
+
+    /* Each underrun raises the target by a step, up to the maximum */
+    for (int i = 0; i < 10; i++) {
+        MCPXAudioRingStats stats;
+        mcpx_audio_ring_get_stats(&r, &stats);
+        while (mcpx_audio_ring_needs_data(&r)) {
+            mcpx_audio_ring_write(&r, buf, 4);
+        }
+        while (mcpx_audio_ring_used(&r)) {
+            mcpx_audio_ring_read(&r, buf, CALLBACK_SIZE);
+        }
+        mcpx_audio_ring_read(&r, buf, CALLBACK_SIZE);
+        mcpx_audio_ring_get_stats(&r, &stats);
+        assert(stats.underruns == 1);
+        uint32_t expected = MIN_LATENCY + (i + 1) * EP_FRAME_SIZE;
+        assert(stats.target ==
+               (expected < MAX_LATENCY ? expected : MAX_LATENCY));
+    }
+
+    /* Clean playback brings it back down */
+    for (int i = 0; i < 1000; i++) {
+        while (mcpx_audio_ring_needs_data(&r)) {
+            mcpx_audio_ring_write(&r, buf, EP_FRAME_SIZE);
+        }
+        mcpx_audio_ring_read(&r, buf, CALLBACK_SIZE);
+    }
+    MCPXAudioRingStats stats;
+    mcpx_audio_ring_get_stats(&r, &stats);
+    assert(stats.underruns == 0 && stats.target == MIN_LATENCY);
+
+    mcpx_audio_ring_destroy(&r);
+    fprintf(stderr, "ok\n");
+}
+
+static void crosscheck_resample(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    MCPXAudioRing r;
+    mcpx_audio_ring_init(&r, RING_SIZE, MIN_LATENCY, MAX_LATENCY,
+                         EP_FRAME_SIZE, SHRINK_AFTER);
+    mcpx_audio_ring_set_drift_compensation(&r, true);
+
+    /*
+     * Keep the ring well over target so playback is sped up, and check the
+     * output is a continuous, slightly faster ramp.
+     */
+    static int16_t in[EP_FRAME_SAMPLES][2], out[CALLBACK_SAMPLES][2];
+    int32_t ramp = 0, last = -1;
+    uint64_t consumed_frames = 0, played_frames = 0;
+    for (int iter = 0; iter < 2000; iter++) {
+        while (mcpx_audio_ring_used(&r) < 2 * MAX_LATENCY - EP_FRAME_SIZE) {
+            for (int i = 0; i < EP_FRAME_SAMPLES; i++) {
+                in[i][0] = in[i][1] = ramp++ & 0x3fff;
+            }
+            mcpx_audio_ring_write(&r, in, sizeof(in));
+        }
+        uint32_t before = mcpx_audio_ring_used(&r);
+        mcpx_audio_ring_read(&r, out, sizeof(out));
+        consumed_frames +=
+            (before - mcpx_audio_ring_used(&r)) / MCPX_AUDIO_RING_FRAME_SIZE;
+        played_frames += CALLBACK_SAMPLES;
+
+        for (int i = 0; i < CALLBACK_SAMPLES; i++) {
+            assert(out[i][0] == out[i][1]);
+            if (last >= 0 && out[i][0] >= last) {
+                assert(out[i][0] - last <= 2);
+            }
+            last = out[i][0];
+        }
+    }
+    MCPXAudioRingStats stats;
+    mcpx_audio_ring_get_stats(&r, &stats);
+    assert(stats.underruns == 0);
+    assert(stats.rate > 1.0f && stats.rate <= 1.0051f);
+    double ratio = (double)consumed_frames / played_frames;
+    assert(ratio > 1.0 && ratio < 1.006);
+
+    mcpx_audio_ring_destroy(&r);
+    fprintf(stderr, "ok\n");
+}
+
+typedef struct Scenario {
+    const char *name;
+
+    /* Producer waits on the ring target, as the APU frame thread does */
+    bool gated;
+
+    /* Producer clock error, for ungated producers */
+    double drift;
+
+    /* Producer stalls of stall_ms every stall_period_ms */
+    int stall_ms, stall_period_ms;
+
+    bool drift_comp;
+} Scenario;
+
+typedef struct Sim {
+    const Scenario *sc;
+    MCPXAudioRing ring;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    volatile bool exiting;
+    double start_us;
+    int time_scale;
+
+    /* Consumer side */
+    int32_t last_seq;
+    uint64_t discontinuities;
+    uint64_t callbacks;
+    uint64_t used_acc;
+    uint32_t used_max;
+    uint32_t underruns_first_half, underruns_second_half;
+    uint32_t wakeups;
+} Sim;
+
+static void sim_wakeup(void *opaque)
+{
+    Sim *s = opaque;
+    pthread_mutex_lock(&s->lock);
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static double sim_time_us(Sim *s)
+{
+    return (now_us() - s->start_us) * s->time_scale;
+}
+
+static void sim_callback(Sim *s, uint8_t *stream, int len)
+{
+    uint32_t used = mcpx_audio_ring_used(&s->ring);
+    s->used_acc += used;
+    if (used > s->used_max) {
+        s->used_max = used;
+    }
+    s->callbacks++;
+
+    mcpx_audio_ring_read(&s->ring, stream, len);
+
+    if (s->sc->drift_comp) {
+        return;
+    }
+
+    /* Without resampling, audio must come out in order with nothing lost */
+    const int16_t *samples = (const int16_t *)stream;
+    for (int i = 0; i < len / MCPX_AUDIO_RING_FRAME_SIZE; i++) {
+        int16_t v = samples[2 * i];
+        if (v == 0) {
+            continue;
+        }
+        if (s->last_seq && v != s->last_seq % 30000 + 1) {
+            s->discontinuities++;
+        }
+        s->last_seq = v;
+    }
+}
+
+static void *sim_device_thread(void *arg)
+{
+    Sim *s = arg;
+    static uint8_t stream[CALLBACK_SIZE];
+    double period_us = 1e6 * CALLBACK_SAMPLES / SAMPLE_RATE / s->time_scale;
+    double next = now_us();
+
+    while (!s->exiting) {
+        sim_callback(s, stream, sizeof(stream));
+        next += period_us;
+        sleep_until_us(next);
+    }
+    return NULL;
+}
+
+#ifdef USE_SDL
+static void sdl_callback(void *opaque, uint8_t *stream, int len)
+{
+    sim_callback(opaque, stream, len);
+}
+#endif
+
+static void *sim_producer_thread(void *arg)
+{
+    Sim *s = arg;
+    int16_t frame[EP_FRAME_SAMPLES][2];
+    uint32_t seq = 0;
+    double frame_us = 1e6 * EP_FRAME_SAMPLES / SAMPLE_RATE;
+    double next_frame = 0, next_stall = s->sc->stall_period_ms * 1e3;
+
+    while (!s->exiting) {
+        double t = sim_time_us(s);
+
+        if (s->sc->stall_ms && t >= next_stall) {
+            next_stall += s->sc->stall_period_ms * 1e3;
+            sleep_until_us(now_us() + s->sc->stall_ms * 1e3 / s->time_scale);
+        }
+
+        if (s->sc->gated) {
+            pthread_mutex_lock(&s->lock);
+            if (!mcpx_audio_ring_needs_data(&s->ring)) {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_nsec += WAIT_MS * 1000000 / s->time_scale;
+                if (ts.tv_nsec >= 1000000000) {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000;
+                }
+                pthread_cond_timedwait(&s->cond, &s->lock, &ts);
+                pthread_mutex_unlock(&s->lock);
+                continue;
+            }
+            pthread_mutex_unlock(&s->lock);
+        } else {
+            /* Paced by its own, slightly wrong, clock */
+            next_frame += frame_us / (1.0 + s->sc->drift);
+            sleep_until_us(s->start_us + next_frame / s->time_scale);
+        }
+
+        fill_frame(&frame[0][0], &seq, EP_FRAME_SAMPLES);
+        mcpx_audio_ring_write(&s->ring, frame, sizeof(frame));
+    }
+    return NULL;
+}
+
+static void run_scenario(const Scenario *sc, bool use_sdl)
+{
+    Sim s;
+    memset(&s, 0, sizeof(s));
+    s.sc = sc;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.cond, NULL);
+    mcpx_audio_ring_init(&s.ring, RING_SIZE, MIN_LATENCY, MAX_LATENCY,
+                         EP_FRAME_SIZE, SHRINK_AFTER);
+    mcpx_audio_ring_set_wakeup(&s.ring, sim_wakeup, &s);
+    mcpx_audio_ring_set_drift_compensation(&s.ring, sc->drift_comp);
+    s.time_scale = use_sdl ? 1 : TIME_SCALE;
+    s.start_us = now_us();
+
+    pthread_t producer, device;
+    pthread_create(&producer, NULL, sim_producer_thread, &s);
+
+    int seconds = SCENARIO_SECONDS;
+#ifdef USE_SDL
+    SDL_AudioDeviceID dev = 0;
+    if (use_sdl) {
+        /* The device callback runs in real time */
+        SDL_AudioSpec spec = {
+            .freq = SAMPLE_RATE,
+            .format = AUDIO_S16LSB,
+            .channels = 2,
+            .samples = CALLBACK_SAMPLES,
+            .callback = sdl_callback,
+            .userdata = &s,
+        };
+        dev = SDL_OpenAudioDevice(NULL, 0, &spec, NULL, 0);
+        assert(dev != 0);
+        SDL_PauseAudioDevice(dev, 0);
+    } else
+#endif
+    {
+        pthread_create(&device, NULL, sim_device_thread, &s);
+    }
+
+    double half = s.start_us + seconds * 1e6 / s.time_scale / 2;
+    sleep_until_us(half);
+    MCPXAudioRingStats stats;
+    mcpx_audio_ring_get_stats(&s.ring, &stats);
+    s.underruns_first_half = stats.underruns;
+    s.wakeups = stats.wakeups;
+    sleep_until_us(half + seconds * 1e6 / s.time_scale / 2);
+    mcpx_audio_ring_get_stats(&s.ring, &stats);
+    s.underruns_second_half = stats.underruns;
+    s.wakeups += stats.wakeups;
+
+#ifdef USE_SDL
+    if (use_sdl) {
+        SDL_CloseAudioDevice(dev);
+    }
+#endif
+    s.exiting = true;
+    sim_wakeup(&s);
+    pthread_join(producer, NULL);
+    if (!use_sdl) {
+        pthread_join(device, NULL);
+    }
+
+    double avg_ms = s.callbacks ?
+        (double)s.used_acc / s.callbacks / BYTES_PER_SEC * 1e3 : 0;
+    printf("%-24s underruns %u+%u wakeups/s %.1f latency avg %.1f ms "
+           "max %.1f ms target %.1f ms rate %.4f gaps %llu\n",
+           sc->name, s.underruns_first_half, s.underruns_second_half,
+           (double)s.wakeups / seconds, avg_ms,
+           (double)s.used_max / BYTES_PER_SEC * 1e3,
+           (double)stats.target / BYTES_PER_SEC * 1e3, stats.rate,
+           (unsigned long long)s.discontinuities);
+
+    /*
+     * A gated producer never overflows the ring, so nothing may be lost. A
+     * paced producer drops frames once the ring is full.
+     */
+    if (sc->gated) {
+        assert(s.discontinuities == 0);
+    }
+    if (sc->stall_ms) {
+        assert(s.underruns_second_half <= s.underruns_first_half);
+        assert(stats.target > MIN_LATENCY);
+    }
+    if (sc->drift_comp) {
+        assert(stats.rate > 1.0f);
+    }
+
+    mcpx_audio_ring_destroy(&s.ring);
+    pthread_cond_destroy(&s.cond);
+    pthread_mutex_destroy(&s.lock);
+}
+
+static const Scenario scenarios[] = {
+    { .name = "gated", .gated = true },
+    { .name = "gated, stalls", .gated = true, .stall_ms = 30,
+      .stall_period_ms = 1000 },
+    { .name = "paced +0.4%", .drift = 0.004 },
+    { .name = "paced +0.4%, drift comp", .drift = 0.004, .drift_comp = true },
+};
+
+static void measure(bool use_sdl)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(scenarios); i++) {
+        run_scenario(&scenarios[i], use_sdl);
+    }
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *times)
+{
+    qsort(times, NUM_ITERATIONS, sizeof(times[0]), cmp_double);
+    double avg = 0;
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        avg += times[i];
+    }
+    avg /= NUM_ITERATIONS;
+    printf("%-24s ns/frame min %.1f max %.1f avg %.1f med %.1f\n", name,
+           times[0], times[NUM_ITERATIONS - 1], avg,
+           times[NUM_ITERATIONS / 2]);
+}
+
+static void bench(void)
+{
+    MCPXAudioRing r;
+    static int16_t frame[EP_FRAME_SAMPLES][2], out[EP_FRAME_SAMPLES][2];
+    double times[NUM_ITERATIONS];
+    volatile int16_t sink = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        mcpx_audio_ring_init(&r, RING_SIZE, MIN_LATENCY, MAX_LATENCY,
+                             EP_FRAME_SIZE, SHRINK_AFTER);
+        mcpx_audio_ring_set_drift_compensation(&r, pass);
+        for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+            double start = now_us();
+            for (int f = 0; f < NUM_FRAMES; f++) {
+                while (mcpx_audio_ring_needs_data(&r)) {
+                    mcpx_audio_ring_write(&r, frame, sizeof(frame));
+                }
+                mcpx_audio_ring_read(&r, out, sizeof(out));
+                sink += out[f % EP_FRAME_SAMPLES][0];
+            }
+            times[iter] = (now_us() - start) * 1e3 / NUM_FRAMES;
+        }
+        report(pass ? "write+read (drift comp)" : "write+read", times);
+        mcpx_audio_ring_destroy(&r);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    crosscheck_fifo();
+    crosscheck_latency();
+    crosscheck_resample();
+    bench();
+
+#ifdef USE_SDL
+    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    printf("SDL audio driver: %s\n", SDL_GetCurrentAudioDriver());
+    measure(true);
+    SDL_Quit();
+#else
+    measure(false);
+#endif
+
+    return 0;
+}
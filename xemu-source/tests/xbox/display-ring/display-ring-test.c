@@ -0,0 +1,348 @@
+/*
+ * Test and measure the hand-off of display images to the UI.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "qemu/osdep.h"
+#include "display_ring.h"
+
+#define UI_FRAMES 120
+#define UI_PERIOD_NS 16666667LL
+
+/* As DISPLAY_SYNC_BUDGET_NS in pgraph.c */
+#define SYNC_BUDGET_NS 4000000LL
+
+/* Time spent compositing the image and the overlay */
+#define COMPOSITE_NS 300000
+
+/* The renderer only looks for requests between batches of guest work */
+#define BATCH_MIN_NS 50000
+#define BATCH_MAX_NS 8000000
+
+/* Drawing the display surface into a presentable image */
+#define RENDER_DISPLAY_NS 150000
+
+/* A guest running a little slower than the UI, so the two drift in phase */
+#define GUEST_PERIOD_NS 16683333LL
+
+/* Scheduling noise allowed on the single worst frame */
+#define LATENCY_SLACK_NS 1000000LL
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void spin_ns(int64_t ns)
+{
+    int64_t end = now_ns() + ns;
+    while (now_ns() < end) {
+    }
+}
+
+static void sleep_until(int64_t deadline)
+{
+    int64_t ns = deadline - now_ns();
+    if (ns > 0) {
+        struct timespec ts = { ns / 1000000000LL, ns % 1000000000LL };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void ordering(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    DisplayRing r;
+    DisplayRingStats s;
+
+    display_ring_init(&r);
+    assert(!display_ring_has_frame(&r));
+    assert(display_ring_acquire(&r) == NULL);
+
+    /* Three distinct slots at all times */
+    int back = display_ring_back(&r);
+    r.slots[back].texture = 1;
+    display_ring_publish(&r, 1000);
+    assert(display_ring_has_frame(&r) && display_ring_has_new_frame(&r));
+    assert(display_ring_back(&r) != back);
+
+    DisplayRingSlot *slot = display_ring_acquire(&r);
+    assert(slot && slot->texture == 1);
+    assert(display_ring_back(&r) != slot - r.slots);
+
+    /* Nothing new: the same image again */
+    assert(!display_ring_has_new_frame(&r));
+    assert(display_ring_acquire(&r) == slot);
+    display_ring_presented(&r, 1500);
+    display_ring_presented(&r, 9000);
+
+    /* Two frames before the UI looks: the first is dropped */
+    r.slots[display_ring_back(&r)].texture = 2;
+    display_ring_publish(&r, 2000);
+    assert(display_ring_back(&r) != slot - r.slots);
+    r.slots[display_ring_back(&r)].texture = 3;
+    display_ring_publish(&r, 3000);
+    assert(display_ring_back(&r) != slot - r.slots);
+
+    slot = display_ring_acquire(&r);
+    assert(slot->texture == 3);
+    display_ring_presented(&r, 3250);
+
+    display_ring_get_stats(&r, &s);
+    assert(s.published == 3 && s.dropped == 1);
+    assert(s.acquired == 2 && s.repeated == 1);
+    assert(s.presented == 2);
+    assert(s.latency_ns == 750 && s.latency_max_ns == 500);
+
+    /* Images go, stats stay */
+    display_ring_reset(&r);
+    assert(!display_ring_has_frame(&r));
+    display_ring_get_stats(&r, &s);
+    assert(s.published == 3);
+
+    fprintf(stderr, "ok!\n");
+}
+
+/*
+ * A guest flipping to a new frame at about 60 Hz, a renderer working
+ * through guest batches, and a UI thread compositing at 60 Hz. Before, the
+ * UI asked for the display and waited until the renderer had drawn it,
+ * however long that took. Now the renderer draws each flipped frame into
+ * the ring as soon as it gets to it, and the UI takes it from there without
+ * waiting (as nv2a_get_framebuffer_surface() does). It only waits if the
+ * guest flipped since, and then as long as before.
+ *
+ * Latency is from the guest flipping to the frame shown to it being
+ * presented, i.e. how old the image on screen is.
+ */
+typedef struct Bench {
+    bool ring;
+    bool stop;
+    bool pending;          /* As sync_pending */
+    uint32_t flips;        /* As display_flips */
+    uint32_t flips_drawn;  /* As display_flips_drawn */
+    int64_t flip_ns;
+    pthread_mutex_t lock;  /* As sync_lock */
+    pthread_cond_t cond;   /* As sync_complete */
+    DisplayRing r;
+    int64_t flip_shown_ns[DISPLAY_RING_SIZE];
+    uint32_t held[DISPLAY_RING_SIZE];
+    uint32_t next_texture;
+    uint64_t overwritten;
+    uint64_t late;
+    int64_t stall_ns, stall_max_ns;
+    int64_t latency_ns, latency_max_ns;
+} Bench;
+
+static bool bench_flip_pending(Bench *b)
+{
+    return __atomic_load_n(&b->flips, __ATOMIC_ACQUIRE) !=
+           __atomic_load_n(&b->flips_drawn, __ATOMIC_ACQUIRE);
+}
+
+static void *guest_thread(void *opaque)
+{
+    Bench *b = opaque;
+    int64_t next = now_ns();
+
+    while (!__atomic_load_n(&b->stop, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&b->flip_ns, now_ns(), __ATOMIC_RELEASE);
+        __atomic_fetch_add(&b->flips, 1, __ATOMIC_RELEASE);
+        next += GUEST_PERIOD_NS;
+        sleep_until(next);
+    }
+    return NULL;
+}
+
+static void *render_thread(void *opaque)
+{
+    Bench *b = opaque;
+
+    while (!__atomic_load_n(&b->stop, __ATOMIC_RELAXED)) {
+        spin_ns(BATCH_MIN_NS + rand() % (BATCH_MAX_NS - BATCH_MIN_NS));
+
+        if (!__atomic_load_n(&b->pending, __ATOMIC_ACQUIRE) &&
+            !(b->ring && bench_flip_pending(b))) {
+            continue;
+        }
+
+        uint32_t drawing = __atomic_load_n(&b->flips, __ATOMIC_ACQUIRE);
+        int back = display_ring_back(&b->r);
+        if (__atomic_load_n(&b->held[back], __ATOMIC_ACQUIRE)) {
+            __atomic_fetch_add(&b->overwritten, 1, __ATOMIC_RELAXED);
+        }
+        b->flip_shown_ns[back] = __atomic_load_n(&b->flip_ns, __ATOMIC_ACQUIRE);
+        spin_ns(RENDER_DISPLAY_NS);
+        b->r.slots[back].texture = ++b->next_texture;
+
+        if (b->ring) {
+            display_ring_publish(&b->r, now_ns());
+        }
+
+        pthread_mutex_lock(&b->lock);
+        __atomic_store_n(&b->flips_drawn, drawing, __ATOMIC_RELEASE);
+        __atomic_store_n(&b->pending, false, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+    }
+    return NULL;
+}
+
+/* Returns the slot to show, as nv2a_get_framebuffer_surface() */
+static int bench_get_display(Bench *b)
+{
+    if (!b->ring) {
+        __atomic_store_n(&b->pending, true, __ATOMIC_RELEASE);
+        pthread_mutex_lock(&b->lock);
+        while (__atomic_load_n(&b->pending, __ATOMIC_ACQUIRE)) {
+            pthread_cond_wait(&b->cond, &b->lock);
+        }
+        pthread_mutex_unlock(&b->lock);
+        return display_ring_back(&b->r);
+    }
+
+    if (!bench_flip_pending(b) && display_ring_has_new_frame(&b->r)) {
+        return display_ring_acquire(&b->r) - b->r.slots;
+    }
+
+    /* As pgraph_wait_display() */
+    bool wait_all = !display_ring_has_frame(&b->r) || bench_flip_pending(b);
+    int64_t deadline = now_ns() + SYNC_BUDGET_NS;
+    struct timespec ts = { deadline / 1000000000LL, deadline % 1000000000LL };
+
+    __atomic_store_n(&b->pending, true, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&b->lock);
+    while (__atomic_load_n(&b->pending, __ATOMIC_ACQUIRE)) {
+        if (wait_all) {
+            pthread_cond_wait(&b->cond, &b->lock);
+        } else if (pthread_cond_timedwait(&b->cond, &b->lock, &ts)) {
+            b->late++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    return display_ring_acquire(&b->r) - b->r.slots;
+}
+
+static void bench_run(Bench *b)
+{
+    pthread_t guest, render;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&b->cond, &attr);
+    pthread_mutex_init(&b->lock, NULL);
+
+    /* Both runs see the same guest batches */
+    srand(1337);
+
+    display_ring_init(&b->r);
+    assert(!pthread_create(&guest, NULL, guest_thread, b));
+    assert(!pthread_create(&render, NULL, render_thread, b));
+
+    int64_t next = now_ns() + UI_PERIOD_NS / 2;
+    sleep_until(next);
+    for (int i = 0; i < UI_FRAMES; i++) {
+        int64_t start = now_ns();
+        int index = bench_get_display(b);
+
+        int64_t stall = now_ns() - start;
+        b->stall_ns += stall;
+        b->stall_max_ns = MAX(b->stall_max_ns, stall);
+
+        /* Sample the image */
+        __atomic_store_n(&b->held[index], 1, __ATOMIC_RELEASE);
+        uint32_t texture = b->r.slots[index].texture;
+        int64_t flip_ns = b->flip_shown_ns[index];
+        spin_ns(COMPOSITE_NS);
+        if (b->r.slots[index].texture != texture) {
+            __atomic_fetch_add(&b->overwritten, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&b->held[index], 0, __ATOMIC_RELEASE);
+
+        int64_t now = now_ns();
+        int64_t latency = now - flip_ns;
+        if (b->ring) {
+            display_ring_presented(&b->r, now);
+        }
+        b->latency_ns += latency;
+        b->latency_max_ns = MAX(b->latency_max_ns, latency);
+
+        next += UI_PERIOD_NS;
+        sleep_until(next);
+    }
+
+    __atomic_store_n(&b->stop, true, __ATOMIC_RELAXED);
+    pthread_join(render, NULL);
+    pthread_join(guest, NULL);
+}
+
+static void handoff(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    Bench before = { .ring = false };
+    Bench after = { .ring = true };
+
+    bench_run(&before);
+    bench_run(&after);
+
+    DisplayRingStats s;
+    display_ring_get_stats(&after.r, &s);
+
+    fprintf(stderr, "  %-8s %12s %12s %12s %12s\n", "", "UI wait",
+            "max wait", "latency", "max latency");
+    fprintf(stderr, "  %-8s %9.3f ms %9.3f ms %9.3f ms %9.3f ms\n", "before",
+            before.stall_ns / 1e6 / UI_FRAMES, before.stall_max_ns / 1e6,
+            before.latency_ns / 1e6 / UI_FRAMES, before.latency_max_ns / 1e6);
+    fprintf(stderr, "  %-8s %9.3f ms %9.3f ms %9.3f ms %9.3f ms\n", "ring",
+            after.stall_ns / 1e6 / UI_FRAMES, after.stall_max_ns / 1e6,
+            after.latency_ns / 1e6 / UI_FRAMES, after.latency_max_ns / 1e6);
+    fprintf(stderr, "  %llu published, %llu dropped, %llu repeated, "
+            "%llu past the budget\n",
+            (unsigned long long)s.published, (unsigned long long)s.dropped,
+            (unsigned long long)s.repeated, (unsigned long long)after.late);
+
+    /* The renderer never drew into an image the UI was sampling */
+    assert(after.overwritten == 0);
+    assert(s.acquired + s.repeated == UI_FRAMES);
+    assert(s.presented == s.acquired);
+
+    /* Less time waiting, and the image shown is no older than before */
+    assert(after.stall_ns < before.stall_ns);
+    assert(after.latency_ns <= before.latency_ns);
+    assert(after.latency_max_ns <= before.latency_max_ns + LATENCY_SLACK_NS);
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    ordering();
+    handoff();
+
+    return 0;
+}
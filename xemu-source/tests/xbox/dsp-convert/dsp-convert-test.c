@@ -0,0 +1,295 @@
+/*
+ * Crosscheck and benchmark DSP sample format conversion.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hw/xbox/mcpx/apu/fpconv.h"
+#include "hw/xbox/mcpx/apu/dsp/dsp_convert.h"
+
+#define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
+
+#define NUM_MIXBINS 32
+#define NUM_SAMPLES_PER_FRAME 32
+#define NUM_FRAMES 10000
+#define NUM_ITERATIONS 10
+
+/* Bit patterns are sampled with this step; it is odd so every alignment and
+ * tail length of the vector loop is exercised. */
+#define PATTERN_STEP 13
+#define PATTERN_BATCH 1021
+
+static float float_from_bits(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static void check_float_to_24b(const float *src, size_t count)
+{
+    uint32_t actual[PATTERN_BATCH];
+    assert(count <= ARRAY_SIZE(actual));
+
+    dsp_convert_float_to_24b(actual, src, count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t expected = float_to_24b(src[i]);
+        if (actual[i] != expected) {
+            fprintf(stderr, "\nMismatch for %a (0x%08x): 0x%06x != 0x%06x\n",
+                    src[i], *(uint32_t *)&src[i], actual[i], expected);
+            assert(0);
+        }
+    }
+}
+
+static void crosscheck_float_to_24b(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    static const float edges[] = {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -0.5f,
+        8388606.5f / 8388608.0f, 8388607.0f / 8388608.0f,
+        -8388607.5f / 8388608.0f, -8388608.0f / 8388608.0f,
+        1.0f / 16777216.0f, 3.0f / 16777216.0f, -1.0f / 16777216.0f,
+        -3.0f / 16777216.0f, 2.0f, -2.0f, 1e30f, -1e30f, 3.4e38f, -3.4e38f,
+        1e-40f, -1e-40f, INFINITY, -INFINITY, NAN, -NAN,
+    };
+    for (size_t len = 0; len <= ARRAY_SIZE(edges); len++) {
+        check_float_to_24b(edges, len);
+        check_float_to_24b(edges + ARRAY_SIZE(edges) - len, len);
+    }
+
+    float src[PATTERN_BATCH];
+    size_t n = 0;
+    for (uint64_t bits = 0; bits <= UINT32_MAX; bits += PATTERN_STEP) {
+        src[n++] = float_from_bits(bits);
+        if (n == ARRAY_SIZE(src)) {
+            check_float_to_24b(src, n);
+            n = 0;
+        }
+    }
+    check_float_to_24b(src, n);
+
+    fprintf(stderr, "ok\n");
+}
+
+static void crosscheck_24b_to_s16(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    uint32_t left[PATTERN_BATCH], right[PATTERN_BATCH];
+    int16_t actual[PATTERN_BATCH + 1][2];
+
+    srand(1);
+    for (int iter = 0; iter < 1000; iter++) {
+        size_t count = rand() % PATTERN_BATCH;
+        for (size_t i = 0; i < count; i++) {
+            left[i] = rand() ^ (rand() << 16);
+            right[i] = rand() ^ (rand() << 16);
+            if (iter & 1) {
+                left[i] &= 0xffffff;
+                right[i] &= 0xffffff;
+            }
+        }
+        memset(actual, 0x55, sizeof(actual));
+        dsp_convert_24b_to_s16_stereo(&actual[0][0], left, right, count);
+        for (size_t i = 0; i < count; i++) {
+            assert(actual[i][0] == (int16_t)(left[i] >> 8));
+            assert(actual[i][1] == (int16_t)(right[i] >> 8));
+        }
+        assert(actual[count][0] == 0x5555 && actual[count][1] == 0x5555);
+    }
+
+    fprintf(stderr, "ok\n");
+}
+
+static void crosscheck_dma_kernels(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    static uint32_t src[16 * PATTERN_BATCH];
+    static uint32_t actual32[16 * PATTERN_BATCH + 1];
+    static int16_t actual16[16 * PATTERN_BATCH + 1];
+    static int16_t samples[PATTERN_BATCH];
+
+    srand(1);
+    for (int iter = 0; iter < 1000; iter++) {
+        size_t count = rand() % PATTERN_BATCH;
+        unsigned int channels = 1 + rand() % 16;
+        for (size_t i = 0; i < count * channels; i++) {
+            src[i] = rand() ^ (rand() << 16);
+            if (iter & 1) {
+                src[i] &= 0xffffff;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = rand();
+        }
+
+        memset(actual16, 0x55, sizeof(actual16));
+        dsp_convert_24b_to_s16(actual16, src, count);
+        for (size_t i = 0; i < count; i++) {
+            assert(actual16[i] == (int16_t)(src[i] >> 8));
+        }
+        assert(actual16[count] == 0x5555);
+
+        memset(actual32, 0x55, sizeof(actual32));
+        dsp_convert_s16_to_24b(actual32, samples, count);
+        for (size_t i = 0; i < count; i++) {
+            assert(actual32[i] == (uint32_t)(uint16_t)samples[i] << 8);
+        }
+        assert(actual32[count] == 0x55555555);
+
+        memset(actual32, 0x55, sizeof(actual32));
+        dsp_convert_mask_24b(actual32, src, count);
+        for (size_t i = 0; i < count; i++) {
+            assert(actual32[i] == (src[i] & 0xffffff));
+        }
+        assert(actual32[count] == 0x55555555);
+
+        size_t total = count * channels;
+
+        memset(actual16, 0x55, sizeof(actual16));
+        dsp_convert_interleave_24b_to_s16(actual16, src, count, channels);
+        for (size_t i = 0; i < count; i++) {
+            for (unsigned int ch = 0; ch < channels; ch++) {
+                assert(actual16[i * channels + ch] ==
+                       (int16_t)(src[ch * count + i] >> 8));
+            }
+        }
+        assert(actual16[total] == 0x5555);
+
+        memset(actual32, 0x55, sizeof(actual32));
+        dsp_convert_interleave_32(actual32, src, count, channels);
+        for (size_t i = 0; i < count; i++) {
+            for (unsigned int ch = 0; ch < channels; ch++) {
+                assert(actual32[i * channels + ch] == src[ch * count + i]);
+            }
+        }
+        assert(actual32[total] == 0x55555555);
+    }
+
+    fprintf(stderr, "ok\n");
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *times)
+{
+    qsort(times, NUM_ITERATIONS, sizeof(times[0]), cmp_double);
+    double avg = 0;
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        avg += times[i];
+    }
+    avg /= NUM_ITERATIONS;
+    printf("%-24s ns/frame min %.1f max %.1f avg %.1f med %.1f\n", name,
+           times[0], times[NUM_ITERATIONS - 1], avg,
+           times[NUM_ITERATIONS / 2]);
+}
+
+static void bench(void)
+{
+    static float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME];
+    static uint32_t mixbuf[NUM_MIXBINS * NUM_SAMPLES_PER_FRAME];
+    static int16_t monitor[NUM_SAMPLES_PER_FRAME][2];
+    double times[NUM_ITERATIONS];
+    volatile uint32_t sink = 0;
+
+    srand(1);
+    for (int b = 0; b < NUM_MIXBINS; b++) {
+        for (int s = 0; s < NUM_SAMPLES_PER_FRAME; s++) {
+            mixbins[b][s] = (rand() / (float)RAND_MAX) * 2.4f - 1.2f;
+        }
+    }
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        double start = now_us();
+        for (int f = 0; f < NUM_FRAMES; f++) {
+            for (int b = 0; b < NUM_MIXBINS; b++) {
+                for (int s = 0; s < NUM_SAMPLES_PER_FRAME; s++) {
+                    mixbuf[b * NUM_SAMPLES_PER_FRAME + s] =
+                        float_to_24b(mixbins[b][s]);
+                }
+            }
+            sink += mixbuf[f % ARRAY_SIZE(mixbuf)];
+        }
+        times[iter] = (now_us() - start) * 1e3 / NUM_FRAMES;
+    }
+    report("float_to_24b (scalar)", times);
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        double start = now_us();
+        for (int f = 0; f < NUM_FRAMES; f++) {
+            dsp_convert_float_to_24b(mixbuf, &mixbins[0][0],
+                                     ARRAY_SIZE(mixbuf));
+            sink += mixbuf[f % ARRAY_SIZE(mixbuf)];
+        }
+        times[iter] = (now_us() - start) * 1e3 / NUM_FRAMES;
+    }
+    report("float_to_24b (bulk)", times);
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        double start = now_us();
+        for (int f = 0; f < NUM_FRAMES; f++) {
+            for (int i = 0; i < NUM_SAMPLES_PER_FRAME; i++) {
+                monitor[i][0] = mixbuf[i] >> 8;
+                monitor[i][1] = mixbuf[NUM_SAMPLES_PER_FRAME + i] >> 8;
+            }
+            sink += monitor[f % NUM_SAMPLES_PER_FRAME][0];
+        }
+        times[iter] = (now_us() - start) * 1e3 / NUM_FRAMES;
+    }
+    report("24b_to_s16 (scalar)", times);
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        double start = now_us();
+        for (int f = 0; f < NUM_FRAMES; f++) {
+            dsp_convert_24b_to_s16_stereo(&monitor[0][0], mixbuf,
+                                          mixbuf + NUM_SAMPLES_PER_FRAME,
+                                          NUM_SAMPLES_PER_FRAME);
+            sink += monitor[f % NUM_SAMPLES_PER_FRAME][0];
+        }
+        times[iter] = (now_us() - start) * 1e3 / NUM_FRAMES;
+    }
+    report("24b_to_s16 (bulk)", times);
+}
+
+int main(int argc, char const *argv[])
+{
+    crosscheck_float_to_24b();
+    crosscheck_24b_to_s16();
+    crosscheck_dma_kernels();
+    bench();
+    return 0;
+}
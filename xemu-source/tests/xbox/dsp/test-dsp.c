@@ -18,7 +18,18 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "qemu/bswap.h"
 #include "hw/xbox/mcpx/apu/dsp/dsp.h"
+#include "hw/xbox/mcpx/apu/dsp/dsp_sg.h"
+#include "hw/xbox/mcpx/apu/dsp/dsp_state.h"
+
+#define SG_RAM_SIZE (16 * 1024 * 1024)
+#define SG_TABLE_BASE 0x1000
+#define SG_MAX_SGE 127
+#define SG_NUM_PAGES (SG_MAX_SGE + 1)
+#define SG_NUM_TRANSFERS 4096
+#define SG_NUM_ITERATIONS 10
 
 static void scratch_rw(void *opaque, uint8_t *ptr, uint32_t addr, size_t len, bool dir)
 {
@@ -74,11 +85,686 @@ static void test_dsp_basic(void)
     dsp_destroy(s);
 }
 
+/* dsp_run without idle loop skipping */
+static void ref_run(DSPState *s, int cycles)
+{
+    s->save_cycles += cycles;
+    if (s->save_cycles <= 0) {
+        return;
+    }
+
+    while (s->save_cycles > 0) {
+        dsp_step(s);
+        s->save_cycles -= s->core.instr_cycle;
+        s->core.cycle_count++;
+        if (s->core.is_idle) {
+            break;
+        }
+    }
+}
+
+static void idle_assert_equal(DSPState *a, DSPState *b)
+{
+    g_assert_cmphex(a->core.pc, ==, b->core.pc);
+    g_assert_cmpuint(a->core.cycle_count, ==, b->core.cycle_count);
+    g_assert_cmpuint(a->core.num_inst, ==, b->core.num_inst);
+    g_assert_cmpint(a->save_cycles, ==, b->save_cycles);
+    g_assert_cmpint(a->core.is_idle, ==, b->core.is_idle);
+    g_assert_cmpmem(a->core.registers, sizeof(a->core.registers),
+                    b->core.registers, sizeof(b->core.registers));
+    g_assert_cmphex(dsp_read_memory(a, 'X', 3), ==,
+                    dsp_read_memory(b, 'X', 3));
+}
+
+/*
+ * Polling loops are fast-forwarded to the end of the run, which must leave
+ * the core exactly where interpreting every iteration would have.
+ */
+static void test_dsp_idle_loop(void)
+{
+    static const int budgets[] = { 1, 7, 100, 1001, 4096, 50000 };
+    g_autofree gchar *path = g_test_build_filename(G_TEST_DIST, "data", "idle", NULL);
+
+    for (int i = 0; i < ARRAY_SIZE(budgets); i++) {
+        DSPState *ref = dsp_init(NULL, scratch_rw, fifo_rw);
+        DSPState *s = dsp_init(NULL, scratch_rw, fifo_rw);
+        load_prog(ref, path);
+        load_prog(s, path);
+
+        /* Spin waiting for the frame, possibly over several runs */
+        for (int run = 0; run < 3; run++) {
+            ref_run(ref, budgets[i]);
+            dsp_run(s, budgets[i]);
+            idle_assert_equal(s, ref);
+        }
+        g_assert_false(s->core.is_idle);
+
+        /* Count until the next frame, which must not be skipped */
+        dsp_start_frame(ref);
+        dsp_start_frame(s);
+        ref_run(ref, budgets[i]);
+        dsp_run(s, budgets[i]);
+        idle_assert_equal(s, ref);
+
+        /* Finish the frame */
+        for (int run = 0; run < 3 && !s->core.is_idle; run++) {
+            dsp_start_frame(ref);
+            dsp_start_frame(s);
+            ref_run(ref, budgets[i] + 100);
+            dsp_run(s, budgets[i] + 100);
+            idle_assert_equal(s, ref);
+        }
+        g_assert_true(s->core.is_idle);
+        g_assert_cmphex(dsp_read_memory(s, 'X', 3), !=, 0);
+
+        dsp_destroy(ref);
+        dsp_destroy(s);
+    }
+}
+
+/*
+ * Scatter-gather tables similar to those set up by the audio driver for
+ * GP/EP scratch and FIFO memory: mostly physically contiguous runs of a few
+ * pages, broken up where the allocator handed out discontiguous memory.
+ */
+static void sg_gen_table(uint8_t *ram, GRand *rand)
+{
+    uint32_t page = 0x100000;
+
+    for (int i = 0; i < SG_NUM_PAGES; i++) {
+        if (g_rand_int_range(rand, 0, 8) == 0) {
+            page = g_rand_int_range(rand, 0x100, SG_RAM_SIZE / 4096 - 1) * 4096;
+        }
+        if (page + DSP_SG_PAGE_SIZE >= SG_RAM_SIZE) {
+            page = 0x100000;
+        }
+        stl_le_p(ram + SG_TABLE_BASE + i * DSP_SG_ENTRY_SIZE, page);
+        stl_le_p(ram + SG_TABLE_BASE + i * DSP_SG_ENTRY_SIZE + 4, 0);
+        page += DSP_SG_PAGE_SIZE;
+    }
+}
+
+/* Previous implementation: one table lookup, copy and dirty mark per page */
+static void sg_ref_rw(uint8_t *ram, uint32_t sge_base, unsigned int max_sge,
+                      uint8_t *ptr, uint32_t addr, size_t len, bool dir,
+                      dsp_sg_dirty_func dirty, void *opaque)
+{
+    unsigned int page_entry = addr / DSP_SG_PAGE_SIZE;
+    unsigned int offset_in_page = addr % DSP_SG_PAGE_SIZE;
+    unsigned int bytes_to_copy = DSP_SG_PAGE_SIZE - offset_in_page;
+
+    while (len > 0) {
+        g_assert_cmpuint(page_entry, <=, max_sge);
+
+        uint32_t prd_address =
+            ldl_le_p(ram + sge_base + page_entry * DSP_SG_ENTRY_SIZE);
+        uint32_t paddr = prd_address + offset_in_page;
+
+        if (bytes_to_copy > len) {
+            bytes_to_copy = len;
+        }
+
+        if (dir) {
+            memcpy(&ram[paddr], ptr, bytes_to_copy);
+            dirty(opaque, paddr, bytes_to_copy);
+        } else {
+            memcpy(ptr, &ram[paddr], bytes_to_copy);
+        }
+
+        ptr += bytes_to_copy;
+        len -= bytes_to_copy;
+        page_entry += 1;
+        bytes_to_copy = DSP_SG_PAGE_SIZE;
+        offset_in_page = 0;
+    }
+}
+
+typedef struct SGDirty {
+    unsigned long *pages;
+    unsigned int calls;
+} SGDirty;
+
+static void sg_mark_dirty(void *opaque, uint32_t addr, size_t len)
+{
+    SGDirty *d = opaque;
+    for (uint32_t p = addr / 4096; p <= (addr + len - 1) / 4096; p++) {
+        d->pages[p / BITS_PER_LONG] |= 1UL << (p % BITS_PER_LONG);
+    }
+    d->calls++;
+}
+
+typedef struct SGTransfer {
+    uint32_t addr;
+    uint32_t len;
+    bool dir;
+} SGTransfer;
+
+static void sg_gen_transfers(SGTransfer *t, int count, GRand *rand)
+{
+    for (int i = 0; i < count; i++) {
+        t[i].len = g_rand_int_range(rand, 1, 4) * 0x400;
+        t[i].addr = g_rand_int_range(rand, 0,
+                                     SG_NUM_PAGES * DSP_SG_PAGE_SIZE -
+                                     t[i].len) & ~3;
+        t[i].dir = g_rand_boolean(rand);
+    }
+}
+
+static void test_dsp_sg_identical(void)
+{
+    g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+    g_autofree uint8_t *ram_ref = g_malloc0(SG_RAM_SIZE);
+    g_autofree uint8_t *ram = g_malloc0(SG_RAM_SIZE);
+    g_autofree SGTransfer *transfers = g_new(SGTransfer, SG_NUM_TRANSFERS);
+    size_t bitmap_size = BITS_TO_LONGS(SG_RAM_SIZE / 4096) * sizeof(long);
+    SGDirty dirty_ref = { g_malloc0(bitmap_size), 0 };
+    SGDirty dirty = { g_malloc0(bitmap_size), 0 };
+    uint8_t buf_ref[0x1000], buf[0x1000];
+
+    for (size_t i = 0; i < SG_RAM_SIZE; i += 4) {
+        stl_le_p(ram_ref + i, g_rand_int(rand));
+    }
+    sg_gen_table(ram_ref, rand);
+    memcpy(ram, ram_ref, SG_RAM_SIZE);
+    sg_gen_transfers(transfers, SG_NUM_TRANSFERS, rand);
+
+    DSPSGCache cache;
+    dsp_sg_cache_init(&cache);
+    g_assert_true(dsp_sg_cache_update(&cache, ram, SG_RAM_SIZE, SG_TABLE_BASE,
+                                      SG_MAX_SGE));
+    g_assert_false(dsp_sg_cache_update(&cache, ram, SG_RAM_SIZE,
+                                       SG_TABLE_BASE, SG_MAX_SGE));
+
+    for (int i = 0; i < SG_NUM_TRANSFERS; i++) {
+        SGTransfer *t = &transfers[i];
+        for (int j = 0; j < t->len; j++) {
+            buf_ref[j] = buf[j] = i + j;
+        }
+        sg_ref_rw(ram_ref, SG_TABLE_BASE, SG_MAX_SGE, buf_ref, t->addr,
+                  t->len, t->dir, sg_mark_dirty, &dirty_ref);
+        dsp_sg_rw(&cache, ram, SG_RAM_SIZE, buf, t->addr, t->len, t->dir,
+                  sg_mark_dirty, &dirty);
+        g_assert_cmpmem(buf, t->len, buf_ref, t->len);
+    }
+
+    g_assert_cmpmem(ram, SG_RAM_SIZE, ram_ref, SG_RAM_SIZE);
+    g_assert_cmpmem(dirty.pages, bitmap_size, dirty_ref.pages, bitmap_size);
+    g_assert_cmpuint(dirty.calls, <, dirty_ref.calls);
+
+    /* Table changes are only picked up after invalidation */
+    uint32_t moved = 0x200000;
+    stl_le_p(ram + SG_TABLE_BASE, moved);
+    dsp_sg_cache_invalidate(&cache);
+    g_assert_true(dsp_sg_cache_update(&cache, ram, SG_RAM_SIZE, SG_TABLE_BASE,
+                                      SG_MAX_SGE));
+    memset(buf, 0x5a, 16);
+    dsp_sg_rw(&cache, ram, SG_RAM_SIZE, buf, 0, 16, true, NULL, NULL);
+    g_assert_cmpmem(ram + moved, 16, buf, 16);
+
+    /* As is a different table location */
+    g_assert_true(dsp_sg_cache_update(&cache, ram, SG_RAM_SIZE,
+                                      SG_TABLE_BASE + DSP_SG_ENTRY_SIZE,
+                                      SG_MAX_SGE - 1));
+
+    dsp_sg_cache_finalize(&cache);
+    g_free(dirty_ref.pages);
+    g_free(dirty.pages);
+}
+
+static void sg_null_dirty(void *opaque, uint32_t addr, size_t len)
+{
+    (*(unsigned int *)opaque)++;
+}
+
+static void test_dsp_sg_bench(void)
+{
+    g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+    g_autofree uint8_t *ram = g_malloc0(SG_RAM_SIZE);
+    g_autofree SGTransfer *transfers = g_new(SGTransfer, SG_NUM_TRANSFERS);
+    uint8_t buf[0x1000] = { 0 };
+    unsigned int calls = 0;
+    size_t bytes = 0;
+
+    sg_gen_table(ram, rand);
+    sg_gen_transfers(transfers, SG_NUM_TRANSFERS, rand);
+    for (int i = 0; i < SG_NUM_TRANSFERS; i++) {
+        bytes += transfers[i].len;
+    }
+
+    DSPSGCache cache;
+    dsp_sg_cache_init(&cache);
+
+    double ref_min = G_MAXDOUBLE, new_min = G_MAXDOUBLE;
+
+    for (int iter = 0; iter < SG_NUM_ITERATIONS; iter++) {
+        g_test_timer_start();
+        for (int i = 0; i < SG_NUM_TRANSFERS; i++) {
+            SGTransfer *t = &transfers[i];
+            sg_ref_rw(ram, SG_TABLE_BASE, SG_MAX_SGE, buf, t->addr, t->len,
+                      t->dir, sg_null_dirty, &calls);
+        }
+        ref_min = MIN(ref_min, g_test_timer_elapsed());
+
+        g_test_timer_start();
+        dsp_sg_cache_invalidate(&cache);
+        for (int i = 0; i < SG_NUM_TRANSFERS; i++) {
+            SGTransfer *t = &transfers[i];
+            dsp_sg_cache_update(&cache, ram, SG_RAM_SIZE, SG_TABLE_BASE,
+                                SG_MAX_SGE);
+            dsp_sg_rw(&cache, ram, SG_RAM_SIZE, buf, t->addr, t->len, t->dir,
+                      sg_null_dirty, &calls);
+        }
+        new_min = MIN(new_min, g_test_timer_elapsed());
+    }
+
+    dsp_sg_cache_finalize(&cache);
+
+    g_test_minimized_result(new_min * 1e9 / SG_NUM_TRANSFERS,
+                            "cached: %.1f MiB/s (reference %.1f MiB/s)",
+                            bytes / new_min / (1024 * 1024),
+                            bytes / ref_min / (1024 * 1024));
+}
+
+#define DMA_SCRATCH_SIZE (64 * 1024)
+#define DMA_FIFO_SIZE (64 * 1024)
+#define DMA_NODE_ADDR 0x100
+#define DMA_NUM_TRANSFERS 2000
+#define DMA_NUM_ITERATIONS 10
+
+#define DMA_CONTROL_START 1
+#define DMA_NODE_EOL (1 << 14)
+#define DMA_CTL_INTERLEAVE (1 << 0)
+#define DMA_CTL_TO_BUFFER (1 << 1)
+#define DMA_CTL_WRITEBACK (1 << 4)
+#define DMA_CTL_BUF(id) ((id) << 5)
+#define DMA_CTL_FORMAT(f) ((f) << 10)
+
+typedef struct DMABuffers {
+    uint8_t scratch[DMA_SCRATCH_SIZE];
+    uint8_t fifo[4][DMA_FIFO_SIZE];
+    size_t fifo_len[4];
+} DMABuffers;
+
+static void dma_scratch_rw(void *opaque, uint8_t *ptr, uint32_t addr,
+                           size_t len, bool dir)
+{
+    DMABuffers *b = opaque;
+    g_assert_cmpuint(addr + len, <=, DMA_SCRATCH_SIZE);
+    if (dir) {
+        memcpy(&b->scratch[addr], ptr, len);
+    } else {
+        memcpy(ptr, &b->scratch[addr], len);
+    }
+}
+
+static void dma_fifo_rw(void *opaque, uint8_t *ptr, unsigned int index,
+                        size_t len, bool dir)
+{
+    DMABuffers *b = opaque;
+    g_assert_true(dir);
+    g_assert_cmpuint(index, <, 4);
+
+    /* Keep the most recent output for each FIFO, wrapping as needed */
+    for (size_t i = 0; i < len; i++) {
+        b->fifo[index][b->fifo_len[index]++ % DMA_FIFO_SIZE] = ptr[i];
+    }
+}
+
+static char dma_space(uint32_t addr, uint32_t *offset)
+{
+    if (addr < 0x1800) {
+        *offset = addr;
+        return 'X';
+    } else if (addr < 0x2000) {
+        *offset = addr - 0x1800;
+        return 'Y';
+    }
+    *offset = addr - 0x2800;
+    return 'P';
+}
+
+static void ref_scratch_circular_copy(DMABuffers *b, uint32_t scratch_base,
+                                      uint32_t *scratch_offset,
+                                      uint32_t scratch_size,
+                                      uint32_t transfer_size,
+                                      uint8_t *scratch_buf, int direction)
+{
+    if (*scratch_offset >= scratch_size) {
+        *scratch_offset = 0;
+    }
+
+    uint32_t buf_offset = 0;
+
+    while (transfer_size > 0) {
+        size_t bytes_until_wrap = scratch_size - *scratch_offset;
+        size_t chunk_size = MIN(transfer_size, bytes_until_wrap);
+        uint32_t scratch_addr = scratch_base + *scratch_offset;
+
+        dma_scratch_rw(b, &scratch_buf[buf_offset], scratch_addr, chunk_size,
+                       direction);
+
+        *scratch_offset += chunk_size;
+        if (*scratch_offset >= scratch_size) {
+            *scratch_offset = 0;
+        }
+
+        transfer_size -= chunk_size;
+        buf_offset += chunk_size;
+    }
+}
+
+/* Previous implementation: per-word DSP memory access for one node */
+static void ref_dma_node(DSPState *s, DMABuffers *b, uint32_t node_addr)
+{
+    uint32_t block_addr;
+    char block_space = dma_space(node_addr, &block_addr);
+
+    uint32_t control = dsp_read_memory(s, block_space, block_addr + 1);
+    uint32_t count = dsp_read_memory(s, block_space, block_addr + 2);
+    uint32_t dsp_offset = dsp_read_memory(s, block_space, block_addr + 3);
+    uint32_t scratch_offset = dsp_read_memory(s, block_space, block_addr + 4);
+    uint32_t scratch_base = dsp_read_memory(s, block_space, block_addr + 5);
+    uint32_t scratch_size = dsp_read_memory(s, block_space, block_addr + 6) + 1;
+
+    bool dsp_interleave = control & DMA_CTL_INTERLEAVE;
+    bool direction = control & DMA_CTL_TO_BUFFER;
+    bool buffer_offset_writeback = control & DMA_CTL_WRITEBACK;
+    uint32_t buf_id = (control >> 5) & 0xf;
+    uint32_t format = (control >> 10) & 0x7;
+    uint32_t channel_count = (count & 0xF) + 1;
+    uint32_t block_count = count >> 4;
+    unsigned int item_size = format == 1 ? 2 : 4;
+    uint32_t item_mask = format == 1 ? 0xffff : 0xffffff;
+
+    size_t scratch_addr = scratch_base + scratch_offset;
+    uint32_t mem_address;
+    char mem_space = dma_space(dsp_offset, &mem_address);
+    size_t transfer_size = count * item_size;
+    g_autofree uint8_t *scratch_buf = g_malloc(count * item_size);
+
+    if (direction) {
+        if (dsp_interleave) {
+            transfer_size = block_count * item_size * channel_count;
+            for (int i = 0; i < block_count; i++) {
+                for (int ch = 0; ch < channel_count; ch++) {
+                    uint32_t v = dsp_read_memory(s, mem_space,
+                        mem_address + ch * block_count + i);
+                    if (item_size == 2) {
+                        *(uint16_t *)(scratch_buf + i * 2 * channel_count +
+                                      ch * 2) = v >> 8;
+                    } else {
+                        *(uint32_t *)(scratch_buf + i * 4 * channel_count +
+                                      ch * 4) = v;
+                    }
+                }
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                uint32_t v = dsp_read_memory(s, mem_space, mem_address + i);
+                if (item_size == 2) {
+                    *(uint16_t *)(scratch_buf + i * 2) = v >> 8;
+                } else {
+                    *(uint32_t *)(scratch_buf + i * 4) = v;
+                }
+            }
+        }
+
+        if (buf_id < 4) {
+            dma_fifo_rw(b, scratch_buf, buf_id, transfer_size, 1);
+        } else if (buf_id == 0xE) {
+            ref_scratch_circular_copy(b, scratch_base, &scratch_offset,
+                                      scratch_size, transfer_size,
+                                      scratch_buf, 1);
+        } else {
+            dma_scratch_rw(b, scratch_buf, scratch_addr, transfer_size, 1);
+        }
+    } else {
+        if (buf_id == 0xE) {
+            ref_scratch_circular_copy(b, scratch_base, &scratch_offset,
+                                      scratch_size, transfer_size,
+                                      scratch_buf, 0);
+        } else {
+            dma_scratch_rw(b, scratch_buf, scratch_addr, transfer_size, 0);
+        }
+
+        for (int i = 0; i < count; i++) {
+            uint32_t v;
+            if (item_size == 2) {
+                v = *(uint16_t *)(scratch_buf + i * 2) << 8;
+            } else {
+                v = (*(uint32_t *)(scratch_buf + i * 4)) & item_mask;
+            }
+            dsp_write_memory(s, mem_space, mem_address + i, v);
+        }
+    }
+
+    if (buffer_offset_writeback) {
+        dsp_write_memory(s, block_space, block_addr + 4, scratch_offset);
+    }
+}
+
+static void dma_run_node(DSPState *s)
+{
+    dsp_write_memory(s, 'X', 0xFFFFD4, DMA_NODE_ADDR);
+    dsp_write_memory(s, 'X', 0xFFFFD6, DMA_CONTROL_START);
+}
+
+static void dma_write_node(DSPState *s, uint32_t control, uint32_t count,
+                           uint32_t dsp_offset, uint32_t scratch_offset,
+                           uint32_t scratch_base, uint32_t scratch_size)
+{
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 0, DMA_NODE_EOL);
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 1, control);
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 2, count);
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 3, dsp_offset);
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 4, scratch_offset);
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 5, scratch_base);
+    dsp_write_memory(s, 'X', DMA_NODE_ADDR + 6, scratch_size - 1);
+}
+
+/* X memory is backed by RAM below 0x1000 and the mixbuffer from 0x1400 */
+static bool dma_x_valid(uint32_t addr)
+{
+    return addr < 0x1000 || (addr >= 0x1400 && addr < 0x1800);
+}
+
+static void dma_fill_memory(DSPState *s, GRand *rand)
+{
+    for (uint32_t a = DMA_NODE_ADDR + 8; a < 0x1800; a++) {
+        if (dma_x_valid(a)) {
+            dsp_write_memory(s, 'X', a, g_rand_int(rand) & 0xffffff);
+        }
+    }
+    for (uint32_t a = 0; a < 0x800; a++) {
+        dsp_write_memory(s, 'Y', a, g_rand_int(rand) & 0xffffff);
+    }
+    for (uint32_t a = 0; a < 0x1000; a++) {
+        dsp_write_memory(s, 'P', a, g_rand_int(rand) & 0xffffff);
+    }
+}
+
+static void dma_assert_memory_equal(DSPState *a, DSPState *b)
+{
+    for (uint32_t addr = 0; addr < 0x1800; addr++) {
+        if (dma_x_valid(addr)) {
+            g_assert_cmphex(dsp_read_memory(a, 'X', addr), ==,
+                            dsp_read_memory(b, 'X', addr));
+        }
+    }
+    for (uint32_t addr = 0; addr < 0x800; addr++) {
+        g_assert_cmphex(dsp_read_memory(a, 'Y', addr), ==,
+                        dsp_read_memory(b, 'Y', addr));
+    }
+    for (uint32_t addr = 0; addr < 0x1000; addr++) {
+        g_assert_cmphex(dsp_read_memory(a, 'P', addr), ==,
+                        dsp_read_memory(b, 'P', addr));
+    }
+}
+
+static void test_dsp_dma_identical(void)
+{
+    static const uint32_t formats[] = { 1, 2, 6 };
+    static const uint32_t to_bufs[] = { 0, 1, 2, 3, 0xE, 0xF };
+    static const uint32_t regions[][2] = {
+        { DMA_NODE_ADDR + 8, 0x1000 }, /* X, aliasing the mixbuffer at 0xc00 */
+        { 0x1400, 0x1800 },            /* X mixbuffer */
+        { 0x1800, 0x2000 },            /* Y */
+        { 0x2800, 0x3800 },            /* P */
+    };
+
+    g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+    g_autofree DMABuffers *bufs_ref = g_new0(DMABuffers, 1);
+    g_autofree DMABuffers *bufs = g_new0(DMABuffers, 1);
+    DSPState *ref = dsp_init(bufs_ref, dma_scratch_rw, dma_fifo_rw);
+    DSPState *s = dsp_init(bufs, dma_scratch_rw, dma_fifo_rw);
+
+    for (size_t i = 0; i < DMA_SCRATCH_SIZE; i += 4) {
+        stl_le_p(bufs_ref->scratch + i, g_rand_int(rand));
+    }
+    memcpy(bufs->scratch, bufs_ref->scratch, DMA_SCRATCH_SIZE);
+
+    g_autoptr(GRand) mem_rand = g_rand_new_with_seed(2);
+    dma_fill_memory(ref, mem_rand);
+    g_rand_set_seed(mem_rand, 2);
+    dma_fill_memory(s, mem_rand);
+
+    for (int t = 0; t < DMA_NUM_TRANSFERS; t++) {
+        /* Cycle through every format, direction, interleave and buffer */
+        uint32_t format = formats[t % ARRAY_SIZE(formats)];
+        bool to_buffer = (t / 3) % 2;
+        bool interleave = to_buffer && (t / 6) % 2;
+        uint32_t buf_id = to_buffer ? to_bufs[(t / 12) % 6] :
+                                      ((t / 12) % 2 ? 0xE : 0xF);
+        const uint32_t *region = regions[g_rand_int_range(rand, 0, 4)];
+
+        uint32_t count;
+        if (interleave) {
+            uint32_t channels = g_rand_int_range(rand, 1, 17);
+            uint32_t blocks = g_rand_int_range(rand, 0, 64);
+            count = (blocks << 4) | (channels - 1);
+        } else {
+            count = g_rand_int_range(rand, 1, 0x400);
+        }
+        uint32_t dsp_offset = g_rand_int_range(rand, region[0],
+                                               region[1] - count);
+
+        uint32_t item_size = format == 1 ? 2 : 4;
+        uint32_t len = count * item_size;
+        uint32_t scratch_base, scratch_size, scratch_offset;
+        if (buf_id == 0xE) {
+            scratch_base = g_rand_int_range(rand, 0, DMA_SCRATCH_SIZE / 2) & ~3;
+            scratch_size = g_rand_int_range(rand, 4, DMA_SCRATCH_SIZE -
+                                            scratch_base) & ~3;
+            scratch_offset = g_rand_int_range(rand, 0, scratch_size + 8) & ~3;
+        } else {
+            scratch_base = g_rand_int_range(rand, 0,
+                                            DMA_SCRATCH_SIZE - len) & ~3;
+            scratch_size = 1;
+            scratch_offset = g_rand_int_range(rand, 0, DMA_SCRATCH_SIZE -
+                                              scratch_base - len + 1) & ~3;
+        }
+
+        uint32_t control = DMA_CTL_BUF(buf_id) | DMA_CTL_FORMAT(format) |
+                           (to_buffer ? DMA_CTL_TO_BUFFER : 0) |
+                           (interleave ? DMA_CTL_INTERLEAVE : 0) |
+                           (g_rand_boolean(rand) ? DMA_CTL_WRITEBACK : 0);
+
+        dma_write_node(ref, control, count, dsp_offset, scratch_offset,
+                       scratch_base, scratch_size);
+        dma_write_node(s, control, count, dsp_offset, scratch_offset,
+                       scratch_base, scratch_size);
+
+        ref_dma_node(ref, bufs_ref, DMA_NODE_ADDR);
+        dma_run_node(s);
+
+        g_assert_cmphex(dsp_read_memory(s, 'X', DMA_NODE_ADDR + 4), ==,
+                        dsp_read_memory(ref, 'X', DMA_NODE_ADDR + 4));
+    }
+
+    dma_assert_memory_equal(s, ref);
+    g_assert_cmpmem(bufs->scratch, DMA_SCRATCH_SIZE, bufs_ref->scratch,
+                    DMA_SCRATCH_SIZE);
+    for (int i = 0; i < 4; i++) {
+        g_assert_cmpuint(bufs->fifo_len[i], ==, bufs_ref->fifo_len[i]);
+        g_assert_cmpmem(bufs->fifo[i], DMA_FIFO_SIZE, bufs_ref->fifo[i],
+                        DMA_FIFO_SIZE);
+    }
+
+    dsp_destroy(ref);
+    dsp_destroy(s);
+}
+
+static void test_dsp_dma_bench(void)
+{
+    static const struct {
+        const char *name;
+        uint32_t control;
+        uint32_t count;
+    } cases[] = {
+        { "16-bit stereo to FIFO",
+          DMA_CTL_TO_BUFFER | DMA_CTL_INTERLEAVE | DMA_CTL_BUF(0) |
+          DMA_CTL_FORMAT(1), (256 << 4) | 1 },
+        { "24-bit 6ch to FIFO",
+          DMA_CTL_TO_BUFFER | DMA_CTL_INTERLEAVE | DMA_CTL_BUF(1) |
+          DMA_CTL_FORMAT(2), (128 << 4) | 5 },
+        { "16-bit from scratch",
+          DMA_CTL_BUF(0xF) | DMA_CTL_FORMAT(1), 0x400 },
+        { "24-bit from circular",
+          DMA_CTL_BUF(0xE) | DMA_CTL_FORMAT(2) | DMA_CTL_WRITEBACK, 0x400 },
+    };
+
+    g_autofree DMABuffers *bufs = g_new0(DMABuffers, 1);
+    DSPState *s = dsp_init(bufs, dma_scratch_rw, dma_fifo_rw);
+    g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+    dma_fill_memory(s, rand);
+    const int reps = 1000;
+
+    for (int c = 0; c < ARRAY_SIZE(cases); c++) {
+        uint32_t words = cases[c].count;
+        if (cases[c].control & DMA_CTL_INTERLEAVE) {
+            words = (words >> 4) * ((words & 0xf) + 1);
+        }
+        size_t bytes = words * ((cases[c].control >> 10 & 7) == 1 ? 2 : 4);
+        double ref_min = G_MAXDOUBLE, new_min = G_MAXDOUBLE;
+
+        dma_write_node(s, cases[c].control, cases[c].count, 0x400, 0, 0x1000,
+                       0x4000);
+        for (int iter = 0; iter < DMA_NUM_ITERATIONS; iter++) {
+            g_test_timer_start();
+            for (int i = 0; i < reps; i++) {
+                ref_dma_node(s, bufs, DMA_NODE_ADDR);
+            }
+            ref_min = MIN(ref_min, g_test_timer_elapsed());
+
+            g_test_timer_start();
+            for (int i = 0; i < reps; i++) {
+                dma_run_node(s);
+            }
+            new_min = MIN(new_min, g_test_timer_elapsed());
+        }
+
+        g_test_minimized_result(new_min * 1e9 / reps,
+                                "%s: %.1f MiB/s (reference %.1f MiB/s)",
+                                cases[c].name,
+                                bytes * reps / new_min / (1024 * 1024),
+                                bytes * reps / ref_min / (1024 * 1024));
+    }
+
+    dsp_destroy(s);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
 
     g_test_add_func("/basic", test_dsp_basic);
+    g_test_add_func("/idle_loop", test_dsp_idle_loop);
+    g_test_add_func("/sg/identical", test_dsp_sg_identical);
+    g_test_add_func("/dma/identical", test_dsp_dma_identical);
+    if (g_test_perf()) {
+        g_test_add_func("/sg/bench", test_dsp_sg_bench);
+        g_test_add_func("/dma/bench", test_dsp_dma_bench);
+    }
 
     return g_test_run();
 }
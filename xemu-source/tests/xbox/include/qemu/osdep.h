@@ -0,0 +1,85 @@
+/*
+ * Stand-in for include/qemu/osdep.h, shared by the standalone tests under
+ * tests/xbox that build a few files of the tree without its generated
+ * config headers. Atomics, barriers and compiler helpers come from the
+ * real headers, so the code under test uses the same ones as the emulator.
+ *
+ * Put this directory ahead of include/ on the include path.
+ */
+#ifndef QEMU_OSDEP_H
+#define QEMU_OSDEP_H
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Tests built against glib get the real thing */
+#if __has_include(<glib.h>)
+#include <glib.h>
+#else
+#define G_NORETURN __attribute__((noreturn))
+#define G_DEFINE_AUTOPTR_CLEANUP_FUNC(type, func)
+#define g_assert_not_reached() abort()
+
+static inline void *g_malloc(size_t size)
+{
+    void *p = malloc(size);
+    assert(p || !size);
+    return p;
+}
+
+static inline void *g_malloc0(size_t size)
+{
+    void *p = calloc(1, size);
+    assert(p || !size);
+    return p;
+}
+
+static inline void *g_malloc0_n(size_t n, size_t size)
+{
+    void *p = calloc(n, size);
+    assert(p || !n || !size);
+    return p;
+}
+
+#define g_free free
+#endif
+
+#include "qemu/compiler.h"
+#include "qemu/typedefs.h"
+
+#define coroutine_fn
+#define coroutine_mixed_fn
+#define no_coroutine_fn
+
+#define qemu_build_not_reached() abort()
+#define qemu_build_assert(test) while (!(test)) qemu_build_not_reached()
+
+#undef MIN
+#undef MAX
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+#ifndef ABS
+#define ABS(a) ((a) < 0 ? -(a) : (a))
+#endif
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define tostring(s) #s
+#define stringify(s) tostring(s)
+
+#include "qemu/atomic.h"
+
+#endif
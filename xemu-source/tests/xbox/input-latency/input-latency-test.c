@@ -0,0 +1,386 @@
+/*
+ * Crosscheck controller state publication and measure input latency.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "qemu/osdep.h"
+#include "ui/xemu-input-state.h"
+
+#define NUM_READERS 3
+#define NUM_PUBLISHES 2000000
+#define NUM_REQUESTS 1000000
+
+/* Synthetic controller changes state every 2-10 ms */
+#define NUM_CHANGES 300
+#define MIN_CHANGE_INTERVAL_US 2000
+#define MAX_CHANGE_INTERVAL_US 10000
+
+/* Interrupt IN polling interval of the XID gamepad */
+#define DEVICE_POLL_INTERVAL_US 4000
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadline_ns)
+{
+    struct timespec ts = {
+        .tv_sec = deadline_ns / 1000000000LL,
+        .tv_nsec = deadline_ns % 1000000000LL,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+    }
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* A sample whose axes can be checked against its buttons */
+static void make_sample(XemuInputSample *s, uint32_t k)
+{
+    memset(s, 0, sizeof(*s));
+    s->ts = 1 + k;
+    s->buttons = k;
+    for (int i = 0; i < XEMU_INPUT_SAMPLE_AXES; i++) {
+        s->axis[i] = (int16_t)(k * (i + 3));
+    }
+}
+
+static bool sample_is_consistent(const XemuInputSample *s)
+{
+    uint16_t k = s->buttons;
+    for (int i = 0; i < XEMU_INPUT_SAMPLE_AXES; i++) {
+        if (s->axis[i] != (int16_t)(k * (i + 3))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct Publish {
+    XemuInputSlot slot;
+    bool done;
+    uint64_t reads[NUM_READERS];
+    uint64_t empty[NUM_READERS];
+} Publish;
+
+typedef struct Reader {
+    Publish *p;
+    int index;
+} Reader;
+
+static void *publish_reader(void *opaque)
+{
+    Reader *r = opaque;
+    Publish *p = r->p;
+    uint32_t last_serial = 0;
+    bool seen = false;
+
+    while (!__atomic_load_n(&p->done, __ATOMIC_ACQUIRE)) {
+        XemuInputSample s;
+        if (!xemu_input_slot_read(&p->slot, &s)) {
+            /* Only before the first publish, never a torn or busy slot */
+            assert(!seen && s.serial == 0 && s.buttons == 0);
+            p->empty[r->index]++;
+            continue;
+        }
+        seen = true;
+        assert(sample_is_consistent(&s));
+        assert(s.serial >= last_serial);
+        last_serial = s.serial;
+        p->reads[r->index]++;
+    }
+
+    return NULL;
+}
+
+static void publish_consistency(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    Publish *p = calloc(1, sizeof(*p));
+    assert(p);
+    xemu_input_slot_init(&p->slot);
+
+    XemuInputSample s;
+    assert(!xemu_input_slot_read(&p->slot, &s));
+
+    pthread_t threads[NUM_READERS];
+    Reader readers[NUM_READERS];
+    for (int i = 0; i < NUM_READERS; i++) {
+        readers[i] = (Reader){ p, i };
+        pthread_create(&threads[i], NULL, publish_reader, &readers[i]);
+    }
+
+    uint32_t changes = 0, k = 0;
+    for (uint32_t i = 0; i < NUM_PUBLISHES; i++) {
+        /* Repeat some samples so the serial only advances on change */
+        k = i - (i % 3 == 1);
+        make_sample(&s, k);
+        changes += xemu_input_slot_publish(&p->slot, &s);
+        assert(s.serial == changes);
+    }
+
+    __atomic_store_n(&p->done, true, __ATOMIC_RELEASE);
+    uint64_t reads = 0, empty = 0;
+    for (int i = 0; i < NUM_READERS; i++) {
+        pthread_join(threads[i], NULL);
+        reads += p->reads[i];
+        empty += p->empty[i];
+    }
+
+    assert(xemu_input_slot_read(&p->slot, &s));
+    assert(s.buttons == (uint16_t)k);
+
+    /* Publishing no controller is a change, and reads as nothing */
+    memset(&s, 0, sizeof(s));
+    assert(xemu_input_slot_publish(&p->slot, &s));
+    assert(!xemu_input_slot_read(&p->slot, &s));
+
+    fprintf(stderr, "  %d publishes, %d changes, %llu reads, %llu before "
+            "the first publish\n", NUM_PUBLISHES, changes,
+            (unsigned long long)reads, (unsigned long long)empty);
+    free(p);
+
+    fprintf(stderr, "ok!\n");
+}
+
+typedef struct Rumble {
+    XemuRumbleQueue q;
+    bool done;
+} Rumble;
+
+static void *rumble_consumer(void *opaque)
+{
+    Rumble *r = opaque;
+    int64_t last_ts[4] = { 0 };
+    uint64_t popped = 0;
+    XemuRumbleRequest req;
+
+    while (true) {
+        bool done = __atomic_load_n(&r->done, __ATOMIC_ACQUIRE);
+        while (xemu_rumble_queue_pop(&r->q, &req)) {
+            /* Requests are never torn or reordered */
+            assert(req.port < 4);
+            assert(req.strength_l == (uint16_t)req.ts);
+            assert(req.strength_r == (uint16_t)~req.ts);
+            assert(req.ts > last_ts[req.port]);
+            last_ts[req.port] = req.ts;
+            popped++;
+        }
+        if (done) {
+            break;
+        }
+    }
+
+    /* The newest request for each port always arrives */
+    for (int port = 0; port < 4; port++) {
+        assert(last_ts[port] == NUM_REQUESTS - 4 + port + 1);
+    }
+
+    return (void *)(uintptr_t)popped;
+}
+
+static void rumble_queue(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    Rumble *r = calloc(1, sizeof(*r));
+    assert(r);
+    xemu_rumble_queue_init(&r->q);
+
+    /* Without a consumer, only the newest requests are kept */
+    XemuRumbleRequest req;
+    for (int i = 0; i < 3 * XEMU_RUMBLE_QUEUE_SIZE; i++) {
+        req = (XemuRumbleRequest){ .ts = i + 1, .port = i % 4 };
+        xemu_rumble_queue_push(&r->q, &req);
+    }
+    assert(r->q.dropped == 2 * XEMU_RUMBLE_QUEUE_SIZE);
+    for (int i = 2 * XEMU_RUMBLE_QUEUE_SIZE; i < 3 * XEMU_RUMBLE_QUEUE_SIZE;
+         i++) {
+        assert(xemu_rumble_queue_pop(&r->q, &req));
+        assert(req.ts == i + 1);
+    }
+    assert(!xemu_rumble_queue_pop(&r->q, &req));
+
+    xemu_rumble_queue_init(&r->q);
+    pthread_t thread;
+    pthread_create(&thread, NULL, rumble_consumer, r);
+
+    for (int i = 0; i < NUM_REQUESTS; i++) {
+        req = (XemuRumbleRequest){
+            .ts = i + 1,
+            .port = i % 4,
+            .strength_l = (uint16_t)(i + 1),
+            .strength_r = (uint16_t)~(i + 1),
+        };
+        xemu_rumble_queue_push(&r->q, &req);
+    }
+
+    __atomic_store_n(&r->done, true, __ATOMIC_RELEASE);
+    void *popped;
+    pthread_join(thread, &popped);
+    fprintf(stderr, "  %d requests, %llu delivered, %u superseded\n",
+            NUM_REQUESTS, (unsigned long long)(uintptr_t)popped,
+            r->q.dropped);
+    assert((uintptr_t)popped + r->q.dropped == NUM_REQUESTS);
+    free(r);
+
+    fprintf(stderr, "ok!\n");
+}
+
+/*
+ * A synthetic virtual controller stands in for the host device, a sampler
+ * thread for whatever refreshes the state the guest sees, and the main
+ * thread for the XID device polling it. Latency is measured from the
+ * controller changing state to the device first reporting it.
+ */
+typedef struct Latency {
+    XemuInputSlot slot;
+    int64_t sample_interval_ns;
+
+    /* Virtual controller */
+    uint32_t state;
+    int64_t change_ns[NUM_CHANGES + 1];
+    bool done;
+} Latency;
+
+static void *virtual_controller(void *opaque)
+{
+    Latency *l = opaque;
+    int64_t t = now_ns();
+
+    for (uint32_t k = 1; k <= NUM_CHANGES; k++) {
+        t += (MIN_CHANGE_INTERVAL_US +
+              rand() % (MAX_CHANGE_INTERVAL_US - MIN_CHANGE_INTERVAL_US)) *
+             1000LL;
+        sleep_until(t);
+        l->change_ns[k] = now_ns();
+        __atomic_store_n(&l->state, k, __ATOMIC_RELEASE);
+    }
+
+    /* Give the device time to see the last change */
+    sleep_until(t + 50 * 1000000LL);
+    __atomic_store_n(&l->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *sampler(void *opaque)
+{
+    Latency *l = opaque;
+    int64_t t = now_ns();
+
+    while (!__atomic_load_n(&l->done, __ATOMIC_ACQUIRE)) {
+        XemuInputSample s;
+        make_sample(&s, __atomic_load_n(&l->state, __ATOMIC_ACQUIRE));
+        s.ts = now_ns();
+        xemu_input_slot_publish(&l->slot, &s);
+        t += l->sample_interval_ns;
+        sleep_until(t);
+    }
+
+    return NULL;
+}
+
+static void run_latency(const char *name, int64_t sample_interval_us)
+{
+    Latency *l = calloc(1, sizeof(*l));
+    assert(l);
+    xemu_input_slot_init(&l->slot);
+    l->sample_interval_ns = sample_interval_us * 1000;
+
+    int64_t *latency = calloc(NUM_CHANGES, sizeof(int64_t));
+    int64_t *publish = calloc(NUM_CHANGES, sizeof(int64_t));
+    int num_seen = 0;
+    uint16_t last_seen = 0;
+
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, sampler, l);
+    pthread_create(&threads[1], NULL, virtual_controller, l);
+
+    int64_t t = now_ns();
+    while (!__atomic_load_n(&l->done, __ATOMIC_ACQUIRE)) {
+        XemuInputSample s;
+        if (xemu_input_slot_read(&l->slot, &s) && s.buttons != last_seen) {
+            int64_t now = now_ns();
+            assert(sample_is_consistent(&s));
+            assert(num_seen < NUM_CHANGES);
+            latency[num_seen] = now - l->change_ns[s.buttons];
+            publish[num_seen] = s.change_ts - l->change_ns[s.buttons];
+            num_seen++;
+            last_seen = s.buttons;
+        }
+        t += DEVICE_POLL_INTERVAL_US * 1000LL;
+        sleep_until(t);
+    }
+
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    assert(num_seen > 0 && last_seen == NUM_CHANGES);
+
+    qsort(latency, num_seen, sizeof(int64_t), cmp_int64);
+    qsort(publish, num_seen, sizeof(int64_t), cmp_int64);
+    fprintf(stderr,
+            "  %-18s publish p50 %5.2f ms  report p50 %5.2f ms  "
+            "p99 %5.2f ms  max %5.2f ms  (%d of %d changes seen)\n",
+            name, publish[num_seen / 2] / 1e6, latency[num_seen / 2] / 1e6,
+            latency[num_seen * 99 / 100] / 1e6, latency[num_seen - 1] / 1e6,
+            num_seen, NUM_CHANGES);
+
+    free(publish);
+    free(latency);
+    free(l);
+}
+
+static void measure_latency(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+    fprintf(stderr, "  device polls every %d ms\n",
+            DEVICE_POLL_INTERVAL_US / 1000);
+
+    /* Controller state only refreshed when the UI pumps SDL events */
+    run_latency("ui frame (60 Hz)", 16667);
+    /* Refreshed and published by the input thread */
+    run_latency("input thread", 1000);
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    publish_consistency();
+    rumble_queue();
+    measure_latency();
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Test and measure coalescing of main loop wakeups.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "qemu/osdep.h"
+#include "qemu/main-loop-notify.h"
+
+#define RUN_NS 500000000LL
+
+/* Timers re-armed by the vCPU, as games keep them */
+#define REARM_INTERVAL_NS 5000
+#define DEADLINE_MIN_NS 200000
+#define DEADLINE_MAX_NS 3000000
+
+/* Time the main loop spends running handlers after each wakeup */
+#define DISPATCH_NS 20000
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void spin_ns(int64_t ns)
+{
+    int64_t end = now_ns() + ns;
+    while (now_ns() < end) {
+    }
+}
+
+static void counting(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    MainLoopNotify n;
+    MainLoopNotifyStats s;
+
+    main_loop_notify_init(&n);
+
+    /* Awake: the loop looks at everything before it sleeps again */
+    assert(!main_loop_notify(&n));
+
+    /* One kick per sleep */
+    main_loop_notify_prepare(&n);
+    assert(main_loop_notify(&n));
+    assert(!main_loop_notify(&n));
+    assert(!main_loop_notify(&n));
+    assert(main_loop_notify_wake(&n));
+    assert(!main_loop_notify(&n));
+
+    /* Woken by something else */
+    main_loop_notify_prepare(&n);
+    assert(!main_loop_notify_wake(&n));
+
+    /* Kicked again on the next sleep */
+    main_loop_notify_prepare(&n);
+    assert(main_loop_notify(&n));
+    assert(main_loop_notify_wake(&n));
+
+    main_loop_notify_get_stats(&n, &s);
+    assert(s.notifies == 6);
+    assert(s.kicks == 2 && s.coalesced == 2 && s.skipped == 2);
+    assert(s.wakeups == 3 && s.kicked_wakeups == 2);
+
+    fprintf(stderr, "ok!\n");
+}
+
+/*
+ * A main loop sleeping until the earliest timer, and a vCPU thread
+ * re-arming timers. Before, every notification made while the loop was in
+ * poll wrote the event (as aio_notify() does for the notify bottom half).
+ * Now it is written once per sleep.
+ */
+typedef struct Bench {
+    bool coalesce;
+    bool stop;
+    int efd;
+    int64_t deadline;
+    MainLoopNotify notify;
+    bool in_poll;
+    uint64_t writes;
+    uint64_t wakeups;
+} Bench;
+
+static void bench_kick(Bench *b)
+{
+    if (b->coalesce) {
+        if (!main_loop_notify(&b->notify)) {
+            return;
+        }
+    } else {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&b->in_poll, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+    uint64_t one = 1;
+    assert(write(b->efd, &one, sizeof(one)) == sizeof(one));
+    __atomic_fetch_add(&b->writes, 1, __ATOMIC_RELAXED);
+}
+
+static void *vcpu_thread(void *opaque)
+{
+    Bench *b = opaque;
+
+    while (!__atomic_load_n(&b->stop, __ATOMIC_RELAXED)) {
+        int64_t deadline = now_ns() + DEADLINE_MIN_NS +
+                           rand() % (DEADLINE_MAX_NS - DEADLINE_MIN_NS);
+
+        /* Only a timer that becomes the earliest needs the loop's attention */
+        int64_t cur = __atomic_load_n(&b->deadline, __ATOMIC_RELAXED);
+        if (deadline < cur || cur < now_ns()) {
+            __atomic_store_n(&b->deadline, deadline, __ATOMIC_RELAXED);
+            bench_kick(b);
+        }
+        spin_ns(REARM_INTERVAL_NS);
+    }
+    return NULL;
+}
+
+static void bench_run(Bench *b)
+{
+    pthread_t vcpu;
+
+    b->efd = eventfd(0, EFD_NONBLOCK);
+    assert(b->efd >= 0);
+    b->deadline = now_ns() + DEADLINE_MAX_NS;
+    main_loop_notify_init(&b->notify);
+    assert(!pthread_create(&vcpu, NULL, vcpu_thread, b));
+
+    int64_t end = now_ns() + RUN_NS;
+    while (now_ns() < end) {
+        struct pollfd pfd = { .fd = b->efd, .events = POLLIN };
+
+        if (b->coalesce) {
+            main_loop_notify_prepare(&b->notify);
+        }
+        int64_t deadline = __atomic_load_n(&b->deadline, __ATOMIC_RELAXED);
+        int64_t timeout = MAX(deadline - now_ns(), 0);
+
+        if (!b->coalesce) {
+            __atomic_store_n(&b->in_poll, true, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        }
+        struct timespec ts = {
+            .tv_sec = timeout / 1000000000LL,
+            .tv_nsec = timeout % 1000000000LL,
+        };
+        ppoll(&pfd, 1, &ts, NULL);
+        if (b->coalesce) {
+            main_loop_notify_wake(&b->notify);
+        } else {
+            __atomic_store_n(&b->in_poll, false, __ATOMIC_RELAXED);
+        }
+        b->wakeups++;
+
+        uint64_t value;
+        if (pfd.revents & POLLIN) {
+            assert(read(b->efd, &value, sizeof(value)) == sizeof(value));
+        }
+        spin_ns(DISPATCH_NS);
+    }
+
+    __atomic_store_n(&b->stop, true, __ATOMIC_RELAXED);
+    pthread_join(vcpu, NULL);
+    close(b->efd);
+}
+
+static void wakeups(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    Bench before = { .coalesce = false };
+    Bench after = { .coalesce = true };
+
+    bench_run(&before);
+    bench_run(&after);
+
+    MainLoopNotifyStats s;
+    main_loop_notify_get_stats(&after.notify, &s);
+    assert(s.kicks + s.coalesced + s.skipped == s.notifies);
+    assert(s.kicks == after.writes);
+    assert(s.wakeups == after.wakeups);
+
+    fprintf(stderr, "  %-10s %10s %10s\n", "", "wakeups", "writes");
+    fprintf(stderr, "  %-10s %10llu %10llu\n", "before",
+            (unsigned long long)before.wakeups,
+            (unsigned long long)before.writes);
+    fprintf(stderr, "  %-10s %10llu %10llu\n", "coalesced",
+            (unsigned long long)after.wakeups,
+            (unsigned long long)after.writes);
+    fprintf(stderr, "  %llu notifications: %llu kicks, %llu coalesced, "
+            "%llu while awake\n", (unsigned long long)s.notifies,
+            (unsigned long long)s.kicks, (unsigned long long)s.coalesced,
+            (unsigned long long)s.skipped);
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    counting();
+    wakeups();
+
+    return 0;
+}
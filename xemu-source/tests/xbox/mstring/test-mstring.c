@@ -0,0 +1,318 @@
+/*
+ * MString tests.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/mstring.h"
+
+/*
+ * The generation benchmark emits pixel shader combiner code the same way
+ * pgraph/glsl/psh.c does: many short-lived register expressions built with
+ * mstring_from_fmt/mstring_from_str, nested into mux expressions and
+ * appended to a stage body, then concatenated into a final source string.
+ * The same corpus is rendered through a reference builder that mirrors the
+ * previous allocation pattern (a fresh GString per string and a formatted
+ * temporary per mstring_from_fmt) and the outputs must be byte-identical.
+ */
+
+#define NUM_STATES 512
+#define NUM_ITERATIONS 10
+
+typedef struct CombinerStage {
+    uint8_t inputs[4];
+    uint8_t mapping[4];
+    bool mux_msb;
+    bool dot_ab;
+    bool dot_cd;
+} CombinerStage;
+
+typedef struct CombinerState {
+    int num_stages;
+    bool vulkan;
+    CombinerStage stages[8];
+} CombinerState;
+
+static const char *reg_names[] = {
+    "c0_0", "c1_0", "pFog", "v0", "v1", "t0", "t1", "t2", "t3", "r0", "r1",
+};
+
+static const char *mapping_fmts[] = {
+    "max(%s, 0.0)",
+    "(1.0 - clamp(%s, 0.0, 1.0))",
+    "(2.0 * max(%s, 0.0) - 1.0)",
+    "(-2.0 * max(%s, 0.0) + 1.0)",
+    "(max(%s, 0.0) - 0.5)",
+    "(-max(%s, 0.0) + 0.5)",
+    "%s",
+    "-%s",
+};
+
+static void gen_corpus(CombinerState *states, int count)
+{
+    GRand *rand = g_rand_new_with_seed(0x4e563241);
+
+    for (int i = 0; i < count; i++) {
+        CombinerState *s = &states[i];
+        s->num_stages = g_rand_int_range(rand, 1, 9);
+        s->vulkan = g_rand_boolean(rand);
+        for (int j = 0; j < s->num_stages; j++) {
+            CombinerStage *st = &s->stages[j];
+            for (int k = 0; k < 4; k++) {
+                st->inputs[k] = g_rand_int_range(rand, 0, ARRAY_SIZE(reg_names));
+                st->mapping[k] =
+                    g_rand_int_range(rand, 0, ARRAY_SIZE(mapping_fmts));
+            }
+            st->mux_msb = g_rand_boolean(rand);
+            st->dot_ab = g_rand_boolean(rand);
+            st->dot_cd = g_rand_boolean(rand);
+        }
+    }
+
+    g_rand_free(rand);
+}
+
+/* Reference builder reproducing the previous MString allocation pattern */
+
+static GString *ref_from_fmt(const char *fmt, ...) G_GNUC_PRINTF(1, 2);
+
+static GString *ref_from_fmt(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    g_autofree gchar *str = g_strdup_vprintf(fmt, args);
+    va_end(args);
+    return g_string_new(str);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+
+static GString *ref_gen_input(const CombinerStage *st, int k)
+{
+    GString *reg = g_string_new(reg_names[st->inputs[k]]);
+    GString *res = ref_from_fmt(mapping_fmts[st->mapping[k]], reg->str);
+    g_string_free(reg, true);
+    return res;
+}
+
+static MString *gen_input(const CombinerStage *st, int k)
+{
+    MString *reg = mstring_from_str(reg_names[st->inputs[k]]);
+    MString *res =
+        mstring_from_fmt(mapping_fmts[st->mapping[k]], mstring_get_str(reg));
+    mstring_unref(reg);
+    return res;
+}
+
+#pragma GCC diagnostic pop
+
+static gchar *ref_gen(const CombinerState *s)
+{
+    GString *preflight = g_string_new("");
+    GString *code = g_string_new("");
+
+    g_string_append_printf(preflight, "layout(binding = %d, std140) uniform "
+                           "PshUniforms {\n", s->vulkan ? 1 : 0);
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 2; j++) {
+            g_string_append_printf(preflight, "#define c%d_%d consts[%d]\n",
+                                   j, i, i * 2 + j);
+        }
+    }
+
+    for (int j = 0; j < s->num_stages; j++) {
+        const CombinerStage *st = &s->stages[j];
+        GString *in[4];
+        for (int k = 0; k < 4; k++) {
+            in[k] = ref_gen_input(st, k);
+        }
+        GString *ab = ref_from_fmt(st->dot_ab ? "dot(%s, %s)" : "(%s * %s)",
+                                   in[0]->str, in[1]->str);
+        GString *cd = ref_from_fmt(st->dot_cd ? "dot(%s, %s)" : "(%s * %s)",
+                                   in[2]->str, in[3]->str);
+        GString *mux = ref_from_fmt("((%s) ? %s(%s) : %s(%s))",
+                                    st->mux_msb ? "r0.a >= 0.5" : "r0.a > 0.0",
+                                    "vec4", cd->str, "vec4", ab->str);
+        g_string_append_printf(code, "// Stage %d\nr0 = %s;\n", j, mux->str);
+        for (int k = 0; k < 4; k++) {
+            g_string_free(in[k], true);
+        }
+        g_string_free(ab, true);
+        g_string_free(cd, true);
+        g_string_free(mux, true);
+    }
+
+    GString *final = g_string_new("");
+    g_string_append_printf(final, "#version %d\n\n", s->vulkan ? 450 : 400);
+    g_string_append(final, preflight->str);
+    g_string_append(final, "void main() {\n");
+    g_string_append(final, code->str);
+    g_string_append(final, "}\n");
+
+    g_string_free(preflight, true);
+    g_string_free(code, true);
+
+    return g_string_free(final, false);
+}
+
+static MString *gen(const CombinerState *s)
+{
+    MString *preflight = mstring_new();
+    MString *code = mstring_new();
+
+    mstring_append_fmt(preflight, "layout(binding = %d, std140) uniform "
+                       "PshUniforms {\n", s->vulkan ? 1 : 0);
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 2; j++) {
+            mstring_append_fmt(preflight, "#define c%d_%d consts[%d]\n",
+                               j, i, i * 2 + j);
+        }
+    }
+
+    for (int j = 0; j < s->num_stages; j++) {
+        const CombinerStage *st = &s->stages[j];
+        MString *in[4];
+        for (int k = 0; k < 4; k++) {
+            in[k] = gen_input(st, k);
+        }
+        MString *ab = mstring_from_fmt(st->dot_ab ? "dot(%s, %s)" : "(%s * %s)",
+                                       mstring_get_str(in[0]),
+                                       mstring_get_str(in[1]));
+        MString *cd = mstring_from_fmt(st->dot_cd ? "dot(%s, %s)" : "(%s * %s)",
+                                       mstring_get_str(in[2]),
+                                       mstring_get_str(in[3]));
+        MString *mux = mstring_from_fmt(
+            "((%s) ? %s(%s) : %s(%s))",
+            st->mux_msb ? "r0.a >= 0.5" : "r0.a > 0.0", "vec4",
+            mstring_get_str(cd), "vec4", mstring_get_str(ab));
+        mstring_append_fmt(code, "// Stage %d\nr0 = %s;\n", j,
+                           mstring_get_str(mux));
+        for (int k = 0; k < 4; k++) {
+            mstring_unref(in[k]);
+        }
+        mstring_unref(ab);
+        mstring_unref(cd);
+        mstring_unref(mux);
+    }
+
+    MString *final = mstring_new_sized(mstring_get_length(preflight) +
+                                       mstring_get_length(code) + 64);
+    mstring_append_fmt(final, "#version %d\n\n", s->vulkan ? 450 : 400);
+    mstring_append_mstring(final, preflight);
+    mstring_append(final, "void main() {\n");
+    mstring_append_mstring(final, code);
+    mstring_append(final, "}\n");
+
+    mstring_unref(preflight);
+    mstring_unref(code);
+
+    return final;
+}
+
+static void test_mstring_basic(void)
+{
+    MString *a = mstring_from_str("hello");
+    g_assert_cmpstr(mstring_get_str(a), ==, "hello");
+    g_assert_cmpuint(mstring_get_length(a), ==, 5);
+
+    mstring_ref(a);
+    mstring_unref(a);
+    mstring_append_fmt(a, ", %s %d", "world", 42);
+    g_assert_cmpstr(mstring_get_str(a), ==, "hello, world 42");
+
+    MString *b = mstring_from_fmt("[%s]", mstring_get_str(a));
+    mstring_append_mstring(b, a);
+    mstring_append_len(b, "!?", 1);
+    g_assert_cmpstr(mstring_get_str(b), ==,
+                    "[hello, world 42]hello, world 42!");
+    mstring_unref(a);
+    mstring_unref(b);
+
+    /* Recycled strings must come back empty */
+    for (int i = 0; i < 256; i++) {
+        MString *c = mstring_new_sized(i * 64);
+        g_assert_cmpuint(mstring_get_length(c), ==, 0);
+        g_assert_cmpstr(mstring_get_str(c), ==, "");
+        mstring_append(c, "x");
+        mstring_unref(c);
+    }
+
+    MString *big = mstring_new();
+    for (int i = 0; i < 128 * 1024; i++) {
+        mstring_append(big, "y");
+    }
+    mstring_unref(big);
+
+    MString *d = mstring_new();
+    g_assert_cmpuint(mstring_get_length(d), ==, 0);
+    mstring_unref(d);
+}
+
+static void test_mstring_gen_identical(void)
+{
+    g_autofree CombinerState *states = g_new0(CombinerState, NUM_STATES);
+    gen_corpus(states, NUM_STATES);
+
+    for (int i = 0; i < NUM_STATES; i++) {
+        g_autofree gchar *expected = ref_gen(&states[i]);
+        MString *actual = gen(&states[i]);
+        g_assert_cmpuint(mstring_get_length(actual), ==, strlen(expected));
+        g_assert_cmpstr(mstring_get_str(actual), ==, expected);
+        mstring_unref(actual);
+    }
+}
+
+static void test_mstring_gen_bench(void)
+{
+    g_autofree CombinerState *states = g_new0(CombinerState, NUM_STATES);
+    gen_corpus(states, NUM_STATES);
+
+    double ref_min = G_MAXDOUBLE, new_min = G_MAXDOUBLE;
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        g_test_timer_start();
+        for (int i = 0; i < NUM_STATES; i++) {
+            g_free(ref_gen(&states[i]));
+        }
+        ref_min = MIN(ref_min, g_test_timer_elapsed());
+
+        g_test_timer_start();
+        for (int i = 0; i < NUM_STATES; i++) {
+            mstring_unref(gen(&states[i]));
+        }
+        new_min = MIN(new_min, g_test_timer_elapsed());
+    }
+
+    g_test_minimized_result(new_min * 1e9 / NUM_STATES,
+                            "pooled: %.0f ns/shader (reference %.0f ns/shader)",
+                            new_min * 1e9 / NUM_STATES,
+                            ref_min * 1e9 / NUM_STATES);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/mstring/basic", test_mstring_basic);
+    g_test_add_func("/mstring/gen-identical", test_mstring_gen_identical);
+    if (g_test_perf()) {
+        g_test_add_func("/mstring/gen-bench", test_mstring_gen_bench);
+    }
+
+    return g_test_run();
+}
@@ -0,0 +1,95 @@
+/*
+ * Stand-in for hw/xbox/nv2a/pgraph/pgraph.h, with only the state the shader
+ * generators read. The generators themselves are the real ones.
+ */
+#ifndef HW_XBOX_NV2A_PGRAPH_H
+#define HW_XBOX_NV2A_PGRAPH_H
+
+#include "qemu/osdep.h"
+#include "hw/xbox/nv2a/nv2a_regs.h"
+#include "hw/xbox/nv2a/pgraph/surface.h"
+#include "hw/xbox/nv2a/pgraph/util.h"
+#include "hw/xbox/nv2a/pgraph/vsh_regs.h"
+
+/* As in texture.h, which needs cpu.h */
+typedef struct BasicColorFormatInfo {
+    unsigned int bytes_per_pixel;
+    bool linear;
+    bool depth;
+} BasicColorFormatInfo;
+
+extern const BasicColorFormatInfo kelvin_color_format_info_map[66];
+
+typedef struct PGRAPHState {
+    SurfaceShape surface_shape;
+    struct {
+        int width;
+        int height;
+    } surface_binding_dim;
+    unsigned int surface_scale_factor;
+
+    bool texture_matrix_enable[NV2A_MAX_TEXTURES];
+    uint32_t primitive_mode;
+    uint32_t program_data[NV2A_MAX_TRANSFORM_PROGRAM_LENGTH][VSH_TOKEN_SIZE];
+    uint32_t vsh_constants[NV2A_VERTEXSHADER_CONSTANTS][4];
+    uint32_t ltctxa[NV2A_LTCTXA_COUNT][4];
+    uint32_t ltctxb[NV2A_LTCTXB_COUNT][4];
+    uint32_t ltc1[NV2A_LTC1_COUNT][4];
+    float material_alpha;
+    float light_infinite_half_vector[NV2A_MAX_LIGHTS][3];
+    float light_infinite_direction[NV2A_MAX_LIGHTS][3];
+    float light_local_position[NV2A_MAX_LIGHTS][3];
+    float light_local_attenuation[NV2A_MAX_LIGHTS][3];
+    float specular_power;
+    float specular_power_back;
+    float point_params[8];
+    uint16_t uniform_attrs;
+
+    uint32_t regs_[0x2000];
+} PGRAPHState;
+
+static inline uint32_t pgraph_reg_r(PGRAPHState *pg, unsigned int r)
+{
+    assert(r % 4 == 0);
+    return pg->regs_[r];
+}
+
+static inline bool pgraph_is_texture_stage_active(PGRAPHState *pg,
+                                                  unsigned int stage)
+{
+    uint32_t mode =
+        (pgraph_reg_r(pg, NV_PGRAPH_SHADERPROG) >> (stage * 5)) & 0x1F;
+    return mode != 0 && mode != 4;
+}
+
+static inline void pgraph_apply_anti_aliasing_factor(PGRAPHState *pg,
+                                                     unsigned int *width,
+                                                     unsigned int *height)
+{
+}
+
+static inline void pgraph_apply_scaling_factor(PGRAPHState *pg,
+                                               unsigned int *width,
+                                               unsigned int *height)
+{
+    *width *= pg->surface_scale_factor;
+    *height *= pg->surface_scale_factor;
+}
+
+static inline void pgraph_get_inline_values(
+    PGRAPHState *pg, uint16_t attrs,
+    float values[NV2A_VERTEXSHADER_ATTRIBUTES][4], int *count)
+{
+    *count = 0;
+}
+
+static inline void pgraph_argb_pack32_to_rgba_float(uint32_t argb,
+                                                    float *rgba)
+{
+    rgba[0] = ((argb >> 16) & 0xFF) / 255.0f;
+    rgba[1] = ((argb >> 8) & 0xFF) / 255.0f;
+    rgba[2] = (argb & 0xFF) / 255.0f;
+    rgba[3] = ((argb >> 24) & 0xFF) / 255.0f;
+}
+
+#endif
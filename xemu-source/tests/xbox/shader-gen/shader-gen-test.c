@@ -0,0 +1,373 @@
+/*
+ * Check the pixel and vertex shader generators across a corpus of states.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <pthread.h>
+#include <time.h>
+
+#include "qemu/osdep.h"
+#include "hw/xbox/nv2a/pgraph/pgraph.h"
+#include "hw/xbox/nv2a/pgraph/glsl/psh.h"
+#include "hw/xbox/nv2a/pgraph/glsl/vsh.h"
+
+#define NUM_STATES 256
+#define NUM_THREADS 4
+#define NUM_ITERATIONS 10
+
+/* Only read when collecting state from registers, which isn't done here */
+const BasicColorFormatInfo kelvin_color_format_info_map[66];
+
+static const uint8_t stage_regs[] = {
+    PS_REGISTER_ZERO, PS_REGISTER_C0, PS_REGISTER_C1, PS_REGISTER_FOG,
+    PS_REGISTER_V0,   PS_REGISTER_V1, PS_REGISTER_R0, PS_REGISTER_R1,
+};
+
+static const uint8_t output_regs[] = {
+    PS_REGISTER_DISCARD, PS_REGISTER_V0, PS_REGISTER_V1, PS_REGISTER_R0,
+    PS_REGISTER_R1,
+};
+
+static const uint8_t output_mappings[] = {
+    PS_COMBINEROUTPUT_IDENTITY,         PS_COMBINEROUTPUT_BIAS,
+    PS_COMBINEROUTPUT_SHIFTLEFT_1,      PS_COMBINEROUTPUT_SHIFTLEFT_1_BIAS,
+    PS_COMBINEROUTPUT_SHIFTLEFT_2,      PS_COMBINEROUTPUT_SHIFTRIGHT_1,
+};
+
+static uint32_t pick(const uint8_t *values, size_t count)
+{
+    return values[rand() % count];
+}
+
+static uint32_t gen_stage_inputs(void)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t in = pick(stage_regs, ARRAY_SIZE(stage_regs)) |
+                      (rand() & 1 ? PS_CHANNEL_ALPHA : 0) | (rand() & 0xE0);
+        v |= in << (i * 8);
+    }
+    return v;
+}
+
+static uint32_t gen_stage_output(bool rgb)
+{
+    uint32_t flags = pick(output_mappings, ARRAY_SIZE(output_mappings)) |
+                     (rand() & PS_COMBINEROUTPUT_AB_CD_MUX);
+    if (rgb) {
+        flags |= rand() & (PS_COMBINEROUTPUT_AB_DOT_PRODUCT |
+                           PS_COMBINEROUTPUT_CD_DOT_PRODUCT);
+    }
+    return pick(output_regs, ARRAY_SIZE(output_regs)) |
+           pick(output_regs, ARRAY_SIZE(output_regs)) << 4 |
+           pick(output_regs, ARRAY_SIZE(output_regs)) << 8 | flags << 12;
+}
+
+static uint32_t gen_final_inputs(void)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        uint32_t in = pick(stage_regs, ARRAY_SIZE(stage_regs)) |
+                      (rand() & 1 ? PS_CHANNEL_ALPHA : 0) |
+                      (rand() & 1 ? PS_INPUTMAPPING_UNSIGNED_INVERT : 0);
+        v |= in << (i * 8);
+    }
+    return v;
+}
+
+static void gen_psh_corpus(PshState *states, int count)
+{
+    for (int i = 0; i < count; i++) {
+        PshState *s = &states[i];
+        memset(s, 0, sizeof(*s));
+
+        int num_stages = 1 + rand() % 8;
+        s->combiner_control = num_stages | (rand() & 0x111) << 8;
+        for (int j = 0; j < num_stages; j++) {
+            s->rgb_inputs[j] = gen_stage_inputs();
+            s->alpha_inputs[j] = gen_stage_inputs();
+            s->rgb_outputs[j] = gen_stage_output(true);
+            s->alpha_outputs[j] = gen_stage_output(false);
+        }
+        if (rand() & 1) {
+            s->final_inputs_0 = gen_final_inputs();
+            s->final_inputs_1 = (gen_final_inputs() & ~0xFF) | (rand() & 0xE0);
+        }
+        s->alpha_test = rand() & 1;
+        s->alpha_func = rand() % 8;
+        s->smooth_shading = rand() & 1;
+        s->z_perspective = rand() & 1;
+        s->depth_clipping = rand() & 1;
+    }
+}
+
+static void gen_vsh_corpus(VshState *states, int count)
+{
+    for (int i = 0; i < count; i++) {
+        VshState *s = &states[i];
+        memset(s, 0, sizeof(*s));
+
+        s->is_fixed_function = true;
+        s->surface_scale_factor = 1;
+        s->uniform_attrs = rand() & 1 ? rand() & 0xFFFF : 0;
+        s->fog_enable = rand() & 1;
+        s->specular_enable = rand() & 1;
+        s->separate_specular = rand() & 1;
+        s->point_params_enable = rand() & 1;
+        s->smooth_shading = rand() & 1;
+        s->z_perspective = rand() & 1;
+        s->fixed_function.normalization = rand() & 1;
+        s->fixed_function.local_eye = rand() & 1;
+        for (int j = 0; j < 4; j++) {
+            s->fixed_function.texture_matrix_enable[j] = rand() & 1;
+        }
+    }
+}
+
+static GenPshGlslOptions psh_opts(int variant)
+{
+    return (GenPshGlslOptions){ .vulkan = variant & 1, .ubo_binding = 1,
+                                .tex_binding = 2 };
+}
+
+static GenVshGlslOptions vsh_opts(int variant)
+{
+    return (GenVshGlslOptions){
+        .vulkan = variant & 1,
+        .prefix_outputs = variant & 1,
+        .use_push_constants_for_uniform_attrs = variant & 2,
+        .ubo_binding = 0,
+    };
+}
+
+/* The uniform declarations as the generators built them before caching */
+
+static void append_uniform_decl(GString *s, bool vulkan,
+                                const UniformInfo *info)
+{
+    const char *u = vulkan ? "" : "uniform ";
+    const char *type_str = uniform_element_type_to_str[info->type];
+    if (info->count == 1) {
+        g_string_append_printf(s, "%s%s %s;\n", u, type_str, info->name);
+    } else {
+        g_string_append_printf(s, "%s%s %s[%zd];\n", u, type_str, info->name,
+                               info->count);
+    }
+}
+
+static char *expected_psh_uniforms(bool vulkan)
+{
+    GString *s = g_string_new("");
+    for (int i = 0; i < PshUniform__COUNT; i++) {
+        append_uniform_decl(s, vulkan, &PshUniformInfo[i]);
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int j = 0; j < 2; j++) {
+            g_string_append_printf(s, "#define c%d_%d consts[%d]\n", j, i,
+                                   i * 2 + j);
+        }
+    }
+    if (vulkan) {
+        g_string_append(s, "};\n");
+    }
+    return g_string_free(s, false);
+}
+
+static char *expected_vsh_uniforms(bool vulkan, bool inline_values)
+{
+    GString *s = g_string_new("");
+    for (int i = 0; i < VshUniform__COUNT; i++) {
+        if (i == VshUniform_inlineValue && !inline_values) {
+            continue;
+        }
+        append_uniform_decl(s, vulkan, &VshUniformInfo[i]);
+    }
+    return g_string_free(s, false);
+}
+
+static int count_occurrences(const char *haystack, const char *needle)
+{
+    int n = 0;
+    for (const char *p = strstr(haystack, needle); p;
+         p = strstr(p + 1, needle)) {
+        n++;
+    }
+    return n;
+}
+
+typedef struct Corpus {
+    PshState psh[NUM_STATES];
+    VshState vsh[NUM_STATES];
+} Corpus;
+
+/* Generated sources, [state][variant] */
+typedef struct Output {
+    char *psh[NUM_STATES][2];
+    char *vsh[NUM_STATES][4];
+} Output;
+
+static Corpus corpus;
+
+static void generate_all(Output *out)
+{
+    for (int i = 0; i < NUM_STATES; i++) {
+        for (int v = 0; v < 2; v++) {
+            MString *s = pgraph_glsl_gen_psh(&corpus.psh[i], psh_opts(v));
+            out->psh[i][v] = g_strdup(mstring_get_str(s));
+            mstring_unref(s);
+        }
+        for (int v = 0; v < 4; v++) {
+            MString *s = pgraph_glsl_gen_vsh(&corpus.vsh[i], vsh_opts(v));
+            out->vsh[i][v] = g_strdup(mstring_get_str(s));
+            mstring_unref(s);
+        }
+    }
+}
+
+static void free_all(Output *out)
+{
+    for (int i = 0; i < NUM_STATES; i++) {
+        for (int v = 0; v < 2; v++) {
+            g_free(out->psh[i][v]);
+        }
+        for (int v = 0; v < 4; v++) {
+            g_free(out->vsh[i][v]);
+        }
+    }
+}
+
+static void compare_all(const Output *a, const Output *b)
+{
+    for (int i = 0; i < NUM_STATES; i++) {
+        for (int v = 0; v < 2; v++) {
+            assert(!strcmp(a->psh[i][v], b->psh[i][v]));
+        }
+        for (int v = 0; v < 4; v++) {
+            assert(!strcmp(a->vsh[i][v], b->vsh[i][v]));
+        }
+    }
+}
+
+static void *generate_thread(void *opaque)
+{
+    generate_all(opaque);
+    return NULL;
+}
+
+/*
+ * Must run first: the cached declarations are built by whichever thread
+ * gets there first, with the others waiting on it.
+ */
+static void first_use_from_threads(Output *outputs)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    pthread_t threads[NUM_THREADS];
+    for (int t = 0; t < NUM_THREADS; t++) {
+        assert(!pthread_create(&threads[t], NULL, generate_thread,
+                               &outputs[t]));
+    }
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    for (int t = 1; t < NUM_THREADS; t++) {
+        compare_all(&outputs[0], &outputs[t]);
+    }
+
+    fprintf(stderr, "ok!\n");
+}
+
+static void uniform_decls(const Output *out)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    for (int v = 0; v < 2; v++) {
+        g_autofree char *decls = expected_psh_uniforms(psh_opts(v).vulkan);
+        for (int i = 0; i < NUM_STATES; i++) {
+            assert(count_occurrences(out->psh[i][v], decls) == 1);
+        }
+    }
+
+    for (int v = 0; v < 4; v++) {
+        GenVshGlslOptions opts = vsh_opts(v);
+        for (int i = 0; i < NUM_STATES; i++) {
+            bool inline_values = corpus.vsh[i].uniform_attrs &&
+                                 !opts.use_push_constants_for_uniform_attrs;
+            g_autofree char *decls =
+                expected_vsh_uniforms(opts.vulkan, inline_values);
+            assert(count_occurrences(out->vsh[i][v], decls) == 1);
+        }
+    }
+
+    fprintf(stderr, "ok!\n");
+}
+
+/* Strings come back from the pool with their old contents gone */
+static void regenerate(const Output *first)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    for (int iter = 0; iter < 3; iter++) {
+        Output again;
+        generate_all(&again);
+        compare_all(first, &again);
+        free_all(&again);
+    }
+
+    fprintf(stderr, "ok!\n");
+}
+
+static void bench(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    double best_ns = 1e30;
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < NUM_STATES; i++) {
+            mstring_unref(pgraph_glsl_gen_psh(&corpus.psh[i], psh_opts(i)));
+            mstring_unref(pgraph_glsl_gen_vsh(&corpus.vsh[i], vsh_opts(i)));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 +
+                    (end.tv_nsec - start.tv_nsec);
+        best_ns = MIN(best_ns, ns);
+    }
+
+    fprintf(stderr, "  %.0f ns per pixel + vertex shader pair\n",
+            best_ns / NUM_STATES);
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+    gen_psh_corpus(corpus.psh, NUM_STATES);
+    gen_vsh_corpus(corpus.vsh, NUM_STATES);
+
+    static Output outputs[NUM_THREADS];
+    first_use_from_threads(outputs);
+    uniform_decls(&outputs[0]);
+    regenerate(&outputs[0]);
+    bench();
+
+    for (int t = 0; t < NUM_THREADS; t++) {
+        free_all(&outputs[t]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Crosscheck and benchmark incremental shader state tracking.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hw/xbox/nv2a/nv2a_regs.h"
+#include "hw/xbox/nv2a/pgraph/glsl/shader-deps.h"
+
+#define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
+
+#define NUM_REGS (0x2000 / 4)
+
+/*
+ * Replays a register-write trace through two models of the shader state
+ * binding path:
+ *
+ * - full: what pgraph_glsl_check_shader_state_dirty used to do, scanning the
+ *   dirty bit of every register shader state depends on, then rebuilding and
+ *   hashing the whole ShaderState on any change.
+ *
+ * - incremental: register writes accumulate a mask of dirty ShaderState parts
+ *   via pgraph_glsl_shader_state_reg_deps, and only dirty parts are rebuilt and
+ *   hashed.
+ *
+ * Rebuilding is modeled by reading the input registers of a part into a
+ * buffer the size of that part (roughly sizeof(VshState), sizeof(GeomState)
+ * and sizeof(PshState) for a fixed-function vertex pipeline).
+ *
+ * A trace may be given as a text file with one operation per line:
+ *
+ *   w <reg> <value>    register write (hex offset and value)
+ *   d                  draw
+ *
+ * Without an argument a synthetic trace is generated.
+ */
+
+static const size_t part_sizes[SHADER_STATE_PART__COUNT] = {
+    [SHADER_STATE_PART_VSH] = 2400,
+    [SHADER_STATE_PART_GEOM] = 28,
+    [SHADER_STATE_PART_PSH] = 460,
+};
+
+/* Registers checked by the previous pgraph_glsl_check_shader_state_dirty */
+static const unsigned int checked_regs[] = {
+    NV_PGRAPH_COMBINECTL,      NV_PGRAPH_COMBINESPECFOG0,
+    NV_PGRAPH_COMBINESPECFOG1, NV_PGRAPH_CONTROL_0,
+    NV_PGRAPH_CONTROL_3,       NV_PGRAPH_CSV0_C,
+    NV_PGRAPH_CSV0_D,          NV_PGRAPH_CSV1_A,
+    NV_PGRAPH_CSV1_B,          NV_PGRAPH_POINTSIZE,
+    NV_PGRAPH_SETUPRASTER,     NV_PGRAPH_SHADERCLIPMODE,
+    NV_PGRAPH_SHADERCTL,       NV_PGRAPH_SHADERPROG,
+    NV_PGRAPH_SHADOWCTL,       NV_PGRAPH_ZCOMPRESSOCCLUDE,
+};
+
+static const unsigned int checked_reg_arrays[][2] = {
+    { NV_PGRAPH_COMBINEALPHAI0, 8 }, { NV_PGRAPH_COMBINEALPHAO0, 8 },
+    { NV_PGRAPH_COMBINECOLORI0, 8 }, { NV_PGRAPH_COMBINECOLORO0, 8 },
+    { NV_PGRAPH_TEXCTL0_0, 4 },      { NV_PGRAPH_TEXFILTER0, 4 },
+    { NV_PGRAPH_TEXFMT0, 4 },
+};
+
+typedef struct TraceOp {
+    uint16_t reg; /* Register index, or UINT16_MAX for a draw */
+    uint32_t value;
+} TraceOp;
+
+typedef struct Trace {
+    TraceOp *ops;
+    size_t num_ops, num_draws, capacity;
+} Trace;
+
+static void trace_append(Trace *t, uint16_t reg, uint32_t value)
+{
+    if (t->num_ops == t->capacity) {
+        t->capacity = t->capacity ? t->capacity * 2 : 1024;
+        t->ops = realloc(t->ops, t->capacity * sizeof(TraceOp));
+        assert(t->ops);
+    }
+    t->ops[t->num_ops++] = (TraceOp){ reg, value };
+    if (reg == UINT16_MAX) {
+        t->num_draws++;
+    }
+}
+
+static void trace_load(Trace *t, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    assert(f && "Error opening trace");
+
+    char line[100];
+    unsigned int reg, value;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == 'd') {
+            trace_append(t, UINT16_MAX, 0);
+        } else if (sscanf(line, "w %x %x", &reg, &value) == 2) {
+            assert(reg < 0x2000 && reg % 4 == 0);
+            trace_append(t, reg / 4, value);
+        }
+    }
+    fclose(f);
+}
+
+/*
+ * A frame of draws cycling through a handful of materials. Every draw updates
+ * the texture and combiner registers of its material, most with values that
+ * are already set, along with a number of registers not affecting shaders.
+ */
+static void trace_generate(Trace *t, int num_frames)
+{
+    static const unsigned int other_regs[] = {
+        NV_PGRAPH_BLEND, NV_PGRAPH_CONTROL_1, NV_PGRAPH_CONTROL_2,
+        NV_PGRAPH_FOGCOLOR, NV_PGRAPH_TEXADDRESS0,
+        NV_PGRAPH_TEXIMAGERECT0, NV_PGRAPH_TEXOFFSET0, NV_PGRAPH_TEXPALETTE0,
+    };
+    const int num_materials = 6, draws_per_frame = 800;
+
+    srand(1);
+    for (int frame = 0; frame < num_frames; frame++) {
+        for (int draw = 0; draw < draws_per_frame; draw++) {
+            int material = (draw / 40) % num_materials;
+            for (int i = 0; i < 4; i++) {
+                trace_append(t, (NV_PGRAPH_TEXFMT0 + i * 4) / 4,
+                             0x10000 * material + i);
+                trace_append(t, (NV_PGRAPH_TEXCTL0_0 + i * 4) / 4,
+                             material & 1 ? 0x40000000 : 0);
+            }
+            for (int i = 0; i < 2; i++) {
+                trace_append(t, (NV_PGRAPH_COMBINECOLORI0 + i * 4) / 4,
+                             0x1000 * material);
+                trace_append(t, (NV_PGRAPH_COMBINEALPHAI0 + i * 4) / 4,
+                             0x1000 * material);
+            }
+            trace_append(t, NV_PGRAPH_CONTROL_0 / 4, 0x100 * (material % 2));
+            for (int i = 0; i < ARRAY_SIZE(other_regs); i++) {
+                trace_append(t, other_regs[i] / 4, rand());
+            }
+            trace_append(t, UINT16_MAX, 0);
+        }
+    }
+}
+
+static uint64_t hash_bytes(const uint8_t *data, size_t len)
+{
+    /* Stand-in for fast_hash, cost scales with length in the same way */
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, sizeof(v));
+        h = (h ^ v) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+    }
+    for (; i < len; i++) {
+        h = (h ^ data[i]) * 0x94D049BB133111EBull;
+    }
+    return h;
+}
+
+static uint16_t part_regs[SHADER_STATE_PART__COUNT][NUM_REGS];
+static int num_part_regs[SHADER_STATE_PART__COUNT];
+
+static void init_part_regs(void)
+{
+    for (int i = 0; i < NUM_REGS; i++) {
+        for (int p = 0; p < SHADER_STATE_PART__COUNT; p++) {
+            if (pgraph_glsl_shader_state_reg_deps[i] & (1 << p)) {
+                part_regs[p][num_part_regs[p]++] = i;
+            }
+        }
+    }
+}
+
+static void build_part(const uint32_t *regs, int part, uint8_t *buf)
+{
+    memset(buf, 0, part_sizes[part]);
+    for (int i = 0; i < num_part_regs[part]; i++) {
+        uint32_t v = regs[part_regs[part][i]];
+        memcpy(buf + (i * sizeof(v)) % part_sizes[part], &v, 1);
+    }
+}
+
+typedef struct Model {
+    uint32_t regs[NUM_REGS];
+    bool regs_dirty[NUM_REGS];
+    unsigned int parts_dirty;
+    uint8_t state[SHADER_STATE_PART__COUNT][2400];
+    uint64_t part_hashes[SHADER_STATE_PART__COUNT];
+    uint64_t hash;
+    size_t num_rebuilds;
+} Model;
+
+static bool full_check_dirty(Model *m)
+{
+    for (int i = 0; i < ARRAY_SIZE(checked_regs); i++) {
+        if (m->regs_dirty[checked_regs[i] / 4]) {
+            return true;
+        }
+    }
+    for (int i = 0; i < ARRAY_SIZE(checked_reg_arrays); i++) {
+        for (int j = 0; j < checked_reg_arrays[i][1]; j++) {
+            if (m->regs_dirty[checked_reg_arrays[i][0] / 4 + j]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void run_full(Model *m, const Trace *t)
+{
+    for (size_t i = 0; i < t->num_ops; i++) {
+        const TraceOp *op = &t->ops[i];
+        if (op->reg != UINT16_MAX) {
+            if (m->regs[op->reg] != op->value) {
+                m->regs_dirty[op->reg] = true;
+            }
+            m->regs[op->reg] = op->value;
+            continue;
+        }
+
+        if (full_check_dirty(m)) {
+            for (int p = 0; p < SHADER_STATE_PART__COUNT; p++) {
+                build_part(m->regs, p, m->state[p]);
+            }
+            m->hash = hash_bytes(&m->state[0][0], sizeof(m->state));
+            m->num_rebuilds++;
+        }
+        memset(m->regs_dirty, 0, sizeof(m->regs_dirty));
+    }
+}
+
+static void run_incremental(Model *m, const Trace *t)
+{
+    for (size_t i = 0; i < t->num_ops; i++) {
+        const TraceOp *op = &t->ops[i];
+        if (op->reg != UINT16_MAX) {
+            if (m->regs[op->reg] != op->value) {
+                m->parts_dirty |= pgraph_glsl_shader_state_reg_deps[op->reg];
+            }
+            m->regs[op->reg] = op->value;
+            continue;
+        }
+
+        if (m->parts_dirty) {
+            for (int p = 0; p < SHADER_STATE_PART__COUNT; p++) {
+                if (m->parts_dirty & (1 << p)) {
+                    build_part(m->regs, p, m->state[p]);
+                    m->part_hashes[p] =
+                        hash_bytes(m->state[p], part_sizes[p]);
+                }
+            }
+            m->hash = hash_bytes((const uint8_t *)m->part_hashes,
+                                 sizeof(m->part_hashes));
+            m->parts_dirty = 0;
+            m->num_rebuilds++;
+        }
+    }
+}
+
+static void crosscheck(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    /* Every register the previous check considered must mark some part */
+    for (int i = 0; i < ARRAY_SIZE(checked_regs); i++) {
+        assert(pgraph_glsl_shader_state_reg_deps[checked_regs[i] / 4]);
+    }
+    for (int i = 0; i < ARRAY_SIZE(checked_reg_arrays); i++) {
+        for (int j = 0; j < checked_reg_arrays[i][1]; j++) {
+            assert(pgraph_glsl_shader_state_reg_deps[
+                checked_reg_arrays[i][0] / 4 + j]);
+        }
+    }
+
+    /* ...and nothing else */
+    int num_checked = ARRAY_SIZE(checked_regs);
+    for (int i = 0; i < ARRAY_SIZE(checked_reg_arrays); i++) {
+        num_checked += checked_reg_arrays[i][1];
+    }
+    int num_deps = 0;
+    for (int i = 0; i < NUM_REGS; i++) {
+        num_deps += !!pgraph_glsl_shader_state_reg_deps[i];
+    }
+    assert(num_deps == num_checked);
+
+    fprintf(stderr, "ok!\n");
+}
+
+/* As nv2a_reset(): registers go back to zero, every part must be rebuilt */
+static void model_reset(Model *m)
+{
+    memset(m->regs, 0, sizeof(m->regs));
+    m->parts_dirty = (1 << SHADER_STATE_PART__COUNT) - 1;
+}
+
+/*
+ * A guest relying on the zero reset value of a register it never writes
+ * must not get the shader built from the value it had before the reset.
+ */
+static void reset(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    Trace setup = { 0 }, draw = { 0 };
+    for (int i = 0; i < NUM_REGS; i++) {
+        if (pgraph_glsl_shader_state_reg_deps[i]) {
+            trace_append(&setup, i, 0xFFFFFFFF);
+        }
+    }
+    trace_append(&setup, UINT16_MAX, 0);
+    trace_append(&draw, UINT16_MAX, 0);
+
+    Model *fresh = calloc(1, sizeof(Model));
+    fresh->parts_dirty = (1 << SHADER_STATE_PART__COUNT) - 1;
+    run_incremental(fresh, &draw);
+
+    Model *m = calloc(1, sizeof(Model));
+    m->parts_dirty = (1 << SHADER_STATE_PART__COUNT) - 1;
+    run_incremental(m, &setup);
+    assert(m->hash != fresh->hash);
+
+    model_reset(m);
+    run_incremental(m, &draw);
+    assert(m->hash == fresh->hash);
+    assert(!memcmp(m->state, fresh->state, sizeof(m->state)));
+
+    free(m);
+    free(fresh);
+    free(setup.ops);
+    free(draw.ops);
+
+    fprintf(stderr, "ok!\n");
+}
+
+#define NUM_ITERATIONS 10
+
+static int compare_ints(const void *a, const void *b)
+{
+    return *(int*)a - *(int*)b;
+}
+
+static void bench_one(const char *name, void (*run)(Model *, const Trace *),
+                      const Trace *t)
+{
+    int samples[NUM_ITERATIONS];
+    int sum = 0;
+    size_t num_rebuilds = 0;
+
+    fprintf(stderr, "[%11s] ", name);
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        Model *m = calloc(1, sizeof(Model));
+        m->parts_dirty = (1 << SHADER_STATE_PART__COUNT) - 1;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        run(m, t);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        uint64_t start_ns = (uint64_t)start.tv_sec * (uint64_t)1000000000 + start.tv_nsec;
+        uint64_t end_ns   = (uint64_t)end.tv_sec   * (uint64_t)1000000000 + end.tv_nsec;
+
+        samples[iter] = (end_ns - start_ns) / 1000;
+        sum += samples[iter];
+        num_rebuilds = m->num_rebuilds;
+        free(m);
+    }
+
+    qsort(samples, ARRAY_SIZE(samples), sizeof(samples[0]), compare_ints);
+
+    int min = samples[0],
+        max = samples[ARRAY_SIZE(samples) - 1],
+        avg = sum / ARRAY_SIZE(samples),
+        med = samples[ARRAY_SIZE(samples) / 2];
+
+    fprintf(stderr, "min: %6d us, max: %6d us, avg: %6d us, med: %6d us  -- "
+                    "%.1f ns/draw, %zu rebuilds\n",
+            min, max, avg, med, med * 1000.0 / t->num_draws, num_rebuilds);
+}
+
+static void bench(const Trace *t)
+{
+    fprintf(stderr, "%s...", __func__);
+    fprintf(stderr, "with %zu register writes, %zu draws, iterations: %d\n",
+            t->num_ops - t->num_draws, t->num_draws, NUM_ITERATIONS);
+
+    bench_one("full", run_full, t);
+    bench_one("incremental", run_incremental, t);
+}
+
+int main(int argc, char const *argv[])
+{
+    Trace trace = { 0 };
+
+    if (argc > 1) {
+        trace_load(&trace, argv[1]);
+    } else {
+        trace_generate(&trace, 60);
+    }
+
+    init_part_regs();
+    crosscheck();
+    reset();
+    bench(&trace);
+
+    free(trace.ops);
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * Benchmark snapshot RAM encoding over synthetic guest memory images.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "migration/snapshot-ram-codec.h"
+
+#define RAM_SIZE (64 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define NUM_PAGES (RAM_SIZE / PAGE_SIZE)
+#define CHUNK_PAGES SNAPSHOT_CHUNK_MAX_PAGES
+#define CHUNK_SIZE (CHUNK_PAGES * PAGE_SIZE)
+#define NUM_CHUNKS (NUM_PAGES / CHUNK_PAGES)
+#define NUM_THREADS 4
+
+/* Stream overhead per record, see ram_save_snapshot_chunk() */
+#define PAGE_HEADER_SIZE 8
+#define CHUNK_HEADER_SIZE (PAGE_HEADER_SIZE + 1 + 1 + 8 + 4)
+
+typedef struct EncodedChunk {
+    uint8_t kinds[CHUNK_PAGES];
+    uint8_t codec;
+    size_t payload_len;
+    uint8_t *payload;
+} EncodedChunk;
+
+typedef struct Run {
+    const uint8_t *ram;
+    const uint8_t *base;
+    uint8_t *out;
+    bool compress;
+    EncodedChunk chunks[NUM_CHUNKS];
+    atomic_int next;
+} Run;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void fill_page(uint8_t *page)
+{
+    static const char *tokens[] = {
+        "mov eax, ", "push ebp", "call ", "ret", "D3DDevice_", "texture",
+        "\x00\x00\x80\x3f", "\xff\xff\xff\xff", "vertex", "\x90\x90\x90\x90",
+    };
+    int kind = rand() % 100;
+
+    if (kind < 35) {
+        /* Untouched memory */
+        memset(page, 0, PAGE_SIZE);
+    } else if (kind < 60) {
+        /* Code and game data, built from a small vocabulary */
+        size_t len = 0;
+        while (len < PAGE_SIZE) {
+            const char *t = tokens[rand() % 10];
+            size_t n = strlen(t) ? strlen(t) : 4;
+            n = n < PAGE_SIZE - len ? n : PAGE_SIZE - len;
+            memcpy(page + len, t, n);
+            len += n;
+        }
+    } else if (kind < 80) {
+        /* Sparse structures, a few fields set */
+        memset(page, 0, PAGE_SIZE);
+        for (int i = 0; i < 32; i++) {
+            ((uint32_t *)page)[rand() % (PAGE_SIZE / 4)] = rand();
+        }
+    } else if (kind < 90) {
+        /* Uncompressed textures, smooth with some noise */
+        int v = rand() & 0xff;
+        for (int i = 0; i < PAGE_SIZE; i++) {
+            v += (rand() % 5) - 2;
+            page[i] = v;
+        }
+    } else {
+        /* Compressed assets */
+        for (int i = 0; i < PAGE_SIZE; i++) {
+            page[i] = rand();
+        }
+    }
+}
+
+/* What the guest does between two snapshots */
+static void mutate_image(uint8_t *ram)
+{
+    for (int p = 0; p < NUM_PAGES; p++) {
+        uint8_t *page = ram + p * PAGE_SIZE;
+        int kind = rand() % 100;
+        if (kind < 6) {
+            for (int i = 0; i < 8; i++) {
+                ((uint32_t *)page)[rand() % (PAGE_SIZE / 4)] = rand();
+            }
+        } else if (kind < 10) {
+            fill_page(page);
+        } else if (kind < 11) {
+            memset(page, 0, PAGE_SIZE);
+        }
+    }
+}
+
+static void *encode_worker(void *opaque)
+{
+    Run *run = opaque;
+    SnapshotChunk c;
+    snapshot_chunk_init(&c, PAGE_SIZE);
+
+    for (int i; (i = atomic_fetch_add(&run->next, 1)) < NUM_CHUNKS;) {
+        EncodedChunk *e = &run->chunks[i];
+        snapshot_chunk_encode(&c, run->ram + i * CHUNK_SIZE,
+                              run->base ? run->base + i * CHUNK_SIZE : NULL,
+                              CHUNK_PAGES, run->compress);
+        memcpy(e->kinds, c.kinds, CHUNK_PAGES);
+        e->codec = c.codec;
+        e->payload_len = c.payload_len;
+        e->payload = malloc(c.payload_len ? c.payload_len : 1);
+        memcpy(e->payload, c.payload, c.payload_len);
+    }
+
+    snapshot_chunk_finalize(&c);
+    return NULL;
+}
+
+static void *decode_worker(void *opaque)
+{
+    Run *run = opaque;
+    SnapshotChunk c;
+    snapshot_chunk_init(&c, PAGE_SIZE);
+
+    for (int i; (i = atomic_fetch_add(&run->next, 1)) < NUM_CHUNKS;) {
+        EncodedChunk *e = &run->chunks[i];
+        c.num_pages = CHUNK_PAGES;
+        memcpy(c.kinds, e->kinds, CHUNK_PAGES);
+        c.codec = e->codec;
+        c.payload_len = e->payload_len;
+        memcpy(c.payload, e->payload, e->payload_len);
+        int ret = snapshot_chunk_decode(&c, run->out + i * CHUNK_SIZE,
+                                        run->base ? run->base + i * CHUNK_SIZE :
+                                                    NULL);
+        assert(ret == 0);
+    }
+
+    snapshot_chunk_finalize(&c);
+    return NULL;
+}
+
+static double run_threads(Run *run, void *(*func)(void *))
+{
+    pthread_t threads[NUM_THREADS];
+    double start = now_ms();
+
+    atomic_store(&run->next, 0);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_create(&threads[i], NULL, func, run);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    return now_ms() - start;
+}
+
+/* Size of the same image as one record per page */
+static size_t legacy_size(const uint8_t *ram)
+{
+    size_t size = 0;
+    for (int p = 0; p < NUM_PAGES; p++) {
+        const uint8_t *page = ram + p * PAGE_SIZE;
+        bool zero = page[0] == 0 && !memcmp(page, page + 1, PAGE_SIZE - 1);
+        size += PAGE_HEADER_SIZE + (zero ? 1 : PAGE_SIZE);
+    }
+    return size;
+}
+
+static size_t run_mode(const char *name, const uint8_t *ram,
+                       const uint8_t *base, bool compress)
+{
+    Run *run = calloc(1, sizeof(*run));
+    assert(run);
+    run->ram = ram;
+    run->base = base;
+    run->compress = compress;
+    run->out = malloc(RAM_SIZE);
+    assert(run->out);
+    memset(run->out, 0xcd, RAM_SIZE);
+
+    double save_ms = run_threads(run, encode_worker);
+    double load_ms = run_threads(run, decode_worker);
+    assert(!memcmp(run->out, ram, RAM_SIZE));
+
+    size_t size = 0;
+    for (int i = 0; i < NUM_CHUNKS; i++) {
+        size += CHUNK_HEADER_SIZE + CHUNK_PAGES + run->chunks[i].payload_len;
+        free(run->chunks[i].payload);
+    }
+
+    fprintf(stderr, "  %-10s %8.1f MiB  save %7.1f ms  load %7.1f ms\n", name,
+            size / (1024.0 * 1024.0), save_ms, load_ms);
+
+    free(run->out);
+    free(run);
+    return size;
+}
+
+static void encode_images(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    uint8_t *base = malloc(RAM_SIZE);
+    uint8_t *ram = malloc(RAM_SIZE);
+    assert(base && ram);
+
+    for (int p = 0; p < NUM_PAGES; p++) {
+        fill_page(base + p * PAGE_SIZE);
+    }
+    memcpy(ram, base, RAM_SIZE);
+    mutate_image(ram);
+
+    bool can_compress = snapshot_chunk_can_compress();
+    fprintf(stderr, "  %d MiB image, %d threads, zstd %s\n",
+            RAM_SIZE / (1024 * 1024), NUM_THREADS,
+            can_compress ? "enabled" : "not available");
+    size_t legacy = legacy_size(ram);
+    fprintf(stderr, "  %-10s %8.1f MiB\n", "per-page",
+            legacy / (1024.0 * 1024.0));
+
+    size_t zero = run_mode("zero", ram, NULL, false);
+    size_t full = can_compress ? run_mode("zstd", ram, NULL, true) : zero;
+    size_t delta = run_mode("delta", ram, base, can_compress);
+
+    assert(zero < legacy);
+    assert(full <= zero);
+    assert(delta < full);
+
+    free(ram);
+    free(base);
+
+    fprintf(stderr, "ok!\n");
+}
+
+static void reject_malformed(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    uint8_t *pages = malloc(CHUNK_SIZE);
+    uint8_t *out = malloc(CHUNK_SIZE);
+    assert(pages && out);
+    for (int p = 0; p < CHUNK_PAGES; p++) {
+        fill_page(pages + p * PAGE_SIZE);
+    }
+    memset(pages, 0x11, PAGE_SIZE);
+
+    SnapshotChunk c;
+    snapshot_chunk_init(&c, PAGE_SIZE);
+
+    /* A delta cannot be decoded without its base */
+    snapshot_chunk_encode(&c, pages, pages, CHUNK_PAGES, true);
+    assert(snapshot_chunk_uses_base(&c));
+    assert(snapshot_chunk_decode(&c, out, NULL) < 0);
+    assert(snapshot_chunk_decode(&c, out, pages) == 0);
+    assert(!memcmp(out, pages, CHUNK_SIZE));
+
+    /* Payload must match the pages that carry data */
+    snapshot_chunk_encode(&c, pages, NULL, CHUNK_PAGES, false);
+    assert(c.codec == SNAPSHOT_CODEC_NONE);
+    c.payload_len -= 1;
+    assert(snapshot_chunk_decode(&c, out, NULL) < 0);
+
+    snapshot_chunk_encode(&c, pages, NULL, CHUNK_PAGES, false);
+    c.kinds[0] = SNAPSHOT_PAGE__COUNT;
+    assert(snapshot_chunk_decode(&c, out, NULL) < 0);
+
+    snapshot_chunk_encode(&c, pages, NULL, CHUNK_PAGES, false);
+    c.codec = SNAPSHOT_CODEC__COUNT;
+    assert(snapshot_chunk_decode(&c, out, NULL) < 0);
+
+    snapshot_chunk_finalize(&c);
+    free(out);
+    free(pages);
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    reject_malformed();
+    encode_images();
+
+    return 0;
+}
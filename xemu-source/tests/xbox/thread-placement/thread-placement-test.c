@@ -0,0 +1,308 @@
+/*
+ * Test host CPU topology parsing and emulator thread layout.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "qemu/osdep.h"
+#include "qemu/cpu-topology.h"
+
+static CpuTopology topo;
+
+static char root[64];
+
+static void write_file(const char *value, const char *fmt, ...)
+{
+    char path[256], dir[256];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = snprintf(path, sizeof(path), "%s/", root);
+    vsnprintf(path + n, sizeof(path) - n, fmt, ap);
+    va_end(ap);
+
+    /* mkdir -p */
+    strcpy(dir, path);
+    for (char *p = dir + strlen(root) + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(dir, 0755);
+            *p = '/';
+        }
+    }
+
+    FILE *f = fopen(path, "w");
+    assert(f);
+    fprintf(f, "%s\n", value);
+    fclose(f);
+}
+
+static void make_root(void)
+{
+    strcpy(root, "/tmp/thread-placement-XXXXXX");
+    assert(mkdtemp(root));
+}
+
+static void remove_root(void)
+{
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+    assert(system(cmd) == 0);
+}
+
+static void add_cpu(int cpu, const char *siblings, int cluster,
+                    const char *llc_cpus, int capacity, int max_freq)
+{
+    char buf[32];
+
+    write_file(siblings, "cpu%d/topology/thread_siblings_list", cpu);
+    write_file("0", "cpu%d/topology/physical_package_id", cpu);
+    snprintf(buf, sizeof(buf), "%d", cluster);
+    write_file(buf, "cpu%d/topology/cluster_id", cpu);
+
+    write_file("Data", "cpu%d/cache/index0/type", cpu);
+    write_file("1", "cpu%d/cache/index0/level", cpu);
+    snprintf(buf, sizeof(buf), "%d", cpu);
+    write_file(buf, "cpu%d/cache/index0/shared_cpu_list", cpu);
+    write_file("Instruction", "cpu%d/cache/index1/type", cpu);
+    write_file("1", "cpu%d/cache/index1/level", cpu);
+    write_file(buf, "cpu%d/cache/index1/shared_cpu_list", cpu);
+    write_file("Unified", "cpu%d/cache/index2/type", cpu);
+    write_file("3", "cpu%d/cache/index2/level", cpu);
+    write_file(llc_cpus, "cpu%d/cache/index2/shared_cpu_list", cpu);
+
+    if (capacity) {
+        snprintf(buf, sizeof(buf), "%d", capacity);
+        write_file(buf, "cpu%d/cpu_capacity", cpu);
+    }
+    if (max_freq) {
+        snprintf(buf, sizeof(buf), "%d", max_freq);
+        write_file(buf, "cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    }
+}
+
+static void assert_cpus(const CpuSet *set, const char *expected)
+{
+    char buf[128];
+    cpu_set_format(set, buf, sizeof(buf));
+    if (strcmp(buf, expected)) {
+        fprintf(stderr, "  got %s, expected %s\n", buf, expected);
+        assert(0);
+    }
+}
+
+static void cpu_lists(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    CpuSet set;
+    char buf[16];
+
+    assert(cpu_set_parse_list(&set, "0-3,8,10-11\n"));
+    assert(cpu_set_count(&set) == 7);
+    assert(cpu_set_has(&set, 10) && !cpu_set_has(&set, 9));
+    assert_cpus(&set, "0-3,8,10-11");
+
+    assert(cpu_set_parse_list(&set, "255"));
+    assert_cpus(&set, "255");
+    assert(cpu_set_parse_list(&set, ""));
+    assert(!cpu_set_count(&set));
+
+    assert(!cpu_set_parse_list(&set, "3-1"));
+    assert(!cpu_set_parse_list(&set, "1,x"));
+    assert(!cpu_set_parse_list(&set, "-1"));
+
+    /* Truncated at a whole range */
+    assert(cpu_set_parse_list(&set, "0-3,8,10-11"));
+    cpu_set_format(&set, buf, 8);
+    assert(!strcmp(buf, "0-3,8"));
+
+    fprintf(stderr, "ok!\n");
+}
+
+/*
+ * Four P-cores with SMT followed by four E-cores in one cluster, all
+ * sharing the L3.
+ */
+static void hybrid_host(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    make_root();
+    write_file("0-11", "online");
+    for (int cpu = 0; cpu < 8; cpu++) {
+        char siblings[16];
+        snprintf(siblings, sizeof(siblings), "%d-%d", cpu & ~1, cpu | 1);
+        add_cpu(cpu, siblings, cpu / 2, "0-11", 1024, 0);
+    }
+    for (int cpu = 8; cpu < 12; cpu++) {
+        char siblings[16];
+        snprintf(siblings, sizeof(siblings), "%d", cpu);
+        add_cpu(cpu, siblings, 4, "0-11", 400, 0);
+    }
+
+    assert(cpu_topology_read(&topo, root));
+    remove_root();
+
+    assert(topo.num_cpus == 12 && topo.num_cores == 8);
+    assert(topo.smt && topo.hybrid);
+    assert_cpus(&topo.cores[0].cpus, "0-1");
+    assert_cpus(&topo.cores[3].cpus, "6-7");
+    assert_cpus(&topo.cores[4].cpus, "8");
+    assert(topo.cores[4].capacity == 400 && topo.cores[4].cluster == 4);
+    assert(topo.cores[7].llc == 0);
+
+    int counts[THREAD_CLASS__COUNT] = {
+        [THREAD_CLASS_VCPU] = 1,   [THREAD_CLASS_PFIFO] = 1,
+        [THREAD_CLASS_RENDER] = 1, [THREAD_CLASS_APU] = 1,
+        [THREAD_CLASS_DSP] = 2,    [THREAD_CLASS_INPUT] = 1,
+        [THREAD_CLASS_MAIN_LOOP] = 1, [THREAD_CLASS_VOICE] = 4,
+    };
+    CpuSet cpus;
+
+    /* Whole P-cores for the busiest threads, then the E-cores */
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_VCPU, 0, &cpus);
+    assert_cpus(&cpus, "0-1");
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_PFIFO, 0, &cpus);
+    assert_cpus(&cpus, "2-3");
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_RENDER, 0, &cpus);
+    assert_cpus(&cpus, "4-5");
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_DSP, 1, &cpus);
+    assert_cpus(&cpus, "9");
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_MAIN_LOOP, 0, &cpus);
+    assert_cpus(&cpus, "11");
+
+    /* Out of cores: share everything past the vCPU, PFIFO and render */
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_VOICE, 3, &cpus);
+    assert_cpus(&cpus, "6-11");
+
+    /* Compact fills siblings first */
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_COMPACT, counts,
+                        THREAD_CLASS_PFIFO, 0, &cpus);
+    assert_cpus(&cpus, "1");
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_COMPACT, counts,
+                        THREAD_CLASS_VOICE, 3, &cpus);
+    assert_cpus(&cpus, "11");
+
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_OFF, counts,
+                        THREAD_CLASS_VCPU, 0, &cpus);
+    assert_cpus(&cpus, "0-11");
+
+    /* Restricted to the first two P-cores and one E-core */
+    CpuSet allowed;
+    assert(cpu_set_parse_list(&allowed, "0-2,8"));
+    cpu_topology_restrict(&topo, &allowed);
+    assert(topo.num_cores == 3 && topo.num_cpus == 4 && topo.smt);
+    assert_cpus(&topo.cores[1].cpus, "2");
+    cpu_topology_layout(&topo, THREAD_PLACEMENT_SPREAD, counts,
+                        THREAD_CLASS_APU, 0, &cpus);
+    assert_cpus(&cpus, "8");
+
+    fprintf(stderr, "ok!\n");
+}
+
+/*
+ * Two last level caches without SMT, where the second holds the cores that
+ * boost highest. That one is used first, and the first is not interleaved
+ * with it.
+ */
+static void split_cache_host(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    make_root();
+    write_file("0-7", "online");
+    for (int cpu = 0; cpu < 8; cpu++) {
+        char siblings[16];
+        snprintf(siblings, sizeof(siblings), "%d", cpu);
+        int freq = cpu == 5 ? 4200000 : cpu == 1 ? 4100000 : 4000000;
+        add_cpu(cpu, siblings, -1, cpu < 4 ? "0-3" : "4-7", 0, freq);
+    }
+
+    assert(cpu_topology_read(&topo, root));
+    remove_root();
+
+    assert(topo.num_cores == 8 && !topo.smt && !topo.hybrid);
+    static const int order[] = { 5, 4, 6, 7, 1, 0, 2, 3 };
+    for (int i = 0; i < 8; i++) {
+        assert(topo.cores[i].first_cpu == order[i]);
+    }
+
+    fprintf(stderr, "ok!\n");
+}
+
+static void missing_topology(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    /* No topology files: every cpu is its own core */
+    make_root();
+    write_file("0-3", "online");
+    assert(cpu_topology_read(&topo, root));
+    assert(topo.num_cores == 4 && !topo.smt && topo.cores[2].llc == -1);
+    remove_root();
+
+    assert(!cpu_topology_read(&topo, "/nonexistent"));
+
+    fprintf(stderr, "ok!\n");
+}
+
+static void print_host(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    if (!cpu_topology_read(&topo, "/sys/devices/system/cpu")) {
+        fprintf(stderr, "  no topology\n");
+        return;
+    }
+
+    fprintf(stderr, "  %d cores, %d threads%s%s\n", topo.num_cores,
+            topo.num_cpus, topo.smt ? ", SMT" : "",
+            topo.hybrid ? ", hybrid" : "");
+    for (int i = 0; i < topo.num_cores; i++) {
+        char buf[64];
+        cpu_set_format(&topo.cores[i].cpus, buf, sizeof(buf));
+        fprintf(stderr, "  core %2d: cpus %-8s llc %d capacity %d\n", i, buf,
+                topo.cores[i].llc, topo.cores[i].capacity);
+    }
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    cpu_lists();
+    hybrid_host();
+    split_cache_host();
+    missing_topology();
+    print_host();
+
+    return 0;
+}
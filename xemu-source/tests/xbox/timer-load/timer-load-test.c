@@ -0,0 +1,322 @@
+/*
+ * Measure deadline accuracy and CPU cost of main loop timer waits.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/prctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "qemu/osdep.h"
+#include "qemu/precise-wait.h"
+
+#define SCALE_MS 1000000LL
+
+/* As in qemu_poll_ns() before, and qemu_poll_deadline_ns() now */
+#define BUSYWAIT_THRESHOLD_NS 1250000
+#define MIN_MARGIN_NS 1000
+#define MAX_MARGIN_NS 100000
+
+/*
+ * Synthetic timer load: mostly timers armed a fraction of a millisecond
+ * apart, as games keep them, with some longer gaps in between.
+ */
+#define NUM_TIMERS 2000
+#define SHORT_PERCENT 80
+#define SHORT_MIN_NS 50000
+#define SHORT_MAX_NS 1500000
+#define LONG_MIN_NS 2000000
+#define LONG_MAX_NS 6000000
+
+typedef int (*WaitFunc)(struct pollfd *fds, int nfds, int64_t timeout);
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t thread_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int ppoll_ns(struct pollfd *fds, int nfds, int64_t timeout)
+{
+    struct timespec ts = {
+        .tv_sec = timeout / 1000000000LL,
+        .tv_nsec = timeout % 1000000000LL,
+    };
+    return ppoll(fds, nfds, &ts, NULL);
+}
+
+/* Before: spin on near deadlines, otherwise poll rounding up to 1 ms */
+static int wait_busy(struct pollfd *fds, int nfds, int64_t timeout)
+{
+    if (timeout < BUSYWAIT_THRESHOLD_NS) {
+        int64_t end = now_ns() + timeout;
+        while (now_ns() < end) {
+        }
+        timeout = 0;
+    }
+    return poll(fds, nfds, (timeout + SCALE_MS - 1) / SCALE_MS);
+}
+
+static int wait_ppoll(struct pollfd *fds, int nfds, int64_t timeout)
+{
+    return ppoll_ns(fds, nfds, timeout);
+}
+
+typedef struct WaitArgs {
+    struct pollfd *fds;
+    int nfds;
+} WaitArgs;
+
+static PreciseWait precise;
+static PreciseWaitStats precise_stats;
+
+static int sleep_ppoll(void *opaque, int64_t timeout)
+{
+    WaitArgs *args = opaque;
+    return ppoll_ns(args->fds, args->nfds, timeout);
+}
+
+/* Same as on hosts without ppoll */
+static int sleep_ms(void *opaque, int64_t timeout)
+{
+    WaitArgs *args = opaque;
+
+    if (timeout >= SCALE_MS) {
+        return poll(args->fds, args->nfds, timeout / SCALE_MS);
+    }
+
+    int ret = poll(args->fds, args->nfds, 0);
+    if (!ret) {
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = timeout };
+        nanosleep(&ts, NULL);
+    }
+    return ret;
+}
+
+static int wait_precise(struct pollfd *fds, int nfds, int64_t timeout)
+{
+    WaitArgs args = { fds, nfds };
+    int ret = precise_wait_until(&precise, now_ns() + timeout, now_ns,
+                                 sleep_ppoll, &args);
+    return ret ? ret : ppoll_ns(fds, nfds, 0);
+}
+
+static int wait_precise_ms(struct pollfd *fds, int nfds, int64_t timeout)
+{
+    WaitArgs args = { fds, nfds };
+    int ret = precise_wait_until(&precise, now_ns() + timeout, now_ns,
+                                 sleep_ms, &args);
+    return ret ? ret : poll(fds, nfds, 0);
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t rand_range(int64_t min, int64_t max)
+{
+    return min + (int64_t)rand() % (max - min);
+}
+
+static void print_hist(const uint64_t *hist)
+{
+    int last = PRECISE_WAIT_HIST_BUCKETS - 1;
+    while (last > 0 && !hist[last]) {
+        last--;
+    }
+
+    fprintf(stderr, "    late us:");
+    for (int i = 0; i <= last; i++) {
+        if (i == 0) {
+            fprintf(stderr, "  <1:%llu", (unsigned long long)hist[i]);
+        } else {
+            fprintf(stderr, "  %d:%llu", 1 << (i - 1),
+                    (unsigned long long)hist[i]);
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+static void run_load(const char *name, WaitFunc wait, const int64_t *gaps)
+{
+    int fds[2];
+    assert(pipe(fds) == 0);
+    struct pollfd pfd = { .fd = fds[0], .events = POLLIN };
+
+    int64_t *late = malloc(NUM_TIMERS * sizeof(int64_t));
+    uint64_t hist[PRECISE_WAIT_HIST_BUCKETS] = { 0 };
+    assert(late);
+
+    precise_wait_init(&precise, MIN_MARGIN_NS, MAX_MARGIN_NS, &precise_stats);
+    memset(&precise_stats, 0, sizeof(precise_stats));
+
+    int64_t start = now_ns();
+    int64_t start_cpu = thread_cpu_ns();
+    int64_t deadline = start;
+
+    for (int i = 0; i < NUM_TIMERS; i++) {
+        deadline += gaps[i];
+        int64_t now = now_ns();
+        /* Timers that are already due run without waiting */
+        if (deadline > now) {
+            assert(wait(&pfd, 1, deadline - now) == 0);
+        }
+        late[i] = MAX(now_ns() - deadline, 0);
+        hist[precise_wait_hist_bucket(late[i])]++;
+    }
+
+    double wall_ms = (now_ns() - start) / 1e6;
+    double cpu_ms = (thread_cpu_ns() - start_cpu) / 1e6;
+
+    qsort(late, NUM_TIMERS, sizeof(int64_t), cmp_int64);
+    fprintf(stderr,
+            "  %-12s cpu %5.1f%%  late p50 %6.1f us  p99 %7.1f us  "
+            "max %7.1f us\n",
+            name, 100.0 * cpu_ms / wall_ms, late[NUM_TIMERS / 2] / 1e3,
+            late[NUM_TIMERS * 99 / 100] / 1e3, late[NUM_TIMERS - 1] / 1e3);
+    print_hist(hist);
+    if (precise_stats.waits) {
+        fprintf(stderr, "    margin %.1f us, slept %.0f ms, spun %.1f ms\n",
+                precise.margin_ns / 1e3, precise_stats.sleep_ns / 1e6,
+                precise_stats.spin_ns / 1e6);
+    }
+
+    free(late);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void timer_load(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    int64_t *gaps = malloc(NUM_TIMERS * sizeof(int64_t));
+    assert(gaps);
+    int64_t total = 0;
+    for (int i = 0; i < NUM_TIMERS; i++) {
+        gaps[i] = rand() % 100 < SHORT_PERCENT ?
+                      rand_range(SHORT_MIN_NS, SHORT_MAX_NS) :
+                      rand_range(LONG_MIN_NS, LONG_MAX_NS);
+        total += gaps[i];
+    }
+    fprintf(stderr, "  %d timers over %.0f ms\n", NUM_TIMERS, total / 1e6);
+
+    run_load("busy-wait", wait_busy, gaps);
+    run_load("ppoll", wait_ppoll, gaps);
+    run_load("precise", wait_precise, gaps);
+    run_load("precise (ms)", wait_precise_ms, gaps);
+
+    free(gaps);
+
+    fprintf(stderr, "ok!\n");
+}
+
+static int64_t fake_clock_ns;
+static int64_t fake_sleep_late_ns;
+
+/* Each read takes 100 ns, so spinning makes progress */
+static int64_t fake_clock(void)
+{
+    fake_clock_ns += 100;
+    return fake_clock_ns;
+}
+
+static int fake_sleep(void *opaque, int64_t timeout)
+{
+    fake_clock_ns += timeout + fake_sleep_late_ns;
+    return 0;
+}
+
+static int fake_sleep_event(void *opaque, int64_t timeout)
+{
+    fake_clock_ns += timeout / 2;
+    return 1;
+}
+
+static void calibrate_margin(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    PreciseWaitStats stats = { 0 };
+    precise_wait_init(&precise, MIN_MARGIN_NS, MAX_MARGIN_NS, &stats);
+
+    /* Sleeps that wake up 20 us late pull the margin towards 20 us */
+    fake_sleep_late_ns = 20000;
+    for (int i = 0; i < 100; i++) {
+        int64_t deadline = fake_clock_ns + 1000000;
+        assert(precise_wait_until(&precise, deadline, fake_clock, fake_sleep,
+                                  NULL) == 0);
+        assert(fake_clock_ns >= deadline);
+    }
+    assert(precise.margin_ns >= 20000 && precise.margin_ns < 25000);
+
+    /* Precise sleeps bring it down to the minimum */
+    fake_sleep_late_ns = 0;
+    for (int i = 0; i < 100; i++) {
+        precise_wait_until(&precise, fake_clock_ns + 1000000, fake_clock,
+                           fake_sleep, NULL);
+    }
+    assert(precise.margin_ns == MIN_MARGIN_NS);
+
+    /* Sleeps far off the mark are bounded by the maximum */
+    fake_sleep_late_ns = 5000000;
+    for (int i = 0; i < 100; i++) {
+        precise_wait_until(&precise, fake_clock_ns + 1000000, fake_clock,
+                           fake_sleep, NULL);
+    }
+    assert(precise.margin_ns == MAX_MARGIN_NS);
+
+    /* Events end the wait and are passed on */
+    assert(precise_wait_until(&precise, fake_clock_ns + 1000000, fake_clock,
+                              fake_sleep_event, NULL) == 1);
+    assert(stats.waits == 300 && stats.interrupted == 1);
+
+    assert(precise_wait_hist_bucket(0) == 0);
+    assert(precise_wait_hist_bucket(999) == 0);
+    assert(precise_wait_hist_bucket(1000) == 1);
+    assert(precise_wait_hist_bucket(3999) == 2);
+    assert(precise_wait_hist_bucket(INT64_MAX) ==
+           PRECISE_WAIT_HIST_BUCKETS - 1);
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    /* As set up by init_clocks() */
+    prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+
+    calibrate_margin();
+    timer_load();
+
+    return 0;
+}
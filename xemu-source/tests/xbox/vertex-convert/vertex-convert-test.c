@@ -0,0 +1,198 @@
+/*
+ * Crosscheck and benchmark vertex attribute conversion.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "../../../hw/xbox/nv2a/pgraph/vertex_convert.h"
+
+#define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
+
+/*
+ * Reference implementations, equivalent to what the vertex shaders used to
+ * compute for CMP (decompress_11_11_10) and UB_D3D (.bgra) attributes.
+ */
+static int32_t bitfield_extract(int32_t v, int offset, int bits)
+{
+    return (int32_t)((uint32_t)v << (32 - offset - bits)) >> (32 - bits);
+}
+
+static void ref_convert_cmp(const uint8_t *src, size_t src_stride, float *dst,
+                            unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        int32_t cmp;
+        memcpy(&cmp, src + i * src_stride, sizeof(cmp));
+        dst[i * 3 + 0] = (float)bitfield_extract(cmp, 0, 11) / 1023.0f;
+        dst[i * 3 + 1] = (float)bitfield_extract(cmp, 11, 11) / 1023.0f;
+        dst[i * 3 + 2] = (float)bitfield_extract(cmp, 22, 10) / 511.0f;
+    }
+}
+
+static void ref_convert_d3d(const uint8_t *src, size_t src_stride,
+                            uint8_t *dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        const uint8_t *bgra = src + i * src_stride;
+        dst[i * 4 + 0] = bgra[2];
+        dst[i * 4 + 1] = bgra[1];
+        dst[i * 4 + 2] = bgra[0];
+        dst[i * 4 + 3] = bgra[3];
+    }
+}
+
+static unsigned int strides[] = { 4, 8, 12, 16, 20, 28, 32, 36, 64 };
+
+static void crosscheck(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    for (int stride_idx = 0; stride_idx < ARRAY_SIZE(strides); stride_idx++)
+    for (unsigned int count = 1; count < 67; count++)
+    for (unsigned int misalign = 0; misalign < 4; misalign++) {
+        unsigned int stride = strides[stride_idx];
+        size_t src_size = misalign + (size_t)(count - 1) * stride + 4;
+        uint8_t *src = malloc(src_size);
+        for (size_t i = 0; i < src_size; i++) {
+            src[i] = rand();
+        }
+
+        /* Guard element after the output to catch overruns */
+        size_t cmp_size = (count + 1) * VERTEX_CONVERT_CMP_ELEMENT_SIZE;
+        float *cmp_ref = malloc(cmp_size);
+        float *cmp_out = malloc(cmp_size);
+        memset(cmp_ref, 0xa5, cmp_size);
+        memset(cmp_out, 0xa5, cmp_size);
+        ref_convert_cmp(src + misalign, stride, cmp_ref, count);
+        vertex_convert_cmp(src + misalign, stride, cmp_out, count);
+        assert(!memcmp(cmp_ref, cmp_out, cmp_size));
+
+        size_t d3d_size = (count + 1) * VERTEX_CONVERT_D3D_ELEMENT_SIZE;
+        uint8_t *d3d_ref = malloc(d3d_size);
+        uint8_t *d3d_out = malloc(d3d_size);
+        memset(d3d_ref, 0xa5, d3d_size);
+        memset(d3d_out, 0xa5, d3d_size);
+        ref_convert_d3d(src + misalign, stride, d3d_ref, count);
+        vertex_convert_d3d(src + misalign, stride, d3d_out, count);
+        assert(!memcmp(d3d_ref, d3d_out, d3d_size));
+
+        free(d3d_out);
+        free(d3d_ref);
+        free(cmp_out);
+        free(cmp_ref);
+        free(src);
+    }
+
+    /* Extremes of each component */
+    static const uint32_t edge_cases[] = {
+        0x00000000, 0xffffffff, 0x000003ff, 0x00000400, 0x001ff800,
+        0x00200000, 0x7fc00000, 0x80000000, 0x801ffbff, 0x7fdffc00,
+    };
+    float ref[ARRAY_SIZE(edge_cases) * 3], out[ARRAY_SIZE(edge_cases) * 3];
+    ref_convert_cmp((const uint8_t *)edge_cases, 4, ref,
+                    ARRAY_SIZE(edge_cases));
+    vertex_convert_cmp((const uint8_t *)edge_cases, 4, out,
+                       ARRAY_SIZE(edge_cases));
+    assert(!memcmp(ref, out, sizeof(ref)));
+
+    fprintf(stderr, "ok!\n");
+}
+
+#define NUM_ITERATIONS 10
+#define NUM_VERTICES (1024 * 1024)
+
+static int compare_ints(const void *a, const void *b)
+{
+    return *(int*)a - *(int*)b;
+}
+
+typedef void (*cmp_convert_handler)(const uint8_t *src, size_t src_stride,
+                                    float *dst, unsigned int count);
+
+static void bench_cmp(const char *name, cmp_convert_handler convert,
+                      const uint8_t *src, unsigned int stride, float *dst)
+{
+    fprintf(stderr, "[%4s, stride %2u] ", name, stride);
+
+    int samples[NUM_ITERATIONS];
+    int sum = 0;
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++ ) {
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        convert(src, stride, dst, NUM_VERTICES);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        uint64_t start_ns = (uint64_t)start.tv_sec * (uint64_t)1000000000 + start.tv_nsec;
+        uint64_t end_ns   = (uint64_t)end.tv_sec   * (uint64_t)1000000000 + end.tv_nsec;
+
+        samples[iter] = (end_ns - start_ns) / 1000;
+        sum += samples[iter];
+    }
+
+    qsort(samples, ARRAY_SIZE(samples), sizeof(samples[0]), compare_ints);
+
+    int min = samples[0],
+        max = samples[ARRAY_SIZE(samples) - 1],
+        avg = sum / ARRAY_SIZE(samples),
+        med = samples[ARRAY_SIZE(samples) / 2];
+    fprintf(stderr, "min: %6d us, max: %6d us, avg: %6d us, med: %6d us  -- %.3g Mvtx/s\n",
+            min, max, avg, med, (NUM_VERTICES / 1e6) / (med / 1000000.0));
+}
+
+static void bench(void)
+{
+    fprintf(stderr, "%s...", __func__);
+    fprintf(stderr, "with CMP streams of %d vertices, iterations: %d\n",
+            NUM_VERTICES, NUM_ITERATIONS);
+
+    static const unsigned int bench_strides[] = { 4, 16, 32 };
+
+    size_t src_size = (size_t)NUM_VERTICES * 32;
+    uint8_t *src = malloc(src_size);
+    for (size_t i = 0; i < src_size; i++) {
+        src[i] = rand();
+    }
+
+    float *dst = malloc(NUM_VERTICES * VERTEX_CONVERT_CMP_ELEMENT_SIZE);
+    memset(dst, 0, NUM_VERTICES * VERTEX_CONVERT_CMP_ELEMENT_SIZE);
+
+    for (int i = 0; i < ARRAY_SIZE(bench_strides); i++) {
+        bench_cmp("ref", ref_convert_cmp, src, bench_strides[i], dst);
+        bench_cmp("simd", vertex_convert_cmp, src, bench_strides[i], dst);
+    }
+
+    free(dst);
+    free(src);
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    crosscheck();
+    bench();
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Included ahead of vp.c for the reference build. The snapshot taken for a
+ * voice never matches it, so every field is read and written in guest memory
+ * as it was before voices were snapshotted.
+ */
+#ifndef VOICE_SNAPSHOT_DIRECT_ACCESS_H
+#define VOICE_SNAPSHOT_DIRECT_ACCESS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define HW_XBOX_MCPX_VP_VOICE_SNAPSHOT_H
+
+typedef struct VoiceSnapshot {
+    uint32_t dirty_words;
+    uint16_t voice;
+} VoiceSnapshot;
+
+static inline void voice_snapshot_load(VoiceSnapshot *s, uint16_t voice,
+                                       const uint8_t *block)
+{
+    s->dirty_words = 0;
+    s->voice = 0xFFFF;
+}
+
+static inline uint32_t voice_snapshot_get_mask(const VoiceSnapshot *s,
+                                               uint32_t offset, uint32_t mask)
+{
+    abort();
+}
+
+static inline void voice_snapshot_set_mask(VoiceSnapshot *s, uint32_t offset,
+                                           uint32_t mask, uint32_t val)
+{
+    abort();
+}
+
+static inline uint32_t voice_snapshot_merge(const VoiceSnapshot *s, int index,
+                                            uint32_t current)
+{
+    abort();
+}
+
+/* Both builds are linked into the test */
+#define mcpx_apu_vp_init direct_vp_init
+#define mcpx_apu_vp_finalize direct_vp_finalize
+#define mcpx_apu_vp_frame direct_vp_frame
+#define mcpx_apu_vp_reset direct_vp_reset
+#define mcpx_apu_vp_capture_ranges direct_vp_capture_ranges
+#define vp_ops direct_vp_ops
+
+#endif
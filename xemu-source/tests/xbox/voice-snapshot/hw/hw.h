@@ -0,0 +1,5 @@
+/* Stand-in for include/hw/hw.h */
+#ifndef QEMU_HW_H
+#define QEMU_HW_H
+
+#endif
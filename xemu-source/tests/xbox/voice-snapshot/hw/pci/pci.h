@@ -0,0 +1,16 @@
+/* Stand-in for include/hw/pci/pci.h, with the memory types vp.h uses */
+#ifndef QEMU_PCI_H
+#define QEMU_PCI_H
+
+#include "exec/hwaddr.h"
+
+typedef struct MemoryRegion {
+    int unused;
+} MemoryRegion;
+
+typedef struct MemoryRegionOps {
+    uint64_t (*read)(void *opaque, hwaddr addr, unsigned size);
+    void (*write)(void *opaque, hwaddr addr, uint64_t data, unsigned size);
+} MemoryRegionOps;
+
+#endif
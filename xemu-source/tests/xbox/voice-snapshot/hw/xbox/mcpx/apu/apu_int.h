@@ -0,0 +1,131 @@
+/*
+ * Stand-in for hw/xbox/mcpx/apu/apu_int.h with only the state and services
+ * the voice processor uses. vp.c itself is the real one. Guest memory is
+ * provided by the test.
+ */
+#ifndef HW_XBOX_MCPX_APU_INT_H
+#define HW_XBOX_MCPX_APU_INT_H
+
+#include <time.h>
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "qemu/thread.h"
+#include "hw/xbox/mcpx/apu/apu_regs.h"
+#include "hw/xbox/mcpx/apu/apu_debug.h"
+#include "hw/xbox/mcpx/apu/fpconv.h"
+#include "hw/xbox/mcpx/apu/vp/vp.h"
+
+#define TARGET_PAGE_SIZE 4096
+
+#define GET_MASK(v, mask) (((v) & (mask)) >> ctz32(mask))
+
+#define SET_MASK(v, mask, val)                                       \
+    do {                                                             \
+        (v) &= ~(mask);                                              \
+        (v) |= ((val) << ctz32(mask)) & (mask);                      \
+    } while (0)
+
+#define CASE_4(v, step)                                              \
+    case (v):                                                        \
+    case (v)+(step):                                                 \
+    case (v)+(step)*2:                                               \
+    case (v)+(step)*3
+
+#define DPRINTF(fmt, ...) \
+    do { } while (0)
+
+typedef struct MCPXAPUState {
+    bool set_irq;
+
+    QemuMutex lock;
+    QemuCond cond;
+
+    uint8_t *ram_ptr;
+
+    MCPXAPUVPState vp;
+
+    uint32_t regs[0x20000];
+
+    struct {
+        McpxApuDebugMonitorPoint point;
+    } monitor;
+} MCPXAPUState;
+
+extern struct McpxApuDebug g_dbg, g_dbg_cache;
+extern int g_dbg_voice_monitor;
+
+uint32_t mcpx_apu_ram_generation(MCPXAPUState *d, hwaddr addr, hwaddr len);
+
+/* The settings vp.c reads, see ui/xemu-settings.h */
+typedef struct Config {
+    struct {
+        struct {
+            int num_workers;
+        } vp;
+        bool hrtf;
+    } audio;
+} Config;
+
+extern Config g_config;
+
+/* Guest memory, see include/exec/memory.h */
+typedef struct AddressSpace {
+    int unused;
+} AddressSpace;
+
+typedef struct MemTxAttrs {
+    unsigned int unspecified;
+} MemTxAttrs;
+
+#define MEMTXATTRS_UNSPECIFIED ((MemTxAttrs){ .unspecified = 1 })
+
+typedef int MemTxResult;
+
+extern AddressSpace address_space_memory;
+
+uint32_t ldub_phys(AddressSpace *as, hwaddr addr);
+uint32_t lduw_le_phys(AddressSpace *as, hwaddr addr);
+uint32_t ldl_le_phys(AddressSpace *as, hwaddr addr);
+void stb_phys(AddressSpace *as, hwaddr addr, uint8_t val);
+void stl_le_phys(AddressSpace *as, hwaddr addr, uint32_t val);
+MemTxResult address_space_read(AddressSpace *as, hwaddr addr,
+                               MemTxAttrs attrs, void *buf, hwaddr len);
+
+#define QEMU_CLOCK_REALTIME 0
+
+static inline int64_t qemu_clock_get_us(int type)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+#define THREAD_CLASS_VOICE 0
+
+static inline void thread_placement_enter(int cls, int index)
+{
+}
+
+static inline void thread_placement_leave(void)
+{
+}
+
+static inline void rcu_register_thread(void)
+{
+}
+
+static inline void rcu_unregister_thread(void)
+{
+}
+
+static inline void trace_mcpx_apu_method(uint32_t addr, uint32_t parameter)
+{
+}
+
+static inline int SDL_GetCPUCount(void)
+{
+    return 1;
+}
+
+#endif
@@ -0,0 +1,16 @@
+/* Stand-in for include/qemu/cutils.h */
+#ifndef QEMU_CUTILS_H
+#define QEMU_CUTILS_H
+
+static inline bool buffer_is_zero(const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,89 @@
+/* Stand-in for include/qemu/thread.h on top of pthreads */
+#ifndef QEMU_THREAD_H
+#define QEMU_THREAD_H
+
+#include <pthread.h>
+
+typedef struct QemuMutex {
+    pthread_mutex_t lock;
+} QemuMutex;
+
+typedef struct QemuCond {
+    pthread_cond_t cond;
+} QemuCond;
+
+typedef struct QemuThread {
+    pthread_t thread;
+} QemuThread;
+
+typedef struct QemuSpin {
+    pthread_spinlock_t lock;
+} QemuSpin;
+
+#define QEMU_THREAD_JOINABLE 0
+
+static inline void qemu_mutex_init(QemuMutex *mutex)
+{
+    pthread_mutex_init(&mutex->lock, NULL);
+}
+
+static inline void qemu_mutex_lock(QemuMutex *mutex)
+{
+    pthread_mutex_lock(&mutex->lock);
+}
+
+static inline void qemu_mutex_unlock(QemuMutex *mutex)
+{
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+static inline void qemu_cond_init(QemuCond *cond)
+{
+    pthread_cond_init(&cond->cond, NULL);
+}
+
+static inline void qemu_cond_signal(QemuCond *cond)
+{
+    pthread_cond_signal(&cond->cond);
+}
+
+static inline void qemu_cond_broadcast(QemuCond *cond)
+{
+    pthread_cond_broadcast(&cond->cond);
+}
+
+static inline void qemu_cond_wait(QemuCond *cond, QemuMutex *mutex)
+{
+    pthread_cond_wait(&cond->cond, &mutex->lock);
+}
+
+static inline void qemu_thread_create(QemuThread *thread, const char *name,
+                                      void *(*start_routine)(void *),
+                                      void *arg, int mode)
+{
+    pthread_create(&thread->thread, NULL, start_routine, arg);
+}
+
+static inline void *qemu_thread_join(QemuThread *thread)
+{
+    void *ret;
+    pthread_join(thread->thread, &ret);
+    return ret;
+}
+
+static inline void qemu_spin_init(QemuSpin *spin)
+{
+    pthread_spin_init(&spin->lock, PTHREAD_PROCESS_PRIVATE);
+}
+
+static inline void qemu_spin_lock(QemuSpin *spin)
+{
+    pthread_spin_lock(&spin->lock);
+}
+
+static inline void qemu_spin_unlock(QemuSpin *spin)
+{
+    pthread_spin_unlock(&spin->lock);
+}
+
+#endif
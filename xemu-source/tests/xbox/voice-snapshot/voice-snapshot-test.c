@@ -0,0 +1,499 @@
+/*
+ * Crosscheck and benchmark VP voice descriptor snapshots.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <time.h>
+
+#include "qemu/osdep.h"
+#include "hw/xbox/mcpx/apu/apu_int.h"
+
+#define NUM_VOICES MCPX_HW_MAX_VOICES
+#define NUM_FRAMES 64
+#define NUM_BENCH_FRAMES 200
+#define NUM_ITERATIONS 5
+
+/*
+ * Guest memory: notifiers, voice blocks and the SGE table, followed by the
+ * pages sample data is scattered over.
+ */
+#define NOTIFIER_ADDR 0x0
+#define VOICE_ADDR 0x10000
+#define SGE_ADDR 0x20000
+#define DATA_ADDR 0x100000
+#define DATA_PAGES 256
+#define RAM_SIZE (DATA_ADDR + (DATA_PAGES + 1) * TARGET_PAGE_SIZE)
+
+/* vp.c built with voice snapshots disabled, see direct-access.h */
+void direct_vp_init(MCPXAPUState *d);
+void direct_vp_finalize(MCPXAPUState *d);
+void direct_vp_frame(MCPXAPUState *d,
+                     float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME]);
+void direct_vp_reset(MCPXAPUState *d);
+
+typedef struct VoiceProcessor {
+    const char *name;
+    void (*init)(MCPXAPUState *d);
+    void (*finalize)(MCPXAPUState *d);
+    void (*frame)(MCPXAPUState *d,
+                  float mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME]);
+    void (*reset)(MCPXAPUState *d);
+} VoiceProcessor;
+
+static const VoiceProcessor snapshot_vp = {
+    "snapshot", mcpx_apu_vp_init, mcpx_apu_vp_finalize, mcpx_apu_vp_frame,
+    mcpx_apu_vp_reset,
+};
+
+static const VoiceProcessor direct_vp = {
+    "direct", direct_vp_init, direct_vp_finalize, direct_vp_frame,
+    direct_vp_reset,
+};
+
+struct McpxApuDebug g_dbg, g_dbg_cache;
+int g_dbg_voice_monitor = -1;
+Config g_config;
+AddressSpace address_space_memory;
+
+static uint8_t guest_ram[RAM_SIZE];
+static unsigned long num_transactions;
+
+/* Set a bit in each voice block right after it was snapshotted */
+static bool inject_guest_writes;
+static uint64_t injected[NUM_VOICES / 64];
+
+bool mcpx_apu_debug_is_muted(uint16_t v)
+{
+    return false;
+}
+
+uint32_t mcpx_apu_ram_generation(MCPXAPUState *d, hwaddr addr, hwaddr len)
+{
+    return 0;
+}
+
+static uint8_t *guest_ptr(hwaddr addr, hwaddr len)
+{
+    assert(addr + len <= sizeof(guest_ram));
+    num_transactions++;
+    return &guest_ram[addr];
+}
+
+uint32_t ldub_phys(AddressSpace *as, hwaddr addr)
+{
+    return *guest_ptr(addr, 1);
+}
+
+uint32_t lduw_le_phys(AddressSpace *as, hwaddr addr)
+{
+    const uint8_t *p = guest_ptr(addr, 2);
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t ldl_le_phys(AddressSpace *as, hwaddr addr)
+{
+    const uint8_t *p = guest_ptr(addr, 4);
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+void stb_phys(AddressSpace *as, hwaddr addr, uint8_t val)
+{
+    *guest_ptr(addr, 1) = val;
+}
+
+void stl_le_phys(AddressSpace *as, hwaddr addr, uint32_t val)
+{
+    uint8_t *p = guest_ptr(addr, 4);
+    p[0] = val;
+    p[1] = val >> 8;
+    p[2] = val >> 16;
+    p[3] = val >> 24;
+}
+
+MemTxResult address_space_read(AddressSpace *as, hwaddr addr,
+                               MemTxAttrs attrs, void *buf, hwaddr len)
+{
+    memcpy(buf, guest_ptr(addr, len), len);
+
+    if (inject_guest_writes) {
+        assert(len == NV_PAVS_SIZE);
+        int v = (addr - VOICE_ADDR) / NV_PAVS_SIZE;
+        guest_ram[addr + NV_PAVS_VOICE_PAR_STATE + 2] |=
+            NV_PAVS_VOICE_PAR_STATE_PAUSED >> 16;
+        injected[v / 64] |= 1ULL << (v % 64);
+    }
+
+    return 0;
+}
+
+static uint32_t ram_ldl(hwaddr addr)
+{
+    return ldl_le_phys(&address_space_memory, addr);
+}
+
+static void ram_stl(hwaddr addr, uint32_t val)
+{
+    stl_le_phys(&address_space_memory, addr, val);
+}
+
+static void voice_set(int v, uint32_t offset, uint32_t mask, uint32_t val)
+{
+    hwaddr addr = VOICE_ADDR + v * NV_PAVS_SIZE + offset;
+    uint32_t cur = ram_ldl(addr);
+    SET_MASK(cur, mask, val);
+    ram_stl(addr, cur);
+}
+
+static uint32_t voice_get(int v, uint32_t offset, uint32_t mask)
+{
+    return GET_MASK(ram_ldl(VOICE_ADDR + v * NV_PAVS_SIZE + offset), mask);
+}
+
+static int rand_range(int lo, int hi)
+{
+    return lo + rand() % (hi - lo + 1);
+}
+
+/* An envelope somewhere in its cycle, with a count valid for its state */
+static void gen_envelope(int v, uint32_t reg_0, uint32_t reg_a,
+                         uint32_t count_mask, uint32_t cur_mask)
+{
+    static const int states[] = {
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_OFF,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_DELAY,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_ATTACK,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_HOLD,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_DECAY,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_SUSTAIN,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_SUSTAIN,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_SUSTAIN,
+        NV_PAVS_VOICE_PAR_STATE_EFCUR_RELEASE,
+    };
+    int cur = states[rand() % ARRAY_SIZE(states)];
+    int attack_rate = voice_get(v, reg_0, NV_PAVS_VOICE_CFG_ENV0_EA_ATTACKRATE);
+    int decay_rate = voice_get(v, reg_a, NV_PAVS_VOICE_CFG_ENVA_EA_DECAYRATE);
+
+    int count = rand_range(0, 0xFFFF);
+    if (cur == NV_PAVS_VOICE_PAR_STATE_EFCUR_ATTACK) {
+        count = rand_range(0, MIN(attack_rate * 16, 0xFFFF));
+    } else if (cur == NV_PAVS_VOICE_PAR_STATE_EFCUR_DECAY) {
+        count = rand_range(0, MIN(decay_rate * 16, 0xFFFF));
+    }
+
+    voice_set(v, NV_PAVS_VOICE_PAR_STATE, cur_mask, cur);
+    voice_set(v, NV_PAVS_VOICE_CUR_ECNT, count_mask, count);
+}
+
+static void gen_voice(int v)
+{
+    static const struct {
+        int sample_size, container_size, bytes;
+    } formats[] = {
+        { NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE_U8,
+          NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE_B8, 1 },
+        { NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE_S16,
+          NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE_B16, 2 },
+        { NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE_S16,
+          NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE_B16, 2 },
+        { NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE_S24,
+          NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE_B32, 4 },
+        { NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE_S32,
+          NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE_B32, 4 },
+        { NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE_S24,
+          NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE_ADPCM, 0 },
+    };
+
+    /* Everything not set below is left random */
+    int f = rand() % ARRAY_SIZE(formats);
+    bool stereo = rand() & 1;
+    int channels = stereo ? 2 : 1;
+    int block_size = (formats[f].bytes ? formats[f].bytes : 36) * channels;
+    int samples_per_block = formats[f].bytes ? 1 : 64;
+
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_SAMPLE_SIZE,
+              formats[f].sample_size);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_CONTAINER_SIZE,
+              formats[f].container_size);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_STEREO, stereo);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_SAMPLES_PER_BLOCK,
+              channels - 1);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_LOOP,
+              rand() % 4 != 0);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_DATA_TYPE, 0);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_MULTIPASS, 0);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_PERSIST, 0);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_LINKED, 0);
+
+    /* Stay clear of the multipass bin */
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_V6BIN,
+              rand() % MULTIPASS_BIN);
+    voice_set(v, NV_PAVS_VOICE_CFG_FMT, NV_PAVS_VOICE_CFG_FMT_V7BIN,
+              rand() % MULTIPASS_BIN);
+    static const uint32_t vbins[] = {
+        NV_PAVS_VOICE_CFG_VBIN_V0BIN, NV_PAVS_VOICE_CFG_VBIN_V1BIN,
+        NV_PAVS_VOICE_CFG_VBIN_V2BIN, NV_PAVS_VOICE_CFG_VBIN_V3BIN,
+        NV_PAVS_VOICE_CFG_VBIN_V4BIN, NV_PAVS_VOICE_CFG_VBIN_V5BIN,
+    };
+    for (int i = 0; i < ARRAY_SIZE(vbins); i++) {
+        voice_set(v, NV_PAVS_VOICE_CFG_VBIN, vbins[i], rand() % MULTIPASS_BIN);
+    }
+
+    /* Some voices are fully attenuated and only move along */
+    if (rand() % 8 == 0) {
+        ram_stl(VOICE_ADDR + v * NV_PAVS_SIZE + NV_PAVS_VOICE_TAR_VOLA,
+                0xFFFFFFFF);
+        ram_stl(VOICE_ADDR + v * NV_PAVS_SIZE + NV_PAVS_VOICE_TAR_VOLB,
+                0xFFFFFFFF);
+        ram_stl(VOICE_ADDR + v * NV_PAVS_SIZE + NV_PAVS_VOICE_TAR_VOLC,
+                0xFFFFFFFF);
+    }
+
+    voice_set(v, NV_PAVS_VOICE_TAR_PITCH_LINK,
+              NV_PAVS_VOICE_TAR_PITCH_LINK_PITCH,
+              (uint16_t)rand_range(-4096, 4096));
+    voice_set(v, NV_PAVS_VOICE_TAR_PITCH_LINK,
+              NV_PAVS_VOICE_TAR_PITCH_LINK_NEXT_VOICE_HANDLE,
+              v + 1 < NUM_VOICES ? v + 1 : 0xFFFF);
+    voice_set(v, NV_PAVS_VOICE_CFG_ENV0, NV_PAVS_VOICE_CFG_ENV0_EF_PITCHSCALE,
+              rand_range(0, 0x20));
+
+    gen_envelope(v, NV_PAVS_VOICE_CFG_ENV1, NV_PAVS_VOICE_CFG_ENVF,
+                 NV_PAVS_VOICE_CUR_ECNT_EFCOUNT, NV_PAVS_VOICE_PAR_STATE_EFCUR);
+    gen_envelope(v, NV_PAVS_VOICE_CFG_ENV0, NV_PAVS_VOICE_CFG_ENVA,
+                 NV_PAVS_VOICE_CUR_ECNT_EACOUNT, NV_PAVS_VOICE_PAR_STATE_EACUR);
+
+    /* Sample data somewhere in the scattered pages */
+    int num_samples = rand_range(NUM_SAMPLES_PER_FRAME, 2048);
+    int data_size = (num_samples + samples_per_block - 1) / samples_per_block *
+                    block_size;
+    int ba = rand_range(0, DATA_PAGES * TARGET_PAGE_SIZE - data_size) & ~3;
+    int ebo = num_samples - 1;
+    voice_set(v, NV_PAVS_VOICE_CUR_PSL_START, NV_PAVS_VOICE_CUR_PSL_START_BA,
+              ba);
+    voice_set(v, NV_PAVS_VOICE_PAR_NEXT, NV_PAVS_VOICE_PAR_NEXT_EBO, ebo);
+    voice_set(v, NV_PAVS_VOICE_PAR_OFFSET, NV_PAVS_VOICE_PAR_OFFSET_CBO,
+              rand_range(0, ebo));
+    voice_set(v, NV_PAVS_VOICE_CUR_PSH_SAMPLE, NV_PAVS_VOICE_CUR_PSH_SAMPLE_LBO,
+              rand_range(0, ebo - 1));
+
+    voice_set(v, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_PAUSED, 0);
+    voice_set(v, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_NEW_VOICE, 1);
+    voice_set(v, NV_PAVS_VOICE_PAR_STATE, NV_PAVS_VOICE_PAR_STATE_ACTIVE_VOICE,
+              rand() % 16 != 0);
+}
+
+static void init_guest_ram(unsigned int seed)
+{
+    srand(seed);
+    for (size_t i = 0; i < sizeof(guest_ram); i++) {
+        guest_ram[i] = rand();
+    }
+
+    /* Pages in a shuffled order */
+    int pages[DATA_PAGES];
+    for (int i = 0; i < DATA_PAGES; i++) {
+        pages[i] = i;
+    }
+    for (int i = DATA_PAGES - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int t = pages[i];
+        pages[i] = pages[j];
+        pages[j] = t;
+    }
+    for (int i = 0; i < DATA_PAGES; i++) {
+        ram_stl(SGE_ADDR + i * NV_PSGE_SIZE,
+                DATA_ADDR + pages[i] * TARGET_PAGE_SIZE);
+    }
+
+    for (int v = 0; v < NUM_VOICES; v++) {
+        gen_voice(v);
+    }
+}
+
+static MCPXAPUState *vp_start(const VoiceProcessor *vp, unsigned int seed)
+{
+    MCPXAPUState *d = calloc(1, sizeof(*d));
+
+    init_guest_ram(seed);
+    num_transactions = 0;
+    memset(injected, 0, sizeof(injected));
+
+    qemu_mutex_init(&d->lock);
+    qemu_cond_init(&d->cond);
+    d->ram_ptr = guest_ram;
+    d->regs[NV_PAPU_FENADDR] = NOTIFIER_ADDR;
+    d->regs[NV_PAPU_VPVADDR] = VOICE_ADDR;
+    d->regs[NV_PAPU_VPSGEADDR] = SGE_ADDR;
+    d->regs[NV_PAPU_FETFORCE1] = NV_PAPU_FETFORCE1_SE2FE_IDLE_VOICE;
+    d->regs[NV_PAPU_TVL2D] = 0;
+    d->regs[NV_PAPU_TVL3D] = 0xFFFF;
+    d->regs[NV_PAPU_TVLMP] = 0xFFFF;
+
+    g_config.audio.vp.num_workers = 1;
+    vp->init(d);
+    vp->reset(d);
+
+    return d;
+}
+
+static void vp_stop(const VoiceProcessor *vp, MCPXAPUState *d)
+{
+    vp->finalize(d);
+    free(d);
+}
+
+typedef float Mixbins[NUM_MIXBINS][NUM_SAMPLES_PER_FRAME];
+
+static void vp_run(const VoiceProcessor *vp, unsigned int seed, int frames,
+                   Mixbins *out, uint8_t *ram_out)
+{
+    MCPXAPUState *d = vp_start(vp, seed);
+    for (int f = 0; f < frames; f++) {
+        memset(out[f], 0, sizeof(out[f]));
+        vp->frame(d, out[f]);
+    }
+    memcpy(ram_out, guest_ram, sizeof(guest_ram));
+    vp_stop(vp, d);
+}
+
+static bool mixbins_silent(const Mixbins *m, int frames)
+{
+    for (int f = 0; f < frames; f++) {
+        for (int b = 0; b < NUM_MIXBINS; b++) {
+            for (int i = 0; i < NUM_SAMPLES_PER_FRAME; i++) {
+                if (m[f][b][i] != 0.0f) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* Voice processing gives the same guest memory and mix as direct access */
+static void crosscheck(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    static Mixbins mix_direct[NUM_FRAMES], mix_snapshot[NUM_FRAMES];
+    static uint8_t ram_initial[RAM_SIZE], ram_direct[RAM_SIZE],
+        ram_snapshot[RAM_SIZE];
+
+    for (unsigned int seed = 1; seed <= 4; seed++) {
+        init_guest_ram(seed);
+        memcpy(ram_initial, guest_ram, sizeof(guest_ram));
+
+        vp_run(&direct_vp, seed, NUM_FRAMES, mix_direct, ram_direct);
+        vp_run(&snapshot_vp, seed, NUM_FRAMES, mix_snapshot, ram_snapshot);
+
+        assert(memcmp(ram_initial, ram_direct, RAM_SIZE));
+        assert(!mixbins_silent(mix_direct, NUM_FRAMES));
+
+        assert(!memcmp(ram_direct, ram_snapshot, RAM_SIZE));
+        assert(!memcmp(mix_direct, mix_snapshot, sizeof(mix_direct)));
+    }
+
+    fprintf(stderr, "ok\n");
+}
+
+/*
+ * Bits the guest writes to a voice block while the voice is being processed
+ * are kept, alongside the fields vp.c modified. The voice is processed as it
+ * was when snapshotted.
+ */
+static void guest_writes(void)
+{
+    fprintf(stderr, "%s...", __func__);
+
+    static Mixbins mix_expected[1], mix[1];
+    static uint8_t ram_expected[RAM_SIZE], ram[RAM_SIZE];
+
+    vp_run(&snapshot_vp, 1, 1, mix_expected, ram_expected);
+    inject_guest_writes = true;
+    vp_run(&snapshot_vp, 1, 1, mix, ram);
+    inject_guest_writes = false;
+
+    assert(!memcmp(mix_expected, mix, sizeof(mix)));
+
+    int num_injected = 0;
+    for (int v = 0; v < NUM_VOICES; v++) {
+        if (injected[v / 64] & (1ULL << (v % 64))) {
+            hwaddr addr = VOICE_ADDR + v * NV_PAVS_SIZE +
+                          NV_PAVS_VOICE_PAR_STATE + 2;
+            ram_expected[addr] |= NV_PAVS_VOICE_PAR_STATE_PAUSED >> 16;
+            num_injected++;
+        }
+    }
+    assert(num_injected > NUM_VOICES / 2);
+    assert(!memcmp(ram_expected, ram, RAM_SIZE));
+
+    fprintf(stderr, "ok\n");
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench(const VoiceProcessor *vp)
+{
+    double times[NUM_ITERATIONS];
+    unsigned long transactions = 0;
+    Mixbins mixbins;
+
+    for (int iter = 0; iter < NUM_ITERATIONS; iter++) {
+        MCPXAPUState *d = vp_start(vp, iter + 1);
+        num_transactions = 0;
+        double start = now_us();
+        for (int f = 0; f < NUM_BENCH_FRAMES; f++) {
+            memset(mixbins, 0, sizeof(mixbins));
+            vp->frame(d, mixbins);
+        }
+        times[iter] = (now_us() - start) / NUM_BENCH_FRAMES;
+        transactions = num_transactions / NUM_BENCH_FRAMES;
+        vp_stop(vp, d);
+    }
+
+    qsort(times, NUM_ITERATIONS, sizeof(times[0]), cmp_double);
+    double avg = 0;
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        avg += times[i];
+    }
+    avg /= NUM_ITERATIONS;
+
+    printf("%-10s %d voices: %6lu transactions/frame, us/frame "
+           "min %.2f max %.2f avg %.2f med %.2f\n",
+           vp->name, NUM_VOICES, transactions, times[0],
+           times[NUM_ITERATIONS - 1], avg, times[NUM_ITERATIONS / 2]);
+}
+
+int main(int argc, char const *argv[])
+{
+    crosscheck();
+    guest_writes();
+    bench(&direct_vp);
+    bench(&snapshot_vp);
+    return 0;
+}
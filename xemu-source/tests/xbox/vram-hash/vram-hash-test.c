@@ -0,0 +1,248 @@
+/*
+ * Check renderer cache revalidation across repeated snapshot loads.
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hw/xbox/nv2a/pgraph/vram_hash.h"
+
+#define VRAM_SIZE (16 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define NUM_PAGES (VRAM_SIZE / PAGE_SIZE)
+#define NUM_OBJECTS 256
+#define NUM_LOADS 32
+
+/* Stand-in for util/fast-hash.c, which needs xxHash */
+uint64_t fast_hash(const uint8_t *data, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, sizeof(v));
+        h = (h ^ v) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    for (; i < len; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+/*
+ * A cached renderer object (surface, texture, vertex buffer...) built from a
+ * range of VRAM. It is valid as long as that range still holds `hash`.
+ */
+typedef struct CachedObject {
+    size_t addr;
+    size_t len;
+    uint64_t hash;
+} CachedObject;
+
+typedef struct Stats {
+    unsigned long rebuilds;
+    unsigned long long upload_bytes;
+} Stats;
+
+static uint8_t *vram;
+static CachedObject objects[NUM_OBJECTS];
+
+/* The real bookkeeping behind pgraph_loadvm_range_changed() */
+static VramChangedRanges changed;
+
+static void record_changed_range(void *opaque, size_t offset, size_t length)
+{
+    assert(offset % PAGE_SIZE == 0 && length % PAGE_SIZE == 0);
+    vram_changed_ranges_add(opaque, offset, length);
+}
+
+/* What the renderers used to do: look through every range */
+static bool range_changed_linear(size_t addr, size_t len)
+{
+    for (size_t i = 0; i < changed.num; i++) {
+        if (addr < changed.offsets[i] + changed.lengths[i] &&
+            changed.offsets[i] < addr + len) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void build_object(CachedObject *o, Stats *stats)
+{
+    o->hash = fast_hash(vram + o->addr, o->len);
+    stats->rebuilds++;
+    stats->upload_bytes += o->len;
+}
+
+static void random_fill(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = rand();
+    }
+}
+
+/* Scribble over a few random spots, as the guest would between loads */
+static void guest_writes(Stats *stats)
+{
+    int num_writes = 1 + rand() % 16;
+    for (int i = 0; i < num_writes; i++) {
+        size_t len = 1 + rand() % (64 * 1024);
+        size_t addr = rand() % (VRAM_SIZE - len);
+        random_fill(vram + addr, len);
+
+        /* The dirty log catches these, rebuild what they touched */
+        for (int j = 0; j < NUM_OBJECTS; j++) {
+            CachedObject *o = &objects[j];
+            if (addr < o->addr + o->len && o->addr < addr + len) {
+                build_object(o, stats);
+            }
+        }
+    }
+}
+
+static void check_changed_pages(const uint8_t *before)
+{
+    bool page_changed[NUM_PAGES] = { false };
+    for (size_t i = 0; i < changed.num; i++) {
+        for (size_t p = changed.offsets[i] / PAGE_SIZE;
+             p < (changed.offsets[i] + changed.lengths[i]) / PAGE_SIZE; p++) {
+            page_changed[p] = true;
+        }
+    }
+    for (size_t p = 0; p < NUM_PAGES; p++) {
+        bool differs = memcmp(before + p * PAGE_SIZE, vram + p * PAGE_SIZE,
+                              PAGE_SIZE) != 0;
+        assert(differs == page_changed[p]);
+    }
+}
+
+/* Lookups agree with a scan of every range, edges included */
+static void check_lookups(void)
+{
+    for (size_t i = 0; i < changed.num; i++) {
+        size_t start = changed.offsets[i];
+        size_t end = start + changed.lengths[i];
+        assert(vram_changed_ranges_overlap(&changed, start, 1));
+        assert(vram_changed_ranges_overlap(&changed, end - 1, 1));
+        assert(start == 0 ||
+               vram_changed_ranges_overlap(&changed, start - 1, 2));
+        assert(end == VRAM_SIZE ||
+               !vram_changed_ranges_overlap(&changed, end, 1));
+    }
+    for (int i = 0; i < 4096; i++) {
+        size_t len = 1 + rand() % (256 * 1024);
+        size_t addr = rand() % (VRAM_SIZE - len);
+        assert(vram_changed_ranges_overlap(&changed, addr, len) ==
+               range_changed_linear(addr, len));
+    }
+}
+
+static void load_repeatedly(void)
+{
+    fprintf(stderr, "%s...\n", __func__);
+
+    uint8_t *snapshot = malloc(VRAM_SIZE);
+    uint8_t *before = malloc(VRAM_SIZE);
+    vram = malloc(VRAM_SIZE);
+    assert(snapshot && before && vram);
+
+    random_fill(snapshot, VRAM_SIZE);
+    memcpy(vram, snapshot, VRAM_SIZE);
+
+    Stats guest = { 0 }, full = { 0 }, revalidate = { 0 };
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        CachedObject *o = &objects[i];
+        o->len = 256 + rand() % (256 * 1024);
+        o->addr = rand() % (VRAM_SIZE - o->len);
+        build_object(o, &guest);
+    }
+
+    VramPageHashes hashes;
+    vram_page_hashes_init(&hashes, VRAM_SIZE, PAGE_SIZE);
+    vram_changed_ranges_init(&changed);
+
+    for (int load = 0; load < NUM_LOADS; load++) {
+        /* Every other load happens right after the previous one */
+        if (load & 1) {
+            guest_writes(&guest);
+        }
+
+        vram_page_hashes_update(&hashes, vram);
+        memcpy(before, vram, VRAM_SIZE);
+        memcpy(vram, snapshot, VRAM_SIZE);
+        vram_changed_ranges_clear(&changed);
+        size_t num_changed =
+            vram_page_hashes_diff(&hashes, vram, record_changed_range,
+                                  &changed);
+        check_changed_pages(before);
+        check_lookups();
+
+        /* What a full flush would cost: all of VRAM plus every object */
+        full.upload_bytes += VRAM_SIZE;
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            full.rebuilds++;
+            full.upload_bytes += objects[i].len;
+        }
+
+        /* Revalidation only rebuilds objects over changed pages */
+        revalidate.upload_bytes += num_changed * PAGE_SIZE;
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            CachedObject *o = &objects[i];
+            if (vram_changed_ranges_overlap(&changed, o->addr, o->len)) {
+                build_object(o, &revalidate);
+            }
+        }
+
+        /* Nothing kept may be stale */
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            CachedObject *o = &objects[i];
+            assert(o->hash == fast_hash(vram + o->addr, o->len));
+        }
+    }
+
+    fprintf(stderr, "  %d loads, %d cached objects\n", NUM_LOADS,
+            NUM_OBJECTS);
+    fprintf(stderr, "  full flush: %6lu rebuilds, %8.1f MiB uploaded\n",
+            full.rebuilds, full.upload_bytes / (1024.0 * 1024.0));
+    fprintf(stderr, "  revalidate: %6lu rebuilds, %8.1f MiB uploaded\n",
+            revalidate.rebuilds, revalidate.upload_bytes / (1024.0 * 1024.0));
+    assert(revalidate.rebuilds < full.rebuilds);
+    assert(revalidate.upload_bytes < full.upload_bytes);
+
+    vram_changed_ranges_finalize(&changed);
+    vram_page_hashes_finalize(&hashes);
+    free(vram);
+    free(before);
+    free(snapshot);
+
+    fprintf(stderr, "ok!\n");
+}
+
+int main(int argc, char const *argv[])
+{
+    srand(1337);
+
+    load_repeatedly();
+
+    return 0;
+}
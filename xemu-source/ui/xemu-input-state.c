@@ -0,0 +1,136 @@
+/*
+ * xemu Input State Publication
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "xemu-input-state.h"
+
+/*
+ * Shared data is only accessed a word at a time, the sequence lock and queue
+ * indices provide the ordering.
+ */
+
+_Static_assert(sizeof(XemuInputSample) % sizeof(uint64_t) == 0,
+               "sample must be a whole number of words");
+_Static_assert(sizeof(XemuRumbleRequest) % sizeof(uint64_t) == 0,
+               "request must be a whole number of words");
+_Static_assert((XEMU_RUMBLE_QUEUE_SIZE & (XEMU_RUMBLE_QUEUE_SIZE - 1)) == 0,
+               "queue size must be a power of two");
+
+static void store_words(uint64_t *dst, const uint64_t *src, int n)
+{
+    for (int i = 0; i < n; i++) {
+        qatomic_set(&dst[i], src[i]);
+    }
+}
+
+static void load_words(uint64_t *dst, const uint64_t *src, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = qatomic_read(&src[i]);
+    }
+}
+
+void xemu_input_slot_init(XemuInputSlot *slot)
+{
+    memset(slot, 0, sizeof(*slot));
+    seqlock_init(&slot->lock);
+}
+
+bool xemu_input_slot_publish(XemuInputSlot *slot, XemuInputSample *sample)
+{
+    XemuInputSample *last = &slot->last;
+    bool changed = sample->buttons != last->buttons ||
+                   memcmp(sample->axis, last->axis, sizeof(sample->axis)) ||
+                   !sample->ts != !last->ts;
+
+    sample->serial = last->serial + changed;
+    sample->change_ts = changed ? sample->ts : last->change_ts;
+    *last = *sample;
+
+    uint64_t words[XEMU_INPUT_SAMPLE_WORDS];
+    memcpy(words, sample, sizeof(words));
+
+    seqlock_write_begin(&slot->lock);
+    store_words(slot->words, words, XEMU_INPUT_SAMPLE_WORDS);
+    seqlock_write_end(&slot->lock);
+
+    return changed;
+}
+
+bool xemu_input_slot_read(const XemuInputSlot *slot, XemuInputSample *sample)
+{
+    uint64_t words[XEMU_INPUT_SAMPLE_WORDS];
+    unsigned start;
+
+    /* The writer only holds the slot for a few stores */
+    do {
+        start = seqlock_read_begin(&slot->lock);
+        load_words(words, slot->words, XEMU_INPUT_SAMPLE_WORDS);
+    } while (seqlock_read_retry(&slot->lock, start));
+
+    memcpy(sample, words, sizeof(words));
+    return sample->ts != 0;
+}
+
+void xemu_rumble_queue_init(XemuRumbleQueue *q)
+{
+    memset(q, 0, sizeof(*q));
+}
+
+void xemu_rumble_queue_push(XemuRumbleQueue *q, const XemuRumbleRequest *req)
+{
+    uint32_t head = q->head;
+    uint32_t tail = qatomic_load_acquire(&q->tail);
+
+    if (head - tail == XEMU_RUMBLE_QUEUE_SIZE) {
+        /*
+         * Discard the oldest request. If the consumer took it in the
+         * meantime the exchange fails, and there is room either way.
+         */
+        if (qatomic_cmpxchg(&q->tail, tail, tail + 1) == tail) {
+            qatomic_set(&q->dropped, q->dropped + 1);
+        }
+    }
+
+    uint64_t words[XEMU_RUMBLE_REQUEST_WORDS];
+    memcpy(words, req, sizeof(words));
+    store_words(q->words[head % XEMU_RUMBLE_QUEUE_SIZE], words,
+                XEMU_RUMBLE_REQUEST_WORDS);
+    qatomic_store_release(&q->head, head + 1);
+}
+
+bool xemu_rumble_queue_pop(XemuRumbleQueue *q, XemuRumbleRequest *req)
+{
+    uint64_t words[XEMU_RUMBLE_REQUEST_WORDS];
+    uint32_t tail = qatomic_load_acquire(&q->tail);
+
+    while (tail != qatomic_load_acquire(&q->head)) {
+        load_words(words, q->words[tail % XEMU_RUMBLE_QUEUE_SIZE],
+                   XEMU_RUMBLE_REQUEST_WORDS);
+        /* Only valid if the producer did not discard it while copying */
+        uint32_t seen = qatomic_cmpxchg(&q->tail, tail, tail + 1);
+        if (seen == tail) {
+            memcpy(req, words, sizeof(words));
+            return true;
+        }
+        tail = seen;
+    }
+
+    return false;
+}
@@ -0,0 +1,93 @@
+/*
+ * xemu Input State Publication
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XEMU_INPUT_STATE_H
+#define XEMU_INPUT_STATE_H
+
+#include "qemu/seqlock.h"
+
+#define XEMU_INPUT_SAMPLE_AXES 6
+
+/* Controller state as sampled by the input thread */
+typedef struct XemuInputSample {
+    int64_t ts;        /* Host clock when sampled in ns, 0 if no controller */
+    int64_t change_ts; /* Host clock of the first sample with this state */
+    uint32_t serial;   /* Incremented whenever buttons or axes change */
+    uint16_t buttons;
+    int16_t axis[XEMU_INPUT_SAMPLE_AXES];
+} XemuInputSample;
+
+#define XEMU_INPUT_SAMPLE_WORDS (sizeof(XemuInputSample) / sizeof(uint64_t))
+
+/*
+ * Latest sample of one controller, published by a single writer through a
+ * sequence lock. Readers never block the writer, and the writer never waits
+ * for readers.
+ */
+typedef struct XemuInputSlot {
+    QemuSeqLock lock;
+    uint64_t words[XEMU_INPUT_SAMPLE_WORDS];
+
+    /* Writer state */
+    XemuInputSample last;
+} XemuInputSlot;
+
+void xemu_input_slot_init(XemuInputSlot *slot);
+
+/*
+ * Publish the buttons and axes of `sample`, sampled at `sample->ts`. The
+ * serial and change timestamp are filled in from the previous sample.
+ * Returns true if the state differs from the previous sample.
+ */
+bool xemu_input_slot_publish(XemuInputSlot *slot, XemuInputSample *sample);
+
+/*
+ * Copy the latest sample. Returns false if there is no controller, in which
+ * case the sample is all zero.
+ */
+bool xemu_input_slot_read(const XemuInputSlot *slot, XemuInputSample *sample);
+
+typedef struct XemuRumbleRequest {
+    int64_t ts;        /* Host clock when requested in ns */
+    uint32_t port;
+    uint16_t strength_l;
+    uint16_t strength_r;
+} XemuRumbleRequest;
+
+#define XEMU_RUMBLE_REQUEST_WORDS \
+    (sizeof(XemuRumbleRequest) / sizeof(uint64_t))
+#define XEMU_RUMBLE_QUEUE_SIZE 32
+
+/*
+ * Bounded single-producer, single-consumer queue of rumble requests. The
+ * producer never waits: when the queue is full the oldest request is
+ * discarded, as a newer one for the same port supersedes it anyway.
+ */
+typedef struct XemuRumbleQueue {
+    uint64_t words[XEMU_RUMBLE_QUEUE_SIZE][XEMU_RUMBLE_REQUEST_WORDS];
+    uint32_t head;    /* Free running, written by the producer */
+    uint32_t tail;    /* Free running, advanced by either side */
+    uint32_t dropped; /* Requests discarded by the producer */
+} XemuRumbleQueue;
+
+void xemu_rumble_queue_init(XemuRumbleQueue *q);
+void xemu_rumble_queue_push(XemuRumbleQueue *q, const XemuRumbleRequest *req);
+bool xemu_rumble_queue_pop(XemuRumbleQueue *q, XemuRumbleRequest *req);
+
+#endif
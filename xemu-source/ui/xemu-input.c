@@ -26,6 +26,8 @@
 #include "qapi/qmp/qdict.h"
 #include "qemu/option.h"
 #include "qemu/timer.h"
+#include "qemu/thread.h"
+#include "qemu/thread-placement.h"
 #include "qemu/config-file.h"
 
 #include "xemu-input.h"
@@ -33,6 +35,7 @@
 #include "xemu-settings.h"
 
 #include "sysemu/blockdev.h"
+#include "sysemu/sysemu.h"
 
 // #define DEBUG_INPUT
 
@@ -47,6 +50,12 @@
 #define XEMU_INPUT_MIN_INPUT_UPDATE_INTERVAL_US  2500
 #define XEMU_INPUT_MIN_RUMBLE_UPDATE_INTERVAL_US 2500
 
+#define XEMU_INPUT_SAMPLE_INTERVAL_MS            1
+#define XEMU_INPUT_RUMBLE_DURATION_MS            250
+#define XEMU_INPUT_RUMBLE_REFRESH_INTERVAL_NS    (100 * SCALE_MS)
+
+QEMU_BUILD_BUG_ON(XEMU_INPUT_SAMPLE_AXES != CONTROLLER_AXIS__COUNT);
+
 #if 0
 static void xemu_input_print_controller_state(ControllerState *state)
 {
@@ -128,6 +137,45 @@ static const char **peripheral_params_settings_map[4][2] = {
 
 static int sdl_kbd_scancode_map[25];
 
+typedef struct XemuInputRumble {
+    ControllerState *state;
+    uint16_t strength_l, strength_r;
+    bool dirty;
+    int64_t sent_ts;
+} XemuInputRumble;
+
+static struct {
+    QemuThread thread;
+    QemuSemaphore wakeup;
+    Notifier exit;
+    bool stop;
+
+    /*
+     * Held by the input thread while sampling, and by the main thread to
+     * change bound_controllers, so a controller is never sampled after it
+     * has been unbound.
+     */
+    QemuMutex lock;
+
+    XemuInputSlot slots[4];
+    XemuRumbleQueue rumble_queue;
+
+    /* Guest rumble state per port, only accessed by the input thread */
+    XemuInputRumble rumble[4];
+} xemu_input_thread;
+
+/*
+ * Keyboard state from the key events pumped by the UI thread, which the
+ * input thread samples. SDL_GetKeyboardState() is updated by the event pump
+ * without a lock, so it is only safe to read on the UI thread.
+ */
+static uint8_t sdl_kbd_state[SDL_NUM_SCANCODES];
+
+static void xemu_input_thread_start(void);
+static void xemu_input_sample_sdl_kbd(uint16_t *buttons, int16_t *axis);
+static void xemu_input_sample_sdl_controller(SDL_GameController *controller,
+                                             uint16_t *buttons, int16_t *axis);
+
 static const char *get_bound_driver(int port)
 {
     assert(port >= 0 && port <= 3);
@@ -160,6 +208,8 @@ void xemu_input_init(void)
         exit(1);
     }
 
+    xemu_input_thread_start();
+
     // Create the keyboard input (always first)
     ControllerState *new_con = malloc(sizeof(ControllerState));
     memset(new_con, 0, sizeof(ControllerState));
@@ -416,38 +466,69 @@ void xemu_input_update_controllers(void)
         xemu_input_update_controller(iter);
     }
     QTAILQ_FOREACH(iter, &available_controllers, entry) {
-        xemu_input_update_rumble(iter);
+        // Rumble requested by the guest is applied by the input thread
+        if (iter->bound < 0 || xemu_input_get_test_mode()) {
+            xemu_input_update_rumble(iter);
+        }
     }
 }
 
 void xemu_input_update_sdl_kbd_controller_state(ControllerState *state)
 {
-    state->buttons = 0;
-    memset(state->axis, 0, sizeof(state->axis));
+    xemu_input_sample_sdl_kbd(&state->buttons, state->axis);
+}
 
-    const uint8_t *kbd = SDL_GetKeyboardState(NULL);
+void xemu_input_track_sdl_keys(const SDL_Event *event)
+{
+    if (event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) {
+        return;
+    }
 
-    for (int i = 0; i < 15; i++) {
-        state->buttons |= kbd[sdl_kbd_scancode_map[i]] << i;
+    unsigned int scancode = event->key.keysym.scancode;
+    if (scancode < SDL_NUM_SCANCODES) {
+        qatomic_set(&sdl_kbd_state[scancode],
+                    event->key.state == SDL_PRESSED);
     }
+}
+
+static bool sdl_kbd_pressed(int button)
+{
+    return qatomic_read(&sdl_kbd_state[sdl_kbd_scancode_map[button]]);
+}
+
+static void xemu_input_sample_sdl_kbd(uint16_t *buttons, int16_t *axis)
+{
+    *buttons = 0;
+    memset(axis, 0, sizeof(int16_t) * CONTROLLER_AXIS__COUNT);
 
-    if (kbd[sdl_kbd_scancode_map[15]]) state->axis[CONTROLLER_AXIS_LSTICK_Y] = 32767;
-    if (kbd[sdl_kbd_scancode_map[16]]) state->axis[CONTROLLER_AXIS_LSTICK_X] = -32768;
-    if (kbd[sdl_kbd_scancode_map[17]]) state->axis[CONTROLLER_AXIS_LSTICK_X] = 32767;
-    if (kbd[sdl_kbd_scancode_map[18]]) state->axis[CONTROLLER_AXIS_LSTICK_Y] = -32768;
-    if (kbd[sdl_kbd_scancode_map[19]]) state->axis[CONTROLLER_AXIS_LTRIG] = 32767;
+    for (int i = 0; i < 15; i++) {
+        *buttons |= sdl_kbd_pressed(i) << i;
+    }
 
-    if (kbd[sdl_kbd_scancode_map[20]]) state->axis[CONTROLLER_AXIS_RSTICK_Y] = 32767;
-    if (kbd[sdl_kbd_scancode_map[21]]) state->axis[CONTROLLER_AXIS_RSTICK_X] = -32768;
-    if (kbd[sdl_kbd_scancode_map[22]]) state->axis[CONTROLLER_AXIS_RSTICK_X] = 32767;
-    if (kbd[sdl_kbd_scancode_map[23]]) state->axis[CONTROLLER_AXIS_RSTICK_Y] = -32768;
-    if (kbd[sdl_kbd_scancode_map[24]]) state->axis[CONTROLLER_AXIS_RTRIG] = 32767;
+    if (sdl_kbd_pressed(15)) axis[CONTROLLER_AXIS_LSTICK_Y] = 32767;
+    if (sdl_kbd_pressed(16)) axis[CONTROLLER_AXIS_LSTICK_X] = -32768;
+    if (sdl_kbd_pressed(17)) axis[CONTROLLER_AXIS_LSTICK_X] = 32767;
+    if (sdl_kbd_pressed(18)) axis[CONTROLLER_AXIS_LSTICK_Y] = -32768;
+    if (sdl_kbd_pressed(19)) axis[CONTROLLER_AXIS_LTRIG] = 32767;
+
+    if (sdl_kbd_pressed(20)) axis[CONTROLLER_AXIS_RSTICK_Y] = 32767;
+    if (sdl_kbd_pressed(21)) axis[CONTROLLER_AXIS_RSTICK_X] = -32768;
+    if (sdl_kbd_pressed(22)) axis[CONTROLLER_AXIS_RSTICK_X] = 32767;
+    if (sdl_kbd_pressed(23)) axis[CONTROLLER_AXIS_RSTICK_Y] = -32768;
+    if (sdl_kbd_pressed(24)) axis[CONTROLLER_AXIS_RTRIG] = 32767;
 }
 
 void xemu_input_update_sdl_controller_state(ControllerState *state)
 {
-    state->buttons = 0;
-    memset(state->axis, 0, sizeof(state->axis));
+    xemu_input_sample_sdl_controller(state->sdl_gamecontroller,
+                                     &state->buttons, state->axis);
+}
+
+static void xemu_input_sample_sdl_controller(SDL_GameController *controller,
+                                             uint16_t *buttons, int16_t *axis)
+{
+    *buttons = 0;
+    memset(axis, 0, sizeof(int16_t) * CONTROLLER_AXIS__COUNT);
 
     const SDL_GameControllerButton sdl_button_map[15] = {
         SDL_CONTROLLER_BUTTON_A,
@@ -468,7 +549,7 @@ void xemu_input_update_sdl_controller_state(ControllerState *state)
     };
 
     for (int i = 0; i < 15; i++) {
-        state->buttons |= SDL_GameControllerGetButton(state->sdl_gamecontroller, sdl_button_map[i]) << i;
+        *buttons |= SDL_GameControllerGetButton(controller, sdl_button_map[i]) << i;
     }
 
     const SDL_GameControllerAxis sdl_axis_map[6] = {
@@ -478,14 +559,12 @@ void xemu_input_update_sdl_controller_state(ControllerState *state)
     };
 
     for (int i = 0; i < 6; i++) {
-        state->axis[i] = SDL_GameControllerGetAxis(state->sdl_gamecontroller, sdl_axis_map[i]);
+        axis[i] = SDL_GameControllerGetAxis(controller, sdl_axis_map[i]);
     }
 
     // FIXME: Check range
-    state->axis[CONTROLLER_AXIS_LSTICK_Y] = -1 - state->axis[CONTROLLER_AXIS_LSTICK_Y];
-    state->axis[CONTROLLER_AXIS_RSTICK_Y] = -1 - state->axis[CONTROLLER_AXIS_RSTICK_Y];
-
-    // xemu_input_print_controller_state(state);
+    axis[CONTROLLER_AXIS_LSTICK_Y] = -1 - axis[CONTROLLER_AXIS_LSTICK_Y];
+    axis[CONTROLLER_AXIS_RSTICK_Y] = -1 - axis[CONTROLLER_AXIS_RSTICK_Y];
 }
 
 void xemu_input_update_rumble(ControllerState *state)
@@ -504,6 +583,145 @@ void xemu_input_update_rumble(ControllerState *state)
     state->last_rumble_updated_ts = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
 }
 
+static void xemu_input_thread_sample(int port, int64_t now)
+{
+    ControllerState *state = bound_controllers[port];
+    XemuInputSample sample = { 0 };
+
+    if (state) {
+        sample.ts = now;
+        if (state->type == INPUT_DEVICE_SDL_KEYBOARD) {
+            xemu_input_sample_sdl_kbd(&sample.buttons, sample.axis);
+        } else if (state->type == INPUT_DEVICE_SDL_GAMECONTROLLER) {
+            xemu_input_sample_sdl_controller(state->sdl_gamecontroller,
+                                             &sample.buttons, sample.axis);
+        }
+    }
+
+    xemu_input_slot_publish(&xemu_input_thread.slots[port], &sample);
+}
+
+static void xemu_input_thread_rumble(int port, int64_t now)
+{
+    ControllerState *state = bound_controllers[port];
+    XemuInputRumble *r = &xemu_input_thread.rumble[port];
+
+    if (r->state != state) {
+        // Carry the guest rumble over to a newly bound controller
+        r->state = state;
+        r->dirty = true;
+    }
+
+    if (!state || !state->rumble_enabled || !g_config.input.allow_vibration ||
+        xemu_input_get_test_mode()) {
+        return;
+    }
+
+    // SDL stops rumbling after the given duration, refresh it while active
+    bool active = r->strength_l || r->strength_r;
+    if (!r->dirty &&
+        !(active && now - r->sent_ts >= XEMU_INPUT_RUMBLE_REFRESH_INTERVAL_NS)) {
+        return;
+    }
+
+    SDL_GameControllerRumble(state->sdl_gamecontroller, r->strength_l,
+                             r->strength_r, XEMU_INPUT_RUMBLE_DURATION_MS);
+    r->sent_ts = now;
+    r->dirty = false;
+}
+
+static void *xemu_input_thread_func(void *opaque)
+{
+    XemuRumbleRequest req;
+
+    thread_placement_enter(THREAD_CLASS_INPUT, 0);
+
+    while (!qatomic_read(&xemu_input_thread.stop)) {
+        qemu_sem_timedwait(&xemu_input_thread.wakeup,
+                           XEMU_INPUT_SAMPLE_INTERVAL_MS);
+
+        qemu_mutex_lock(&xemu_input_thread.lock);
+
+        // Read pending controller reports now rather than waiting for the
+        // next UI frame to pump SDL events. The UI thread pumps events at
+        // the same time, so hold SDL's joystick lock for every joystick and
+        // game controller call. The keyboard comes from sdl_kbd_state.
+        SDL_LockJoysticks();
+        SDL_JoystickUpdate();
+
+        int64_t now = get_clock();
+        for (int port = 0; port < 4; port++) {
+            xemu_input_thread_sample(port, now);
+        }
+
+        while (xemu_rumble_queue_pop(&xemu_input_thread.rumble_queue, &req)) {
+            XemuInputRumble *r = &xemu_input_thread.rumble[req.port];
+            r->strength_l = req.strength_l;
+            r->strength_r = req.strength_r;
+            r->dirty = true;
+        }
+        for (int port = 0; port < 4; port++) {
+            xemu_input_thread_rumble(port, now);
+        }
+
+        SDL_UnlockJoysticks();
+        qemu_mutex_unlock(&xemu_input_thread.lock);
+    }
+
+    return NULL;
+}
+
+static void xemu_input_thread_stop(Notifier *notifier, void *data)
+{
+    qatomic_set(&xemu_input_thread.stop, true);
+    qemu_sem_post(&xemu_input_thread.wakeup);
+    qemu_thread_join(&xemu_input_thread.thread);
+}
+
+static void xemu_input_thread_start(void)
+{
+    for (int i = 0; i < 4; i++) {
+        xemu_input_slot_init(&xemu_input_thread.slots[i]);
+    }
+    xemu_rumble_queue_init(&xemu_input_thread.rumble_queue);
+    qemu_sem_init(&xemu_input_thread.wakeup, 0);
+    qemu_mutex_init(&xemu_input_thread.lock);
+    qemu_thread_create(&xemu_input_thread.thread, "xemu-input",
+                       xemu_input_thread_func, NULL, QEMU_THREAD_JOINABLE);
+
+    // Stop sampling before SDL and the bound controllers go away
+    xemu_input_thread.exit.notify = xemu_input_thread_stop;
+    qemu_add_exit_notifier(&xemu_input_thread.exit);
+}
+
+static void xemu_input_set_bound(int index, ControllerState *state)
+{
+    qemu_mutex_lock(&xemu_input_thread.lock);
+    bound_controllers[index] = state;
+    qemu_mutex_unlock(&xemu_input_thread.lock);
+}
+
+bool xemu_input_read_sample(int index, XemuInputSample *sample)
+{
+    assert(index >= 0 && index < 4);
+    return xemu_input_slot_read(&xemu_input_thread.slots[index], sample);
+}
+
+void xemu_input_queue_rumble(int index, uint16_t strength_l,
+                             uint16_t strength_r)
+{
+    assert(index >= 0 && index < 4);
+
+    XemuRumbleRequest req = {
+        .ts = get_clock(),
+        .port = index,
+        .strength_l = strength_l,
+        .strength_r = strength_r,
+    };
+    xemu_rumble_queue_push(&xemu_input_thread.rumble_queue, &req);
+    qemu_sem_post(&xemu_input_thread.wakeup);
+}
+
 ControllerState *xemu_input_get_bound(int index)
 {
     return bound_controllers[index];
@@ -539,7 +757,7 @@ void xemu_input_bind(int index, ControllerState *state, int save)
 
         bound_controllers[index]->bound = -1;
         bound_controllers[index]->device = NULL;
-        bound_controllers[index] = NULL;
+        xemu_input_set_bound(index, NULL);
     }
 
     // Save this controller's GUID in settings for auto re-connect
@@ -564,7 +782,7 @@ void xemu_input_bind(int index, ControllerState *state, int save)
             xemu_input_bind(state->bound, NULL, 1);
         }
 
-        bound_controllers[index] = state;
+        xemu_input_set_bound(index, state);
         bound_controllers[index]->bound = index;
 
         char *tmp;
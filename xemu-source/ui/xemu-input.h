@@ -29,6 +29,7 @@
 #include <stdbool.h>
 
 #include "qemu/queue.h"
+#include "xemu-input-state.h"
 
 #define DRIVER_DUKE "usb-xbox-gamepad"
 #define DRIVER_S "usb-xbox-gamepad-s"
@@ -121,11 +122,21 @@ extern "C" {
 
 void xemu_input_init(void);
 void xemu_input_process_sdl_events(const SDL_Event *event); // SDL_CONTROLLERDEVICEADDED, SDL_CONTROLLERDEVICEREMOVED
+void xemu_input_track_sdl_keys(const SDL_Event *event); // SDL_KEYDOWN, SDL_KEYUP, every event pumped
 void xemu_input_update_controllers(void);
 void xemu_input_update_controller(ControllerState *state);
 void xemu_input_update_sdl_kbd_controller_state(ControllerState *state);
 void xemu_input_update_sdl_controller_state(ControllerState *state);
 void xemu_input_update_rumble(ControllerState *state);
+
+/*
+ * Bound controllers are sampled on a dedicated input thread. The emulated
+ * devices read the latest sample and queue rumble requests without taking
+ * locks or calling into SDL.
+ */
+bool xemu_input_read_sample(int index, XemuInputSample *sample);
+void xemu_input_queue_rumble(int index, uint16_t strength_l,
+                             uint16_t strength_r);
 ControllerState *xemu_input_get_bound(int index);
 void xemu_input_bind(int index, ControllerState *state, int save);
 bool xemu_input_bind_xmu(int player_index, int peripheral_port_index,
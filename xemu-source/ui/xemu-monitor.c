@@ -22,6 +22,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/main-loop.h"
 #include "qapi/error.h"
 #include "ui/console.h"
 #include "ui/input.h"
@@ -100,10 +101,18 @@ void xemu_run_monitor_command(const char *cmd)
     /* Send command to monitor */
     int len = strlen(cmd)+1;
 
+    /*
+     * Commands such as savevm, loadvm, stop and cont poll the main
+     * AioContext, keep the main loop out as the snapshot menu does
+     */
+    qemu_main_loop_handoff_begin();
+
     /* FIXME: qemu_chr_be_write needs to be fixed to declare inbuf as const. It
      * does not modify the data. Cast for now.
      */
     qemu_chr_be_write(mon_chr, (unsigned char*)cmd, len);
+
+    qemu_main_loop_handoff_end();
 }
 
 static const TypeInfo char_xemu_type_info = {
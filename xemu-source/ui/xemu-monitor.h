@@ -30,6 +30,7 @@ extern "C" {
 
 void xemu_monitor_init(void);
 char *xemu_get_monitor_buffer(void);
+/* Called with the BQL held, parks the main loop while the command runs */
 void xemu_run_monitor_command(const char *cmd);
 
 #ifdef __cplusplus
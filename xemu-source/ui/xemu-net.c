@@ -32,6 +32,7 @@
 #include "qapi/qmp/qdict.h"
 #include "qemu/option.h"
 #include "qemu/config-file.h"
+#include "qemu/main-loop.h"
 #include "net/net.h"
 #include "net/hub.h"
 #include "net/slirp.h"
@@ -48,6 +49,8 @@ void xemu_net_enable(void)
 {
     Error *local_err = NULL;
 
+    BQL_LOCK_GUARD();
+
     NetClientState *nc = qemu_find_netdev(id);
     if (nc != NULL) {
         return;
@@ -196,6 +199,8 @@ static void clear_slirp_port_forwards(void)
 
 void xemu_net_disable(void)
 {
+    BQL_LOCK_GUARD();
+
     if (g_config.net.backend == CONFIG_NET_BACKEND_NAT) {
         clear_slirp_port_forwards();
     }
@@ -210,6 +215,8 @@ void xemu_net_disable(void)
 int xemu_net_is_enabled(void)
 {
     NetClientState *nc;
+
+    BQL_LOCK_GUARD();
     nc = qemu_find_netdev(id);
     g_config.net.enable = (nc != NULL);
     return g_config.net.enable;
@@ -18,6 +18,7 @@
  */
 
 #include "xemu-snapshots.h"
+#include "xemu-notifications.h"
 #include "xemu-settings.h"
 #include "xemu-xbe.h"
 
@@ -29,11 +30,21 @@
 #include "block/qapi.h"
 #include "block/qdict.h"
 #include "block/block-io.h"
+#include "block/snapshot-stop-point.h"
+#include "io/channel-file.h"
+#include "migration/misc.h"
 #include "migration/qemu-file.h"
 #include "migration/snapshot.h"
+#include "migration/snapshot-ram.h"
 #include "qapi/error.h"
 #include "qapi/qapi-commands-block.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qemu/memfd.h"
+#include "qemu/units.h"
 #include "sysemu/runstate.h"
+#include "trace.h"
 
 #include "ui/console.h"
 #include "ui/input.h"
@@ -43,6 +54,41 @@ static XemuSnapshotData *xemu_snapshots_extra_data = NULL;
 static int xemu_snapshots_len = 0;
 static bool xemu_snapshots_dirty = true;
 
+/*
+ * State of a background save. The disk is captured at the stop point (see
+ * block/snapshot-stop-point.h) while the guest is stopped for device state,
+ * and the VM state stream is collected in a memfd while the guest runs
+ * again.
+ */
+#define XEMU_SNAPSHOT_WRITE_CHUNK (1 * MiB)
+
+typedef struct XemuSnapshotBackgroundSave {
+    bool active;
+    bool stopped;
+    bool resumed;
+    bool disk_saved;
+    BlockDriverState *bs;
+    QEMUSnapshotInfo sn;
+    int fd;
+    uint64_t vm_state_size;
+    int64_t start_us;
+    int64_t stop_us;
+    int64_t pause_us;
+    VMChangeStateEntry *vm_change_state;
+    NotifierWithReturn migration_notifier;
+} XemuSnapshotBackgroundSave;
+
+static XemuSnapshotBackgroundSave xemu_snapshots_bg;
+
+/* Delta base recorded in the extra data of the snapshot being saved */
+static const char *xemu_snapshots_save_delta_base;
+
+/*
+ * The thumbnail is encoded while RAM is saved and appended after the VM
+ * state, this is where its size and offset are filled in.
+ */
+static int64_t xemu_snapshots_thumbnail_field = -1;
+
 const char **g_snapshot_shortcut_index_key_map[] = {
     &g_config.general.snapshots.shortcuts.f5,
     &g_config.general.snapshots.shortcuts.f6,
@@ -57,6 +103,7 @@ static void xemu_snapshots_load_data(BlockDriverState *bs_ro,
     data->disc_path = NULL;
     data->xbe_title_name = NULL;
     data->gl_thumbnail = 0;
+    data->delta_base = NULL;
 
     int res = bdrv_snapshot_load_tmp(bs_ro, info->id_str, info->name, err);
     if (res < 0) {
@@ -71,8 +118,9 @@ static void xemu_snapshots_load_data(BlockDriverState *bs_ro,
     }
     offset += res;
 
+    const uint32_t version = be32_to_cpu(header[1]);
     if (be32_to_cpu(header[0]) != XEMU_SNAPSHOT_DATA_MAGIC ||
-        be32_to_cpu(header[1]) != XEMU_SNAPSHOT_DATA_VERSION) {
+        version < 1 || version > XEMU_SNAPSHOT_DATA_VERSION) {
         return;
     }
 
@@ -114,17 +162,51 @@ static void xemu_snapshots_load_data(BlockDriverState *bs_ro,
     const size_t thumbnail_size = be32_to_cpu(*(uint32_t *)&buf[offset]);
     offset += 4;
 
-    if (thumbnail_size) {
+    uint8_t *thumbnail_buf = NULL;
+    if (version >= 3) {
+        /* Stored after the VM state */
+        assert(size >= (offset + 8));
+        const uint64_t thumbnail_offset =
+            be64_to_cpu(*(uint64_t *)&buf[offset]);
+        offset += 8;
+
+        if (thumbnail_size) {
+            thumbnail_buf = g_malloc(thumbnail_size);
+            if (bdrv_load_vmstate(bs_ro, thumbnail_buf, thumbnail_offset,
+                                  thumbnail_size) != thumbnail_size) {
+                g_free(thumbnail_buf);
+                thumbnail_buf = NULL;
+            }
+        }
+    } else if (thumbnail_size) {
+        assert(size >= (offset + thumbnail_size));
+        thumbnail_buf = g_memdup2(&buf[offset], thumbnail_size);
+        offset += thumbnail_size;
+    }
+
+    if (thumbnail_buf) {
         GLuint thumbnail;
         glGenTextures(1, &thumbnail);
-        assert(size >= (offset + thumbnail_size));
-        if (xemu_snapshots_load_png_to_texture(thumbnail, &buf[offset],
+        if (xemu_snapshots_load_png_to_texture(thumbnail, thumbnail_buf,
                                                thumbnail_size)) {
             data->gl_thumbnail = thumbnail;
         } else {
             glDeleteTextures(1, &thumbnail);
         }
-        offset += thumbnail_size;
+        g_free(thumbnail_buf);
+    }
+
+    if (version >= 2) {
+        assert(size >= (offset + 1));
+        const size_t delta_base_size = buf[offset];
+        offset += 1;
+
+        if (delta_base_size) {
+            assert(size >= (offset + delta_base_size));
+            data->delta_base =
+                g_strndup((const char *)&buf[offset], delta_base_size);
+            offset += delta_base_size;
+        }
     }
 
     g_free(buf);
@@ -142,6 +224,7 @@ static void xemu_snapshots_all_load_data(QEMUSnapshotInfo **info,
     if (*data) {
         for (int i = 0; i < xemu_snapshots_len; ++i) {
             g_free((*data)[i].xbe_title_name);
+            g_free((*data)[i].delta_base);
             if ((*data)[i].gl_thumbnail) {
                 glDeleteTextures(1, &((*data)[i].gl_thumbnail));
             }
@@ -182,6 +265,9 @@ int xemu_snapshots_list(QEMUSnapshotInfo **info, XemuSnapshotData **extra_data,
     int snapshots_len;
     assert(err);
 
+    /* The UI lists snapshots while laying out its frame */
+    BQL_LOCK_GUARD();
+
     if (!xemu_snapshots_dirty && xemu_snapshots_extra_data &&
         xemu_snapshots_metadata) {
         goto done;
@@ -196,6 +282,18 @@ int xemu_snapshots_list(QEMUSnapshotInfo **info, XemuSnapshotData **extra_data,
     }
 
     snapshots_len = bdrv_snapshot_list(bs, &xemu_snapshots_metadata);
+
+    /* Hide the disk captures of a background save */
+    if (snapshots_len > 0) {
+        int kept = 0;
+        for (int i = 0; i < snapshots_len; i++) {
+            if (!g_str_has_prefix(xemu_snapshots_metadata[i].name,
+                                  BDRV_STOP_POINT_PREFIX)) {
+                xemu_snapshots_metadata[kept++] = xemu_snapshots_metadata[i];
+            }
+        }
+        snapshots_len = kept;
+    }
     xemu_snapshots_all_load_data(&xemu_snapshots_metadata,
                                  &xemu_snapshots_extra_data, snapshots_len,
                                  err);
@@ -222,6 +320,7 @@ char *xemu_get_currently_loaded_disc_path(void)
     char *file = NULL;
     BlockInfoList *block_list, *info;
 
+    BQL_LOCK_GUARD();
     block_list = qmp_query_block(NULL);
     
     for (info = block_list; info; info = info->next) {
@@ -238,23 +337,520 @@ char *xemu_get_currently_loaded_disc_path(void)
     return file;
 }
 
-void xemu_snapshots_load(const char *vm_name, Error **err)
+static XemuSnapshotData *xemu_snapshots_find_data(const char *vm_name)
+{
+    QEMUSnapshotInfo *info;
+    XemuSnapshotData *data;
+    Error *err = NULL;
+
+    int len = xemu_snapshots_list(&info, &data, &err);
+    if (err) {
+        error_free(err);
+        return NULL;
+    }
+
+    for (int i = 0; i < len; i++) {
+        if (!strcmp(info[i].name, vm_name)) {
+            return &data[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Whether other snapshots are stored as deltas against `vm_name` */
+static bool xemu_snapshots_has_deltas(const char *vm_name)
 {
+    QEMUSnapshotInfo *info;
+    XemuSnapshotData *data;
+    Error *err = NULL;
+
+    int len = xemu_snapshots_list(&info, &data, &err);
+    if (err) {
+        error_free(err);
+        return false;
+    }
+
+    for (int i = 0; i < len; i++) {
+        if (data[i].delta_base && !strcmp(data[i].delta_base, vm_name)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool xemu_snapshots_is_delta_base(const char *vm_name)
+{
+    const char *delta_base = g_config.general.snapshots.delta_base;
+    return vm_name && delta_base && delta_base[0] &&
+           !strcmp(vm_name, delta_base);
+}
+
+static void xemu_snapshots_do_load(const char *vm_name, Error **err)
+{
+    if (xemu_snapshots_bg.active) {
+        error_setg(err, "A snapshot is still being saved");
+        return;
+    }
+
+    /* A delta is applied on top of its base, load that first if needed */
+    XemuSnapshotData *data = xemu_snapshots_find_data(vm_name);
+    char *delta_base = data && data->delta_base &&
+                               !snapshot_ram_base_is(data->delta_base) ?
+                           g_strdup(data->delta_base) :
+                           NULL;
+
     bool vm_running = runstate_is_running();
     vm_stop(RUN_STATE_RESTORE_VM);
-    if (load_snapshot(vm_name, NULL, false, NULL, err) && vm_running) {
+
+    if (delta_base) {
+        bool loaded = load_snapshot(delta_base, NULL, false, NULL, err);
+        if (loaded) {
+            snapshot_ram_base_capture(delta_base);
+        } else {
+            error_prepend(err, "Could not load base snapshot \"%s\": ",
+                          delta_base);
+        }
+        g_free(delta_base);
+        if (!loaded) {
+            return;
+        }
+    }
+
+    if (!load_snapshot(vm_name, NULL, false, NULL, err)) {
+        return;
+    }
+
+    if (xemu_snapshots_is_delta_base(vm_name)) {
+        snapshot_ram_base_capture(vm_name);
+    }
+
+    if (vm_running) {
         vm_start();
     }
 }
 
+/*
+ * Guest-visible pause benchmark. With XEMU_SNAPSHOT_BENCH=<n>, the UI saves
+ * n snapshots in each mode, alternating, one every few seconds while the
+ * guest runs. It then prints the pause times and quits. On a headless
+ * machine, run with display.renderer = "NULL" and SDL_VIDEODRIVER=offscreen.
+ */
+#define XEMU_SNAPSHOT_BENCH_NAME "xemu-bench"
+#define XEMU_SNAPSHOT_BENCH_INTERVAL_US (5 * 1000000)
+
+static struct {
+    bool initialized;
+    int saves;
+    int started;
+    int64_t next_us;
+    int count[2];
+    int64_t pause_us[2];
+    int64_t pause_max_us[2];
+} xemu_snapshots_bench;
+
+static void xemu_snapshots_bench_record(const char *vm_name, bool background,
+                                        int64_t pause_us)
+{
+    if (!xemu_snapshots_bench.saves ||
+        strcmp(vm_name, XEMU_SNAPSHOT_BENCH_NAME)) {
+        return;
+    }
+
+    xemu_snapshots_bench.count[background]++;
+    xemu_snapshots_bench.pause_us[background] += pause_us;
+    xemu_snapshots_bench.pause_max_us[background] =
+        MAX(xemu_snapshots_bench.pause_max_us[background], pause_us);
+}
+
+static void xemu_snapshots_report_save(const char *vm_name, bool background,
+                                       int64_t pause_us, int64_t total_us,
+                                       uint64_t vm_state_size)
+{
+    trace_xemu_snapshots_save(vm_name ?: "", background, pause_us, total_us,
+                              vm_state_size);
+    xemu_snapshots_bench_record(vm_name ?: "", background, pause_us);
+
+    if (background) {
+        char *msg = g_strdup_printf("Saved snapshot \"%s\" (paused %.1f ms)",
+                                    vm_name, pause_us / 1000.0);
+        xemu_queue_notification(msg);
+        g_free(msg);
+    }
+}
+
+static void xemu_snapshots_bg_finish(XemuSnapshotBackgroundSave *bg, Error *err)
+{
+    if (bg->disk_saved) {
+        bdrv_stop_point_release();
+    }
+    if (bg->vm_change_state) {
+        qemu_del_vm_change_state_handler(bg->vm_change_state);
+        bg->vm_change_state = NULL;
+    }
+    close(bg->fd);
+    bg->active = false;
+    xemu_snapshots_dirty = true;
+
+    if (err) {
+        xemu_queue_error_message(error_get_pretty(err));
+        error_free(err);
+        return;
+    }
+
+    xemu_snapshots_report_save(bg->sn.name, true, bg->pause_us,
+                               qemu_clock_get_us(QEMU_CLOCK_REALTIME) -
+                                   bg->start_us,
+                               bg->vm_state_size);
+}
+
+/* Copy the collected stream into the vmstate area of the active layer */
+static int64_t xemu_snapshots_bg_write_vmstate(BlockDriverState *bs,
+                                               void *opaque)
+{
+    XemuSnapshotBackgroundSave *bg = opaque;
+    g_autofree uint8_t *buf = g_malloc(XEMU_SNAPSHOT_WRITE_CHUNK);
+    off_t size = lseek(bg->fd, 0, SEEK_END);
+    int ret = size < 0 ? -errno : 0;
+
+    GRAPH_RDLOCK_GUARD_MAINLOOP();
+
+    for (off_t pos = 0; pos < size && ret >= 0;) {
+        size_t len = MIN(size - pos, XEMU_SNAPSHOT_WRITE_CHUNK);
+        if (pread(bg->fd, buf, len, pos) != len) {
+            return -EIO;
+        }
+        ret = bdrv_save_vmstate(bs, buf, pos, len);
+        pos += len;
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    bg->vm_state_size = size;
+    return size;
+}
+
+static void xemu_snapshots_bg_create_bh(void *opaque)
+{
+    XemuSnapshotBackgroundSave *bg = opaque;
+    Error *err = NULL;
+
+    if (!bg->disk_saved) {
+        error_setg(&err, "Could not save disk state for snapshot \"%s\"",
+                   bg->sn.name);
+    } else {
+        bdrv_stop_point_create(&bg->sn, bg->bs,
+                               xemu_snapshots_bg_write_vmstate, bg, &err);
+    }
+
+    xemu_snapshots_bg_finish(bg, err);
+}
+
+static void xemu_snapshots_bg_vm_state_change(void *opaque, bool running,
+                                              RunState state)
+{
+    XemuSnapshotBackgroundSave *bg = opaque;
+
+    if (!running && state == RUN_STATE_SAVE_VM && !bg->stopped) {
+        /*
+         * Device state is about to be captured. Capture the disk along with
+         * it, draining only while the guest is stopped anyway.
+         */
+        bg->stopped = true;
+        bg->stop_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+        bg->sn.vm_clock_nsec = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+        bg->disk_saved = bdrv_stop_point_capture(bg->bs, &bg->sn, NULL) == 0;
+    } else if (running && bg->stopped && !bg->resumed) {
+        bg->resumed = true;
+        bg->pause_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME) - bg->stop_us;
+    }
+}
+
+static int xemu_snapshots_bg_migration_notify(NotifierWithReturn *notifier,
+                                              MigrationEvent *e, Error **errp)
+{
+    XemuSnapshotBackgroundSave *bg =
+        container_of(notifier, XemuSnapshotBackgroundSave, migration_notifier);
+
+    if (!bg->active || e->type == MIG_EVENT_PRECOPY_SETUP) {
+        return 0;
+    }
+
+    migration_remove_notifier(notifier);
+
+    if (e->type == MIG_EVENT_PRECOPY_FAILED || !bg->stopped) {
+        Error *err = NULL;
+        error_setg(&err, "Could not save snapshot \"%s\"", bg->sn.name);
+        xemu_snapshots_bg_finish(bg, err);
+        return 0;
+    }
+
+    /* The stream is complete, append the thumbnail to it */
+    off_t end = lseek(bg->fd, 0, SEEK_END);
+    uint8_t fields[12];
+    size_t size;
+    g_autofree void *png =
+        end < 0 ? NULL : xemu_snapshots_finish_thumbnail(end, &size, fields);
+    if (png && (pwrite(bg->fd, png, size, end) != size ||
+                pwrite(bg->fd, fields, sizeof(fields),
+                       xemu_snapshots_thumbnail_field) != sizeof(fields))) {
+        warn_report("Could not add thumbnail to snapshot \"%s\"",
+                    bg->sn.name);
+    }
+    xemu_snapshots_thumbnail_field = -1;
+
+    aio_bh_schedule_oneshot(qemu_get_aio_context(),
+                            xemu_snapshots_bg_create_bh, bg);
+    return 0;
+}
+
+/*
+ * Save with the guest running: device state is captured at a short stop
+ * point, then RAM is streamed copy-on-write while the guest continues.
+ * Returns false without side effects if this is not possible, e.g. because
+ * the host lacks userfaultfd write protection.
+ */
+static bool xemu_snapshots_save_background(const char *vm_name, Error **errp)
+{
+    XemuSnapshotBackgroundSave *bg = &xemu_snapshots_bg;
+    g_autoptr(GDateTime) now = g_date_time_new_now_local();
+
+    if (!bdrv_all_can_snapshot(false, NULL, errp)) {
+        return false;
+    }
+
+    BlockDriverState *bs = bdrv_all_find_vmstate_bs(NULL, false, NULL, errp);
+    if (!bs) {
+        return false;
+    }
+
+    if (bdrv_stop_point_prepare(errp) < 0) {
+        return false;
+    }
+
+    int fd = qemu_memfd_create("xemu-snapshot", 0, false, 0, 0, errp);
+    if (fd < 0) {
+        return false;
+    }
+
+    /* The stream is preceded by the title, as for other saves */
+    QEMUFile *f = qemu_file_new_output(
+        QIO_CHANNEL(qio_channel_file_new_fd(dup(fd))));
+    xemu_snapshots_save_extra_data(f);
+    if (qemu_fclose(f) < 0) {
+        error_setg(errp, "Could not write snapshot data");
+        close(fd);
+        return false;
+    }
+
+    memset(bg, 0, sizeof(*bg));
+    bg->bs = bs;
+    bg->fd = fd;
+    bg->start_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    bg->sn.date_sec = g_date_time_to_unix(now);
+    bg->sn.date_nsec = g_date_time_get_microsecond(now) * 1000;
+    bg->sn.icount = -1ULL;
+    if (vm_name) {
+        pstrcpy(bg->sn.name, sizeof(bg->sn.name), vm_name);
+    } else {
+        g_autofree char *autoname = g_date_time_format(now, "vm-%Y%m%d%H%M%S");
+        pstrcpy(bg->sn.name, sizeof(bg->sn.name), autoname);
+    }
+
+    QIOChannelFile *ioc = qio_channel_file_new_fd(dup(fd));
+    qio_channel_set_name(QIO_CHANNEL(ioc), "xemu-snapshot");
+
+    bg->active = true;
+    bg->vm_change_state = qemu_add_vm_change_state_handler(
+        xemu_snapshots_bg_vm_state_change, bg);
+    migration_add_notifier(&bg->migration_notifier,
+                           xemu_snapshots_bg_migration_notify);
+
+    if (!save_snapshot_background_start(QIO_CHANNEL(ioc), errp)) {
+        object_unref(OBJECT(ioc));
+        migration_remove_notifier(&bg->migration_notifier);
+        qemu_del_vm_change_state_handler(bg->vm_change_state);
+        close(fd);
+        bg->active = false;
+        return false;
+    }
+
+    object_unref(OBJECT(ioc));
+    return true;
+}
+
+static void xemu_snapshots_do_save(const char *vm_name, bool background,
+                                   Error **err)
+{
+    if (xemu_snapshots_bg.active) {
+        error_setg(err, "A snapshot is still being saved");
+        return;
+    }
+
+    /* Replacing the base would invalidate the deltas stored against it */
+    const bool is_delta_base = xemu_snapshots_is_delta_base(vm_name);
+    if (is_delta_base && xemu_snapshots_has_deltas(vm_name)) {
+        error_setg(err, "Snapshot \"%s\" is the delta base of other "
+                   "snapshots", vm_name);
+        return;
+    }
+
+    /* Scaled down and read back while the save gets under way */
+    xemu_snapshots_thumbnail_capture();
+
+    /* The base is retained from a stopped VM, so it is saved in foreground */
+    if (background && runstate_is_running() && !is_delta_base) {
+        Error *local_err = NULL;
+        if (xemu_snapshots_save_background(vm_name, &local_err)) {
+            return;
+        }
+
+        static bool warned;
+        if (!warned) {
+            char *msg = g_strdup_printf("Saving in the foreground: %s",
+                                        error_get_pretty(local_err));
+            xemu_queue_notification(msg);
+            g_free(msg);
+            warned = true;
+        }
+        error_free(local_err);
+    }
+
+    /*
+     * Store a delta if the base is retained, otherwise fall back to a full
+     * snapshot rather than loading the base behind the user's back.
+     */
+    const char *delta_base = g_config.general.snapshots.delta_base;
+    const bool delta = !is_delta_base && delta_base && delta_base[0] &&
+                       snapshot_ram_base_is(delta_base);
+
+    xemu_snapshots_save_delta_base = delta ? delta_base : NULL;
+    snapshot_ram_save_begin(g_config.general.snapshots.compress, delta,
+                            is_delta_base ? vm_name : NULL);
+
+    int64_t start_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    bool saved = save_snapshot(vm_name, true, NULL, false, NULL, err);
+
+    snapshot_ram_save_end();
+    xemu_snapshots_save_delta_base = NULL;
+
+    if (saved) {
+        int64_t elapsed_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_us;
+        xemu_snapshots_report_save(vm_name, false, elapsed_us, elapsed_us, 0);
+    } else if (is_delta_base) {
+        snapshot_ram_base_release();
+    }
+}
+
+static void xemu_snapshots_do_delete(const char *vm_name, Error **err)
+{
+    if (xemu_snapshots_bg.active) {
+        error_setg(err, "A snapshot is still being saved");
+        return;
+    }
+
+    if (xemu_snapshots_has_deltas(vm_name)) {
+        error_setg(err, "Snapshot \"%s\" is the delta base of other "
+                   "snapshots", vm_name);
+        return;
+    }
+
+    if (delete_snapshot(vm_name, false, NULL, err) &&
+        snapshot_ram_base_is(vm_name)) {
+        snapshot_ram_base_release();
+    }
+}
+
+/* Loading and saving poll the main AioContext, keep the main loop out */
+void xemu_snapshots_load(const char *vm_name, Error **err)
+{
+    qemu_main_loop_handoff_begin();
+    xemu_snapshots_do_load(vm_name, err);
+    qemu_main_loop_handoff_end();
+}
+
+static void xemu_snapshots_save_mode(const char *vm_name, bool background,
+                                     Error **err)
+{
+    qemu_main_loop_handoff_begin();
+    xemu_snapshots_do_save(vm_name, background, err);
+    qemu_main_loop_handoff_end();
+}
+
 void xemu_snapshots_save(const char *vm_name, Error **err)
 {
-    save_snapshot(vm_name, true, NULL, false, NULL, err);
+    xemu_snapshots_save_mode(vm_name,
+                             g_config.general.snapshots.background_save, err);
+}
+
+static void xemu_snapshots_bench_report(void)
+{
+    static const char *const modes[] = { "foreground", "background" };
+
+    for (int i = 0; i < 2; i++) {
+        int n = xemu_snapshots_bench.count[i];
+        fprintf(stderr, "snapshot bench: %-10s %3d saves, pause avg %8.1f ms, "
+                "max %8.1f ms\n", modes[i], n,
+                n ? xemu_snapshots_bench.pause_us[i] / 1000.0 / n : 0.0,
+                xemu_snapshots_bench.pause_max_us[i] / 1000.0);
+    }
+}
+
+void xemu_snapshots_bench_frame(void)
+{
+    int64_t now_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+
+    if (!xemu_snapshots_bench.initialized) {
+        const char *saves = getenv("XEMU_SNAPSHOT_BENCH");
+        xemu_snapshots_bench.initialized = true;
+        xemu_snapshots_bench.saves = saves ? atoi(saves) : 0;
+        xemu_snapshots_bench.next_us = now_us + XEMU_SNAPSHOT_BENCH_INTERVAL_US;
+    }
+
+    if (xemu_snapshots_bench.saves <= 0 || xemu_snapshots_bg.active ||
+        !runstate_is_running() || now_us < xemu_snapshots_bench.next_us) {
+        return;
+    }
+
+    Error *err = NULL;
+    if (xemu_snapshots_bench.started < 2 * xemu_snapshots_bench.saves) {
+        /* Background saves fall back to the foreground where unsupported */
+        bool background = xemu_snapshots_bench.started++ % 2;
+        xemu_snapshots_save_mode(XEMU_SNAPSHOT_BENCH_NAME, background, &err);
+        xemu_snapshots_bench.next_us =
+            qemu_clock_get_us(QEMU_CLOCK_REALTIME) +
+            XEMU_SNAPSHOT_BENCH_INTERVAL_US;
+        if (!err) {
+            return;
+        }
+        error_report_err(err);
+    } else {
+        xemu_snapshots_bench_report();
+        xemu_snapshots_delete(XEMU_SNAPSHOT_BENCH_NAME, NULL);
+    }
+
+    xemu_snapshots_bench.saves = 0;
+    qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_UI);
 }
 
 void xemu_snapshots_delete(const char *vm_name, Error **err)
 {
-    delete_snapshot(vm_name, false, NULL, err);
+    qemu_main_loop_handoff_begin();
+    xemu_snapshots_do_delete(vm_name, err);
+    qemu_main_loop_handoff_end();
+}
+
+void xemu_snapshots_set_delta_base(const char *vm_name)
+{
+    xemu_settings_set_string(&g_config.general.snapshots.delta_base,
+                             vm_name ? vm_name : "");
+
+    /* The new base is retained the next time it is saved or loaded */
+    if (!vm_name || !snapshot_ram_base_is(vm_name)) {
+        snapshot_ram_base_release();
+    }
 }
 
 void xemu_snapshots_save_extra_data(QEMUFile *f)
@@ -273,12 +869,16 @@ void xemu_snapshots_save_extra_data(QEMUFile *f)
         }
     }
 
-    size_t thumbnail_size = 0;
-    void *thumbnail_buf = xemu_snapshots_create_framebuffer_thumbnail_png(&thumbnail_size);
+    /* Pick up the pixels, the PNG is encoded while the VM state is saved */
+    xemu_snapshots_thumbnail_encode();
+
+    const char *delta_base = xemu_snapshots_save_delta_base;
+    size_t delta_base_size = delta_base ? MIN(strlen(delta_base), 255) : 0;
 
     qemu_put_be32(f, XEMU_SNAPSHOT_DATA_MAGIC);
     qemu_put_be32(f, XEMU_SNAPSHOT_DATA_VERSION);
-    qemu_put_be32(f, 4 + path_size + 1 + xbe_title_name_size + 4 + thumbnail_size);
+    qemu_put_be32(f, 4 + path_size + 1 + xbe_title_name_size + 4 + 8 + 1 +
+                         delta_base_size);
 
     qemu_put_be32(f, path_size);
     if (path_size) {
@@ -292,15 +892,70 @@ void xemu_snapshots_save_extra_data(QEMUFile *f)
         g_free(xbe_title_name);
     }
 
-    qemu_put_be32(f, thumbnail_size);
-    if (thumbnail_size) {
-        qemu_put_buffer(f, (const uint8_t *)thumbnail_buf, thumbnail_size);
-        g_free(thumbnail_buf);
+    /* Extra data starts the VM state, so this is the offset in it */
+    xemu_snapshots_thumbnail_field = 12 + 4 + path_size + 1 +
+                                     xbe_title_name_size;
+    qemu_put_be32(f, 0);
+    qemu_put_be64(f, 0);
+
+    qemu_put_byte(f, delta_base_size);
+    if (delta_base_size) {
+        qemu_put_buffer(f, (const uint8_t *)delta_base, delta_base_size);
     }
 
     xemu_snapshots_dirty = true;
 }
 
+/*
+ * Wait for the thumbnail and return it along with the header fields that
+ * locate it at `offset`. Returns NULL if there is no thumbnail.
+ */
+static void *xemu_snapshots_finish_thumbnail(uint64_t offset, size_t *size,
+                                             uint8_t fields[12])
+{
+    XemuThumbnailTimes times;
+    void *png = xemu_snapshots_thumbnail_collect(size, &times);
+
+    if (png) {
+        trace_xemu_snapshots_thumbnail(times.capture_us, times.readback_us,
+                                       times.encode_us, times.wait_us, *size);
+    }
+    if (!png || xemu_snapshots_thumbnail_field < 0) {
+        g_free(png);
+        return NULL;
+    }
+
+    stl_be_p(fields, *size);
+    stq_be_p(fields + 4, offset);
+    return png;
+}
+
+int xemu_snapshots_save_extra_data_finish(BlockDriverState *bs,
+                                          uint64_t *vm_state_size)
+{
+    uint8_t fields[12];
+    size_t size;
+    g_autofree void *png =
+        xemu_snapshots_finish_thumbnail(*vm_state_size, &size, fields);
+    int64_t field = xemu_snapshots_thumbnail_field;
+
+    xemu_snapshots_thumbnail_field = -1;
+    if (!png) {
+        return 0;
+    }
+
+    int ret = bdrv_save_vmstate(bs, png, *vm_state_size, size);
+    if (ret >= 0) {
+        ret = bdrv_save_vmstate(bs, fields, field, sizeof(fields));
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    *vm_state_size += size;
+    return 0;
+}
+
 bool xemu_snapshots_offset_extra_data(QEMUFile *f)
 {
     unsigned int v;
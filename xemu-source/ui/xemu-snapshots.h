@@ -29,7 +29,7 @@ extern "C" {
 #include <epoxy/gl.h>
 
 #define XEMU_SNAPSHOT_DATA_MAGIC 0x78656d75 // 'xemu'
-#define XEMU_SNAPSHOT_DATA_VERSION 1
+#define XEMU_SNAPSHOT_DATA_VERSION 3
 
 #define XEMU_SNAPSHOT_THUMBNAIL_WIDTH 160
 #define XEMU_SNAPSHOT_THUMBNAIL_HEIGHT 120
@@ -40,8 +40,16 @@ typedef struct XemuSnapshotData {
     char *disc_path;
     char *xbe_title_name;
     GLuint gl_thumbnail;
+    char *delta_base;
 } XemuSnapshotData;
 
+typedef struct XemuThumbnailTimes {
+    int64_t capture_us;  // Scaling and starting the readback
+    int64_t readback_us; // Waiting for and copying the pixels
+    int64_t encode_us;   // PNG encoding, on a worker thread
+    int64_t wait_us;     // Waiting for the encoded PNG
+} XemuThumbnailTimes;
+
 // Implemented in xemu-snapshots.c
 char *xemu_get_currently_loaded_disc_path(void);
 int xemu_snapshots_list(QEMUSnapshotInfo **info, XemuSnapshotData **extra_data,
@@ -49,15 +57,21 @@ int xemu_snapshots_list(QEMUSnapshotInfo **info, XemuSnapshotData **extra_data,
 void xemu_snapshots_load(const char *vm_name, Error **err);
 void xemu_snapshots_save(const char *vm_name, Error **err);
 void xemu_snapshots_delete(const char *vm_name, Error **err);
+void xemu_snapshots_set_delta_base(const char *vm_name);
+void xemu_snapshots_bench_frame(void);
 
 void xemu_snapshots_save_extra_data(QEMUFile *f);
+int xemu_snapshots_save_extra_data_finish(BlockDriverState *bs,
+                                          uint64_t *vm_state_size);
 bool xemu_snapshots_offset_extra_data(QEMUFile *f);
 void xemu_snapshots_mark_dirty(void);
 
 // Implemented in xemu-thumbnail.cc
 void xemu_snapshots_set_framebuffer_texture(GLuint tex, bool flip);
 bool xemu_snapshots_load_png_to_texture(GLuint tex, void *buf, size_t size);
-void *xemu_snapshots_create_framebuffer_thumbnail_png(size_t *size);
+void xemu_snapshots_thumbnail_capture(void);
+void xemu_snapshots_thumbnail_encode(void);
+void *xemu_snapshots_thumbnail_collect(size_t *size, XemuThumbnailTimes *times);
 
 #ifdef __cplusplus
 }
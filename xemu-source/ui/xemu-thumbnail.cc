@@ -24,6 +24,9 @@
 #include "xemu-snapshots.h"
 #include "xui/gl-helpers.hh"
 
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+
 static GLuint display_tex = 0;
 static bool display_flip = false;
 
@@ -55,7 +58,52 @@ bool xemu_snapshots_load_png_to_texture(GLuint tex, void *buf, size_t size)
     return true;
 }
 
-void *xemu_snapshots_create_framebuffer_thumbnail_png(size_t *size)
+/*
+ * A snapshot thumbnail goes through three phases: the display is scaled down
+ * and read back asynchronously when the save is requested, the pixels are
+ * picked up once the savevm stream starts, and PNG encoding runs on a worker
+ * while guest RAM is written. Only one thumbnail is in flight at a time.
+ */
+static struct {
+    GLuint pbo;
+    GLsync fence;
+    int width, height;
+    int64_t request_us;
+    bool encoding;
+    QemuThread thread;
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> png;
+    XemuThumbnailTimes times;
+} thumbnail;
+
+static void *thumbnail_encode_worker(void *opaque)
+{
+    int64_t start_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    if (!fpng::fpng_encode_image_to_memory(thumbnail.pixels.data(),
+                                           thumbnail.width, thumbnail.height,
+                                           3, thumbnail.png)) {
+        thumbnail.png.clear();
+    }
+    thumbnail.times.encode_us =
+        qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_us;
+    return NULL;
+}
+
+static void thumbnail_discard(void)
+{
+    if (thumbnail.encoding) {
+        qemu_thread_join(&thumbnail.thread);
+        thumbnail.encoding = false;
+    }
+    if (thumbnail.fence) {
+        glDeleteSync(thumbnail.fence);
+        thumbnail.fence = 0;
+    }
+    thumbnail.pixels.clear();
+    thumbnail.png.clear();
+}
+
+void xemu_snapshots_thumbnail_capture(void)
 {
     /*
      * Avoids crashing if a snapshot is made on a thread with no GL context
@@ -65,18 +113,86 @@ void *xemu_snapshots_create_framebuffer_thumbnail_png(size_t *size)
      * remove this altogether.
      */
     if (!SDL_GL_GetCurrentContext() || display_tex == 0) {
-        return NULL;
+        return;
     }
 
-    std::vector<uint8_t> png;
-    if (!RenderFramebufferToPng(display_tex, display_flip, png,
-                                2 * XEMU_SNAPSHOT_THUMBNAIL_WIDTH,
-                                2 * XEMU_SNAPSHOT_THUMBNAIL_HEIGHT)) {
+    thumbnail_discard();
+    memset(&thumbnail.times, 0, sizeof(thumbnail.times));
+    thumbnail.request_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+
+    if (!thumbnail.pbo) {
+        glGenBuffers(1, &thumbnail.pbo);
+    }
+    thumbnail.fence = RenderFramebufferToPbo(
+        display_tex, display_flip, thumbnail.pbo,
+        2 * XEMU_SNAPSHOT_THUMBNAIL_WIDTH, 2 * XEMU_SNAPSHOT_THUMBNAIL_HEIGHT,
+        &thumbnail.width, &thumbnail.height);
+
+    thumbnail.times.capture_us =
+        qemu_clock_get_us(QEMU_CLOCK_REALTIME) - thumbnail.request_us;
+}
+
+void xemu_snapshots_thumbnail_encode(void)
+{
+    /* Not requested through the UI, e.g. savevm from the monitor */
+    if (!thumbnail.fence) {
+        xemu_snapshots_thumbnail_capture();
+        if (!thumbnail.fence) {
+            return;
+        }
+    }
+
+    int64_t start_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    GLenum status = glClientWaitSync(thumbnail.fence,
+                                     GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     1000000000 /* 1s */);
+    glDeleteSync(thumbnail.fence);
+    thumbnail.fence = 0;
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        return;
+    }
+
+    size_t size = thumbnail.width * thumbnail.height * 3;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, thumbnail.pbo);
+    const uint8_t *pixels = (const uint8_t *)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pixels) {
+        thumbnail.pixels.assign(pixels, pixels + size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    thumbnail.times.readback_us =
+        qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_us;
+
+    if (!pixels) {
+        return;
+    }
+
+    qemu_thread_create(&thumbnail.thread, "snapshot-thumbnail",
+                       thumbnail_encode_worker, NULL, QEMU_THREAD_JOINABLE);
+    thumbnail.encoding = true;
+}
+
+void *xemu_snapshots_thumbnail_collect(size_t *size, XemuThumbnailTimes *times)
+{
+    if (!thumbnail.encoding) {
         return NULL;
     }
 
-    void *buf = g_malloc(png.size());
-    memcpy(buf, png.data(), png.size());
-    *size = png.size();
+    int64_t start_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    qemu_thread_join(&thumbnail.thread);
+    thumbnail.encoding = false;
+    thumbnail.times.wait_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_us;
+    *times = thumbnail.times;
+
+    void *buf = NULL;
+    *size = thumbnail.png.size();
+    if (*size) {
+        buf = g_malloc(*size);
+        memcpy(buf, thumbnail.png.data(), *size);
+    }
+
+    thumbnail.pixels.clear();
+    thumbnail.png.clear();
     return buf;
 }
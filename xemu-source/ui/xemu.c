@@ -30,6 +30,7 @@
 #include "qemu/osdep.h"
 #include "qemu/module.h"
 #include "qemu/thread.h"
+#include "qemu/thread-placement.h"
 #include "qemu/main-loop.h"
 #include "qemu/rcu.h"
 #include "qemu-version.h"
@@ -544,10 +545,39 @@ static void handle_windowevent(SDL_Event *ev)
     }
 }
 
-void sdl2_poll_events(struct sdl2_console *scon)
+/*
+ * Events for the guest, gathered without the BQL while the UI lays out its
+ * frame and dispatched in one batch with it.
+ */
+static GArray *pending_events;
+
+static void queue_event(SDL_Event *ev)
+{
+    if (ev->type == SDL_MOUSEMOTION && pending_events->len) {
+        SDL_Event *last =
+            &g_array_index(pending_events, SDL_Event, pending_events->len - 1);
+
+        /* Fold motion into the previous motion, buttons keep their order */
+        if (last->type == SDL_MOUSEMOTION &&
+            last->motion.windowID == ev->motion.windowID &&
+            last->motion.state == ev->motion.state) {
+            last->motion.x = ev->motion.x;
+            last->motion.y = ev->motion.y;
+            last->motion.xrel += ev->motion.xrel;
+            last->motion.yrel += ev->motion.yrel;
+            return;
+        }
+    }
+    g_array_append_val(pending_events, *ev);
+}
+
+static void sdl2_pump_events(struct sdl2_console *scon)
 {
     SDL_Event ev1, *ev = &ev1;
-    bool allow_close = true;
+
+    if (!pending_events) {
+        pending_events = g_array_new(false, false, sizeof(SDL_Event));
+    }
 
     if (scon->last_vm_running != runstate_is_running()) {
         scon->last_vm_running = runstate_is_running();
@@ -558,20 +588,53 @@ void sdl2_poll_events(struct sdl2_console *scon)
     xemu_hud_should_capture_kbd_mouse(&kbd, &mouse);
 
     while (SDL_PollEvent(ev)) {
-        xemu_input_process_sdl_events(ev);
         xemu_hud_process_sdl_events(ev);
+        xemu_input_track_sdl_keys(ev);
 
         switch (ev->type) {
         case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_TEXTINPUT:
             if (kbd) break;
+            queue_event(ev);
+            break;
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEWHEEL:
+            if (mouse) break;
+            queue_event(ev);
+            break;
+        case SDL_CONTROLLERDEVICEADDED:
+        case SDL_CONTROLLERDEVICEREMOVED:
+        case SDL_QUIT:
+        case SDL_WINDOWEVENT:
+            queue_event(ev);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* Called with the BQL held */
+static void sdl2_dispatch_events(struct sdl2_console *scon)
+{
+    bool allow_close = true;
+
+    for (guint i = 0; i < pending_events->len; i++) {
+        SDL_Event *ev = &g_array_index(pending_events, SDL_Event, i);
+
+        xemu_input_process_sdl_events(ev);
+
+        switch (ev->type) {
+        case SDL_KEYDOWN:
             handle_keydown(ev);
             break;
         case SDL_KEYUP:
-            if (kbd) break;
             handle_keyup(ev);
             break;
         case SDL_TEXTINPUT:
-            if (kbd) break;
             handle_textinput(ev);
             break;
         case SDL_QUIT:
@@ -584,16 +647,13 @@ void sdl2_poll_events(struct sdl2_console *scon)
             }
             break;
         case SDL_MOUSEMOTION:
-            if (mouse) break;
             handle_mousemotion(ev);
             break;
         case SDL_MOUSEBUTTONDOWN:
         case SDL_MOUSEBUTTONUP:
-            if (mouse) break;
             handle_mousebutton(ev);
             break;
         case SDL_MOUSEWHEEL:
-            if (mouse) break;
             handle_mousewheel(ev);
             break;
         case SDL_WINDOWEVENT:
@@ -603,6 +663,7 @@ void sdl2_poll_events(struct sdl2_console *scon)
             break;
         }
     }
+    g_array_set_size(pending_events, 0);
 
     xemu_input_update_controllers();
 
@@ -610,6 +671,12 @@ void sdl2_poll_events(struct sdl2_console *scon)
     scon->dcl.update_interval = 16; // Ignored
 }
 
+void sdl2_poll_events(struct sdl2_console *scon)
+{
+    sdl2_pump_events(scon);
+    sdl2_dispatch_events(scon);
+}
+
 static void sdl_mouse_warp(DisplayChangeListener *dcl,
                            int x, int y, bool on)
 {
@@ -1047,14 +1114,13 @@ void sdl2_gl_refresh(DisplayChangeListener *dcl)
         flip_required = true;
     }
 
-    /* FIXME: Finer locking. Event handlers in segments of the code expect
-     * to be running on the main thread with the BQL. For now, acquire the
-     * lock and perform rendering, but release before swap to avoid
-     * possible lengthy blocking (for vsync).
+    /*
+     * Events are pumped and the UI laid out and drawn without the BQL. What
+     * the UI does to the guest (menu actions, input) is queued and run in
+     * one short batch afterwards. Handlers that need the main loop to stay
+     * out of the way take a handoff themselves.
      */
-    qemu_mutex_lock_main_loop();
-    bql_lock();
-    sdl2_poll_events(scon);
+    sdl2_pump_events(scon);
 
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -1062,23 +1128,27 @@ void sdl2_gl_refresh(DisplayChangeListener *dcl)
     xemu_hud_set_framebuffer_texture(tex, flip_required);
     xemu_hud_render();
 
-    // Release BQL before swapping (which may sleep if swap interval is not immediate)
+    /*
+     * Actions first: they may hold on to controllers that a removal event
+     * in this batch frees.
+     */
+    bql_lock();
+    xemu_hud_run_bql_actions();
+    xemu_snapshots_bench_frame();
+    sdl2_dispatch_events(scon);
     bql_unlock();
-    qemu_mutex_unlock_main_loop();
 
     glFinish();
     nv2a_release_framebuffer_surface();
     SDL_GL_SwapWindow(scon->real_window);
 
     /* VGA update (see note above) + vblank */
-    qemu_mutex_lock_main_loop();
     bql_lock();
     graphic_hw_update(scon->dcl.con);
     if (scon->updates && scon->surface) {
         scon->updates = 0;
     }
     bql_unlock();
-    qemu_mutex_unlock_main_loop();
 
     /*
      * Throttle to make sure swaps happen at 60Hz
@@ -1246,6 +1316,8 @@ static void *call_qemu_main(void *opaque)
 {
     int status;
 
+    thread_placement_enter(THREAD_CLASS_MAIN_LOOP, 0);
+
     DPRINTF("Second thread: calling qemu_main()\n");
     qemu_init(gArgc, gArgv);
     status = qemu_main();
@@ -1253,6 +1325,34 @@ static void *call_qemu_main(void *opaque)
     exit(status);
 }
 
+#define THREAD_CLASS_CONFIG(name)                                 \
+    {                                                             \
+        .sched = g_config.perf.thread_placement.name.sched,       \
+        .priority = g_config.perf.thread_placement.name.priority, \
+    }
+
+static void xemu_thread_placement_init(void)
+{
+    ThreadPlacementConfig config = {
+        .policy = g_config.perf.thread_placement.policy,
+        .classes = {
+            [THREAD_CLASS_VCPU] = THREAD_CLASS_CONFIG(vcpu),
+            [THREAD_CLASS_PFIFO] = THREAD_CLASS_CONFIG(pfifo),
+            [THREAD_CLASS_RENDER] = THREAD_CLASS_CONFIG(render),
+            [THREAD_CLASS_APU] = THREAD_CLASS_CONFIG(apu),
+            [THREAD_CLASS_DSP] = THREAD_CLASS_CONFIG(dsp),
+            [THREAD_CLASS_INPUT] = THREAD_CLASS_CONFIG(input),
+            [THREAD_CLASS_MAIN_LOOP] = THREAD_CLASS_CONFIG(main_loop),
+            [THREAD_CLASS_VOICE] = THREAD_CLASS_CONFIG(voice),
+        },
+    };
+
+    thread_placement_init(&config);
+
+    /* This thread goes on to run the UI and renderer */
+    thread_placement_enter(THREAD_CLASS_RENDER, 0);
+}
+
 /* Note: only supports millisecond resolution on Windows */
 static void sleep_ns(int64_t ns)
 {
@@ -1376,6 +1476,7 @@ int main(int argc, char **argv)
     }
 #endif
 
+    xemu_thread_placement_init();
     sdl2_display_very_early_init(NULL);
 
     qemu_sem_init(&display_init_sem, 0);
@@ -1401,11 +1502,9 @@ int main(int argc, char **argv)
 
     DPRINTF("Main thread: initializing app\n");
 
-    qemu_mutex_lock_main_loop();
     bql_lock();
     xemu_input_init();
     bql_unlock();
-    qemu_mutex_unlock_main_loop();
 
     while (1) {
         sdl2_gl_refresh(&sdl2_console[0].dcl);
@@ -1415,10 +1514,23 @@ int main(int argc, char **argv)
     // rcu_unregister_thread();
 }
 
+void xemu_toggle_pause(void)
+{
+    // Stopping drains block devices on the main AioContext
+    qemu_main_loop_handoff_begin();
+    if (runstate_is_running()) {
+        vm_stop(RUN_STATE_PAUSED);
+    } else {
+        vm_start();
+    }
+    qemu_main_loop_handoff_end();
+}
+
 void xemu_eject_disc(Error **errp)
 {
     Error *error = NULL;
 
+    qemu_main_loop_handoff_begin();
     xbox_smc_eject_button();
     xemu_settings_set_string(&g_config.sys.files.dvd_path, "");
 
@@ -1429,12 +1541,15 @@ void xemu_eject_disc(Error **errp)
     }
 
     xbox_smc_update_tray_state();
+    qemu_main_loop_handoff_end();
 }
 
 void xemu_load_disc(const char *path, Error **errp)
 {
     Error *error = NULL;
 
+    qemu_main_loop_handoff_begin();
+
     // Ensure an eject sequence is always triggered so Xbox software reloads
     xbox_smc_eject_button();
     xemu_settings_set_string(&g_config.sys.files.dvd_path, "");
@@ -1448,4 +1563,5 @@ void xemu_load_disc(const char *path, Error **errp)
     }
 
     xbox_smc_update_tray_state();
+    qemu_main_loop_handoff_end();
 }
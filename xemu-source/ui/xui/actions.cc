@@ -23,15 +23,35 @@
 #include "../xemu-snapshots.h"
 #include "../xemu-notifications.h"
 #include "snapshot-manager.hh"
+#include <vector>
 
-void ActionEjectDisc(void)
+static std::vector<std::function<void()>> g_bql_actions;
+
+void RunWithBql(std::function<void()> fn)
+{
+    g_bql_actions.push_back(std::move(fn));
+}
+
+void xemu_hud_run_bql_actions(void)
 {
-    Error *err = NULL;
-    xemu_eject_disc(&err);
-    if (err) {
-        xemu_queue_error_message(error_get_pretty(err));
-        error_free(err);
+    // Actions may queue more, run those in the same batch
+    for (size_t i = 0; i < g_bql_actions.size(); i++) {
+        std::function<void()> fn = std::move(g_bql_actions[i]);
+        fn();
     }
+    g_bql_actions.clear();
+}
+
+void ActionEjectDisc(void)
+{
+    RunWithBql([] {
+        Error *err = NULL;
+        xemu_eject_disc(&err);
+        if (err) {
+            xemu_queue_error_message(error_get_pretty(err));
+            error_free(err);
+        }
+    });
 }
 
 void ActionLoadDisc(void)
@@ -51,32 +71,30 @@ void ActionLoadDisc(void)
 
 void ActionLoadDiscFile(const char *file_path)
 {
-    Error *err = NULL;
-    xemu_load_disc(file_path, &err);
+    RunWithBql([path = std::string(file_path)] {
+        Error *err = NULL;
+        xemu_load_disc(path.c_str(), &err);
 
-    if (err) {
-        xemu_queue_error_message(error_get_pretty(err));
-        error_free(err);
-    }
+        if (err) {
+            xemu_queue_error_message(error_get_pretty(err));
+            error_free(err);
+        }
+    });
 }
 
 void ActionTogglePause(void)
 {
-    if (runstate_is_running()) {
-        vm_stop(RUN_STATE_PAUSED);
-    } else {
-        vm_start();
-    }
+    RunWithBql(xemu_toggle_pause);
 }
 
 void ActionReset(void)
 {
-    qemu_system_reset_request(SHUTDOWN_CAUSE_GUEST_RESET);
+    RunWithBql([] { qemu_system_reset_request(SHUTDOWN_CAUSE_GUEST_RESET); });
 }
 
 void ActionShutdown(void)
 {
-    qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_UI);
+    RunWithBql([] { qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_UI); });
 }
 
 void ActionScreenshot(void)
@@ -95,17 +113,35 @@ void ActionActivateBoundSnapshot(int slot, bool save)
         return;
     }
 
-    Error *err = NULL;
     if (save) {
-        xemu_snapshots_save(snapshot_name, &err);
+        ActionSaveSnapshot(snapshot_name);
     } else {
         ActionLoadSnapshotChecked(snapshot_name);
     }
+}
 
-    if (err) {
-        xemu_queue_error_message(error_get_pretty(err));
-        error_free(err);
-    }
+void ActionSaveSnapshot(const char *name)
+{
+    RunWithBql([name = std::string(name ? name : "")] {
+        Error *err = NULL;
+        xemu_snapshots_save(name.empty() ? NULL : name.c_str(), &err);
+        if (err) {
+            xemu_queue_error_message(error_get_pretty(err));
+            error_free(err);
+        }
+    });
+}
+
+void ActionDeleteSnapshot(const char *name)
+{
+    RunWithBql([name = std::string(name)] {
+        Error *err = NULL;
+        xemu_snapshots_delete(name.c_str(), &err);
+        if (err) {
+            xemu_queue_error_message(error_get_pretty(err));
+            error_free(err);
+        }
+    });
 }
 
 void ActionLoadSnapshotChecked(const char *name)
@@ -17,6 +17,11 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #pragma once
+#include <functional>
+
+// The UI lays out frames without the BQL. Anything touching guest state is
+// queued here and run with the BQL in one batch after layout.
+void RunWithBql(std::function<void()> fn);
 
 void ActionEjectDisc();
 void ActionLoadDisc();
@@ -27,3 +32,5 @@ void ActionShutdown();
 void ActionScreenshot();
 void ActionActivateBoundSnapshot(int slot, bool save);
 void ActionLoadSnapshotChecked(const char *name);
+void ActionSaveSnapshot(const char *name); // NULL for a generated name
+void ActionDeleteSnapshot(const char *name);
@@ -42,6 +42,8 @@ extern "C" {
 #include "hw/xbox/mcpx/apu/apu_debug.h"
 #include "hw/xbox/nv2a/debug.h"
 #include "hw/xbox/nv2a/nv2a.h"
+#include "qemu/thread-placement.h"
+#include "qemu/main-loop-notify.h"
 
 #undef typename
 #undef atomic_fetch_add
@@ -21,6 +21,7 @@
 #include "misc.hh"
 #include "font-manager.hh"
 #include "viewport-manager.hh"
+#include "ui/xemu-notifications.h"
 
 #define MAX_VOICES 256
 
@@ -220,6 +221,15 @@ void DebugApuWindow::Draw()
 
     ImGui::Checkbox("HRTF Filtering\n", &g_config.audio.hrtf);
 
+    if (ImGui::Button("Capture State")) {
+        g_autofree char *path = g_strdup_printf(
+            "%sapu-capture.bin", xemu_settings_get_base_path());
+        if (mcpx_apu_debug_capture(path)) {
+            g_autofree char *msg = g_strdup_printf("Saved %s", path);
+            xemu_queue_notification(msg);
+        }
+    }
+
     ImGui::PushFont(g_font_mgr.m_fixed_width_font);
 
     bool color = (dbg->utilization > 0.9);
@@ -229,6 +239,11 @@ void DebugApuWindow::Draw()
 
     ImGui::Text("Frames:      %04d", dbg->frames_processed);
     ImGui::Text("VP:          %4d us", dbg->vp.total_worker_time_us);
+    int num_silent = 0;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        num_silent += dbg->vp.v[i].active && dbg->vp.v[i].silent;
+    }
+    ImGui::Text("Silent:      %4d voices", num_silent);
     if (ImGui::TreeNode("VP Workers")) {
         ImGui::Text(" W: #  us");
         ImGui::SameLine();
@@ -242,6 +257,17 @@ void DebugApuWindow::Draw()
     }
     ImGui::Text("GP Cycles:   %04d", dbg->gp.cycles);
     ImGui::Text("EP Cycles:   %04d", dbg->ep.cycles);
+    ImGui::Text("VP/GP/EP us: %d/%d/%d", dbg->pipeline.vp_time_us,
+                dbg->pipeline.gp_time_us, dbg->pipeline.ep_time_us);
+    ImGui::Text("GP stalls:   %d (%d us)", dbg->pipeline.gp_stalls,
+                dbg->pipeline.gp_stall_us);
+    ImGui::Text("EP stalls:   %d (%d us)", dbg->pipeline.ep_stalls,
+                dbg->pipeline.ep_stall_us);
+    ImGui::Text("Latency:     %.1f/%.1f ms", dbg->output.latency_ms,
+                dbg->output.target_ms);
+    ImGui::Text("Underruns:   %d", dbg->output.underruns);
+    ImGui::Text("Wakeups:     %d", dbg->output.wakeups);
+    ImGui::Text("Rate:        %.4f", dbg->output.rate);
 
     ImGui::PopFont();
     ImGui::Columns(1);
@@ -274,6 +300,43 @@ struct ScrollingBuffer {
     }
 };
 
+// Main loop activity over the last second
+static void DrawMainLoopStats()
+{
+    static MainLoopStats prev, rate;
+    static uint32_t last_sample;
+
+    uint32_t now = SDL_GetTicks();
+    if (now - last_sample >= 1000) {
+        MainLoopStats cur;
+        qemu_main_loop_get_stats(&cur);
+
+        const uint64_t *a = (const uint64_t *)&cur;
+        const uint64_t *b = (const uint64_t *)&prev;
+        uint64_t *r = (uint64_t *)&rate;
+        for (size_t i = 0; i < sizeof(cur) / sizeof(uint64_t); i++) {
+            r[i] = (a[i] - b[i]) * 1000 / (now - last_sample);
+        }
+        prev = cur;
+        last_sample = now;
+    }
+
+    ImGui::Text("Main loop: %llu wakeups/s (%llu kicked), BQL %.1f%%",
+                (unsigned long long)rate.notify.wakeups,
+                (unsigned long long)rate.notify.kicked_wakeups,
+                rate.bql_hold_ns / 1e7);
+    ImGui::Text("Notify: %llu/s, %llu kicks, %llu coalesced, %llu skipped",
+                (unsigned long long)rate.notify.notifies,
+                (unsigned long long)rate.notify.kicks,
+                (unsigned long long)rate.notify.coalesced,
+                (unsigned long long)rate.notify.skipped);
+    if (rate.handoffs) {
+        ImGui::Text("UI handoffs: %llu/s, %.2f ms waiting, %.2f ms parked",
+                    (unsigned long long)rate.handoffs,
+                    rate.handoff_wait_ns / 1e6, rate.handoff_hold_ns / 1e6);
+    }
+}
+
 DebugVideoWindow::DebugVideoWindow()
 {
     m_is_open = false;
@@ -360,6 +423,7 @@ void DebugVideoWindow::Draw()
             ImGui::TreeNode("Advanced");
 
         if (g_config.display.debug.video.advanced_tree_state) {
+            DrawMainLoopStats();
             ImGui::SetNextWindowBgAlpha(alpha);
             if (ImPlot::BeginPlot("##ScrollingDraws", ImVec2(-1,-1))) {
                 ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit);
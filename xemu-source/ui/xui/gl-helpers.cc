@@ -964,7 +964,8 @@ void RenderFramebuffer(GLint tex, int width, int height, bool flip)
     RenderFramebuffer(tex, width, height, flip, scale);
 }
 
-bool RenderFramebufferToPng(GLuint tex, bool flip, std::vector<uint8_t> &png, int max_width, int max_height)
+static void GetFramebufferOutputSize(GLuint tex, int max_width, int max_height,
+                                     int *out_width, int *out_height)
 {
     int width, height;
 
@@ -977,7 +978,13 @@ bool RenderFramebufferToPng(GLuint tex, bool flip, std::vector<uint8_t> &png, in
 
     if (!max_width) max_width = width;
     if (!max_height) max_height = height;
-    ScaleDimensions(width, height, max_width, max_height, &width, &height);
+    ScaleDimensions(width, height, max_width, max_height, out_width, out_height);
+}
+
+bool RenderFramebufferToPng(GLuint tex, bool flip, std::vector<uint8_t> &png, int max_width, int max_height)
+{
+    int width, height;
+    GetFramebufferOutputSize(tex, max_width, max_height, &width, &height);
 
     std::vector<uint8_t> pixels;
     pixels.resize(width * height * 3);
@@ -998,6 +1005,34 @@ bool RenderFramebufferToPng(GLuint tex, bool flip, std::vector<uint8_t> &png, in
     return fpng::fpng_encode_image_to_memory(pixels.data(), width, height, 3, png);
 }
 
+GLsync RenderFramebufferToPbo(GLuint tex, bool flip, GLuint pbo, int max_width,
+                              int max_height, int *width, int *height)
+{
+    GetFramebufferOutputSize(tex, max_width, max_height, width, height);
+
+    Fbo fbo(*width, *height);
+    fbo.Target();
+    bool blend = glIsEnabled(GL_BLEND);
+    if (blend) glDisable(GL_BLEND);
+    float scale[2] = {1.0, 1.0};
+    RenderFramebuffer(tex, *width, *height, !flip, scale);
+    if (blend) glEnable(GL_BLEND);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, *width * *height * 3, NULL,
+                 GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ROW_LENGTH, *width);
+    glPixelStorei(GL_PACK_IMAGE_HEIGHT, *height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, *width, *height, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fbo.Restore();
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    return fence;
+}
+
 void SaveScreenshot(GLuint tex, bool flip)
 {
     Error *err = NULL;
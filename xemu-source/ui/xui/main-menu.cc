@@ -56,6 +56,44 @@ MainMenuScene g_main_menu;
 MainMenuTabView::~MainMenuTabView() {}
 void MainMenuTabView::Draw() {}
 
+void MainMenuGeneralView::DrawThreadLayout()
+{
+    const CpuTopology *topo = thread_placement_get_topology();
+    ThreadPlacementInfo info[64];
+    int count = thread_placement_get_layout(info, ARRAY_SIZE(info));
+
+    std::string text;
+    if (topo) {
+        text += string_format("Host: %d cores, %d threads%s%s\n",
+                              topo->num_cores, topo->num_cpus,
+                              topo->smt ? ", SMT" : "",
+                              topo->hybrid ? ", hybrid" : "");
+    } else {
+        text += "Host: topology unknown\n";
+    }
+
+    for (int i = 0; i < count; i++) {
+        char cpus[64] = "floating";
+        if (cpu_set_count(&info[i].cpus)) {
+            cpu_set_format(&info[i].cpus, cpus, sizeof(cpus));
+        }
+        auto name = string_format("%s %d", thread_class_names[info[i].cls],
+                                  info[i].index);
+        text += string_format("%-12s %s", name.c_str(), cpus);
+        if (info[i].error) {
+            text += string_format(" (%s)", strerror(info[i].error));
+        }
+        text += "\n";
+    }
+
+    ImGui::PushFont(g_font_mgr.m_fixed_width_font);
+    ImGui::InputTextMultiline("##thread_layout", (char *)text.c_str(),
+                              text.size() + 1,
+                              ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 8),
+                              ImGuiInputTextFlags_ReadOnly);
+    ImGui::PopFont();
+}
+
 void MainMenuGeneralView::Draw()
 {
 #if defined(_WIN32)
@@ -73,6 +111,15 @@ void MainMenuGeneralView::Draw()
     Toggle("Cache shaders to disk", &g_config.perf.cache_shaders,
            "Reduce stutter in games by caching previously generated shaders");
 
+    if (ChevronCombo("Thread placement",
+                     &g_config.perf.thread_placement.policy,
+                     "Off\0Spread\0Compact\0",
+                     "Pin emulator threads to separate physical cores")) {
+        thread_placement_set_policy(
+            (ThreadPlacementPolicy)g_config.perf.thread_placement.policy);
+    }
+    DrawThreadLayout();
+
     SectionTitle("Miscellaneous");
     Toggle("Skip startup animation", &g_config.general.skip_boot_anim,
            "Skip the full Xbox boot animation sequence");
@@ -207,7 +254,9 @@ void MainMenuInputView::Draw()
                     if (iter == driver_display_names[j])
                         bound_drivers[active] = available_drivers[j];
                 }
-                xemu_input_bind(active, bound_controllers[active], 1);
+                RunWithBql([port = active] {
+                    xemu_input_bind(port, bound_controllers[port], 1);
+                });
             }
             if (is_selected) {
                 ImGui::SetItemDefaultFocus();
@@ -247,7 +296,7 @@ void MainMenuInputView::Draw()
         // Handle "Not connected"
         bool is_selected = bound_state == NULL;
         if (ImGui::Selectable(not_connected, is_selected)) {
-            xemu_input_bind(active, NULL, 1);
+            RunWithBql([port = active] { xemu_input_bind(port, NULL, 1); });
             bound_state = NULL;
         }
         if (is_selected) {
@@ -266,16 +315,18 @@ void MainMenuInputView::Draw()
                 selectable_label = buf;
             }
             if (ImGui::Selectable(selectable_label, is_selected)) {
-                xemu_input_bind(active, iter, 1);
-
                 // FIXME: We want to bind the XMU here, but we can't because we
                 // just unbound it and we need to wait for Qemu to release the
                 // file
 
                 // If we previously had no controller connected, we can rebind
                 // the XMU
-                if (bound_state == NULL)
-                    xemu_input_rebind_xmu(active);
+                bool rebind_xmu = bound_state == NULL;
+                RunWithBql([port = active, iter, rebind_xmu] {
+                    xemu_input_bind(port, iter, 1);
+                    if (rebind_xmu)
+                        xemu_input_rebind_xmu(port);
+                });
 
                 bound_state = iter;
             }
@@ -375,34 +426,36 @@ void MainMenuInputView::Draw()
                     const char *selectable_label = peripheral_type_names[j];
 
                     if (ImGui::Selectable(selectable_label, is_selected)) {
-                        // Free any existing peripheral
-                        if (bound_state->peripherals[i] != NULL) {
-                            if (bound_state->peripheral_types[i] ==
-                                PERIPHERAL_XMU) {
-                                // Another peripheral was already bound.
-                                // Unplugging
-                                xemu_input_unbind_xmu(active, i);
+                        RunWithBql([bound_state, port = active, i, j] {
+                            // Free any existing peripheral
+                            if (bound_state->peripherals[i] != NULL) {
+                                if (bound_state->peripheral_types[i] ==
+                                    PERIPHERAL_XMU) {
+                                    // Another peripheral was already bound.
+                                    // Unplugging
+                                    xemu_input_unbind_xmu(port, i);
+                                }
+
+                                // Free the existing state
+                                g_free((void *)bound_state->peripherals[i]);
+                                bound_state->peripherals[i] = NULL;
                             }
 
-                            // Free the existing state
-                            g_free((void *)bound_state->peripherals[i]);
-                            bound_state->peripherals[i] = NULL;
-                        }
-
-                        // Change the peripheral type to the newly selected type
-                        bound_state->peripheral_types[i] =
-                            (enum peripheral_type)j;
+                            // Change the peripheral type to the newly selected type
+                            bound_state->peripheral_types[i] =
+                                (enum peripheral_type)j;
 
-                        // Allocate state for the new peripheral
-                        if (j == PERIPHERAL_XMU) {
-                            bound_state->peripherals[i] =
-                                g_malloc(sizeof(XmuState));
-                            memset(bound_state->peripherals[i], 0,
-                                   sizeof(XmuState));
-                        }
+                            // Allocate state for the new peripheral
+                            if (j == PERIPHERAL_XMU) {
+                                bound_state->peripherals[i] =
+                                    g_malloc(sizeof(XmuState));
+                                memset(bound_state->peripherals[i], 0,
+                                       sizeof(XmuState));
+                            }
 
-                        xemu_save_peripheral_settings(
-                            active, i, bound_state->peripheral_types[i], NULL);
+                            xemu_save_peripheral_settings(
+                                port, i, bound_state->peripheral_types[i], NULL);
+                        });
                     }
 
                     if (is_selected) {
@@ -466,7 +519,9 @@ void MainMenuInputView::Draw()
                     if (new_path) {
                         if (create_fatx_image(new_path, DEFAULT_XMU_SIZE)) {
                             // XMU was created successfully. Bind it
-                            xemu_input_bind_xmu(active, i, new_path, false);
+                            RunWithBql([port = active, i, path = std::string(new_path)] {
+                                xemu_input_bind_xmu(port, i, path.c_str(), false);
+                            });
                         } else {
                             // Show alert message
                             char *msg = g_strdup_printf(
@@ -483,11 +538,13 @@ void MainMenuInputView::Draw()
                 else
                     xmu_port_path = g_strdup(xmu->filename);
                 if (FilePicker("Image", &xmu_port_path, img_file_filters)) {
-                    if (strlen(xmu_port_path) == 0) {
-                        xemu_input_unbind_xmu(active, i);
-                    } else {
-                        xemu_input_bind_xmu(active, i, xmu_port_path, false);
-                    }
+                    RunWithBql([port = active, i, path = std::string(xmu_port_path)] {
+                        if (path.empty()) {
+                            xemu_input_unbind_xmu(port, i);
+                        } else {
+                            xemu_input_bind_xmu(port, i, path.c_str(), false);
+                        }
+                    });
                 }
                 g_free((void *)xmu_port_path);
 
@@ -701,6 +758,8 @@ void MainMenuAudioView::Draw()
     SectionTitle("Quality");
     Toggle("Real-time DSP processing", &g_config.audio.use_dsp,
            "Enable improved audio accuracy (experimental)");
+    Toggle("Drift compensation", &g_config.audio.drift_compensation,
+           "Slightly resample output to hold audio latency steady");
 
 }
 
@@ -906,11 +965,13 @@ void MainMenuNetworkView::Draw()
                enabled ? "Virtual network connected (disable to change network "
                          "settings)" :
                          "Connect virtual network cable to machine")) {
-        if (enabled) {
-            xemu_net_disable();
-        } else {
-            xemu_net_enable();
-        }
+        RunWithBql([enabled] {
+            if (enabled) {
+                xemu_net_disable();
+            } else {
+                xemu_net_enable();
+            }
+        });
     }
 
     bool appearing = ImGui::IsWindowAppearing();
@@ -1286,6 +1347,12 @@ void MainMenuSnapshotsView::Draw()
     g_snapshot_mgr.Refresh();
 
     SectionTitle("Snapshots");
+    Toggle("Save in background", &g_config.general.snapshots.background_save,
+           "Keep the game running while a snapshot is written to disk. "
+           "Requires Linux with userfaultfd write protection");
+    Toggle("Compress snapshots", &g_config.general.snapshots.compress,
+           "Store guest memory compressed. Snapshots saved in the background "
+           "are not compressed");
     Toggle("Filter by current title",
            &g_config.general.snapshots.filter_current_game,
            "Only display snapshots created while running the currently running "
@@ -1335,8 +1402,7 @@ void MainMenuSnapshotsView::Draw()
     }
     if (ImGui::Button(snapshot_with_create_name_exists ? "Replace" : "Create",
                       ImVec2(-FLT_MIN, 0))) {
-        xemu_snapshots_save(m_search_buf.empty() ? NULL : m_search_buf.c_str(),
-                            NULL);
+        ActionSaveSnapshot(m_search_buf.empty() ? NULL : m_search_buf.c_str());
         ClearSearch();
     }
     if (snapshot_with_create_name_exists) {
@@ -1480,21 +1546,26 @@ void MainMenuSnapshotsView::DrawSnapshotContextMenu(
         ImGui::EndMenu();
     }
 
-    ImGui::Separator();
+    bool is_delta_base =
+        !g_strcmp0(g_config.general.snapshots.delta_base, snapshot->name);
+    if (ImGui::MenuItem("Use as Delta Base", NULL, is_delta_base)) {
+        RunWithBql([name = std::string(is_delta_base ? "" : snapshot->name)] {
+            xemu_snapshots_set_delta_base(name.empty() ? NULL : name.c_str());
+        });
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Store later snapshots as differences to this one "
+                          "once it has been loaded or saved");
+    }
 
-    Error *err = NULL;
+    ImGui::Separator();
 
     if (ImGui::MenuItem("Replace")) {
-        xemu_snapshots_save(snapshot->name, &err);
+        ActionSaveSnapshot(snapshot->name);
     }
 
     if (ImGui::MenuItem("Delete")) {
-        xemu_snapshots_delete(snapshot->name, &err);
-    }
-
-    if (err) {
-        xemu_queue_error_message(error_get_pretty(err));
-        error_free(err);
+        ActionDeleteSnapshot(snapshot->name);
     }
 
     ImGui::EndPopup();
@@ -40,6 +40,9 @@ public:
 
 class MainMenuGeneralView : public virtual MainMenuTabView
 {
+protected:
+    void DrawThreadLayout();
+
 public:
     void Draw() override;
 };
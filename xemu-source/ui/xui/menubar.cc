@@ -93,7 +93,7 @@ void ShowMainMenu()
 
             if (ImGui::BeginMenu("Snapshot")) {
                 if (ImGui::MenuItem("Create Snapshot")) {
-                    xemu_snapshots_save(NULL, NULL);
+                    ActionSaveSnapshot(NULL);
                     xemu_queue_notification("Created new snapshot");
                 }
 
@@ -17,6 +17,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include "monitor.hh"
+#include "actions.hh"
 #include "imgui.h"
 #include "misc.hh"
 #include "font-manager.hh"
@@ -120,7 +121,9 @@ void MonitorWindow::ToggleOpen(void)
 
 void MonitorWindow::ExecCommand(const char* command_line)
 {
-    xemu_run_monitor_command(command_line);
+    RunWithBql([cmd = std::string(command_line)] {
+        xemu_run_monitor_command(cmd.c_str());
+    });
 
     // Insert into history. First find match and delete it so it can be pushed to the back. This isn't trying to be smart or optimal.
     HistoryPos = -1;
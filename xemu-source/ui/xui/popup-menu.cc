@@ -437,7 +437,7 @@ public:
             pop = true;
         }
         if (PopupMenuButton("Save Snapshot", ICON_FA_DOWNLOAD)) {
-            xemu_snapshots_save(NULL, NULL);
+            ActionSaveSnapshot(NULL);
             xemu_queue_notification("Created new snapshot");
             pop = true;
         }
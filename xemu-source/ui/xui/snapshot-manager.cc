@@ -18,6 +18,7 @@
 //
 
 #include "common.hh"
+#include "actions.hh"
 #include "notifications.hh"
 #include "snapshot-manager.hh"
 #include "xemu-hud.h"
@@ -84,7 +85,7 @@ void SnapshotManager::LoadSnapshotChecked(const char *name)
         m_open_pending = true;
     } else {
         if (!data->disc_path) {
-            xemu_eject_disc(NULL);
+            RunWithBql([] { xemu_eject_disc(NULL); });
         }
         LoadSnapshot(name);
     }
@@ -96,14 +97,16 @@ void SnapshotManager::LoadSnapshotChecked(const char *name)
 
 void SnapshotManager::LoadSnapshot(const char *name)
 {
-    Error *err = NULL;
+    RunWithBql([name = std::string(name)] {
+        Error *err = NULL;
 
-    xemu_snapshots_load(name, &err);
+        xemu_snapshots_load(name.c_str(), &err);
 
-    if (err) {
-        xemu_queue_error_message(error_get_pretty(err));
-        error_free(err);
-    }
+        if (err) {
+            xemu_queue_error_message(error_get_pretty(err));
+            error_free(err);
+        }
+    });
 }
 
 void SnapshotManager::Draw()
@@ -134,16 +137,19 @@ void SnapshotManager::DrawSnapshotDiscLoadDialog()
     ImGui::Dummy(ImVec2(0,16));
 
     if (ImGui::Button("Yes", ImVec2(120, 0))) {
-        xemu_eject_disc(NULL);
-        
-        Error *err = NULL;
-        xemu_load_disc(m_target_disc_path.c_str(), &err);
-        if (err) {
-            xemu_queue_error_message(error_get_pretty(err));
-            error_free(err);
-        } else {
-            LoadSnapshot(m_pending_load_name.c_str());
-        }
+        RunWithBql([this, disc_path = m_target_disc_path,
+                    name = m_pending_load_name] {
+            xemu_eject_disc(NULL);
+
+            Error *err = NULL;
+            xemu_load_disc(disc_path.c_str(), &err);
+            if (err) {
+                xemu_queue_error_message(error_get_pretty(err));
+                error_free(err);
+            } else {
+                LoadSnapshot(name.c_str());
+            }
+        });
 
         ImGui::CloseCurrentPopup();
     }
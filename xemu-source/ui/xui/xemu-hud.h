@@ -33,6 +33,7 @@ extern "C" {
 // Implemented in xemu.c
 int xemu_is_fullscreen(void);
 void xemu_toggle_fullscreen(void);
+void xemu_toggle_pause(void);
 void xemu_eject_disc(Error **errp);
 void xemu_load_disc(const char *path, Error **errp);
 
@@ -44,6 +45,9 @@ void xemu_hud_process_sdl_events(SDL_Event *event);
 void xemu_hud_should_capture_kbd_mouse(int *kbd, int *mouse);
 void xemu_hud_set_framebuffer_texture(GLuint tex, bool flip);
 
+// Implemented in actions.cc, called with the BQL held
+void xemu_hud_run_bql_actions(void);
+
 #ifdef __cplusplus
 }
 #endif
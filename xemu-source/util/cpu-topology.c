@@ -0,0 +1,416 @@
+/*
+ * Host CPU topology and thread layout
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cpu-topology.h"
+
+/* Plain libc only, so this can be built into standalone tests */
+
+const char *const thread_class_names[THREAD_CLASS__COUNT] = {
+    [THREAD_CLASS_VCPU] = "vCPU",
+    [THREAD_CLASS_PFIFO] = "PFIFO",
+    [THREAD_CLASS_RENDER] = "Render",
+    [THREAD_CLASS_APU] = "APU",
+    [THREAD_CLASS_DSP] = "DSP",
+    [THREAD_CLASS_INPUT] = "Input",
+    [THREAD_CLASS_MAIN_LOOP] = "Main loop",
+    [THREAD_CLASS_VOICE] = "Voice",
+};
+
+const char *const thread_placement_policy_names[THREAD_PLACEMENT__COUNT] = {
+    [THREAD_PLACEMENT_OFF] = "off",
+    [THREAD_PLACEMENT_SPREAD] = "spread",
+    [THREAD_PLACEMENT_COMPACT] = "compact",
+};
+
+void cpu_set_clear(CpuSet *set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+void cpu_set_add(CpuSet *set, int cpu)
+{
+    if (cpu >= 0 && cpu < CPU_TOPOLOGY_MAX_CPUS) {
+        set->bits[cpu / CPU_SET_BITS_PER_WORD] |=
+            1UL << (cpu % CPU_SET_BITS_PER_WORD);
+    }
+}
+
+bool cpu_set_has(const CpuSet *set, int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_TOPOLOGY_MAX_CPUS) {
+        return false;
+    }
+    return set->bits[cpu / CPU_SET_BITS_PER_WORD] &
+           (1UL << (cpu % CPU_SET_BITS_PER_WORD));
+}
+
+int cpu_set_count(const CpuSet *set)
+{
+    int count = 0;
+    for (int i = 0; i < CPU_SET_WORDS; i++) {
+        count += __builtin_popcountl(set->bits[i]);
+    }
+    return count;
+}
+
+void cpu_set_union(CpuSet *dst, const CpuSet *src)
+{
+    for (int i = 0; i < CPU_SET_WORDS; i++) {
+        dst->bits[i] |= src->bits[i];
+    }
+}
+
+bool cpu_set_equal(const CpuSet *a, const CpuSet *b)
+{
+    return !memcmp(a, b, sizeof(*a));
+}
+
+static int cpu_set_first(const CpuSet *set)
+{
+    for (int cpu = 0; cpu < CPU_TOPOLOGY_MAX_CPUS; cpu++) {
+        if (cpu_set_has(set, cpu)) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+bool cpu_set_parse_list(CpuSet *set, const char *list)
+{
+    const char *p = list;
+
+    cpu_set_clear(set);
+    while (*p && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0) {
+            return false;
+        }
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_TOPOLOGY_MAX_CPUS;
+             cpu++) {
+            cpu_set_add(set, cpu);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p && *p != '\n') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void cpu_set_format(const CpuSet *set, char *buf, size_t size)
+{
+    size_t len = 0;
+
+    if (!size) {
+        return;
+    }
+    buf[0] = '\0';
+
+    for (int cpu = 0; cpu < CPU_TOPOLOGY_MAX_CPUS; cpu++) {
+        if (!cpu_set_has(set, cpu)) {
+            continue;
+        }
+        int last = cpu;
+        while (cpu_set_has(set, last + 1)) {
+            last++;
+        }
+        int n = last == cpu ?
+                    snprintf(buf + len, size - len, "%s%d", len ? "," : "",
+                             cpu) :
+                    snprintf(buf + len, size - len, "%s%d-%d",
+                             len ? "," : "", cpu, last);
+        if (n < 0 || len + n >= size) {
+            buf[len] = '\0';
+            return;
+        }
+        len += n;
+        cpu = last;
+    }
+}
+
+static bool read_line(const char *root, const char *path, char *buf,
+                      size_t size)
+{
+    char full[256];
+    snprintf(full, sizeof(full), "%s/%s", root, path);
+
+    FILE *f = fopen(full, "r");
+    if (!f) {
+        return false;
+    }
+    bool ok = fgets(buf, size, f) != NULL;
+    fclose(f);
+    return ok;
+}
+
+static int read_int(const char *root, const char *path, int fallback)
+{
+    char buf[32];
+    if (!read_line(root, path, buf, sizeof(buf))) {
+        return fallback;
+    }
+    return atoi(buf);
+}
+
+/* First cpu sharing the highest level data or unified cache */
+static int read_llc(const char *root, int cpu)
+{
+    int llc = -1, llc_level = 0;
+
+    for (int i = 0; i < 16; i++) {
+        char path[96], buf[1024];
+        CpuSet shared;
+
+        snprintf(path, sizeof(path), "cpu%d/cache/index%d/type", cpu, i);
+        if (!read_line(root, path, buf, sizeof(buf))) {
+            break;
+        }
+        if (!strncmp(buf, "Instruction", 11)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "cpu%d/cache/index%d/level", cpu, i);
+        int level = read_int(root, path, 0);
+        snprintf(path, sizeof(path), "cpu%d/cache/index%d/shared_cpu_list",
+                 cpu, i);
+        if (level > llc_level && read_line(root, path, buf, sizeof(buf)) &&
+            cpu_set_parse_list(&shared, buf)) {
+            llc = cpu_set_first(&shared);
+            llc_level = level;
+        }
+    }
+
+    return llc;
+}
+
+static int read_capacity(const char *root, int cpu)
+{
+    char path[96];
+
+    /* Scaled to 1024 for the fastest core, where the kernel knows */
+    snprintf(path, sizeof(path), "cpu%d/cpu_capacity", cpu);
+    int capacity = read_int(root, path, 0);
+    if (capacity > 0) {
+        return capacity;
+    }
+
+    snprintf(path, sizeof(path), "cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    return read_int(root, path, 0) / 1000;
+}
+
+static const CpuTopology *sort_topo;
+
+/* Best capacity of any core sharing the last level cache with `core` */
+static int llc_capacity(const CpuTopologyCore *core)
+{
+    int capacity = 0;
+    for (int i = 0; i < sort_topo->num_cores; i++) {
+        if (sort_topo->cores[i].llc == core->llc) {
+            capacity = MAX(capacity, sort_topo->cores[i].capacity);
+        }
+    }
+    return capacity;
+}
+
+static int compare_cores(const void *pa, const void *pb)
+{
+    const CpuTopologyCore *a = pa, *b = pb;
+    int ca = llc_capacity(a), cb = llc_capacity(b);
+
+    if (ca != cb) {
+        return cb - ca;
+    }
+    if (a->llc != b->llc) {
+        return a->llc - b->llc;
+    }
+    if (a->capacity != b->capacity) {
+        return b->capacity - a->capacity;
+    }
+    if (a->cluster != b->cluster) {
+        return a->cluster - b->cluster;
+    }
+    return a->first_cpu - b->first_cpu;
+}
+
+bool cpu_topology_read(CpuTopology *topo, const char *root)
+{
+    char buf[1024];
+
+    memset(topo, 0, sizeof(*topo));
+
+    if (!read_line(root, "online", buf, sizeof(buf)) ||
+        !cpu_set_parse_list(&topo->online, buf)) {
+        return false;
+    }
+
+    for (int cpu = 0; cpu < CPU_TOPOLOGY_MAX_CPUS; cpu++) {
+        if (!cpu_set_has(&topo->online, cpu)) {
+            continue;
+        }
+        topo->num_cpus++;
+
+        char path[96];
+        CpuSet siblings;
+        snprintf(path, sizeof(path), "cpu%d/topology/thread_siblings_list",
+                 cpu);
+        if (!read_line(root, path, buf, sizeof(buf)) ||
+            !cpu_set_parse_list(&siblings, buf) ||
+            !cpu_set_has(&siblings, cpu)) {
+            cpu_set_clear(&siblings);
+            cpu_set_add(&siblings, cpu);
+        }
+
+        int first = cpu_set_first(&siblings);
+        int capacity = read_capacity(root, cpu);
+        CpuTopologyCore *core = NULL;
+        for (int i = 0; i < topo->num_cores; i++) {
+            if (topo->cores[i].first_cpu == first) {
+                core = &topo->cores[i];
+                break;
+            }
+        }
+
+        if (core) {
+            cpu_set_add(&core->cpus, cpu);
+            core->capacity = MAX(core->capacity, capacity);
+            topo->smt = true;
+            continue;
+        }
+
+        core = &topo->cores[topo->num_cores++];
+        cpu_set_add(&core->cpus, cpu);
+        core->first_cpu = first;
+        snprintf(path, sizeof(path), "cpu%d/topology/physical_package_id",
+                 cpu);
+        core->package = read_int(root, path, 0);
+        snprintf(path, sizeof(path), "cpu%d/topology/cluster_id", cpu);
+        core->cluster = read_int(root, path, -1);
+        core->llc = read_llc(root, cpu);
+        core->capacity = capacity;
+    }
+
+    if (!topo->num_cores) {
+        return false;
+    }
+
+    int min_capacity = topo->cores[0].capacity;
+    int max_capacity = min_capacity;
+    for (int i = 1; i < topo->num_cores; i++) {
+        min_capacity = MIN(min_capacity, topo->cores[i].capacity);
+        max_capacity = MAX(max_capacity, topo->cores[i].capacity);
+    }
+    /* Boost frequencies of preferred cores differ by a few percent */
+    topo->hybrid = max_capacity > min_capacity + min_capacity / 8;
+
+    sort_topo = topo;
+    qsort(topo->cores, topo->num_cores, sizeof(topo->cores[0]),
+          compare_cores);
+    sort_topo = NULL;
+
+    return true;
+}
+
+void cpu_topology_restrict(CpuTopology *topo, const CpuSet *allowed)
+{
+    int num_cores = 0;
+
+    topo->num_cpus = 0;
+    topo->smt = false;
+    for (int i = 0; i < CPU_SET_WORDS; i++) {
+        topo->online.bits[i] &= allowed->bits[i];
+    }
+
+    for (int i = 0; i < topo->num_cores; i++) {
+        CpuTopologyCore core = topo->cores[i];
+        for (int j = 0; j < CPU_SET_WORDS; j++) {
+            core.cpus.bits[j] &= allowed->bits[j];
+        }
+        int count = cpu_set_count(&core.cpus);
+        if (count) {
+            topo->cores[num_cores++] = core;
+            topo->num_cpus += count;
+            topo->smt |= count > 1;
+        }
+    }
+    topo->num_cores = num_cores;
+}
+
+/* The n-th logical cpu, filling the siblings of each core in order */
+static int compact_cpu(const CpuTopology *topo, int n)
+{
+    n %= topo->num_cpus;
+    for (int i = 0; i < topo->num_cores; i++) {
+        int count = cpu_set_count(&topo->cores[i].cpus);
+        if (n < count) {
+            for (int cpu = 0; cpu < CPU_TOPOLOGY_MAX_CPUS; cpu++) {
+                if (cpu_set_has(&topo->cores[i].cpus, cpu) && !n--) {
+                    return cpu;
+                }
+            }
+        }
+        n -= count;
+    }
+    return topo->cores[0].first_cpu;
+}
+
+void cpu_topology_layout(const CpuTopology *topo, ThreadPlacementPolicy policy,
+                         const int counts[THREAD_CLASS__COUNT], ThreadClass cls,
+                         int index, CpuSet *cpus)
+{
+    int position = index;
+    for (int i = 0; i < cls; i++) {
+        position += counts[i];
+    }
+
+    cpu_set_clear(cpus);
+
+    if (!topo->num_cores || policy == THREAD_PLACEMENT_OFF) {
+        *cpus = topo->online;
+        return;
+    }
+
+    if (policy == THREAD_PLACEMENT_COMPACT) {
+        cpu_set_add(cpus, compact_cpu(topo, position));
+        return;
+    }
+
+    if (position < topo->num_cores) {
+        *cpus = topo->cores[position].cpus;
+        return;
+    }
+
+    int exclusive = counts[THREAD_CLASS_VCPU] + counts[THREAD_CLASS_PFIFO] +
+                    counts[THREAD_CLASS_RENDER];
+    exclusive = MIN(exclusive, topo->num_cores - 1);
+    for (int i = exclusive; i < topo->num_cores; i++) {
+        cpu_set_union(cpus, &topo->cores[i].cpus);
+    }
+}
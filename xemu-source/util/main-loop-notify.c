@@ -0,0 +1,76 @@
+/*
+ * Coalescing of main loop wakeups
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/main-loop-notify.h"
+
+void main_loop_notify_init(MainLoopNotify *n)
+{
+    memset(n, 0, sizeof(*n));
+}
+
+void main_loop_notify_prepare(MainLoopNotify *n)
+{
+    /* Pairs with the fence in main_loop_notify() */
+    qatomic_set(&n->sleeping, true);
+    smp_mb();
+}
+
+bool main_loop_notify(MainLoopNotify *n)
+{
+    qatomic_inc(&n->stats.notifies);
+
+    /*
+     * Order the caller's update before the check. Either the loop sees the
+     * update as it prepares to sleep, or we see it sleeping and kick it.
+     */
+    smp_mb();
+    if (!qatomic_read(&n->sleeping)) {
+        qatomic_inc(&n->stats.skipped);
+        return false;
+    }
+    if (qatomic_xchg(&n->kicked, true)) {
+        qatomic_inc(&n->stats.coalesced);
+        return false;
+    }
+    qatomic_inc(&n->stats.kicks);
+    return true;
+}
+
+bool main_loop_notify_wake(MainLoopNotify *n)
+{
+    qatomic_set(&n->sleeping, false);
+    bool kicked = qatomic_xchg(&n->kicked, false);
+
+    qatomic_inc(&n->stats.wakeups);
+    if (kicked) {
+        qatomic_inc(&n->stats.kicked_wakeups);
+    }
+    return kicked;
+}
+
+void main_loop_notify_get_stats(MainLoopNotify *n, MainLoopNotifyStats *stats)
+{
+    const uint64_t *src = (const uint64_t *)&n->stats;
+    uint64_t *dst = (uint64_t *)stats;
+
+    for (size_t i = 0; i < sizeof(*stats) / sizeof(uint64_t); i++) {
+        dst[i] = qatomic_read(&src[i]);
+    }
+}
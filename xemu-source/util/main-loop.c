@@ -34,27 +34,48 @@
 #include "qemu/error-report.h"
 #include "qemu/queue.h"
 #include "qom/object.h"
+#include "qemu/main-loop-notify.h"
+#include "qemu/stats64.h"
 
 #ifdef XBOX
-/* FIXME: This is a slightly incomplete implementation of moving
- * QEMU to a dedicated glib context.
- *
- *  * Some glib functions which implicitly use the default main context
- *    (specified by NULL) are still in the code base; e.g.:
- *    - g_source_remove
- *    - g_main_loop_new (nbd)
- *  * Needs a nicer way to get the main context instead of referencing a
- *    global context pointer.
- *
+/*
+ * The main loop runs on its own glib context. Its sources must be attached
+ * to qemu_get_main_context() rather than the default context (NULL), which
+ * nothing polls.
  */
-GMainContext *qemu_main_context = NULL;
-GMainLoop *qemu_main_loop_obj = NULL;
+static GMainContext *qemu_main_context;
 
-/* *Another* main loop lock. Used for ensuring the main loop does not get a
- * chance to continue when some action is being handled on the UI interaction
- * thread that gives up the BQL but expects the main loop to not be running.
+/*
+ * Wakeups. qemu_notify_event() signals the event only if the loop may be
+ * asleep, and only once per sleep.
+ */
+static MainLoopNotify main_loop_notify_state;
+static EventNotifier main_loop_event;
+
+/*
+ * Handoff of the main AioContext to the UI thread. Some UI actions (disc
+ * changes, snapshots) poll the main AioContext themselves and must not race
+ * the main loop doing the same. Instead of the main loop holding a second
+ * lock across each iteration, the UI asks it to park at its next wakeup.
  */
-QemuMutex qemu_main_loop_lock;
+static struct {
+    QemuMutex lock;
+    QemuCond cond;
+    QemuThread thread; /* Running the main loop */
+    bool requested;
+    bool parked;
+} handoff;
+
+static __thread int handoff_depth;
+static __thread bool handoff_owner;
+
+static struct {
+    Stat64 bql_hold_ns;
+    Stat64 handoffs;
+    Stat64 handoff_wait_ns;
+    Stat64 handoff_hold_ns;
+    int64_t bql_acquired;
+} main_loop_stats;
 #endif
 
 #ifndef _WIN32
@@ -151,6 +172,7 @@ static int qemu_signal_init(Error **errp)
 #endif
 
 static AioContext *qemu_aio_context;
+#ifndef XBOX
 static QEMUBH *qemu_notify_bh;
 
 static void notify_event_cb(void *opaque)
@@ -159,39 +181,151 @@ static void notify_event_cb(void *opaque)
      * kick the kernel out of ppoll/poll/WaitForMultipleObjects.
      */
 }
+#endif
 
 AioContext *qemu_get_aio_context(void)
 {
     return qemu_aio_context;
 }
 
+#ifdef XBOX
+GMainContext *qemu_get_main_context(void)
+{
+    return qemu_main_context;
+}
+
+bool qemu_main_context_source_remove(guint tag)
+{
+    GSource *source = g_main_context_find_source_by_id(qemu_main_context, tag);
+
+    if (!source) {
+        return false;
+    }
+    g_source_destroy(source);
+    return true;
+}
+
+static void main_loop_event_cb(EventNotifier *e)
+{
+    event_notifier_test_and_clear(e);
+}
+
 void qemu_notify_event(void)
 {
     if (!qemu_aio_context) {
         return;
     }
-    qemu_bh_schedule(qemu_notify_bh);
+    if (main_loop_notify(&main_loop_notify_state)) {
+        event_notifier_set(&main_loop_event);
+    }
 }
 
-static GArray *gpollfds;
+/* Called by the main loop just before it drops the BQL to poll */
+static void main_loop_enter_poll(void)
+{
+    if (main_loop_stats.bql_acquired) {
+        stat64_add(&main_loop_stats.bql_hold_ns,
+                   get_clock() - main_loop_stats.bql_acquired);
+    }
+}
 
-#ifdef XBOX
-void qemu_init_main_loop_lock(void)
+/* Called on return from poll, before the BQL is taken again */
+static void main_loop_leave_poll(void)
+{
+    main_loop_notify_wake(&main_loop_notify_state);
+
+    if (qatomic_read(&handoff.requested)) {
+        int64_t start = get_clock();
+
+        qemu_mutex_lock(&handoff.lock);
+        handoff.parked = true;
+        qemu_cond_broadcast(&handoff.cond);
+        while (handoff.requested) {
+            qemu_cond_wait(&handoff.cond, &handoff.lock);
+        }
+        handoff.parked = false;
+        qemu_mutex_unlock(&handoff.lock);
+
+        stat64_add(&main_loop_stats.handoff_hold_ns, get_clock() - start);
+    }
+}
+
+static void main_loop_bql_acquired(void)
+{
+    main_loop_stats.bql_acquired = get_clock();
+}
+
+void qemu_main_loop_handoff_begin(void)
+{
+    assert(bql_locked());
+
+    if (handoff_depth++ || !qemu_aio_context ||
+        qemu_thread_is_self(&handoff.thread)) {
+        return;
+    }
+
+    int64_t start = get_clock();
+
+    qemu_mutex_lock(&handoff.lock);
+    qatomic_set(&handoff.requested, true);
+    event_notifier_set(&main_loop_event);
+    bql_unlock();
+    while (!handoff.parked) {
+        qemu_cond_wait(&handoff.cond, &handoff.lock);
+    }
+    qemu_mutex_unlock(&handoff.lock);
+    bql_lock();
+
+    handoff_owner = true;
+    stat64_add(&main_loop_stats.handoffs, 1);
+    stat64_add(&main_loop_stats.handoff_wait_ns, get_clock() - start);
+}
+
+void qemu_main_loop_handoff_end(void)
+{
+    assert(handoff_depth > 0);
+
+    if (--handoff_depth || !handoff_owner) {
+        return;
+    }
+    handoff_owner = false;
+
+    qemu_mutex_lock(&handoff.lock);
+    qatomic_set(&handoff.requested, false);
+    qemu_cond_broadcast(&handoff.cond);
+    qemu_mutex_unlock(&handoff.lock);
+}
+
+void qemu_main_loop_get_stats(MainLoopStats *stats)
+{
+    main_loop_notify_get_stats(&main_loop_notify_state, &stats->notify);
+    stats->bql_hold_ns = stat64_get(&main_loop_stats.bql_hold_ns);
+    stats->handoffs = stat64_get(&main_loop_stats.handoffs);
+    stats->handoff_wait_ns = stat64_get(&main_loop_stats.handoff_wait_ns);
+    stats->handoff_hold_ns = stat64_get(&main_loop_stats.handoff_hold_ns);
+}
+#else
+GMainContext *qemu_get_main_context(void)
 {
-    qemu_mutex_init(&qemu_main_loop_lock);
+    return g_main_context_default();
 }
 
-void qemu_mutex_lock_main_loop(void)
+bool qemu_main_context_source_remove(guint tag)
 {
-    qemu_mutex_lock(&qemu_main_loop_lock);
+    return g_source_remove(tag);
 }
 
-void qemu_mutex_unlock_main_loop(void)
+void qemu_notify_event(void)
 {
-    qemu_mutex_unlock(&qemu_main_loop_lock);
+    if (!qemu_aio_context) {
+        return;
+    }
+    qemu_bh_schedule(qemu_notify_bh);
 }
 #endif
 
+static GArray *gpollfds;
+
 int qemu_init_main_loop(Error **errp)
 {
     int ret;
@@ -201,7 +335,10 @@ int qemu_init_main_loop(Error **errp)
     qemu_main_context = g_main_context_new();
     assert(qemu_main_context != NULL);
     g_main_context_push_thread_default(qemu_main_context);
-    qemu_main_loop_obj = g_main_loop_new(qemu_main_context, FALSE);
+
+    qemu_mutex_init(&handoff.lock);
+    qemu_cond_init(&handoff.cond);
+    qemu_thread_get_self(&handoff.thread);
 #endif
 
     init_clocks(qemu_timer_notify_cb);
@@ -216,7 +353,18 @@ int qemu_init_main_loop(Error **errp)
         return -EMFILE;
     }
     qemu_set_current_aio_context(qemu_aio_context);
+#ifdef XBOX
+    main_loop_notify_init(&main_loop_notify_state);
+    ret = event_notifier_init(&main_loop_event, false);
+    if (ret) {
+        error_setg_errno(errp, -ret, "Failed to initialize main loop event");
+        return ret;
+    }
+    aio_set_event_notifier(qemu_aio_context, &main_loop_event,
+                           main_loop_event_cb, NULL, NULL);
+#else
     qemu_notify_bh = qemu_bh_new(notify_event_cb, NULL);
+#endif
     gpollfds = g_array_new(FALSE, FALSE, sizeof(GPollFD));
     src = aio_get_g_source(qemu_aio_context);
     g_source_set_name(src, "aio-context");
@@ -305,11 +453,7 @@ static int glib_n_poll_fds;
 
 static void glib_pollfds_fill(int64_t *cur_timeout)
 {
-#ifdef XBOX
-    GMainContext *context = g_main_context_get_thread_default();
-#else
-    GMainContext *context = g_main_context_default();
-#endif
+    GMainContext *context = qemu_get_main_context();
     int timeout = 0;
     int64_t timeout_ns;
     int n;
@@ -338,11 +482,7 @@ static void glib_pollfds_fill(int64_t *cur_timeout)
 
 static void glib_pollfds_poll(void)
 {
-#ifdef XBOX
-    GMainContext *context = g_main_context_get_thread_default();
-#else
-    GMainContext *context = g_main_context_default();
-#endif
+    GMainContext *context = qemu_get_main_context();
     GPollFD *pfds = &g_array_index(gpollfds, GPollFD, glib_pollfds_idx);
 
     if (g_main_context_check(context, max_priority, pfds, glib_n_poll_fds)) {
@@ -354,30 +494,32 @@ static void glib_pollfds_poll(void)
 
 static int os_host_main_loop_wait(int64_t timeout)
 {
-#ifdef XBOX
-    GMainContext *context = g_main_context_get_thread_default();
-#else
-    GMainContext *context = g_main_context_default();
-#endif
+    GMainContext *context = qemu_get_main_context();
     int ret;
 
     g_main_context_acquire(context);
 
     glib_pollfds_fill(&timeout);
 
+#ifdef XBOX
+    main_loop_enter_poll();
+#endif
     bql_unlock();
     replay_mutex_unlock();
 
 #ifdef XBOX
-    qemu_mutex_unlock_main_loop();
-#endif
+    ret = qemu_poll_deadline_ns((GPollFD *)gpollfds->data, gpollfds->len,
+                                timeout);
+    main_loop_leave_poll();
+#else
     ret = qemu_poll_ns((GPollFD *)gpollfds->data, gpollfds->len, timeout);
-#ifdef XBOX
-    qemu_mutex_lock_main_loop();
 #endif
 
     replay_mutex_lock();
     bql_lock();
+#ifdef XBOX
+    main_loop_bql_acquired();
+#endif
 
     glib_pollfds_poll();
 
@@ -530,11 +672,7 @@ static void pollfds_poll(GArray *pollfds, int nfds, fd_set *rfds,
 
 static int os_host_main_loop_wait(int64_t timeout)
 {
-#ifdef XBOX
-    GMainContext *context = g_main_context_get_thread_default();
-#else
-    GMainContext *context = g_main_context_default();
-#endif
+    GMainContext *context = qemu_get_main_context();
     GPollFD poll_fds[1024 * 2]; /* this is probably overkill */
     int select_ret = 0;
     int g_poll_ret, ret, i, n_poll_fds;
@@ -580,21 +718,27 @@ static int os_host_main_loop_wait(int64_t timeout)
 
     poll_timeout_ns = qemu_soonest_timeout(poll_timeout_ns, timeout);
 
+#ifdef XBOX
+    main_loop_enter_poll();
+#endif
     bql_unlock();
 
     replay_mutex_unlock();
 
 #ifdef XBOX
-    qemu_mutex_unlock_main_loop();
-#endif
+    g_poll_ret = qemu_poll_deadline_ns(poll_fds, n_poll_fds + w->num,
+                                       poll_timeout_ns);
+    main_loop_leave_poll();
+#else
     g_poll_ret = qemu_poll_ns(poll_fds, n_poll_fds + w->num, poll_timeout_ns);
-#ifdef XBOX
-    qemu_mutex_lock_main_loop();
 #endif
 
     replay_mutex_lock();
 
     bql_lock();
+#ifdef XBOX
+    main_loop_bql_acquired();
+#endif
     if (g_poll_ret > 0) {
         for (i = 0; i < w->num; i++) {
             w->revents[i] = poll_fds[n_poll_fds + i].revents;
@@ -639,6 +783,13 @@ void main_loop_poll_remove_notifier(Notifier *notify)
     notifier_remove(notify);
 }
 
+void main_loop_prepare_wait(void)
+{
+#ifdef XBOX
+    main_loop_notify_prepare(&main_loop_notify_state);
+#endif
+}
+
 void main_loop_wait(int nonblocking)
 {
     MainLoopPoll mlpoll = {
@@ -653,6 +804,9 @@ void main_loop_wait(int nonblocking)
         mlpoll.timeout = 0;
     }
 
+    /* From here on, changes to timers or fds must wake us */
+    main_loop_prepare_wait();
+
     /* poll any events */
     g_array_set_size(gpollfds, 0); /* reset for new iteration */
     /* XXX: separate device handlers from system ones */
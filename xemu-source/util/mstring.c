@@ -0,0 +1,95 @@
+/*
+ * Recycling allocator for MString
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/mstring.h"
+
+/* Maximum number of idle strings kept per thread */
+#define MSTRING_POOL_SIZE 64
+
+/* Strings that grew beyond this are freed rather than recycled */
+#define MSTRING_POOL_MAX_CAPACITY (64 * 1024)
+
+/* Initial capacity of newly allocated strings */
+#define MSTRING_DEFAULT_CAPACITY 256
+
+typedef struct MStringPool {
+    unsigned int count;
+    MString *entries[MSTRING_POOL_SIZE];
+} MStringPool;
+
+static void mstring_pool_free(gpointer data)
+{
+    MStringPool *pool = data;
+
+    for (unsigned int i = 0; i < pool->count; i++) {
+        g_string_free(pool->entries[i]->gstr, true);
+        g_free(pool->entries[i]);
+    }
+    g_free(pool);
+}
+
+static GPrivate mstring_pool_key = G_PRIVATE_INIT(mstring_pool_free);
+
+static MStringPool *mstring_get_pool(void)
+{
+    MStringPool *pool = g_private_get(&mstring_pool_key);
+
+    if (!pool) {
+        pool = g_new0(MStringPool, 1);
+        g_private_set(&mstring_pool_key, pool);
+    }
+
+    return pool;
+}
+
+MString *mstring_new_sized(size_t reserve)
+{
+    MStringPool *pool = mstring_get_pool();
+    MString *mstr;
+
+    if (pool->count > 0) {
+        mstr = pool->entries[--pool->count];
+        if (mstr->gstr->allocated_len <= reserve) {
+            g_string_set_size(mstr->gstr, reserve);
+        }
+        g_string_truncate(mstr->gstr, 0);
+    } else {
+        mstr = g_new(MString, 1);
+        mstr->gstr =
+            g_string_sized_new(MAX(reserve + 1, MSTRING_DEFAULT_CAPACITY));
+    }
+
+    mstr->refcnt = 1;
+    return mstr;
+}
+
+void mstring_release(MString *mstr)
+{
+    MStringPool *pool = mstring_get_pool();
+
+    if (pool->count < MSTRING_POOL_SIZE &&
+        mstr->gstr->allocated_len <= MSTRING_POOL_MAX_CAPACITY) {
+        pool->entries[pool->count++] = mstr;
+        return;
+    }
+
+    g_string_free(mstr->gstr, true);
+    g_free(mstr);
+}
@@ -0,0 +1,114 @@
+/*
+ * Precise deadline waits
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/precise-wait.h"
+
+void precise_wait_init(PreciseWait *w, int64_t min_margin_ns,
+                       int64_t max_margin_ns, PreciseWaitStats *stats)
+{
+    memset(w, 0, sizeof(*w));
+    w->min_margin_ns = min_margin_ns;
+    w->max_margin_ns = max_margin_ns;
+    w->margin_ns = (min_margin_ns + max_margin_ns) / 2;
+    w->late_avg_ns = w->margin_ns;
+    w->stats = stats;
+}
+
+int precise_wait_hist_bucket(int64_t late_ns)
+{
+    int64_t late_us = late_ns / 1000;
+    int bucket = 0;
+
+    while (late_us > 0 && bucket < PRECISE_WAIT_HIST_BUCKETS - 1) {
+        late_us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/*
+ * Keep the margin at the smoothed lateness of sleeps plus a few deviations,
+ * as in TCP retransmit timeout estimation.
+ */
+static void precise_wait_calibrate(PreciseWait *w, int64_t late_ns)
+{
+    int64_t err = MAX(late_ns, 0) - w->late_avg_ns;
+
+    w->late_avg_ns += err / 8;
+    w->late_dev_ns += (ABS(err) - w->late_dev_ns) / 4;
+    w->margin_ns = MIN(MAX(w->late_avg_ns + 4 * w->late_dev_ns,
+                           w->min_margin_ns), w->max_margin_ns);
+}
+
+int precise_wait_until(PreciseWait *w, int64_t deadline,
+                       PreciseWaitClockFunc clock, PreciseWaitSleepFunc sleep,
+                       void *opaque)
+{
+    PreciseWaitStats *stats = w->stats;
+    int64_t now = clock();
+    int64_t start = now;
+
+    while (deadline - now > w->margin_ns) {
+        int64_t target = deadline - w->margin_ns;
+        int ret = sleep(opaque, target - now);
+        now = clock();
+
+        if (ret) {
+            if (stats) {
+                qatomic_inc(&stats->interrupted);
+                qatomic_add(&stats->sleep_ns, now - start);
+            }
+            return ret;
+        }
+
+        /* Sleeps may also end early, e.g. on hosts with coarse timeouts */
+        if (now >= target) {
+            precise_wait_calibrate(w, now - target);
+        }
+    }
+
+    int64_t spin_start = now;
+    while (now < deadline) {
+        now = clock();
+    }
+
+    if (stats) {
+        int bucket = precise_wait_hist_bucket(now - deadline);
+        qatomic_inc(&stats->waits);
+        qatomic_add(&stats->sleep_ns, spin_start - start);
+        qatomic_add(&stats->spin_ns, now - spin_start);
+        qatomic_inc(&stats->late_hist[bucket]);
+    }
+
+    return 0;
+}
+
+void precise_wait_stats_read(PreciseWaitStats *dst,
+                             const PreciseWaitStats *src)
+{
+    dst->waits = qatomic_read(&src->waits);
+    dst->interrupted = qatomic_read(&src->interrupted);
+    dst->sleep_ns = qatomic_read(&src->sleep_ns);
+    dst->spin_ns = qatomic_read(&src->spin_ns);
+    for (int i = 0; i < PRECISE_WAIT_HIST_BUCKETS; i++) {
+        dst->late_hist[i] = qatomic_read(&src->late_hist[i]);
+    }
+}
@@ -319,12 +319,9 @@ int qemu_timeout_ns_to_ms(int64_t ns)
 }
 
 
-/* qemu implementation of g_poll which uses a nanosecond timeout but is
- * otherwise identical to g_poll
- */
-int qemu_poll_ns(GPollFD *fds, guint nfds, int64_t timeout)
-{
 #ifdef CONFIG_PPOLL
+static int qemu_ppoll_ns(GPollFD *fds, guint nfds, int64_t timeout)
+{
     if (timeout < 0) {
         return ppoll((struct pollfd *)fds, nfds, NULL, NULL);
     } else {
@@ -340,23 +337,123 @@ int qemu_poll_ns(GPollFD *fds, guint nfds, int64_t timeout)
         ts.tv_nsec = timeout % 1000000000LL;
         return ppoll((struct pollfd *)fds, nfds, &ts, NULL);
     }
-#else
+}
+#endif
 
 #ifdef XBOX
-    /* Timers are facilitated by this function. Busy-wait if the deadline is
-     * near, to avoid missing deadlines due to costly sleeps.
-     */
-    #define XBOX_BUSYWAIT_THRESHOLD_NS 1250000
-    if ((0 < timeout) && (timeout < XBOX_BUSYWAIT_THRESHOLD_NS)) {
-        int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
-        int64_t end = now + timeout;
-        while (now < end) {
-            now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+/* Guest timers are run by the main loop. Games keep them armed less than a
+ * millisecond apart, so the main loop waits for its deadline precisely:
+ * sleep until shortly before it, then spin for the last microseconds.
+ * Other pollers keep the plain qemu_poll_ns() timeout.
+ */
+#define XBOX_WAIT_MIN_MARGIN_NS 1000
+#define XBOX_WAIT_MAX_MARGIN_NS 100000
+
+typedef struct QemuPollWaitArgs {
+    GPollFD *fds;
+    guint nfds;
+} QemuPollWaitArgs;
+
+static PreciseWaitStats qemu_poll_wait_stats;
+static PreciseWait qemu_poll_wait;
+static bool qemu_poll_wait_initialized;
+
+#if !defined(CONFIG_PPOLL) && defined(_WIN32)
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+static HANDLE qemu_poll_wait_timer;
+
+static void qemu_poll_wait_sleep_ns(int64_t ns)
+{
+    if (!qemu_poll_wait_timer) {
+        qemu_poll_wait_timer = CreateWaitableTimerExW(
+            NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+            TIMER_ALL_ACCESS);
+        if (!qemu_poll_wait_timer) {
+            qemu_poll_wait_timer = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    /* Not available before Windows 10 1803, spin instead */
+    if (qemu_poll_wait_timer == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    /* Negative for a relative time, in 100 ns units */
+    LARGE_INTEGER due = { .QuadPart = -MAX(ns / 100, 1) };
+    if (SetWaitableTimer(qemu_poll_wait_timer, &due, 0, NULL, NULL, FALSE)) {
+        WaitForSingleObject(qemu_poll_wait_timer, INFINITE);
+    }
+}
+#elif !defined(CONFIG_PPOLL)
+static void qemu_poll_wait_sleep_ns(int64_t ns)
+{
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = ns };
+    nanosleep(&ts, NULL);
+}
+#endif
+
+static int qemu_poll_wait_sleep(void *opaque, int64_t timeout)
+{
+    QemuPollWaitArgs *args = opaque;
+
+#ifdef CONFIG_PPOLL
+    return qemu_ppoll_ns(args->fds, args->nfds, timeout);
+#else
+    if (timeout >= SCALE_MS) {
+        /* Round down, the remainder is slept below */
+        return g_poll(args->fds, args->nfds, timeout / SCALE_MS);
+    }
+
+    /* Sub-millisecond sleeps can't watch the fds, check them beforehand */
+    int ret = g_poll(args->fds, args->nfds, 0);
+    if (!ret) {
+        qemu_poll_wait_sleep_ns(timeout);
+    }
+    return ret;
+#endif
+}
+
+void qemu_poll_get_wait_stats(PreciseWaitStats *stats)
+{
+    precise_wait_stats_read(stats, &qemu_poll_wait_stats);
+}
+
+int qemu_poll_deadline_ns(GPollFD *fds, guint nfds, int64_t timeout)
+{
+    if (timeout > 0) {
+        QemuPollWaitArgs args = { fds, nfds };
+
+        if (!qemu_poll_wait_initialized) {
+            precise_wait_init(&qemu_poll_wait, XBOX_WAIT_MIN_MARGIN_NS,
+                              XBOX_WAIT_MAX_MARGIN_NS, &qemu_poll_wait_stats);
+            qemu_poll_wait_initialized = true;
+        }
+
+        int ret = precise_wait_until(&qemu_poll_wait, get_clock() + timeout,
+                                     get_clock, qemu_poll_wait_sleep, &args);
+        if (ret) {
+            return ret;
         }
+
+        /* Pick up events that arrived while spinning */
         timeout = 0;
     }
+
+    return qemu_poll_ns(fds, nfds, timeout);
+}
 #endif
 
+/* qemu implementation of g_poll which uses a nanosecond timeout but is
+ * otherwise identical to g_poll
+ */
+int qemu_poll_ns(GPollFD *fds, guint nfds, int64_t timeout)
+{
+#ifdef CONFIG_PPOLL
+    return qemu_ppoll_ns(fds, nfds, timeout);
+#else
     return g_poll(fds, nfds, qemu_timeout_ns_to_ms(timeout));
 #endif
 }
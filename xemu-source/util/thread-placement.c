@@ -0,0 +1,329 @@
+/*
+ * Placement of emulator threads on host cores
+ *
+ * Copyright (c) 2025 Matt Borgerson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/thread.h"
+#include "qemu/error-report.h"
+#include "qemu/thread-placement.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+#define MAX_THREADS 64
+
+typedef struct ThreadPlacementEntry {
+    bool active;
+    ThreadClass cls;
+    int index;
+    QemuThread thread;
+    int tid;
+    CpuSet initial; /* Affinity as started, restored when unpinned */
+    CpuSet cpus;    /* Current pinning, empty if none */
+    bool sched_set;
+    bool warned;
+    int error;
+} ThreadPlacementEntry;
+
+static struct {
+    QemuMutex lock;
+    bool initialized;
+    bool topo_valid;
+    CpuTopology topo;
+    ThreadPlacementConfig config;
+    int vcpu_affinity_core;
+    ThreadPlacementEntry threads[MAX_THREADS];
+} placement;
+
+static __thread ThreadPlacementEntry *current_entry;
+
+static void __attribute__((__constructor__)) thread_placement_early_init(void)
+{
+    qemu_mutex_init(&placement.lock);
+
+    const char *env = getenv("XEMU_VCPU_AFFINITY");
+    placement.vcpu_affinity_core = env ? atoi(env) : -1;
+}
+
+static void get_affinity(QemuThread *thread, CpuSet *set)
+{
+    unsigned long *bits;
+    unsigned long nbits;
+
+    cpu_set_clear(set);
+    if (qemu_thread_get_affinity(thread, &bits, &nbits)) {
+        return;
+    }
+    for (unsigned long cpu = 0; cpu < MIN(nbits, CPU_TOPOLOGY_MAX_CPUS);
+         cpu++) {
+        if (bits[cpu / CPU_SET_BITS_PER_WORD] &
+            (1UL << (cpu % CPU_SET_BITS_PER_WORD))) {
+            cpu_set_add(set, cpu);
+        }
+    }
+    g_free(bits);
+}
+
+static void report_error(ThreadPlacementEntry *e, const char *what, int err)
+{
+    e->error = err;
+    if (!e->warned) {
+        e->warned = true;
+        warn_report("Failed to set %s of %s thread %d: %s", what,
+                    thread_class_names[e->cls], e->index, strerror(err));
+    }
+}
+
+static void apply_sched(ThreadPlacementEntry *e)
+{
+    const ThreadClassConfig *c = &placement.config.classes[e->cls];
+
+    /* Leave threads alone unless they were configured */
+    if (c->sched == THREAD_SCHED_DEFAULT && !c->priority && !e->sched_set) {
+        return;
+    }
+    e->sched_set = true;
+
+#ifdef __linux__
+    static const int policies[THREAD_SCHED__COUNT] = {
+        [THREAD_SCHED_DEFAULT] = SCHED_OTHER,
+        [THREAD_SCHED_BATCH] = SCHED_BATCH,
+        [THREAD_SCHED_IDLE] = SCHED_IDLE,
+        [THREAD_SCHED_FIFO] = SCHED_FIFO,
+        [THREAD_SCHED_RR] = SCHED_RR,
+    };
+    int policy = policies[c->sched];
+    struct sched_param param = { 0 };
+    bool realtime = policy == SCHED_FIFO || policy == SCHED_RR;
+
+    if (realtime) {
+        param.sched_priority = MIN(MAX(c->priority, 1), 99);
+    }
+    int err = pthread_setschedparam(e->thread.thread, policy, &param);
+    if (err) {
+        report_error(e, "scheduling policy", err);
+        return;
+    }
+    if (!realtime && policy != SCHED_IDLE &&
+        setpriority(PRIO_PROCESS, e->tid, MIN(MAX(c->priority, -20), 19))) {
+        report_error(e, "priority", errno);
+    }
+#else
+    report_error(e, "scheduling policy", ENOSYS);
+#endif
+}
+
+static void apply_affinity(ThreadPlacementEntry *e, const CpuSet *cpus)
+{
+    const CpuSet *target = cpu_set_count(cpus) ? cpus : &e->initial;
+
+    /* Threads that were never pinned keep their affinity */
+    if (!cpu_set_count(cpus) && !cpu_set_count(&e->cpus)) {
+        return;
+    }
+    if (cpu_set_equal(cpus, &e->cpus) || !cpu_set_count(target)) {
+        return;
+    }
+
+    int err = qemu_thread_set_affinity(&e->thread, (unsigned long *)target->bits,
+                                       CPU_TOPOLOGY_MAX_CPUS);
+    if (err) {
+        report_error(e, "affinity", abs(err));
+        return;
+    }
+    e->cpus = *cpus;
+    e->error = 0;
+}
+
+static void get_counts(int counts[THREAD_CLASS__COUNT])
+{
+    memset(counts, 0, THREAD_CLASS__COUNT * sizeof(int));
+    for (int i = 0; i < MAX_THREADS; i++) {
+        ThreadPlacementEntry *e = &placement.threads[i];
+        if (e->active) {
+            counts[e->cls] = MAX(counts[e->cls], e->index + 1);
+        }
+    }
+}
+
+/* Called with the lock held whenever threads or the policy change */
+static void update_layout(void)
+{
+    int counts[THREAD_CLASS__COUNT];
+
+    if (!placement.initialized) {
+        return;
+    }
+
+    get_counts(counts);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        ThreadPlacementEntry *e = &placement.threads[i];
+        CpuSet cpus;
+
+        if (!e->active) {
+            continue;
+        }
+
+        if (e->cls == THREAD_CLASS_VCPU && placement.vcpu_affinity_core >= 0) {
+            cpu_set_clear(&cpus);
+            cpu_set_add(&cpus, placement.vcpu_affinity_core);
+        } else if (placement.topo_valid &&
+                   placement.config.policy != THREAD_PLACEMENT_OFF) {
+            cpu_topology_layout(&placement.topo, placement.config.policy,
+                                counts, e->cls, e->index, &cpus);
+        } else {
+            cpu_set_clear(&cpus);
+        }
+        apply_affinity(e, &cpus);
+    }
+}
+
+void thread_placement_init(const ThreadPlacementConfig *config)
+{
+    QemuThread self;
+    CpuSet allowed;
+
+    qemu_thread_get_self(&self);
+    get_affinity(&self, &allowed);
+
+    qemu_mutex_lock(&placement.lock);
+    placement.config = *config;
+    placement.topo_valid =
+        cpu_topology_read(&placement.topo, "/sys/devices/system/cpu");
+    if (placement.topo_valid && cpu_set_count(&allowed)) {
+        cpu_topology_restrict(&placement.topo, &allowed);
+        placement.topo_valid = placement.topo.num_cores > 0;
+    }
+    placement.initialized = true;
+
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (placement.threads[i].active) {
+            apply_sched(&placement.threads[i]);
+        }
+    }
+    update_layout();
+    qemu_mutex_unlock(&placement.lock);
+
+    if (placement.vcpu_affinity_core >= 0) {
+        fprintf(stderr, "xemu: vCPU affinity set to core %d\n",
+                placement.vcpu_affinity_core);
+    }
+}
+
+void thread_placement_set_policy(ThreadPlacementPolicy policy)
+{
+    qemu_mutex_lock(&placement.lock);
+    placement.config.policy = policy;
+    update_layout();
+    qemu_mutex_unlock(&placement.lock);
+}
+
+ThreadPlacementPolicy thread_placement_get_policy(void)
+{
+    qemu_mutex_lock(&placement.lock);
+    ThreadPlacementPolicy policy = placement.config.policy;
+    qemu_mutex_unlock(&placement.lock);
+    return policy;
+}
+
+void thread_placement_enter(ThreadClass cls, int index)
+{
+    ThreadPlacementEntry *e = NULL;
+
+    assert(!current_entry);
+
+    qemu_mutex_lock(&placement.lock);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (!placement.threads[i].active) {
+            e = &placement.threads[i];
+            break;
+        }
+    }
+    if (!e) {
+        /* Left to the scheduler */
+        qemu_mutex_unlock(&placement.lock);
+        return;
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->active = true;
+    e->cls = cls;
+    e->index = index;
+    e->tid = qemu_get_thread_id();
+    qemu_thread_get_self(&e->thread);
+    get_affinity(&e->thread, &e->initial);
+    current_entry = e;
+
+    if (placement.initialized) {
+        apply_sched(e);
+    }
+    update_layout();
+    qemu_mutex_unlock(&placement.lock);
+}
+
+void thread_placement_leave(void)
+{
+    if (!current_entry) {
+        return;
+    }
+
+    qemu_mutex_lock(&placement.lock);
+    current_entry->active = false;
+    current_entry = NULL;
+    update_layout();
+    qemu_mutex_unlock(&placement.lock);
+}
+
+const CpuTopology *thread_placement_get_topology(void)
+{
+    return placement.topo_valid ? &placement.topo : NULL;
+}
+
+static int compare_info(const void *pa, const void *pb)
+{
+    const ThreadPlacementInfo *a = pa, *b = pb;
+    if (a->cls != b->cls) {
+        return a->cls - b->cls;
+    }
+    return a->index - b->index;
+}
+
+int thread_placement_get_layout(ThreadPlacementInfo *info, int max)
+{
+    int count = 0;
+
+    qemu_mutex_lock(&placement.lock);
+    for (int i = 0; i < MAX_THREADS && count < max; i++) {
+        ThreadPlacementEntry *e = &placement.threads[i];
+        if (e->active) {
+            info[count++] = (ThreadPlacementInfo){
+                .cls = e->cls,
+                .index = e->index,
+                .tid = e->tid,
+                .cpus = e->cpus,
+                .error = e->error,
+            };
+        }
+    }
+    qemu_mutex_unlock(&placement.lock);
+
+    qsort(info, count, sizeof(*info), compare_info);
+    return count;
+}
@@ -26,6 +26,7 @@
 #include "hw/pci/pci.h"
 #include "sysemu/hw_accel.h"
 #include "cpu.h"
+#include "qemu/main-loop.h"
 
 static int virt_to_phys(vaddr vaddr, hwaddr *phys_addr)
 {
@@ -84,6 +85,9 @@ struct xbe *xemu_get_xbe_info(void)
 
     static struct xbe xbe = {0};
 
+    /* The UI asks while laying out its frame */
+    BQL_LOCK_GUARD();
+
     if (xbe.headers) {
         free(xbe.headers);
         xbe.headers = NULL;